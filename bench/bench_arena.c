@@ -0,0 +1,149 @@
+/* Allocator benchmark for image decoding.
+ *
+ * Decodes a big asset set (the real assets plus the generated corpus at several sizes) a few times over, three ways:
+ * plain stbi_load_from_memory() + free, stbi_load_from_memory_into() a reused buffer with the decoder's scratch on
+ * the heap, and hz_stbi_load_from_memory_into() with the scratch in the per-thread arena. We report total time,
+ * malloc()/realloc() calls per decode and how many bytes the decoder asked for, and check all three produce the same
+ * pixels.
+ *
+ *   bench_arena [--passes=N] [--cpu=N] [FILE...]
+ */
+#include "holyh/src/holy.h"
+#include "hz_stbi.h"
+#include "stb_image.h"
+#include "bench_corpus.h"
+
+#define BENCH_MAX_IMAGES 512
+
+enum { MODE_LOAD, MODE_INTO_HEAP, MODE_INTO_ARENA, MODE_COUNT };
+
+static const CHR *mode_names[MODE_COUNT] = { "stbi_load + free", "stbi_load_into, heap", "hz_stbi_load_into, arena" };
+
+/* Decodes `img` to RGBA in `out` (`size` bytes), returns false if it doesn't decode */
+static U1 decode(INAT mode, const struct benchimage *img, U8 *out, size_t size)
+{
+	INAT w, h, comp;
+	if (mode == MODE_LOAD) {
+		U8 *pixels = stbi_load_from_memory(img->data, img->len, &w, &h, &comp, 4);
+		if (!pixels) return false;
+		memcpy(out, pixels, (size_t)w * h * 4);
+		stbi_image_free(pixels);
+		return true;
+	}
+	if (mode == MODE_INTO_HEAP) return stbi_load_from_memory_into(img->data, img->len, out, size, 0, &w, &h, &comp, 4);
+	return hz_stbi_load_from_memory_into(img->data, img->len, out, size, 0, &w, &h, &comp, 4);
+}
+
+INAT main(INAT argc, CHR *argv[])
+{
+	static struct benchimage images[BENCH_MAX_IMAGES];
+	static const INAT sizes[] = { 96, 256, 640, 1024 };
+	INAT passes = 5, cpu = -2, nimages = 0;
+
+	for (INAT i = 1; i < argc; i++) {
+		const CHR *v;
+		if ((v = bench_arg_value(argv[i], "--passes"))) passes = atoi(v);
+		else if ((v = bench_arg_value(argv[i], "--cpu"))) cpu = atoi(v);
+		else if (nimages < BENCH_MAX_IMAGES && bench_load_file(&images[nimages], argv[i])) nimages++;
+		else fprintf(stderr, "bench: unable to load %s, skipping it\n", argv[i]);
+	}
+	if (passes < 1) passes = 1;
+	/* This is about the allocator, keep threaded decoding out of it (and the same for every mode) */
+	hz_stbi_set_threads(1);
+
+	cpu = bench_pin_cpu(cpu);
+
+	if (nimages < BENCH_MAX_IMAGES && bench_load_file(&images[nimages], "assets/puckface.png")) nimages++;
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		if (nimages + 32 > BENCH_MAX_IMAGES) break;
+		INAT n = bench_corpus_generate(images + nimages, sizes[i]);
+		for (INAT j = 0; j < n; j++) {
+			CHR *name = images[nimages + j].name;
+			size_t len = strlen(name);
+			snprintf(name + len, sizeof(images[0].name) - len, "@%d", sizes[i]);
+		}
+		nimages += n;
+	}
+
+	/* Drop anything stb_image can't decode, and size the output buffer for the biggest image */
+	size_t out_size = 0, compressed = 0;
+	INAT kept = 0;
+	for (INAT i = 0; i < nimages; i++) {
+		INAT w, h, comp;
+		if (!stbi_info_from_memory(images[i].data, images[i].len, &w, &h, &comp)) {
+			fprintf(stderr, "bench: %s doesn't decode: %s\n", images[i].name, stbi_failure_reason());
+			free(images[i].data);
+			continue;
+		}
+		if ((size_t)w * h * 4 > out_size) out_size = (size_t)w * h * 4;
+		compressed += images[i].len;
+		images[kept++] = images[i];
+	}
+	nimages = kept;
+
+	U8 *out = malloc(out_size), *expected = malloc(out_size);
+	if (!out || !expected) {
+		fprintf(stderr, "bench: out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("%d images (%.1f MiB compressed), %d passes, pinned to CPU %d, output converted to RGBA8\n\n", nimages,
+		compressed / (1024.0 * 1024.0), passes, cpu);
+	printf("%-26s %10s %10s %14s %14s %12s\n", "", "total ms", "ms/decode", "mallocs/decode", "MiB requested",
+		"peak MiB");
+
+	R64 times[MODE_COUNT];
+	INAT failed = 0;
+	for (INAT mode = 0; mode < MODE_COUNT; mode++) {
+		/* One untimed pass, so every mode starts with a warm heap (and the arena has grown to size) */
+		for (INAT i = 0; i < nimages; i++) decode(mode, &images[i], out, out_size);
+
+		struct hzarenastats before, after;
+		hz_stbi_stats(NULL, &before);
+		R64 start = bench_now_ms();
+		for (INAT p = 0; p < passes; p++) {
+			for (INAT i = 0; i < nimages; i++) {
+				if (!decode(mode, &images[i], out, out_size)) failed++;
+			}
+		}
+		times[mode] = bench_now_ms() - start;
+		hz_stbi_stats(NULL, &after);
+
+		U64 decodes = (U64)passes * nimages;
+		CHR peak[32] = "-";
+		if (mode == MODE_INTO_ARENA) snprintf(peak, sizeof(peak), "%.1f", after.peak / (1024.0 * 1024.0));
+		printf("%-26s %10.1f %10.3f %14.2f %14.1f %12s\n", mode_names[mode], times[mode], times[mode] / decodes,
+			(R64)(after.heap_allocs - before.heap_allocs) / decodes,
+			(after.bytes - before.bytes) / (1024.0 * 1024.0), peak);
+	}
+
+	/* Per-image breakdown for the arena, and a check that every mode decodes to the same pixels */
+	printf("\n%-28s %8s %14s %12s %10s\n", "image", "allocs", "grown in place", "peak KiB", "output");
+	INAT mismatches = 0;
+	for (INAT i = 0; i < nimages; i++) {
+		INAT w, h, comp;
+		stbi_info_from_memory(images[i].data, images[i].len, &w, &h, &comp);
+		size_t size = (size_t)w * h * 4;
+
+		U1 same = decode(MODE_LOAD, &images[i], expected, out_size);
+		for (INAT mode = MODE_INTO_HEAP; mode < MODE_COUNT; mode++) {
+			same = same && decode(mode, &images[i], out, out_size) && !memcmp(out, expected, size);
+		}
+		struct hzarenastats last;
+		hz_stbi_stats(&last, NULL);
+		if (!same) mismatches++;
+		printf("%-28s %8llu %14llu %12.1f %10s\n", images[i].name, (unsigned long long)last.allocs,
+			(unsigned long long)last.grown_in_place, last.peak / 1024.0, same ? "same" : "DIFFERS");
+	}
+
+	printf("\narena vs stbi_load: %.2fx, arena vs heap scratch: %.2fx\n", times[MODE_LOAD] / times[MODE_INTO_ARENA],
+		times[MODE_INTO_HEAP] / times[MODE_INTO_ARENA]);
+	if (failed) printf("%d decode(s) failed\n", failed);
+	if (mismatches) printf("%d image(s) decode differently between modes\n", mismatches);
+
+	hz_stbi_release();
+	for (INAT i = 0; i < nimages; i++) free(images[i].data);
+	free(out);
+	free(expected);
+	return failed || mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+/* BVH culling and picking benchmark.
+ *
+ * Scatters cubes over a flat field at a fixed density, the way puck_props does, for a range of counts, so the bigger
+ * runs are bigger worlds rather than more crowded ones, and as many cubes as before are in view. For each count we
+ * time hz_bvh_build(), hz_bvh_refit() after every cube has moved a little, then frustum culling for a camera turning
+ * on the spot and picking rays through its view, both with the BVH and by testing every cube. Linear culling is
+ * O(n); with the BVH the time should stay close to flat. Every query is checked against the linear answer.
+ *
+ *   bench_bvh [--max=N] [--views=N] [--cpu=N]
+ */
+#include "holyh/src/holy.h"
+#include "hz_bvh.h"
+#include "bench_corpus.h"
+#include <math.h>
+
+#define SPACING 2.0f
+#define RAYS 64 /* Per view */
+
+static R32 random01(U32 *seed)
+{
+	*seed = *seed * 1664525u + 1013904223u;
+	return (*seed >> 8) / 16777216.0f;
+}
+
+/* A camera standing in the middle of the field looking out at `theta`, as a world space frustum and a basis to aim
+ * rays with
+ */
+static X0 camera(R32 theta, struct hzfrustum *f, R32 eye[3], R32 forward[3], R32 right[3], R32 up[3])
+{
+	eye[0] = 0.0f;
+	eye[1] = 6.0f;
+	eye[2] = 0.0f;
+	R32 d[3] = { cosf(theta) * 10.0f, -4.0f, sinf(theta) * 10.0f };
+	R32 len = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	for (INAT c = 0; c < 3; c++) forward[c] = d[c] / len;
+	len = sqrtf(forward[0] * forward[0] + forward[2] * forward[2]);
+	right[0] = -forward[2] / len;
+	right[1] = 0.0f;
+	right[2] = forward[0] / len;
+	up[0] = right[1] * forward[2] - right[2] * forward[1];
+	up[1] = right[2] * forward[0] - right[0] * forward[2];
+	up[2] = right[0] * forward[1] - right[1] * forward[0];
+
+	/* The same perspective as puck_props: 45 degrees, 4:3, 0.1 to 200 */
+	R32 fy = 1.0f / tanf(0.7854f * 0.5f), fx = fy / 1.3333f, n = 0.1f, far_plane = 200.0f;
+	R32 view[16] = {
+		right[0], up[0], -forward[0], 0.0f,
+		right[1], up[1], -forward[1], 0.0f,
+		right[2], up[2], -forward[2], 0.0f,
+		-(right[0] * eye[0] + right[1] * eye[1] + right[2] * eye[2]),
+		-(up[0] * eye[0] + up[1] * eye[1] + up[2] * eye[2]),
+		forward[0] * eye[0] + forward[1] * eye[1] + forward[2] * eye[2], 1.0f
+	};
+	R32 proj[16] = {
+		fx, 0.0f, 0.0f, 0.0f,
+		0.0f, fy, 0.0f, 0.0f,
+		0.0f, 0.0f, (far_plane + n) / (n - far_plane), -1.0f,
+		0.0f, 0.0f, 2.0f * far_plane * n / (n - far_plane), 0.0f
+	};
+	R32 viewproj[16];
+	for (INAT c = 0; c < 4; c++) {
+		for (INAT r = 0; r < 4; r++) {
+			viewproj[c * 4 + r] = proj[r] * view[c * 4] + proj[4 + r] * view[c * 4 + 1] + proj[8 + r] * view[c * 4 + 2]
+				+ proj[12 + r] * view[c * 4 + 3];
+		}
+	}
+	hz_frustum_from_matrix(f, viewproj);
+}
+
+/* The nearest box a ray hits, the slow way, with the distance to it in `*t` */
+static INAT ray_linear(const R32 *boxes, U32 count, const R32 origin[3], const R32 dir[3], R32 max_t, R32 *t)
+{
+	INAT found = -1;
+	for (U32 i = 0; i < count; i++) {
+		const R32 *box = &boxes[i * 6];
+		R32 t0 = 0.0f, t1 = max_t;
+		for (INAT c = 0; c < 3; c++) {
+			R32 inv = 1.0f / dir[c], a = (box[c] - origin[c]) * inv, b = (box[c + 3] - origin[c]) * inv;
+			if (a > b) {
+				R32 t = a;
+				a = b;
+				b = t;
+			}
+			t0 = a > t0 ? a : t0;
+			t1 = b < t1 ? b : t1;
+		}
+		if (t0 <= t1 && (t0 < max_t || found < 0)) {
+			max_t = t0;
+			found = i;
+		}
+	}
+	*t = max_t;
+	return found;
+}
+
+INAT main(INAT argc, CHR *argv[])
+{
+	U32 max_count = 1u << 20, views = 32;
+	INAT cpu = -2;
+	for (INAT i = 1; i < argc; i++) {
+		const CHR *v;
+		if ((v = bench_arg_value(argv[i], "--max"))) max_count = strtoul(v, NULL, 10);
+		else if ((v = bench_arg_value(argv[i], "--views"))) views = strtoul(v, NULL, 10);
+		else if ((v = bench_arg_value(argv[i], "--cpu"))) cpu = atoi(v);
+		else fprintf(stderr, "bench: unknown argument %s, ignoring it\n", argv[i]);
+	}
+	if (views < 1) views = 1;
+
+	cpu = bench_pin_cpu(cpu);
+
+	printf("cubes spaced %.0f apart, %u views, %u rays per view, pinned to CPU %d\n\n", SPACING, views, RAYS, cpu);
+	printf("%9s %10s %10s %10s %12s %12s %8s %12s %12s\n", "cubes", "nodes", "build ms", "refit ms", "linear us",
+		"bvh us", "visible", "ray lin us", "ray bvh us");
+
+	INAT mismatches = 0;
+	for (U32 count = 1u << 14; count <= max_count; count <<= 2) {
+		R32 *boxes = malloc((size_t)count * 6 * sizeof(R32));
+		U32 *out = malloc((size_t)count * sizeof(U32));
+		U8 *visible = malloc(count);
+		if (!boxes || !out || !visible) {
+			fprintf(stderr, "bench: out of memory for %u cubes\n", count);
+			return EXIT_FAILURE;
+		}
+
+		/* A square field, each cube jittered in its cell with a random size */
+		U32 side = (U32)ceil(sqrt(count)), seed = 12345;
+		for (U32 i = 0; i < count; i++) {
+			R32 half = 0.25f + 0.35f * random01(&seed);
+			R32 x = ((R32)(i % side) - (side - 1) * 0.5f) * SPACING + random01(&seed) - 0.5f;
+			R32 z = ((R32)(i / side) - (side - 1) * 0.5f) * SPACING + random01(&seed) - 0.5f;
+			R32 box[6] = { x - half, 0.0f, z - half, x + half, 2.0f * half, z + half };
+			memcpy(&boxes[i * 6], box, sizeof(box));
+		}
+
+		struct hzbvh bvh = { 0 };
+		R64 start = bench_now_ms();
+		if (!hz_bvh_build(&bvh, boxes, count)) return EXIT_FAILURE;
+		R64 build = bench_now_ms() - start;
+
+		/* Everything bobs up or down a bit, and the queries run on the refitted tree */
+		for (U32 i = 0; i < count; i++) {
+			R32 dy = sinf(i * 0.37f);
+			boxes[i * 6 + 1] += dy;
+			boxes[i * 6 + 4] += dy;
+		}
+		start = bench_now_ms();
+		hz_bvh_refit(&bvh, boxes);
+		R64 refit = bench_now_ms() - start;
+
+		R64 linear = 0.0, tree = 0.0, ray_linear_ms = 0.0, ray_tree = 0.0;
+		U64 in_view = 0;
+		for (U32 v = 0; v < views; v++) {
+			struct hzfrustum f;
+			R32 eye[3], forward[3], right[3], up[3];
+			camera(v * 2.0f * (R32)M_PI / views, &f, eye, forward, right, up);
+
+			start = bench_now_ms();
+			U32 expected = 0;
+			for (U32 i = 0; i < count; i++) {
+				visible[i] = hz_frustum_aabb(&f, &boxes[i * 6], &boxes[i * 6 + 3]);
+				expected += visible[i];
+			}
+			linear += bench_now_ms() - start;
+
+			start = bench_now_ms();
+			U32 found = hz_bvh_frustum(&bvh, &f, out, count);
+			tree += bench_now_ms() - start;
+
+			U1 same = found == expected;
+			for (U32 i = 0; same && i < found; i++) {
+				same = visible[out[i]] == 1;
+				visible[out[i]] = 2;
+			}
+			if (!same) mismatches++;
+			in_view += found;
+
+			/* Rays spread over the middle of the view, as if the cursor were moving around */
+			R32 dirs[RAYS][3];
+			for (U32 r = 0; r < RAYS; r++) {
+				R32 sx = (random01(&seed) - 0.5f) * 0.8f, sy = (random01(&seed) - 0.5f) * 0.6f;
+				for (INAT c = 0; c < 3; c++) dirs[r][c] = forward[c] + sx * right[c] + sy * up[c];
+			}
+			INAT hits[RAYS][2];
+			R32 t[RAYS][2];
+			start = bench_now_ms();
+			for (U32 r = 0; r < RAYS; r++) hits[r][0] = ray_linear(boxes, count, eye, dirs[r], 1000.0f, &t[r][0]);
+			ray_linear_ms += bench_now_ms() - start;
+			start = bench_now_ms();
+			for (U32 r = 0; r < RAYS; r++) hits[r][1] = hz_bvh_ray(&bvh, eye, dirs[r], 1000.0f, NULL, NULL, &t[r][1]);
+			ray_tree += bench_now_ms() - start;
+			/* Two boxes the ray enters at the same distance can come out either way, so compare the distances */
+			for (U32 r = 0; r < RAYS; r++) {
+				if ((hits[r][0] < 0) != (hits[r][1] < 0) || (hits[r][0] >= 0 && t[r][0] != t[r][1])) mismatches++;
+			}
+		}
+
+		printf("%9u %10u %10.2f %10.3f %12.1f %12.1f %8llu %12.2f %12.2f\n", count, bvh.nodes, build, refit,
+			linear * 1000.0 / views, tree * 1000.0 / views, (unsigned long long)(in_view / views),
+			ray_linear_ms * 1000.0 / (views * RAYS), ray_tree * 1000.0 / (views * RAYS));
+
+		hz_bvh_destroy(&bvh);
+		free(boxes);
+		free(out);
+		free(visible);
+	}
+
+	if (mismatches) printf("\n%d quer%s disagree with testing every cube\n", mismatches, mismatches == 1 ? "y" : "ies");
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
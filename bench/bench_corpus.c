@@ -0,0 +1,716 @@
+#define _GNU_SOURCE
+#include "bench_corpus.h"
+#include "hz_png.h"
+#include <math.h>
+#include <sched.h>
+#include <time.h>
+
+/* Everything here writes through a memory stream, so the writers look like ordinary file writers */
+static FILE *open_buffer(CHR **buf, size_t *len)
+{
+	return open_memstream(buf, len);
+}
+
+static U8 *close_buffer(FILE *f, CHR **buf, size_t *len, size_t *out_len)
+{
+	if (fclose(f) != 0) {
+		free(*buf);
+		return NULL;
+	}
+	*out_len = *len;
+	return (U8*)*buf;
+}
+
+static X0 put_le16(FILE *f, U32 v)
+{
+	fputc(v & 0xff, f);
+	fputc((v >> 8) & 0xff, f);
+}
+
+static X0 put_le32(FILE *f, U32 v)
+{
+	put_le16(f, v & 0xffff);
+	put_le16(f, v >> 16);
+}
+
+static X0 put_be16(FILE *f, U32 v)
+{
+	fputc((v >> 8) & 0xff, f);
+	fputc(v & 0xff, f);
+}
+
+U8 *bench_write_tga(const U8 *rgb, INAT w, INAT h, U1 rle, size_t *len)
+{
+	CHR *buf;
+	size_t blen;
+	FILE *f = open_buffer(&buf, &blen);
+	if (!f) return NULL;
+
+	U8 hdr[18] = { 0, 0, rle ? 10 : 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, w & 0xff, w >> 8, h & 0xff, h >> 8, 24, 0x20 };
+	fwrite(hdr, 1, 18, f);
+
+	for (INAT y = 0; y < h; y++) {
+		const U8 *row = rgb + (size_t)y * w * 3;
+		for (INAT x = 0; x < w;) {
+			if (!rle) {
+				fputc(row[x * 3 + 2], f);
+				fputc(row[x * 3 + 1], f);
+				fputc(row[x * 3], f);
+				x++;
+				continue;
+			}
+
+			/* RLE packets never cross a scanline, which keeps every decoder happy */
+			INAT run = 1;
+			while (x + run < w && run < 128 && !memcmp(row + x * 3, row + (x + run) * 3, 3)) run++;
+			if (run > 1) {
+				fputc(0x80 | (run - 1), f);
+				fputc(row[x * 3 + 2], f);
+				fputc(row[x * 3 + 1], f);
+				fputc(row[x * 3], f);
+				x += run;
+				continue;
+			}
+
+			INAT raw = 1;
+			while (x + raw < w && raw < 128 && (x + raw + 1 >= w || memcmp(row + (x + raw) * 3,
+				row + (x + raw + 1) * 3, 3))) raw++;
+			fputc(raw - 1, f);
+			for (INAT i = 0; i < raw; i++) {
+				fputc(row[(x + i) * 3 + 2], f);
+				fputc(row[(x + i) * 3 + 1], f);
+				fputc(row[(x + i) * 3], f);
+			}
+			x += raw;
+		}
+	}
+
+	return close_buffer(f, &buf, &blen, len);
+}
+
+U8 *bench_write_bmp(const U8 *rgb, INAT w, INAT h, size_t *len)
+{
+	CHR *buf;
+	size_t blen;
+	FILE *f = open_buffer(&buf, &blen);
+	if (!f) return NULL;
+
+	INAT pad = (4 - (w * 3) % 4) % 4;
+	U32 image_size = (w * 3 + pad) * h;
+
+	fputc('B', f);
+	fputc('M', f);
+	put_le32(f, 54 + image_size);
+	put_le32(f, 0);
+	put_le32(f, 54);
+	put_le32(f, 40);
+	put_le32(f, w);
+	put_le32(f, h); /* Positive height, so rows are stored bottom-up */
+	put_le16(f, 1);
+	put_le16(f, 24);
+	put_le32(f, 0); /* BI_RGB */
+	put_le32(f, image_size);
+	put_le32(f, 2835);
+	put_le32(f, 2835);
+	put_le32(f, 0);
+	put_le32(f, 0);
+
+	for (INAT y = h - 1; y >= 0; y--) {
+		const U8 *row = rgb + (size_t)y * w * 3;
+		for (INAT x = 0; x < w; x++) {
+			fputc(row[x * 3 + 2], f);
+			fputc(row[x * 3 + 1], f);
+			fputc(row[x * 3], f);
+		}
+		for (INAT i = 0; i < pad; i++) fputc(0, f);
+	}
+
+	return close_buffer(f, &buf, &blen, len);
+}
+
+/* LZW codes go out LSB-first, in sub-blocks of up to 255 bytes */
+struct gifcodes {
+	FILE *f;
+	U8 block[255];
+	INAT nblock;
+	U32 acc;
+	INAT nbits;
+};
+
+static X0 gif_byte(struct gifcodes *g, U8 byte)
+{
+	g->block[g->nblock++] = byte;
+	if (g->nblock == 255) {
+		fputc(255, g->f);
+		fwrite(g->block, 1, 255, g->f);
+		g->nblock = 0;
+	}
+}
+
+static X0 gif_code(struct gifcodes *g, U32 code)
+{
+	g->acc |= code << g->nbits;
+	g->nbits += 9;
+	while (g->nbits >= 8) {
+		gif_byte(g, g->acc & 0xff);
+		g->acc >>= 8;
+		g->nbits -= 8;
+	}
+}
+
+/* GIF, palette is a 6x6x6 colour cube. The LZW stream never lets the dictionary grow past 9-bit codes (it sends a
+ * clear code every 254 literals), so it doesn't compress at all - but it's valid, and it exercises the decoder.
+ */
+U8 *bench_write_gif(const U8 *rgb, INAT w, INAT h, size_t *len)
+{
+	CHR *buf;
+	size_t blen;
+	FILE *f = open_buffer(&buf, &blen);
+	if (!f) return NULL;
+
+	fwrite("GIF89a", 1, 6, f);
+	put_le16(f, w);
+	put_le16(f, h);
+	fputc(0xf7, f); /* Global colour table, 8 bits per primary, 256 entries */
+	fputc(0, f);
+	fputc(0, f);
+	for (INAT i = 0; i < 256; i++) {
+		INAT c = i < 216 ? i : 0;
+		fputc((c / 36) * 51, f);
+		fputc((c / 6 % 6) * 51, f);
+		fputc((c % 6) * 51, f);
+	}
+
+	fputc(0x2c, f);
+	put_le16(f, 0);
+	put_le16(f, 0);
+	put_le16(f, w);
+	put_le16(f, h);
+	fputc(0, f);
+	fputc(8, f); /* LZW minimum code size */
+
+	struct gifcodes g = { f, { 0 }, 0, 0, 0 };
+	size_t npixels = (size_t)w * h;
+
+	gif_code(&g, 256); /* Clear */
+	for (size_t i = 0, literals = 0; i < npixels; i++, literals++) {
+		if (literals == 254) {
+			gif_code(&g, 256);
+			literals = 0;
+		}
+		const U8 *p = rgb + i * 3;
+		gif_code(&g, (p[0] * 6 / 256) * 36 + (p[1] * 6 / 256) * 6 + p[2] * 6 / 256);
+	}
+	gif_code(&g, 257); /* End of information */
+	if (g.nbits) gif_byte(&g, g.acc);
+
+	if (g.nblock) {
+		fputc(g.nblock, f);
+		fwrite(g.block, 1, g.nblock, f);
+	}
+	fputc(0, f);
+	fputc(0x3b, f);
+
+	return close_buffer(f, &buf, &blen, len);
+}
+
+/* Radiance HDR with run-length encoded scanlines. The 8-bit input is expanded to linear light and scaled up a bit,
+ * so there's actually something above 1.0 in there.
+ */
+U8 *bench_write_hdr(const U8 *rgb, INAT w, INAT h, size_t *len)
+{
+	CHR *buf;
+	size_t blen;
+	FILE *f = open_buffer(&buf, &blen);
+	U8 *scan = malloc((size_t)w * 4);
+	if (!f || !scan) {
+		if (f) fclose(f);
+		free(scan);
+		return NULL;
+	}
+
+	fprintf(f, "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %d +X %d\n", h, w);
+
+	for (INAT y = 0; y < h; y++) {
+		for (INAT x = 0; x < w; x++) {
+			const U8 *p = rgb + ((size_t)y * w + x) * 3;
+			R32 c[3];
+			for (INAT i = 0; i < 3; i++) c[i] = powf(p[i] / 255.0f, 2.2f) * 4.0f;
+			R32 m = fmaxf(c[0], fmaxf(c[1], c[2]));
+			U8 *e = scan + x * 4;
+			if (m < 1e-32f) {
+				e[0] = e[1] = e[2] = e[3] = 0;
+			} else {
+				INAT ex;
+				R32 scale = frexpf(m, &ex) * 256.0f / m;
+				e[0] = c[0] * scale;
+				e[1] = c[1] * scale;
+				e[2] = c[2] * scale;
+				e[3] = ex + 128;
+			}
+		}
+
+		/* New-style RLE: each of the four components is run-length coded separately */
+		fputc(2, f);
+		fputc(2, f);
+		put_be16(f, w);
+		for (INAT ch = 0; ch < 4; ch++) {
+			for (INAT x = 0; x < w;) {
+				INAT run = 1;
+				while (x + run < w && run < 127 && scan[(x + run) * 4 + ch] == scan[x * 4 + ch]) run++;
+				if (run >= 4) {
+					fputc(128 + run, f);
+					fputc(scan[x * 4 + ch], f);
+					x += run;
+					continue;
+				}
+				INAT lit = 0;
+				while (x + lit < w && lit < 128) {
+					INAT r = 1;
+					while (x + lit + r < w && r < 4 && scan[(x + lit + r) * 4 + ch] == scan[(x + lit) * 4 + ch]) r++;
+					if (r >= 4) break;
+					lit++;
+				}
+				fputc(lit, f);
+				for (INAT i = 0; i < lit; i++) fputc(scan[(x + i) * 4 + ch], f);
+				x += lit;
+			}
+		}
+	}
+	free(scan);
+
+	return close_buffer(f, &buf, &blen, len);
+}
+
+/* Standard tables from ITU T.81 Annex K */
+static const U8 jpeg_luma_quant[64] = {
+	16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55,
+	14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+	18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+	49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99
+};
+static const U8 jpeg_chroma_quant[64] = {
+	17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+	24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99
+};
+static const U8 jpeg_zigzag[64] = {
+	0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47,
+	55, 62, 63
+};
+static const U8 jpeg_dc_luma_bits[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const U8 jpeg_dc_chroma_bits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+static const U8 jpeg_dc_vals[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+static const U8 jpeg_ac_luma_bits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+static const U8 jpeg_ac_luma_vals[162] = {
+	0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14,
+	0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09,
+	0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a,
+	0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65,
+	0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88,
+	0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9,
+	0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca,
+	0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea,
+	0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa
+};
+static const U8 jpeg_ac_chroma_bits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const U8 jpeg_ac_chroma_vals[162] = {
+	0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32,
+	0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16,
+	0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39,
+	0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64,
+	0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86,
+	0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+	0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8,
+	0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9,
+	0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa
+};
+
+struct jpeghuff {
+	U16 code[256];
+	U8 size[256];
+};
+
+struct jpegwriter {
+	FILE *f;
+	U32 acc;
+	INAT nbits;
+};
+
+static X0 jpeg_build_huff(struct jpeghuff *h, const U8 *bits, const U8 *vals)
+{
+	U32 code = 0;
+	INAT k = 0;
+	for (INAT len = 1; len <= 16; len++) {
+		for (INAT i = 0; i < bits[len - 1]; i++, k++) {
+			h->code[vals[k]] = code++;
+			h->size[vals[k]] = len;
+		}
+		code <<= 1;
+	}
+}
+
+static X0 jpeg_put_bits(struct jpegwriter *w, U32 bits, INAT n)
+{
+	w->acc = (w->acc << n) | (bits & ((1u << n) - 1));
+	w->nbits += n;
+	while (w->nbits >= 8) {
+		U8 byte = (w->acc >> (w->nbits - 8)) & 0xff;
+		fputc(byte, w->f);
+		if (byte == 0xff) fputc(0, w->f); /* Byte stuffing */
+		w->nbits -= 8;
+	}
+}
+
+static X0 jpeg_flush_bits(struct jpegwriter *w)
+{
+	/* Pad with ones, as the spec asks */
+	if (w->nbits) jpeg_put_bits(w, 0x7f, 8 - w->nbits);
+	w->acc = 0;
+}
+
+static X0 jpeg_put_table(FILE *f, INAT id, const U8 *bits, const U8 *vals, INAT nvals)
+{
+	fputc(0xff, f);
+	fputc(0xc4, f);
+	put_be16(f, 2 + 1 + 16 + nvals);
+	fputc(id, f);
+	fwrite(bits, 1, 16, f);
+	fwrite(vals, 1, nvals, f);
+}
+
+/* Forward DCT, quantisation and entropy coding of one 8x8 block of level-shifted samples */
+static X0 jpeg_block(struct jpegwriter *w, const R32 *in, const U8 *quant, INAT *dc_pred,
+	const struct jpeghuff *dc, const struct jpeghuff *ac)
+{
+	static R32 cosines[8][8];
+	static U1 ready = false;
+	if (!ready) {
+		for (INAT u = 0; u < 8; u++)
+			for (INAT x = 0; x < 8; x++)
+				cosines[u][x] = cosf((2 * x + 1) * u * 3.14159265f / 16.0f) * (u ? 0.5f : 0.35355339f);
+		ready = true;
+	}
+
+	R32 tmp[64];
+	INAT coef[64];
+	for (INAT y = 0; y < 8; y++)
+		for (INAT u = 0; u < 8; u++) {
+			R32 s = 0;
+			for (INAT x = 0; x < 8; x++) s += in[y * 8 + x] * cosines[u][x];
+			tmp[y * 8 + u] = s;
+		}
+	for (INAT v = 0; v < 8; v++)
+		for (INAT u = 0; u < 8; u++) {
+			R32 s = 0;
+			for (INAT y = 0; y < 8; y++) s += tmp[y * 8 + u] * cosines[v][y];
+			coef[v * 8 + u] = lrintf(s / quant[v * 8 + u]);
+		}
+
+	INAT diff = coef[0] - *dc_pred;
+	*dc_pred = coef[0];
+	INAT mag = abs(diff), cat = 0;
+	while (mag >> cat) cat++;
+	jpeg_put_bits(w, dc->code[cat], dc->size[cat]);
+	if (cat) jpeg_put_bits(w, diff < 0 ? diff - 1 : diff, cat);
+
+	INAT run = 0;
+	for (INAT k = 1; k < 64; k++) {
+		INAT c = coef[jpeg_zigzag[k]];
+		if (!c) {
+			run++;
+			continue;
+		}
+		while (run >= 16) {
+			jpeg_put_bits(w, ac->code[0xf0], ac->size[0xf0]);
+			run -= 16;
+		}
+		mag = abs(c);
+		cat = 0;
+		while (mag >> cat) cat++;
+		INAT sym = (run << 4) | cat;
+		jpeg_put_bits(w, ac->code[sym], ac->size[sym]);
+		jpeg_put_bits(w, c < 0 ? c - 1 : c, cat);
+		run = 0;
+	}
+	if (run) jpeg_put_bits(w, ac->code[0], ac->size[0]);
+}
+
+U8 *bench_write_jpeg(const U8 *rgb, INAT w, INAT h, INAT quality, INAT restart, size_t *len)
+{
+	CHR *buf;
+	size_t blen;
+	FILE *f = open_buffer(&buf, &blen);
+	if (!f) return NULL;
+
+	INAT scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+	U8 quant[2][64];
+	for (INAT i = 0; i < 64; i++) {
+		INAT l = (jpeg_luma_quant[i] * scale + 50) / 100, c = (jpeg_chroma_quant[i] * scale + 50) / 100;
+		quant[0][i] = l < 1 ? 1 : l > 255 ? 255 : l;
+		quant[1][i] = c < 1 ? 1 : c > 255 ? 255 : c;
+	}
+
+	fputc(0xff, f);
+	fputc(0xd8, f);
+
+	for (INAT t = 0; t < 2; t++) {
+		fputc(0xff, f);
+		fputc(0xdb, f);
+		put_be16(f, 67);
+		fputc(t, f);
+		for (INAT k = 0; k < 64; k++) fputc(quant[t][jpeg_zigzag[k]], f);
+	}
+
+	fputc(0xff, f);
+	fputc(0xc0, f);
+	put_be16(f, 17);
+	fputc(8, f);
+	put_be16(f, h);
+	put_be16(f, w);
+	fputc(3, f);
+	U8 comps[9] = { 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1 };
+	fwrite(comps, 1, 9, f);
+
+	jpeg_put_table(f, 0x00, jpeg_dc_luma_bits, jpeg_dc_vals, 12);
+	jpeg_put_table(f, 0x10, jpeg_ac_luma_bits, jpeg_ac_luma_vals, 162);
+	jpeg_put_table(f, 0x01, jpeg_dc_chroma_bits, jpeg_dc_vals, 12);
+	jpeg_put_table(f, 0x11, jpeg_ac_chroma_bits, jpeg_ac_chroma_vals, 162);
+
+	if (restart) {
+		fputc(0xff, f);
+		fputc(0xdd, f);
+		put_be16(f, 4);
+		put_be16(f, restart);
+	}
+
+	fputc(0xff, f);
+	fputc(0xda, f);
+	put_be16(f, 12);
+	fputc(3, f);
+	U8 scan[6] = { 1, 0x00, 2, 0x11, 3, 0x11 };
+	fwrite(scan, 1, 6, f);
+	fputc(0, f);
+	fputc(63, f);
+	fputc(0, f);
+
+	struct jpeghuff dc_luma, ac_luma, dc_chroma, ac_chroma;
+	jpeg_build_huff(&dc_luma, jpeg_dc_luma_bits, jpeg_dc_vals);
+	jpeg_build_huff(&ac_luma, jpeg_ac_luma_bits, jpeg_ac_luma_vals);
+	jpeg_build_huff(&dc_chroma, jpeg_dc_chroma_bits, jpeg_dc_vals);
+	jpeg_build_huff(&ac_chroma, jpeg_ac_chroma_bits, jpeg_ac_chroma_vals);
+
+	struct jpegwriter bw = { f, 0, 0 };
+	INAT pred[3] = { 0, 0, 0 };
+	INAT mcus_x = (w + 15) / 16, mcus_y = (h + 15) / 16, mcu = 0, rst = 0;
+
+	for (INAT my = 0; my < mcus_y; my++)
+		for (INAT mx = 0; mx < mcus_x; mx++, mcu++) {
+			if (restart && mcu && mcu % restart == 0) {
+				jpeg_flush_bits(&bw);
+				fputc(0xff, f);
+				fputc(0xd0 + rst, f);
+				rst = (rst + 1) & 7;
+				pred[0] = pred[1] = pred[2] = 0;
+			}
+
+			/* Colour convert the 16x16 MCU, clamping reads at the image edge */
+			R32 ys[256], cb[256], cr[256];
+			for (INAT y = 0; y < 16; y++)
+				for (INAT x = 0; x < 16; x++) {
+					INAT sx = mx * 16 + x, sy = my * 16 + y;
+					if (sx >= w) sx = w - 1;
+					if (sy >= h) sy = h - 1;
+					const U8 *p = rgb + ((size_t)sy * w + sx) * 3;
+					ys[y * 16 + x] = 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2] - 128.0f;
+					cb[y * 16 + x] = -0.168736f * p[0] - 0.331264f * p[1] + 0.5f * p[2];
+					cr[y * 16 + x] = 0.5f * p[0] - 0.418688f * p[1] - 0.081312f * p[2];
+				}
+
+			R32 block[64];
+			for (INAT b = 0; b < 4; b++) {
+				INAT ox = (b & 1) * 8, oy = (b >> 1) * 8;
+				for (INAT i = 0; i < 64; i++) block[i] = ys[(oy + i / 8) * 16 + ox + i % 8];
+				jpeg_block(&bw, block, quant[0], &pred[0], &dc_luma, &ac_luma);
+			}
+			for (INAT c = 0; c < 2; c++) {
+				const R32 *src = c ? cr : cb;
+				for (INAT i = 0; i < 64; i++) {
+					INAT x = (i % 8) * 2, y = (i / 8) * 2;
+					block[i] = (src[y * 16 + x] + src[y * 16 + x + 1] + src[y * 16 + x + 16]
+						+ src[y * 16 + x + 17]) * 0.25f;
+				}
+				jpeg_block(&bw, block, quant[1], &pred[c + 1], &dc_chroma, &ac_chroma);
+			}
+		}
+
+	jpeg_flush_bits(&bw);
+	fputc(0xff, f);
+	fputc(0xd9, f);
+
+	return close_buffer(f, &buf, &blen, len);
+}
+
+/* xorshift32, so the corpus is identical on every machine */
+static U32 corpus_rand(U32 *state)
+{
+	U32 x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+static X0 synth_rgba(U8 *out, INAT w, INAT h)
+{
+	U32 seed = 0x2545f491;
+	for (INAT y = 0; y < h; y++)
+		for (INAT x = 0; x < w; x++) {
+			R32 fx = (R32)x / w, fy = (R32)y / h;
+			INAT noise = (INAT)(corpus_rand(&seed) & 7) - 4;
+			INAT r = 128 + 100 * sinf(fx * 6.0f + fy * 2.0f) + noise;
+			INAT g = 40 + 180 * fy + 20 * sinf(fx * 31.0f) + noise;
+			INAT b = 128 + 90 * cosf(fx * fy * 20.0f) + noise;
+			INAT a = 255 - 200 * ((fx - 0.5f) * (fx - 0.5f) + (fy - 0.5f) * (fy - 0.5f));
+			U8 *p = out + ((size_t)y * w + x) * 4;
+			p[0] = r < 0 ? 0 : r > 255 ? 255 : r;
+			p[1] = g < 0 ? 0 : g > 255 ? 255 : g;
+			p[2] = b < 0 ? 0 : b > 255 ? 255 : b;
+			p[3] = a;
+		}
+}
+
+static X0 add(struct benchimage *out, INAT *n, const CHR *name, U8 *data, size_t len)
+{
+	if (!data) {
+		fprintf(stderr, "bench: unable to generate %s\n", name);
+		return;
+	}
+	snprintf(out[*n].name, sizeof(out[*n].name), "%s", name);
+	out[*n].data = data;
+	out[*n].len = len;
+	(*n)++;
+}
+
+static X0 add_png(struct benchimage *out, INAT *n, const CHR *name, const X0 *pixels, INAT size, INAT comp,
+	INAT filter, INAT level, INAT depth, U1 palette, U1 interlace)
+{
+	struct hzpngopts opts = { filter, level, depth, palette, interlace };
+	size_t len = 0;
+	U8 *png = hz_png_encode(pixels, size, size, comp, 0, false, &opts, &len);
+	add(out, n, name, png, len);
+}
+
+INAT bench_corpus_generate(struct benchimage *out, INAT size)
+{
+	size_t npix = (size_t)size * size;
+	U8 *rgba = malloc(npix * 4), *rgb = malloc(npix * 3), *grey = malloc(npix), *quant = malloc(npix * 3);
+	U16 *rgb16 = malloc(npix * 3 * sizeof(U16));
+	INAT n = 0;
+
+	if (!rgba || !rgb || !grey || !quant || !rgb16) goto done;
+
+	synth_rgba(rgba, size, size);
+	U32 seed = 0x9e3779b9;
+	for (size_t i = 0; i < npix; i++) {
+		const U8 *p = rgba + i * 4;
+		for (INAT c = 0; c < 3; c++) {
+			rgb[i * 3 + c] = p[c];
+			quant[i * 3 + c] = (p[c] * 6 / 256) * 51; /* The same 6x6x6 cube the GIF writer uses */
+			rgb16[i * 3 + c] = p[c] * 257 + (corpus_rand(&seed) & 0xff);
+		}
+		grey[i] = (p[0] * 77 + p[1] * 150 + p[2] * 29) >> 8;
+	}
+
+	static const CHR *filter_names[5] = { "none", "sub", "up", "avg", "paeth" };
+	CHR name[64];
+	for (INAT fil = 0; fil < 5; fil++) {
+		snprintf(name, sizeof(name), "png-rgb8-%s", filter_names[fil]);
+		add_png(out, &n, name, rgb, size, 3, fil, 6, 8, false, false);
+	}
+	add_png(out, &n, "png-rgb8-adaptive", rgb, size, 3, HZ_PNG_FILTER_ADAPTIVE, 6, 8, false, false);
+	/* No compression at all, so the time is all unfiltering and format conversion */
+	add_png(out, &n, "png-rgb8-paeth-stored", rgb, size, 3, HZ_PNG_FILTER_PAETH, 0, 8, false, false);
+	add_png(out, &n, "png-rgba8-paeth", rgba, size, 4, HZ_PNG_FILTER_PAETH, 6, 8, false, false);
+	add_png(out, &n, "png-rgba8-avg", rgba, size, 4, HZ_PNG_FILTER_AVG, 6, 8, false, false);
+	add_png(out, &n, "png-grey8-adaptive", grey, size, 1, HZ_PNG_FILTER_ADAPTIVE, 6, 8, false, false);
+	add_png(out, &n, "png-rgb16-adaptive", rgb16, size, 3, HZ_PNG_FILTER_ADAPTIVE, 6, 16, false, false);
+	add_png(out, &n, "png-palette", quant, size, 3, HZ_PNG_FILTER_NONE, 6, 8, true, false);
+	add_png(out, &n, "png-rgb8-interlaced", rgb, size, 3, HZ_PNG_FILTER_ADAPTIVE, 6, 8, false, true);
+
+	/* The writers report their length through a pointer, so each call needs to finish before add() reads it */
+	U8 *data;
+	size_t len = 0;
+	data = bench_write_jpeg(rgb, size, size, 90, 0, &len);
+	add(out, &n, "jpeg-baseline", data, len);
+	data = bench_write_jpeg(rgb, size, size, 90, (size + 15) / 16, &len);
+	add(out, &n, "jpeg-baseline-restart", data, len);
+	data = bench_write_tga(rgb, size, size, false, &len);
+	add(out, &n, "tga-rgb", data, len);
+	data = bench_write_tga(quant, size, size, true, &len);
+	add(out, &n, "tga-rle", data, len);
+	data = bench_write_bmp(rgb, size, size, &len);
+	add(out, &n, "bmp-rgb", data, len);
+	data = bench_write_gif(rgb, size, size, &len);
+	add(out, &n, "gif", data, len);
+	data = bench_write_hdr(rgb, size, size, &len);
+	add(out, &n, "hdr-rle", data, len);
+
+done:
+	free(rgba);
+	free(rgb);
+	free(grey);
+	free(quant);
+	free(rgb16);
+	return n;
+}
+
+R64 bench_now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+const CHR *bench_arg_value(const CHR *arg, const CHR *name)
+{
+	size_t len = strlen(name);
+	if (strncmp(arg, name, len) == 0 && arg[len] == '=') return arg + len + 1;
+	return NULL;
+}
+
+INAT bench_pin_cpu(INAT cpu)
+{
+	if (cpu == -2) cpu = sched_getcpu();
+	if (cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		if (sched_setaffinity(0, sizeof(set), &set) != 0) fprintf(stderr, "bench: unable to pin to CPU %d\n", cpu);
+	}
+	return cpu;
+}
+
+U1 bench_load_file(struct benchimage *img, const CHR *path)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f) return false;
+
+	fseek(f, 0, SEEK_END);
+	long len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	img->data = len > 0 ? malloc(len) : NULL;
+	U1 ok = img->data && fread(img->data, 1, len, f) == (size_t)len;
+	fclose(f);
+
+	if (!ok) {
+		free(img->data);
+		return false;
+	}
+	img->len = len;
+	const CHR *base = strrchr(path, '/');
+	snprintf(img->name, sizeof(img->name), "%s", base ? base + 1 : path);
+	return true;
+}
@@ -0,0 +1,44 @@
+#ifndef BENCH_CORPUS_H
+#define BENCH_CORPUS_H
+
+#include "holyh/src/holy.h"
+
+/* Synthetic decode corpus for bench_image. We only have one real asset, so everything else is generated: a
+ * deterministic "photo-ish" test pattern (gradients, some structure, a little noise) written out in every format
+ * and sub-format stb_image has a separate code path for. Progressive JPEGs are the one thing we can't produce here,
+ * pass real files to bench_image for those.
+ */
+
+struct benchimage {
+	CHR name[64];
+	U8 *data; /* The encoded file */
+	size_t len;
+};
+
+/* Fills `out` (which must hold room for at least 32 entries) and returns how many images were generated. */
+INAT bench_corpus_generate(struct benchimage *out, INAT size);
+
+/* Writers, exposed so other tools can produce test inputs too. Each returns a malloc()'d file or NULL. `rgb` is
+ * tightly packed, top-down 8-bit RGB.
+ */
+U8 *bench_write_tga(const U8 *rgb, INAT w, INAT h, U1 rle, size_t *len);
+U8 *bench_write_bmp(const U8 *rgb, INAT w, INAT h, size_t *len);
+U8 *bench_write_gif(const U8 *rgb, INAT w, INAT h, size_t *len);
+U8 *bench_write_hdr(const U8 *rgb, INAT w, INAT h, size_t *len);
+/* Baseline, 4:2:0. `restart` is the restart interval in MCUs, 0 for none. */
+U8 *bench_write_jpeg(const U8 *rgb, INAT w, INAT h, INAT quality, INAT restart, size_t *len);
+
+/* Odds and ends every benchmark needs, so they all time, parse and pin the same way */
+
+/* CLOCK_MONOTONIC in milliseconds */
+R64 bench_now_ms();
+/* The value of a --name=value argument, or NULL if `arg` isn't `name` */
+const CHR *bench_arg_value(const CHR *arg, const CHR *name);
+/* Pins the process to `cpu` so samples don't get migrated, -2 meaning whichever CPU we're on now and -1 not at all.
+ * Returns the CPU it asked for, for the report.
+ */
+INAT bench_pin_cpu(INAT cpu);
+/* Reads a whole file into `img`, named after its base name */
+U1 bench_load_file(struct benchimage *img, const CHR *path);
+
+#endif
@@ -0,0 +1,157 @@
+/* stb_image decode microbenchmark.
+ *
+ * Decodes every image in the corpus (see bench_corpus.h, plus the real assets and anything passed on the command
+ * line) with stbi_load_from_memory, over and over, with both the SIMD and the STBI_NO_SIMD build of stb_image. We
+ * report the min and median time per decode, and throughput both as compressed MB/s and output Mpixels/s. The two
+ * builds' outputs are compared too, and any difference fails the run, so a SIMD path that drifts from the scalar one
+ * shows up immediately.
+ *
+ * --threads=N hands the SIMD build a job pool of N threads (see stbi_set_job_runner), the scalar build stays single
+ * threaded, so the comparison also checks threaded JPEG decoding against the serial decoder. Threads and pinning to a
+ * single CPU don't mix, so --threads turns pinning off.
+ *
+ *   bench_image [--reps=N] [--size=N] [--cpu=N] [--threads=N] [--filter=SUBSTRING] [--json=PATH] [FILE...]
+ */
+#include "holyh/src/holy.h"
+#include "bench_stbi.h"
+#include "bench_corpus.h"
+
+#define BENCH_MAX_IMAGES 256
+
+struct benchresult {
+	R64 min_ms;
+	R64 median_ms;
+	INAT width;
+	INAT height;
+	U8 *pixels; /* Output of the last decode, kept around for the SIMD/scalar comparison */
+};
+
+typedef U8 *(*loadfn)(const U8 *, INAT, INAT *, INAT *, INAT *, INAT);
+typedef X0 (*freefn)(X0 *);
+
+static INAT compare_r64(const X0 *a, const X0 *b)
+{
+	R64 x = *(const R64*)a, y = *(const R64*)b;
+	return (x > y) - (x < y);
+}
+
+static U1 run(const struct benchimage *img, INAT reps, loadfn load, freefn release, struct benchresult *r)
+{
+	R64 *times = malloc(reps * sizeof(R64));
+	INAT comp;
+	if (!times) return false;
+
+	/* One untimed decode first, so the first sample isn't paying for cold caches and page faults */
+	U8 *pixels = load(img->data, img->len, &r->width, &r->height, &comp, 4);
+	if (!pixels) {
+		free(times);
+		return false;
+	}
+	release(pixels);
+
+	for (INAT i = 0; i < reps; i++) {
+		R64 start = bench_now_ms();
+		pixels = load(img->data, img->len, &r->width, &r->height, &comp, 4);
+		times[i] = bench_now_ms() - start;
+		if (i + 1 < reps) release(pixels);
+	}
+
+	qsort(times, reps, sizeof(R64), compare_r64);
+	r->min_ms = times[0];
+	r->median_ms = times[reps / 2];
+	r->pixels = pixels;
+	free(times);
+	return true;
+}
+
+INAT main(INAT argc, CHR *argv[])
+{
+	static struct benchimage images[BENCH_MAX_IMAGES];
+	INAT reps = 15, size = 1024, cpu = -2, threads = 1, nimages = 0;
+	const CHR *json_path = NULL, *filter = NULL;
+
+	for (INAT i = 1; i < argc; i++) {
+		const CHR *v;
+		if ((v = bench_arg_value(argv[i], "--reps"))) reps = atoi(v);
+		else if ((v = bench_arg_value(argv[i], "--size"))) size = atoi(v);
+		else if ((v = bench_arg_value(argv[i], "--cpu"))) cpu = atoi(v);
+		else if ((v = bench_arg_value(argv[i], "--threads"))) threads = atoi(v);
+		else if ((v = bench_arg_value(argv[i], "--json"))) json_path = v;
+		else if ((v = bench_arg_value(argv[i], "--filter"))) filter = v;
+		else if (nimages < BENCH_MAX_IMAGES && bench_load_file(&images[nimages], argv[i])) nimages++;
+		else fprintf(stderr, "bench: unable to load %s, skipping it\n", argv[i]);
+	}
+	if (reps < 1) reps = 1;
+	if (threads != 1) {
+		threads = bench_set_threads(threads);
+		cpu = -1;
+	}
+
+	/* Pin ourselves to one CPU so the scheduler can't migrate us between samples. By default that's whichever CPU
+	 * we happen to be on, --cpu=-1 turns pinning off.
+	 */
+	cpu = bench_pin_cpu(cpu);
+
+	if (nimages < BENCH_MAX_IMAGES && bench_load_file(&images[nimages], "assets/puckface.png")) nimages++;
+	if (nimages + 32 <= BENCH_MAX_IMAGES) nimages += bench_corpus_generate(images + nimages, size);
+
+	FILE *json = json_path ? fopen(json_path, "w") : NULL;
+	if (json) {
+		fprintf(json, "{\n\t\"reps\": %d,\n\t\"cpu\": %d,\n\t\"threads\": %d,\n\t\"images\": [\n", reps, cpu,
+			threads);
+	}
+
+	printf("%d reps per image, pinned to CPU %d, %d thread(s), output converted to RGBA8\n\n", reps, cpu, threads);
+	printf("%-24s %9s %9s | %-27s | %-27s | %7s %s\n", "", "", "", "SIMD", "STBI_NO_SIMD", "", "");
+	printf("%-24s %9s %9s | %8s %8s %9s | %8s %8s %9s | %7s %s\n", "image", "KiB", "Mpixels",
+		"min ms", "med ms", "MB/s", "min ms", "med ms", "MB/s", "speedup", "output");
+
+	INAT mismatches = 0, reported = 0;
+	for (INAT i = 0; i < nimages; i++) {
+		const struct benchimage *img = &images[i];
+		if (filter && !strstr(img->name, filter)) continue;
+
+		struct benchresult simd = { 0 }, scalar = { 0 };
+		if (!run(img, reps, bench_load_simd, bench_free_simd, &simd)
+			|| !run(img, reps, bench_load_nosimd, bench_free_nosimd, &scalar)) {
+			printf("%-24s failed to decode: %s\n", img->name, bench_failure_reason());
+			bench_free_simd(simd.pixels);
+			continue;
+		}
+
+		R64 mpix = (R64)simd.width * simd.height / 1e6;
+		R64 mb = img->len / 1e6;
+		U1 same = simd.width == scalar.width && simd.height == scalar.height
+			&& !memcmp(simd.pixels, scalar.pixels, (size_t)simd.width * simd.height * 4);
+		if (!same) mismatches++;
+
+		printf("%-24s %9.1f %9.3f | %8.3f %8.3f %9.1f | %8.3f %8.3f %9.1f | %6.2fx %s\n",
+			img->name, img->len / 1024.0, mpix,
+			simd.min_ms, simd.median_ms, mb / (simd.median_ms / 1000.0),
+			scalar.min_ms, scalar.median_ms, mb / (scalar.median_ms / 1000.0),
+			scalar.median_ms / simd.median_ms, same ? "same" : "DIFFERS");
+
+		if (json) {
+			fprintf(json, "%s\t\t{ \"name\": \"%s\", \"bytes\": %zu, \"width\": %d, \"height\": %d, "
+				"\"simd_min_ms\": %.4f, \"simd_median_ms\": %.4f, \"simd_mpixels_per_s\": %.2f, "
+				"\"scalar_min_ms\": %.4f, \"scalar_median_ms\": %.4f, \"scalar_mpixels_per_s\": %.2f, "
+				"\"identical\": %s }",
+				reported++ ? ",\n" : "", img->name, img->len, simd.width, simd.height,
+				simd.min_ms, simd.median_ms, mpix / (simd.median_ms / 1000.0),
+				scalar.min_ms, scalar.median_ms, mpix / (scalar.median_ms / 1000.0), same ? "true" : "false");
+		}
+
+		bench_free_simd(simd.pixels);
+		bench_free_nosimd(scalar.pixels);
+	}
+
+	if (json) {
+		fprintf(json, "\n\t]\n}\n");
+		fclose(json);
+	}
+
+	for (INAT i = 0; i < nimages; i++) free(images[i].data);
+
+	if (mismatches) printf("\n%d image(s) decode differently with and without SIMD\n", mismatches);
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,17 @@
+#ifndef BENCH_STBI_H
+#define BENCH_STBI_H
+
+#include "holyh/src/holy.h"
+
+/* stb_image is compiled twice into bench_image, once as-is and once with STBI_NO_SIMD, each copy static in its own
+ * translation unit. These are the only ways in.
+ */
+U8 *bench_load_simd(const U8 *data, INAT len, INAT *x, INAT *y, INAT *comp, INAT req_comp);
+U8 *bench_load_nosimd(const U8 *data, INAT len, INAT *x, INAT *y, INAT *comp, INAT req_comp);
+X0 bench_free_simd(X0 *pixels);
+X0 bench_free_nosimd(X0 *pixels);
+const CHR *bench_failure_reason();
+/* Gives the SIMD copy a job pool (hz_jobs.h) of `threads` threads, 0 for one per CPU. Returns the thread count. */
+INAT bench_set_threads(INAT threads);
+
+#endif
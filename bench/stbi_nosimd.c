@@ -0,0 +1,15 @@
+#include "bench_stbi.h"
+#define STBI_NO_SIMD
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+U8 *bench_load_nosimd(const U8 *data, INAT len, INAT *x, INAT *y, INAT *comp, INAT req_comp)
+{
+	return stbi_load_from_memory(data, len, x, y, comp, req_comp);
+}
+
+X0 bench_free_nosimd(X0 *pixels)
+{
+	stbi_image_free(pixels);
+}
@@ -0,0 +1,33 @@
+#include "bench_stbi.h"
+#include "hz_jobs.h"
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+U8 *bench_load_simd(const U8 *data, INAT len, INAT *x, INAT *y, INAT *comp, INAT req_comp)
+{
+	return stbi_load_from_memory(data, len, x, y, comp, req_comp);
+}
+
+X0 bench_free_simd(X0 *pixels)
+{
+	stbi_image_free(pixels);
+}
+
+const CHR *bench_failure_reason()
+{
+	return stbi_failure_reason();
+}
+
+static X0 run_jobs(X0 *user, stbi_job_func *fn, X0 *data, INAT count)
+{
+	(X0)user;
+	hz_jobs_run(fn, data, count);
+}
+
+INAT bench_set_threads(INAT threads)
+{
+	hz_jobs_init(threads);
+	stbi_set_job_runner(run_jobs, NULL, hz_jobs_threads());
+	return hz_jobs_threads();
+}
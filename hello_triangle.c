@@ -4,6 +4,9 @@
 #include <GL/glew.h>
 #include <SDL2/SDL_opengl.h>
 #include <GL/glu.h>
+#include "hz_capture.h"
+#include "hz_frame.h"
+#include "hz_gpumem.h"
 
 /* This struct contains all of the properties for a window - borrowed from HAZE. */
 struct hzwinprop {
@@ -147,6 +150,11 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 	 * You'll see this in action a bit later.
 	 */
 	SDL_GL_SetSwapInterval(1);
+
+	/* Frame capture and fixed frame counts, if they were asked for on the command line. See hz_capture.h */
+	hz_capture_init(argc, argv);
+	/* --gpumem and --gpumem-budget, see hz_gpumem.h */
+	hz_gpumem_init(argc, argv);
 	
 	/* the shaders */
 	/* i think this is dumb. how do i include a shader as a separate file? */
@@ -221,6 +229,7 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 	
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	hz_gpumem_buffer(VBO, sizeof(vertices), "vertices");
 	
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(RNAT), (X0*)0);
 	glEnableVertexAttribArray(0);
@@ -267,12 +276,30 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 		glBindVertexArray(VAO);
 		glDrawArrays(GL_TRIANGLES, 0, 3);
 
+		/* Queue a readback of this frame if we're capturing. It has to happen before the swap. */
+		hz_capture_frame(primarywin.window);
+		if (hz_capture_done()) primarywin.quit = true;
+
 		/* Swap our buffer to display the current contents of buffer on screen.
 		 * Since we set SDL_GL_SetSwapInterval(1), this will use the monitor's refresh rate.
 		 */
 		SDL_GL_SwapWindow(primarywin.window);
+		hz_frame_end();
 	}
 
+	/* Dump GPU memory before the capture buffers go, so they're in it */
+	U1 within_budget = hz_gpumem_shutdown();
+	/* Flush out any frames still being read back. A capture that silently lost frames is worse than no capture. */
+	if (!hz_capture_shutdown()) errwindow("Frame capture failed! Check the terminal output for details.");
+	if (!within_budget) errwindow("Went over the GPU memory budget! Check the terminal output for details.");
+
+	glDeleteVertexArrays(1, &VAO);
+	hz_gpumem_free(HZ_GPUMEM_BUFFER, VBO);
+	glDeleteBuffers(1, &VBO);
+
+	/* Gives the frame arenas back and reports the most a frame needed */
+	hz_frame_shutdown();
+
 	/* Cleanup before exit, just in case. */
 	cleanup();
 
@@ -0,0 +1,228 @@
+#include "hz_arena.h"
+
+/* Every allocation is preceded by a header holding its size, so realloc works without being told the old size. The
+ * header is a full HZ_ARENA_ALIGN bytes to keep the allocation itself aligned.
+ */
+#define HZ_ARENA_HEADER HZ_ARENA_ALIGN
+
+/* Bytes of HZ_ARENA_GUARD at least, after each allocation */
+#ifdef HZ_ARENA_DEBUG
+#define GUARD_SIZE HZ_ARENA_ALIGN
+#else
+#define GUARD_SIZE 0
+#endif
+
+struct hzarenablock {
+	struct hzarenablock *next;
+	size_t cap;
+	size_t used;
+	size_t pad; /* Keeps data[] aligned on 64-bit */
+	U8 data[];
+};
+
+static size_t align_up(size_t n)
+{
+	return (n + HZ_ARENA_ALIGN - 1) & ~(size_t)(HZ_ARENA_ALIGN - 1);
+}
+
+static size_t alloc_size(const U8 *p)
+{
+	return *(const size_t*)(p - HZ_ARENA_HEADER);
+}
+
+/* Bytes an allocation of `size` takes up after its header, guard included */
+static size_t footprint(size_t size)
+{
+	return align_up(size + GUARD_SIZE);
+}
+
+#ifdef HZ_ARENA_DEBUG
+static X0 set_guard(U8 *p)
+{
+	size_t size = alloc_size(p);
+	memset(p + size, HZ_ARENA_GUARD, footprint(size) - size);
+}
+
+static X0 check_guard(const U8 *p)
+{
+	size_t size = alloc_size(p);
+	for (size_t i = size; i < footprint(size); i++) {
+		if (p[i] == HZ_ARENA_GUARD) continue;
+		fprintf(stderr, "arena: write past the end of a %zu byte allocation at %p (byte %zu is 0x%02x)\n", size,
+			(const X0*)p, i, p[i]);
+		abort();
+	}
+}
+#endif
+
+static struct hzarenablock *new_block(struct hzarena *a, size_t cap)
+{
+	struct hzarenablock *b = malloc(sizeof(struct hzarenablock) + cap);
+	if (!b) return NULL;
+	b->next = NULL;
+	b->cap = cap;
+	b->used = 0;
+	a->stats.heap_allocs++;
+	return b;
+}
+
+X0 hz_arena_init(struct hzarena *a, size_t initial, size_t keep)
+{
+	memset(a, 0, sizeof(*a));
+	a->initial = initial ? align_up(initial) : 64 * 1024;
+	a->keep = keep;
+}
+
+X0 *hz_arena_alloc(struct hzarena *a, size_t size)
+{
+	if (size > SIZE_MAX / 2) return NULL;
+	size_t need = HZ_ARENA_HEADER + footprint(size);
+	struct hzarenablock *b = a->head;
+
+	if (!b || b->cap - b->used < need) {
+		/* Double up each time so a big decode only costs a handful of blocks, the next reset merges them anyway */
+		size_t cap = b ? b->cap * 2 : a->initial;
+		if (cap < need) cap = align_up(need);
+		struct hzarenablock *nb = new_block(a, cap);
+		if (!nb) return NULL;
+		nb->next = b;
+		a->head = b = nb;
+	}
+
+	U8 *p = b->data + b->used + HZ_ARENA_HEADER;
+	*(size_t*)(p - HZ_ARENA_HEADER) = size;
+	b->used += need;
+	a->used += need;
+	a->last = p;
+#ifdef HZ_ARENA_DEBUG
+	memset(p, HZ_ARENA_FRESH, size);
+	set_guard(p);
+#endif
+
+	a->stats.allocs++;
+	a->stats.bytes += size;
+	if (a->used > a->stats.peak) a->stats.peak = a->used;
+	return p;
+}
+
+X0 *hz_arena_realloc(struct hzarena *a, X0 *ptr, size_t size)
+{
+	U8 *p = ptr;
+	if (!p) return hz_arena_alloc(a, size);
+	a->stats.reallocs++;
+
+	size_t old = alloc_size(p);
+	struct hzarenablock *b = a->head;
+#ifdef HZ_ARENA_DEBUG
+	check_guard(p);
+#endif
+	if (p == a->last && size <= SIZE_MAX / 2) {
+		/* The last allocation just moves the end of the block, if there's room */
+		size_t start = (size_t)(p - b->data), end = start + footprint(size);
+		if (end <= b->cap) {
+			size_t was = b->used;
+			b->used = end;
+			a->used = a->used - was + end;
+			*(size_t*)(p - HZ_ARENA_HEADER) = size;
+#ifdef HZ_ARENA_DEBUG
+			if (size > old) memset(p + old, HZ_ARENA_FRESH, size - old);
+			else if (was > end) memset(b->data + end, HZ_ARENA_POISON, was - end);
+			set_guard(p);
+#endif
+			if (size > old) a->stats.bytes += size - old;
+			if (a->used > a->stats.peak) a->stats.peak = a->used;
+			a->stats.grown_in_place++;
+			return p;
+		}
+	}
+
+	U8 *np = hz_arena_alloc(a, size);
+	if (!np) return NULL;
+	memcpy(np, p, old < size ? old : size);
+	return np;
+}
+
+X0 hz_arena_free(struct hzarena *a, X0 *ptr)
+{
+	U8 *p = ptr;
+	if (!p) return;
+	a->stats.frees++;
+#ifdef HZ_ARENA_DEBUG
+	check_guard(p);
+	if (p != a->last) memset(p, HZ_ARENA_POISON, alloc_size(p));
+#endif
+	if (p != a->last) return;
+
+	/* Undoing the last allocation gives its space back right away */
+	struct hzarenablock *b = a->head;
+	size_t start = (size_t)(p - b->data) - HZ_ARENA_HEADER;
+	a->used -= b->used - start;
+#ifdef HZ_ARENA_DEBUG
+	memset(b->data + start, HZ_ARENA_POISON, b->used - start);
+#endif
+	b->used = start;
+	a->last = NULL;
+}
+
+U1 hz_arena_owns(const struct hzarena *a, const X0 *ptr)
+{
+	const U8 *p = ptr;
+	for (const struct hzarenablock *b = a->head; b; b = b->next) {
+		if (p >= b->data && p < b->data + b->cap) return true;
+	}
+	return false;
+}
+
+X0 hz_arena_check(const struct hzarena *a)
+{
+#ifdef HZ_ARENA_DEBUG
+	/* Allocations sit back to back in each block, so the headers lead from one to the next */
+	for (const struct hzarenablock *b = a->head; b; b = b->next) {
+		for (size_t at = 0; at < b->used; at += HZ_ARENA_HEADER + footprint(alloc_size(b->data + at +
+			HZ_ARENA_HEADER))) check_guard(b->data + at + HZ_ARENA_HEADER);
+	}
+#else
+	(X0)a;
+#endif
+}
+
+X0 hz_arena_reset(struct hzarena *a)
+{
+	struct hzarenablock *b = a->head;
+	hz_arena_check(a);
+	a->used = 0;
+	a->last = NULL;
+	if (!b) return;
+
+	if (!b->next && (!a->keep || b->cap <= a->keep)) {
+#ifdef HZ_ARENA_DEBUG
+		memset(b->data, HZ_ARENA_POISON, b->used);
+#endif
+		b->used = 0;
+		return;
+	}
+
+	/* Several blocks (or one that's too big to keep): swap them for a single block that fits all of it */
+	size_t total = 0;
+	while (b) {
+		struct hzarenablock *next = b->next;
+		total += b->cap;
+		free(b);
+		b = next;
+	}
+	if (a->keep && total > a->keep) total = a->keep;
+	a->head = total >= a->initial ? new_block(a, total) : NULL;
+}
+
+X0 hz_arena_destroy(struct hzarena *a)
+{
+	struct hzarenablock *b = a->head;
+	while (b) {
+		struct hzarenablock *next = b->next;
+		free(b);
+		b = next;
+	}
+	a->head = NULL;
+	a->last = NULL;
+	a->used = 0;
+}
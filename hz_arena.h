@@ -0,0 +1,64 @@
+#ifndef HZ_ARENA_H
+#define HZ_ARENA_H
+
+#include "holyh/src/holy.h"
+
+/* A bump allocator. Allocations are carved off the end of a block, and the whole arena is released in one go with
+ * hz_arena_reset(). Individual frees only give memory back when they undo the most recent allocation, which is
+ * also the only allocation that can grow in place - that's exactly the pattern of a decoder growing its output
+ * buffer, and everything else just waits for the reset.
+ *
+ * When a block runs out, a bigger one is chained on. hz_arena_reset() merges the chain back into a single block
+ * sized for everything that was used, so after the first few resets a steady workload never touches the heap.
+ *
+ * With HZ_ARENA_DEBUG defined (the meson debug buildtype does that), every allocation is followed by a guard that's
+ * checked when it's freed or reallocated and on every reset, fresh memory is filled with HZ_ARENA_FRESH and released
+ * memory with HZ_ARENA_POISON. Overrunning an allocation, or using it after the reset, then shows up right away
+ * instead of as somebody else's corrupt data three frames later.
+ */
+
+#define HZ_ARENA_ALIGN 16
+
+#define HZ_ARENA_FRESH 0xcd /* HZ_ARENA_DEBUG fill patterns */
+#define HZ_ARENA_POISON 0xdd
+#define HZ_ARENA_GUARD 0xfd
+
+struct hzarenastats {
+	U64 allocs; /* hz_arena_alloc() calls, plus reallocs that had to move */
+	U64 reallocs;
+	U64 frees;
+	U64 grown_in_place; /* Reallocs of the last allocation that didn't need a copy */
+	U64 heap_allocs; /* Blocks the arena itself had to malloc() */
+	size_t bytes; /* Total bytes requested */
+	size_t peak; /* Most bytes in use at once, headers and padding included */
+};
+
+struct hzarenablock;
+
+struct hzarena {
+	struct hzarenablock *head; /* The block we allocate from, older (full) blocks hang off it */
+	U8 *last; /* Most recent allocation */
+	size_t used; /* Bytes in use across all blocks */
+	size_t initial; /* Size of the first block */
+	size_t keep; /* On reset, don't hang on to more than this (0 = no limit) */
+	struct hzarenastats stats;
+};
+
+X0 hz_arena_init(struct hzarena *a, size_t initial, size_t keep);
+/* Returns memory aligned to HZ_ARENA_ALIGN, or NULL if the heap is out. */
+X0 *hz_arena_alloc(struct hzarena *a, size_t size);
+/* Same contract as realloc(): NULL `p` allocates, the old contents are kept up to the smaller size. */
+X0 *hz_arena_realloc(struct hzarena *a, X0 *p, size_t size);
+X0 hz_arena_free(struct hzarena *a, X0 *p);
+/* True if `p` points into memory owned by the arena. */
+U1 hz_arena_owns(const struct hzarena *a, const X0 *p);
+/* Checks the guard of every live allocation and aborts (saying which) if one was overrun. Does nothing without
+ * HZ_ARENA_DEBUG, in which case it's also done on every reset.
+ */
+X0 hz_arena_check(const struct hzarena *a);
+/* Releases every allocation at once. Doesn't touch the stats. */
+X0 hz_arena_reset(struct hzarena *a);
+/* Gives all memory back to the heap. The arena can be used again afterwards, it starts over from `initial`. */
+X0 hz_arena_destroy(struct hzarena *a);
+
+#endif
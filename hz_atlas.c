@@ -0,0 +1,217 @@
+#include "hz_atlas.h"
+#include "hz_gpumem.h"
+#include "hz_file.h"
+#include "hz_stbi.h"
+#include "stb_image.h"
+#include <GL/glew.h>
+#include <limits.h>
+
+/* One segment of a page's outline: everything below y, from x to x + width, is taken */
+struct hzskyline {
+	U32 x, y, width;
+};
+
+X0 hz_atlas_init(struct hzatlas *a, U32 size)
+{
+	memset(a, 0, sizeof(*a));
+	a->size = size;
+}
+
+static struct hzatlaspage *add_page(struct hzatlas *a)
+{
+	struct hzatlaspage *pages = realloc(a->page, (a->pages + 1) * sizeof(*pages));
+	if (!pages) return NULL;
+	a->page = pages;
+
+	struct hzatlaspage *p = &pages[a->pages];
+	memset(p, 0, sizeof(*p));
+	p->node_cap = 16;
+	p->skyline = malloc(p->node_cap * sizeof(*p->skyline));
+	if (!p->skyline) return NULL;
+	p->skyline[0] = (struct hzskyline){ 0, 0, a->size };
+	p->nodes = 1;
+	a->pages++;
+	return p;
+}
+
+/* The height a w x h rectangle would sit at with its left edge on node i, or false if it runs off the page */
+static U1 fit(const struct hzatlaspage *p, U32 size, U32 i, U32 w, U32 h, U32 *y)
+{
+	U32 x = p->skyline[i].x, top = 0;
+	if (w > size - x) return false;
+
+	/* The outline always spans the whole page, so this can't run past the last node */
+	for (U32 left = w; left > 0; i++) {
+		if (p->skyline[i].y > top) top = p->skyline[i].y;
+		if (h > size - top) return false;
+		left = p->skyline[i].width >= left ? 0 : left - p->skyline[i].width;
+	}
+	*y = top;
+	return true;
+}
+
+/* Raises the outline over [x, x + w) to y + h. The new node goes in at i, where the rectangle's left edge is. */
+static U1 place(struct hzatlaspage *p, U32 i, U32 x, U32 y, U32 w, U32 h)
+{
+	if (p->nodes == p->node_cap) {
+		struct hzskyline *skyline = realloc(p->skyline, p->node_cap * 2 * sizeof(*skyline));
+		if (!skyline) return false;
+		p->skyline = skyline;
+		p->node_cap *= 2;
+	}
+	memmove(p->skyline + i + 1, p->skyline + i, (p->nodes - i) * sizeof(*p->skyline));
+	p->skyline[i] = (struct hzskyline){ x, y + h, w };
+	p->nodes++;
+
+	/* Eat whatever the rectangle now covers */
+	for (U32 j = i + 1; j < p->nodes && p->skyline[j].x < x + w;) {
+		struct hzskyline *n = &p->skyline[j];
+		U32 shrink = x + w - n->x;
+		if (shrink < n->width) {
+			n->x += shrink;
+			n->width -= shrink;
+			break;
+		}
+		memmove(n, n + 1, (p->nodes - j - 1) * sizeof(*n));
+		p->nodes--;
+	}
+
+	/* Neighbours at the same height are one segment */
+	for (U32 j = 0; j + 1 < p->nodes;) {
+		if (p->skyline[j].y == p->skyline[j + 1].y) {
+			p->skyline[j].width += p->skyline[j + 1].width;
+			memmove(p->skyline + j + 1, p->skyline + j + 2, (p->nodes - j - 2) * sizeof(*p->skyline));
+			p->nodes--;
+		} else {
+			j++;
+		}
+	}
+	return true;
+}
+
+U1 hz_atlas_pack(struct hzatlas *a, U32 w, U32 h, U32 *page, U32 *x, U32 *y)
+{
+	if (w > a->size - 2 * HZ_ATLAS_PADDING || h > a->size - 2 * HZ_ATLAS_PADDING) return false;
+	w += 2 * HZ_ATLAS_PADDING;
+	h += 2 * HZ_ATLAS_PADDING;
+
+	/* Earlier pages first, so they fill up before we start on a new one. Most images go in one of the last few. */
+	for (U32 pi = 0; pi <= a->pages; pi++) {
+		struct hzatlaspage *p = pi < a->pages ? &a->page[pi] : add_page(a);
+		if (!p) return false;
+
+		U32 best = UINT_MAX, best_top = UINT_MAX, best_y = 0;
+		for (U32 i = 0; i < p->nodes; i++) {
+			U32 top;
+			if (fit(p, a->size, i, w, h, &top) && top + h < best_top) {
+				best = i;
+				best_top = top + h;
+				best_y = top;
+			}
+		}
+		if (best == UINT_MAX) continue;
+
+		U32 bx = p->skyline[best].x;
+		if (!place(p, best, bx, best_y, w, h)) return false;
+		a->area += (U64)w * h;
+		*page = pi;
+		*x = bx + HZ_ATLAS_PADDING;
+		*y = best_y + HZ_ATLAS_PADDING;
+		return true;
+	}
+	return false;
+}
+
+static U16 normalise(U32 texel, U32 size)
+{
+	return (U16)(((U64)texel * 65535 + size / 2) / size);
+}
+
+U1 hz_atlas_add(struct hzatlas *a, const U8 *rgba, U32 w, U32 h, struct hzsprite *s)
+{
+	const U32 pad = HZ_ATLAS_PADDING;
+	U32 page, x, y, pw = w + 2 * pad, ph = h + 2 * pad;
+	U8 *padded = malloc((size_t)pw * ph * 4);
+	if (!padded || !hz_atlas_pack(a, w, h, &page, &x, &y)) {
+		fprintf(stderr, "atlas: no room for a %ux%u image in %ux%u pages%s\n", w, h, a->size, a->size,
+			padded ? "" : " (out of memory)");
+		free(padded);
+		return false;
+	}
+
+	/* Repeat the edges out into the padding, clamping the source coordinates does the corners too */
+	for (U32 py = 0; py < ph; py++) {
+		U32 sy = py < pad ? 0 : py - pad >= h ? h - 1 : py - pad;
+		for (U32 px = 0; px < pw; px++) {
+			U32 sx = px < pad ? 0 : px - pad >= w ? w - 1 : px - pad;
+			memcpy(padded + ((size_t)py * pw + px) * 4, rgba + ((size_t)sy * w + sx) * 4, 4);
+		}
+	}
+
+	struct hzatlaspage *p = &a->page[page];
+	if (!p->texture) {
+		glGenTextures(1, &p->texture);
+		glBindTexture(GL_TEXTURE_2D, p->texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, a->size, a->size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		hz_gpumem_texture(p->texture, GL_RGBA8, a->size, a->size, 1, 1, "atlas");
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, p->texture);
+	/* Rows of RGBA8 are always a multiple of the default GL_UNPACK_ALIGNMENT */
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x - pad, y - pad, pw, ph, GL_RGBA, GL_UNSIGNED_BYTE, padded);
+	free(padded);
+
+	s->page = page;
+	s->texture = p->texture;
+	s->width = w;
+	s->height = h;
+	s->u0 = normalise(x, a->size);
+	s->v0 = normalise(y, a->size);
+	s->u1 = normalise(x + w, a->size);
+	s->v1 = normalise(y + h, a->size);
+	return true;
+}
+
+U1 hz_atlas_add_file(struct hzatlas *a, const CHR *path, struct hzsprite *s)
+{
+	INAT w, h, comp;
+	struct hzfile f;
+	if (!hz_file_map(&f, path, HZ_FILE_SEQUENTIAL)) return false;
+	if (f.size > INT_MAX || !stbi_info_from_memory(f.data, f.size, &w, &h, &comp)) {
+		fprintf(stderr, "atlas: unable to load %s: %s\n", path,
+			f.size > INT_MAX ? "File too large" : stbi_failure_reason());
+		hz_file_unmap(&f);
+		return false;
+	}
+
+	U8 *pixels = malloc((size_t)w * h * 4);
+	stbi_set_flip_vertically_on_load(1);
+	U1 ok = pixels && hz_stbi_load_from_memory_into(f.data, f.size, pixels, (size_t)w * h * 4, w * 4, &w, &h, NULL, 4);
+	hz_file_unmap(&f);
+	if (!ok) fprintf(stderr, "atlas: unable to load %s: %s\n", path, pixels ? stbi_failure_reason() : "Out of memory");
+	else ok = hz_atlas_add(a, pixels, w, h, s);
+	free(pixels);
+	return ok;
+}
+
+R64 hz_atlas_occupancy(const struct hzatlas *a)
+{
+	return a->pages ? (R64)a->area / ((R64)a->size * a->size * a->pages) : 0.0;
+}
+
+X0 hz_atlas_destroy(struct hzatlas *a)
+{
+	for (U32 i = 0; i < a->pages; i++) {
+		if (a->page[i].texture) {
+			glDeleteTextures(1, &a->page[i].texture);
+			hz_gpumem_free(HZ_GPUMEM_TEXTURE, a->page[i].texture);
+		}
+		free(a->page[i].skyline);
+	}
+	free(a->page);
+	memset(a, 0, sizeof(*a));
+}
@@ -0,0 +1,62 @@
+#ifndef HZ_ATLAS_H
+#define HZ_ATLAS_H
+
+#include "holyh/src/holy.h"
+
+/* Texture atlases: lots of small images packed into a few big GL_RGBA8 page textures, so things drawn with different
+ * images can still go out in one draw call (see hz_sprite.h).
+ *
+ * Rectangles are placed with a skyline packer: each page keeps the outline of its filled area as a list of horizontal
+ * segments, and a new rectangle goes wherever its top edge ends up lowest, leftmost on ties. It wastes a little more
+ * space than maxrects, but adding an image costs a walk over a few dozen segments instead of a few thousand free
+ * rectangles. When no page has room, a new page is opened.
+ *
+ * Every image gets HZ_ATLAS_PADDING texels of its own edge pixels repeated around it, so linear filtering never
+ * bleeds in a neighbour. The pages have no mipmaps.
+ */
+
+#define HZ_ATLAS_PADDING 1
+
+struct hzskyline;
+
+struct hzatlaspage {
+	UNAT texture; /* Created on the first image uploaded to the page */
+	struct hzskyline *skyline;
+	U32 nodes;
+	U32 node_cap;
+};
+
+struct hzatlas {
+	U32 size; /* Page width and height */
+	U32 pages;
+	struct hzatlaspage *page;
+	U64 area; /* Texels taken, padding included */
+};
+
+/* Where an image ended up. u/v are normalised to 0..65535 over the page, v0 is the bottom row (GL's order). */
+struct hzsprite {
+	U32 page;
+	UNAT texture;
+	U32 width, height;
+	U16 u0, v0, u1, v1;
+};
+
+/* Sets up an empty atlas with `size` x `size` pages, which has to be within GL_MAX_TEXTURE_SIZE. Doesn't touch GL. */
+X0 hz_atlas_init(struct hzatlas *a, U32 size);
+/* Finds room for a w x h rectangle (padding not included) and returns its page and bottom left corner, inside the
+ * padding. Only does the packing, without uploading anything. Returns false if the rectangle can't fit on a page at
+ * all, or the heap is out.
+ */
+U1 hz_atlas_pack(struct hzatlas *a, U32 w, U32 h, U32 *page, U32 *x, U32 *y);
+/* Packs a w x h image of tightly packed RGBA8, bottom row first, and uploads it. Leaves GL_TEXTURE_2D bound to its
+ * page. Returns false (with a message on stderr) if it doesn't fit.
+ */
+U1 hz_atlas_add(struct hzatlas *a, const U8 *rgba, U32 w, U32 h, struct hzsprite *s);
+/* Loads an image file through hz_stbi and adds it, flipped to bottom row first like hz_texture_load() does. */
+U1 hz_atlas_add_file(struct hzatlas *a, const CHR *path, struct hzsprite *s);
+/* Fraction of the pages' area in use, padding included. */
+R64 hz_atlas_occupancy(const struct hzatlas *a);
+/* Frees the packing state and deletes the page textures. */
+X0 hz_atlas_destroy(struct hzatlas *a);
+
+#endif
@@ -0,0 +1,203 @@
+#include "hz_batch.h"
+#include "hz_frame.h"
+#include <math.h>
+
+/* One hz_batch_add(), until it's merged into its chunk */
+struct hzbatchplacement {
+	U32 material;
+	I32 cell[3];
+	U32 first_vertex, vertex_count;
+	U32 first_index, index_count;
+	R32 min[3], max[3];
+};
+
+X0 hz_batch_init(struct hzbatch *b, U32 vertex_size, U32 position, I32 normal, R32 chunk_size, U1 allow_indirect)
+{
+	memset(b, 0, sizeof(*b));
+	hz_meshpool_init(&b->pool, vertex_size, allow_indirect);
+	b->vertex_size = vertex_size;
+	b->position = position;
+	b->normal = normal;
+	b->chunk_size = chunk_size > 0.0f ? chunk_size : 1.0f;
+}
+
+/* Grows `*array` to hold `need` elements of `size` bytes, doubling */
+static U1 reserve(X0 **array, U32 *cap, U32 need, size_t size)
+{
+	if (need <= *cap) return true;
+	U32 n = *cap ? *cap : 1024;
+	while (n < need) n *= 2;
+	X0 *a = realloc(*array, (size_t)n * size);
+	if (!a) return false;
+	*array = a;
+	*cap = n;
+	return true;
+}
+
+U1 hz_batch_add(struct hzbatch *b, U32 material, const X0 *vertices, U32 vertex_count, const U32 *indices,
+	U32 index_count, const R32 model[16])
+{
+	if (!vertex_count || index_count < 3) return true;
+	if (vertex_count > UINT32_MAX / 2 - b->vertex_count || index_count > UINT32_MAX / 2 - b->index_count
+		|| !reserve((X0**)&b->vertices, &b->vertex_cap, b->vertex_count + vertex_count, b->vertex_size)
+		|| !reserve((X0**)&b->indices, &b->index_cap, b->index_count + index_count, sizeof(U32))
+		|| !reserve((X0**)&b->placement, &b->placement_cap, b->placements + 1, sizeof(*b->placement))) {
+		fprintf(stderr, "batch: out of memory\n");
+		return false;
+	}
+
+	/* Normals want the inverse transpose of the upper 3x3, whose columns are the cross products of the matrix's
+	 * columns over the determinant. They get normalised anyway, so only the determinant's sign matters, and that
+	 * also says whether the matrix mirrors.
+	 */
+	const R32 *m = model;
+	R32 cof[9] = {
+		m[5] * m[10] - m[6] * m[9], m[6] * m[8] - m[4] * m[10], m[4] * m[9] - m[5] * m[8],
+		m[9] * m[2] - m[10] * m[1], m[10] * m[0] - m[8] * m[2], m[8] * m[1] - m[9] * m[0],
+		m[1] * m[6] - m[2] * m[5], m[2] * m[4] - m[0] * m[6], m[0] * m[5] - m[1] * m[4]
+	};
+	R32 det = m[0] * cof[0] + m[1] * cof[1] + m[2] * cof[2];
+	if (det < 0.0f) for (INAT i = 0; i < 9; i++) cof[i] = -cof[i];
+
+	struct hzbatchplacement *pl = &b->placement[b->placements++];
+	*pl = (struct hzbatchplacement){ material, {0}, b->vertex_count, vertex_count, b->index_count, index_count,
+		{ INFINITY, INFINITY, INFINITY }, { -INFINITY, -INFINITY, -INFINITY } };
+
+	U8 *out = b->vertices + (size_t)b->vertex_count * b->vertex_size;
+	memcpy(out, vertices, (size_t)vertex_count * b->vertex_size);
+	for (U32 v = 0; v < vertex_count; v++, out += b->vertex_size) {
+		/* memcpy() because nothing says the caller's layout keeps floats aligned */
+		R32 p[3], w[3];
+		memcpy(p, out + b->position, sizeof(p));
+		for (INAT r = 0; r < 3; r++) {
+			w[r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r];
+			if (w[r] < pl->min[r]) pl->min[r] = w[r];
+			if (w[r] > pl->max[r]) pl->max[r] = w[r];
+		}
+		memcpy(out + b->position, w, sizeof(w));
+
+		if (b->normal == HZ_BATCH_NO_NORMAL) continue;
+		R32 n[3], len = 0.0f;
+		memcpy(n, out + b->normal, sizeof(n));
+		for (INAT r = 0; r < 3; r++) {
+			w[r] = cof[r] * n[0] + cof[3 + r] * n[1] + cof[6 + r] * n[2];
+			len += w[r] * w[r];
+		}
+		len = len > 0.0f ? 1.0f / sqrtf(len) : 0.0f;
+		for (INAT r = 0; r < 3; r++) w[r] *= len;
+		memcpy(out + b->normal, w, sizeof(w));
+	}
+
+	U32 *idx = b->indices + b->index_count;
+	memcpy(idx, indices, (size_t)index_count * sizeof(U32));
+	if (det < 0.0f) {
+		for (U32 i = 0; i + 2 < index_count; i += 3) {
+			U32 t = idx[i + 1];
+			idx[i + 1] = idx[i + 2];
+			idx[i + 2] = t;
+		}
+	}
+	b->vertex_count += vertex_count;
+	b->index_count += index_count;
+
+	for (INAT r = 0; r < 3; r++) pl->cell[r] = (I32)floorf((pl->min[r] + pl->max[r]) * 0.5f / b->chunk_size);
+	return true;
+}
+
+static INAT placement_order(const X0 *a, const X0 *b)
+{
+	const struct hzbatchplacement *x = a, *y = b;
+	if (x->material != y->material) return x->material < y->material ? -1 : 1;
+	for (INAT r = 0; r < 3; r++) if (x->cell[r] != y->cell[r]) return x->cell[r] < y->cell[r] ? -1 : 1;
+	/* Keep the order they were added in, qsort() isn't stable */
+	return x->first_vertex < y->first_vertex ? -1 : x->first_vertex > y->first_vertex;
+}
+
+static U1 same_chunk(const struct hzbatchplacement *x, const struct hzbatchplacement *y)
+{
+	return x->material == y->material && x->cell[0] == y->cell[0] && x->cell[1] == y->cell[1]
+		&& x->cell[2] == y->cell[2];
+}
+
+U1 hz_batch_build(struct hzbatch *b)
+{
+	qsort(b->placement, b->placements, sizeof(*b->placement), placement_order);
+
+	/* At most one chunk per placement */
+	b->chunk = malloc((b->placements ? b->placements : 1) * sizeof(*b->chunk));
+	U8 *vertices = malloc((size_t)(b->vertex_count ? b->vertex_count : 1) * b->vertex_size);
+	U32 *indices = malloc((size_t)(b->index_count ? b->index_count : 1) * sizeof(U32));
+	U1 ok = b->chunk && vertices && indices;
+	if (!ok) fprintf(stderr, "batch: out of memory\n");
+
+	for (U32 first = 0, last; ok && first < b->placements; first = last) {
+		struct hzbatchchunk *c = &b->chunk[b->chunks];
+		*c = (struct hzbatchchunk){ b->placement[first].material, 0, 0,
+			{ INFINITY, INFINITY, INFINITY }, { -INFINITY, -INFINITY, -INFINITY } };
+
+		/* Gather the chunk's placements into one mesh, rebasing their indices onto it */
+		U32 vcount = 0, icount = 0;
+		for (last = first; last < b->placements && same_chunk(&b->placement[first], &b->placement[last]); last++) {
+			const struct hzbatchplacement *pl = &b->placement[last];
+			memcpy(vertices + (size_t)vcount * b->vertex_size,
+				b->vertices + (size_t)pl->first_vertex * b->vertex_size, (size_t)pl->vertex_count * b->vertex_size);
+			for (U32 i = 0; i < pl->index_count; i++) indices[icount + i] = b->indices[pl->first_index + i] + vcount;
+			vcount += pl->vertex_count;
+			icount += pl->index_count;
+			for (INAT r = 0; r < 3; r++) {
+				if (pl->min[r] < c->min[r]) c->min[r] = pl->min[r];
+				if (pl->max[r] > c->max[r]) c->max[r] = pl->max[r];
+			}
+			c->placements++;
+		}
+
+		INAT mesh = hz_meshpool_add(&b->pool, vertices, vcount, indices, icount);
+		if (mesh < 0) ok = false;
+		c->mesh = mesh;
+		b->triangles += icount / 3;
+		b->chunks++;
+	}
+
+	free(vertices);
+	free(indices);
+	free(b->vertices);
+	free(b->indices);
+	free(b->placement);
+	b->vertices = NULL;
+	b->indices = NULL;
+	b->placement = NULL;
+	b->vertex_count = b->vertex_cap = b->index_count = b->index_cap = b->placements = b->placement_cap = 0;
+
+	/* No draw IDs: there's one model matrix for everything, the identity */
+	return ok && hz_meshpool_upload(&b->pool, 0);
+}
+
+X0 hz_batch_destroy(struct hzbatch *b)
+{
+	hz_meshpool_destroy(&b->pool);
+	free(b->vertices);
+	free(b->indices);
+	free(b->placement);
+	free(b->chunk);
+	memset(b, 0, sizeof(*b));
+}
+
+U32 hz_batch_draw(struct hzbatch *b, U32 material, const struct hzfrustum *frustum, struct hzocclusion *occlusion,
+	U32 *visible)
+{
+	/* The chunks are sorted by material, so this material's are one run */
+	U32 first = 0, last;
+	while (first < b->chunks && b->chunk[first].material != material) first++;
+	for (last = first; last < b->chunks && b->chunk[last].material == material; last++);
+
+	struct hzdrawlist list;
+	if (!hz_drawlist_begin(&list, last - first)) return 0;
+	for (U32 i = first; i < last; i++) {
+		const struct hzbatchchunk *c = &b->chunk[i];
+		if (frustum && !hz_frustum_aabb(frustum, c->min, c->max)) continue;
+		if (occlusion && !hz_occlusion_aabb(occlusion, c->min, c->max)) continue;
+		hz_drawlist_add(&list, &b->pool, c->mesh, 1);
+	}
+	if (visible) *visible += list.count;
+	return hz_meshpool_draw(&b->pool, &list);
+}
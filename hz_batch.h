@@ -0,0 +1,81 @@
+#ifndef HZ_BATCH_H
+#define HZ_BATCH_H
+
+#include "holyh/src/holy.h"
+#include "hz_frustum.h"
+#include "hz_meshpool.h"
+#include "hz_occlusion.h"
+
+/* Static geometry batching, done once at load time. Scenery made of lots of small meshes that never move (the crates,
+ * the rocks, the lamp posts) costs a draw call each if it's drawn like everything else. Instead, every placement of a
+ * mesh gets added here with its model matrix and a material (whatever the caller means by that: a texture, a
+ * program, a set of uniforms), and hz_batch_build() pre-transforms all of it into world space and merges it into a
+ * handful of big meshes in an hz_meshpool (see hz_meshpool.h), which the shaders draw with an identity model matrix.
+ *
+ * Merging everything of one material into a single mesh would make it impossible to cull, so the world is cut into a
+ * grid of chunk_size cubes, and each material gets a mesh per cell it has anything in. A placement goes to the cell
+ * its bounding box is centred in, whole, so a chunk's bounds can stick out of its cell a bit but no triangle is ever
+ * split. hz_batch_draw() tests every chunk of a material against the frustum and draws the ones that pass in one call.
+ *
+ * The vertex layout is the caller's, hz_batch only needs to know where the position (three floats) and, optionally,
+ * the normal (three floats) are. Normals go through the inverse transpose, so non-uniform scales are fine, and
+ * placements with a mirroring matrix get their winding flipped so they still face the right way.
+ */
+
+#define HZ_BATCH_NO_NORMAL -1
+
+struct hzbatchchunk {
+	U32 material;
+	U32 mesh; /* In the pool */
+	U32 placements;
+	R32 min[3], max[3]; /* World space bounds */
+};
+
+struct hzbatchplacement;
+
+struct hzbatch {
+	struct hzmeshpool pool;
+	U32 vertex_size;
+	U32 position; /* Byte offsets into a vertex */
+	I32 normal; /* Or HZ_BATCH_NO_NORMAL */
+	R32 chunk_size;
+
+	/* Pre-transformed, staged until hz_batch_build() */
+	U8 *vertices;
+	U32 vertex_count, vertex_cap;
+	U32 *indices;
+	U32 index_count, index_cap;
+	struct hzbatchplacement *placement;
+	U32 placements, placement_cap;
+
+	struct hzbatchchunk *chunk; /* Sorted by material */
+	U32 chunks;
+	U32 triangles;
+};
+
+/* Sets up an empty batch for vertices of `vertex_size` bytes, with the position `position` bytes in and the normal
+ * `normal` bytes in (or HZ_BATCH_NO_NORMAL), cut into chunks of `chunk_size` world units. `allow_indirect` goes to
+ * hz_meshpool_init().
+ */
+X0 hz_batch_init(struct hzbatch *b, U32 vertex_size, U32 position, I32 normal, R32 chunk_size, U1 allow_indirect);
+/* Places a mesh (indexed triangles, indices relative to its own vertices) in the world with a column major model
+ * matrix. The vertices are transformed and copied right away, so they don't need to stay around. Returns false, with
+ * a message on stderr, if we're out of memory.
+ */
+U1 hz_batch_add(struct hzbatch *b, U32 material, const X0 *vertices, U32 vertex_count, const U32 *indices,
+	U32 index_count, const R32 model[16]);
+/* Merges everything added so far into chunks and uploads them. Like hz_meshpool_upload(), leaves the VAO and the
+ * vertex buffer bound for the caller's vertex attributes. Nothing can be added after. Returns false (with a message
+ * on stderr) if that didn't work out.
+ */
+U1 hz_batch_build(struct hzbatch *b);
+X0 hz_batch_destroy(struct hzbatch *b);
+
+/* Draws the chunks of `material` inside the frustum (all of them if `frustum` is NULL) and not hidden behind the
+ * occluders in `occlusion` (if that isn't NULL, see hz_occlusion.h) with whatever program is current. Returns the
+ * number of draw calls that took, and adds the chunks that were drawn to `*visible` if that isn't NULL.
+ */
+U32 hz_batch_draw(struct hzbatch *b, U32 material, const struct hzfrustum *frustum, struct hzocclusion *occlusion,
+	U32 *visible);
+
+#endif
@@ -0,0 +1,462 @@
+#include "hz_bc.h"
+#include "hz_jobs.h"
+#include <GL/glew.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* One 4x4 block as a plane of floats per channel, so the SSE2 loops can take 4 pixels at a time */
+struct bcblock {
+	R32 c[4][16];
+};
+
+/* Interpolation weights of BC7's 4-bit indices, out of 64 */
+static const U8 bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static const CHR *names[] = { "bc1", "bc3", "bc7" };
+
+size_t hz_bc_size(enum hzbcformat format, U32 w, U32 h)
+{
+	return (size_t)((w + 3) / 4) * ((h + 3) / 4) * (format == HZ_BC1 ? 8 : 16);
+}
+
+UNAT hz_bc_gl_format(enum hzbcformat format, U1 srgb)
+{
+	switch (format) {
+	case HZ_BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case HZ_BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case HZ_BC7: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+	return 0;
+}
+
+const CHR *hz_bc_name(enum hzbcformat format)
+{
+	return names[format];
+}
+
+U1 hz_bc_parse(const CHR *name, enum hzbcformat *format)
+{
+	for (INAT i = 0; i < (INAT)(sizeof(names) / sizeof(names[0])); i++) {
+		if (!strcmp(name, names[i])) {
+			*format = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static R32 clamp255(R32 v)
+{
+	return v < 0.0f ? 0.0f : v > 255.0f ? 255.0f : v;
+}
+
+static X0 load_block(const U8 *rgba, U32 w, U32 h, U32 bx, U32 by, struct bcblock *b)
+{
+	for (U32 y = 0; y < 4; y++) {
+		U32 sy = by * 4 + y < h ? by * 4 + y : h - 1;
+		for (U32 x = 0; x < 4; x++) {
+			U32 sx = bx * 4 + x < w ? bx * 4 + x : w - 1;
+			const U8 *p = rgba + ((size_t)sy * w + sx) * 4;
+			for (INAT c = 0; c < 4; c++) b->c[c][y * 4 + x] = p[c];
+		}
+	}
+}
+
+/* Endpoints for the first `channels` channels: the extremes of the block along its principal axis, which we find by
+ * power iteration on the covariance matrix.
+ */
+static X0 axis_endpoints(const struct bcblock *b, INAT channels, R32 e0[4], R32 e1[4])
+{
+	R32 mean[4] = { 0 }, cov[4][4] = { { 0 } }, axis[4] = { 0 };
+	for (INAT c = 0; c < channels; c++) {
+		for (INAT i = 0; i < 16; i++) mean[c] += b->c[c][i];
+		mean[c] /= 16.0f;
+	}
+	for (INAT i = 0; i < 16; i++) {
+		for (INAT c = 0; c < channels; c++) {
+			for (INAT k = 0; k < channels; k++) cov[c][k] += (b->c[c][i] - mean[c]) * (b->c[k][i] - mean[k]);
+		}
+	}
+
+	/* Start from the channel with the most spread, it's never orthogonal to the answer */
+	INAT widest = 0;
+	for (INAT c = 1; c < channels; c++) if (cov[c][c] > cov[widest][widest]) widest = c;
+	for (INAT c = 0; c < channels; c++) axis[c] = cov[widest][c];
+	for (INAT iter = 0; iter < 8; iter++) {
+		R32 next[4] = { 0 }, big = 0.0f;
+		for (INAT c = 0; c < channels; c++) {
+			for (INAT k = 0; k < channels; k++) next[c] += cov[c][k] * axis[k];
+			if (fabsf(next[c]) > big) big = fabsf(next[c]);
+		}
+		if (big < 1e-12f) break;
+		for (INAT c = 0; c < channels; c++) axis[c] = next[c] / big;
+	}
+
+	R32 len = 0.0f, lo = 0.0f, hi = 0.0f;
+	for (INAT c = 0; c < channels; c++) len += axis[c] * axis[c];
+	len = sqrtf(len);
+	for (INAT c = 0; c < channels; c++) axis[c] = len > 1e-6f ? axis[c] / len : 0.0f;
+	for (INAT i = 0; i < 16; i++) {
+		R32 t = 0.0f;
+		for (INAT c = 0; c < channels; c++) t += (b->c[c][i] - mean[c]) * axis[c];
+		if (t < lo) lo = t;
+		if (t > hi) hi = t;
+	}
+	for (INAT c = 0; c < channels; c++) {
+		e0[c] = clamp255(mean[c] + lo * axis[c]);
+		e1[c] = clamp255(mean[c] + hi * axis[c]);
+	}
+}
+
+/* Where each pixel falls on the line from e0 to e1, as the nearest of `levels` evenly spaced points */
+static X0 project(const struct bcblock *b, INAT channels, const R32 e0[4], const R32 e1[4], INAT levels, U8 level[16])
+{
+	R32 d[4], len2 = 0.0f;
+	for (INAT c = 0; c < channels; c++) {
+		d[c] = e1[c] - e0[c];
+		len2 += d[c] * d[c];
+	}
+	if (len2 < 1e-6f) {
+		memset(level, 0, 16);
+		return;
+	}
+	for (INAT c = 0; c < channels; c++) d[c] *= (levels - 1) / len2;
+
+#ifdef __SSE2__
+	__m128 top = _mm_set1_ps(levels - 1);
+	for (INAT i = 0; i < 16; i += 4) {
+		__m128 t = _mm_setzero_ps();
+		for (INAT c = 0; c < channels; c++) {
+			__m128 v = _mm_sub_ps(_mm_loadu_ps(b->c[c] + i), _mm_set1_ps(e0[c]));
+			t = _mm_add_ps(t, _mm_mul_ps(v, _mm_set1_ps(d[c])));
+		}
+		t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), top);
+		__m128i q = _mm_cvtps_epi32(t);
+		q = _mm_packs_epi32(q, q);
+		q = _mm_packus_epi16(q, q);
+		INAT packed = _mm_cvtsi128_si32(q);
+		memcpy(level + i, &packed, 4);
+	}
+#else
+	for (INAT i = 0; i < 16; i++) {
+		R32 t = 0.0f;
+		for (INAT c = 0; c < channels; c++) t += (b->c[c][i] - e0[c]) * d[c];
+		t = t < 0.0f ? 0.0f : t > levels - 1 ? levels - 1 : t;
+		level[i] = (U8)(t + 0.5f);
+	}
+#endif
+}
+
+/* Least squares fit of the endpoints to the pixels, given which point on the line each pixel uses. `weights` gives the
+ * position of each level out of 64, NULL means evenly spaced. Leaves the endpoints alone if every pixel is on the
+ * same level.
+ */
+static X0 refine(const struct bcblock *b, INAT channels, const U8 level[16], INAT levels, const U8 *weights,
+	R32 e0[4], R32 e1[4])
+{
+	R32 aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[4] = { 0 }, bx[4] = { 0 };
+	for (INAT i = 0; i < 16; i++) {
+		R32 t = weights ? weights[level[i]] / 64.0f : level[i] / (R32)(levels - 1), s = 1.0f - t;
+		aa += s * s;
+		ab += s * t;
+		bb += t * t;
+		for (INAT c = 0; c < channels; c++) {
+			ax[c] += s * b->c[c][i];
+			bx[c] += t * b->c[c][i];
+		}
+	}
+
+	R32 det = aa * bb - ab * ab;
+	if (fabsf(det) < 1e-6f) return;
+	for (INAT c = 0; c < channels; c++) {
+		e0[c] = clamp255((ax[c] * bb - bx[c] * ab) / det);
+		e1[c] = clamp255((bx[c] * aa - ax[c] * ab) / det);
+	}
+}
+
+static U16 pack565(const R32 c[4])
+{
+	return (U16)((INAT)(c[0] * 31.0f / 255.0f + 0.5f) << 11 | (INAT)(c[1] * 63.0f / 255.0f + 0.5f) << 5
+		| (INAT)(c[2] * 31.0f / 255.0f + 0.5f));
+}
+
+static X0 unpack565(U16 v, U8 c[4])
+{
+	U8 r = v >> 11, g = (v >> 5) & 63, b = v & 31;
+	c[0] = r << 3 | r >> 2;
+	c[1] = g << 2 | g >> 4;
+	c[2] = b << 3 | b >> 2;
+	c[3] = 255;
+}
+
+/* The colour half of BC1 and BC3, always in 4 colour mode */
+static X0 encode_color(const struct bcblock *b, U8 *out)
+{
+	static const U8 order[4] = { 0, 2, 3, 1 }; /* Index of each level, going from c0 to c1 */
+	R32 e0[4], e1[4], q0[4], q1[4];
+	U8 level[16], u[4];
+	U32 indices = 0;
+
+	axis_endpoints(b, 3, e0, e1);
+	project(b, 3, e0, e1, 4, level);
+	refine(b, 3, level, 4, NULL, e0, e1);
+
+	/* 4 colour mode needs c0 > c1, and c0 == c1 is fine as long as every index is 0 */
+	U16 c0 = pack565(e0), c1 = pack565(e1);
+	if (c0 < c1) {
+		U16 t = c0;
+		c0 = c1;
+		c1 = t;
+	}
+	if (c0 != c1) {
+		unpack565(c0, u);
+		for (INAT c = 0; c < 3; c++) q0[c] = u[c];
+		unpack565(c1, u);
+		for (INAT c = 0; c < 3; c++) q1[c] = u[c];
+		project(b, 3, q0, q1, 4, level);
+		for (INAT i = 0; i < 16; i++) indices |= (U32)order[level[i]] << (2 * i);
+	}
+
+	out[0] = c0 & 0xff;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 0xff;
+	out[3] = c1 >> 8;
+	for (INAT i = 0; i < 4; i++) out[4 + i] = indices >> (8 * i);
+}
+
+/* BC3's alpha half: the 8 level mode, spanning the block's alpha range */
+static X0 encode_alpha(const struct bcblock *b, U8 *out)
+{
+	static const U8 order[8] = { 0, 2, 3, 4, 5, 6, 7, 1 }; /* Index of each level, from a0 down to a1 */
+	const R32 *a = b->c[3];
+	R32 lo = a[0], hi = a[0];
+	U64 indices = 0;
+	for (INAT i = 1; i < 16; i++) {
+		if (a[i] < lo) lo = a[i];
+		if (a[i] > hi) hi = a[i];
+	}
+
+	if (hi > lo) {
+		for (INAT i = 0; i < 16; i++) indices |= (U64)order[(INAT)((hi - a[i]) * 7.0f / (hi - lo) + 0.5f)] << (3 * i);
+	}
+	out[0] = (U8)hi;
+	out[1] = (U8)lo;
+	for (INAT i = 0; i < 6; i++) out[2 + i] = indices >> (8 * i);
+}
+
+static X0 put_bits(U8 *out, U32 *pos, U32 value, U32 count)
+{
+	for (U32 i = 0; i < count; i++, (*pos)++) {
+		if ((value >> i) & 1) out[*pos >> 3] |= 1 << (*pos & 7);
+	}
+}
+
+static U32 get_bits(const U8 *in, U32 *pos, U32 count)
+{
+	U32 value = 0;
+	for (U32 i = 0; i < count; i++, (*pos)++) value |= (U32)((in[*pos >> 3] >> (*pos & 7)) & 1) << i;
+	return value;
+}
+
+/* A BC7 mode 6 endpoint is 7 bits per channel plus a low bit shared by all four, pick whichever low bit fits best */
+static X0 quantize_bc7(const R32 e[4], U8 q[4], U8 *p, R32 x[4])
+{
+	R32 best = INFINITY;
+	for (U8 pb = 0; pb < 2; pb++) {
+		U8 t[4];
+		R32 err = 0.0f;
+		for (INAT c = 0; c < 4; c++) {
+			INAT v = (INAT)((e[c] - pb) / 2.0f + 0.5f);
+			t[c] = v < 0 ? 0 : v > 127 ? 127 : v;
+			R32 d = (t[c] << 1 | pb) - e[c];
+			err += d * d;
+		}
+		if (err < best) {
+			best = err;
+			memcpy(q, t, 4);
+			*p = pb;
+		}
+	}
+	for (INAT c = 0; c < 4; c++) x[c] = q[c] << 1 | *p;
+}
+
+static X0 encode_bc7(const struct bcblock *b, U8 *out)
+{
+	R32 e0[4], e1[4], x0[4], x1[4];
+	U8 level[16], q[2][4], p[2];
+	U32 pos = 0;
+
+	axis_endpoints(b, 4, e0, e1);
+	project(b, 4, e0, e1, 16, level);
+	refine(b, 4, level, 16, bc7_weights, e0, e1);
+	quantize_bc7(e0, q[0], &p[0], x0);
+	quantize_bc7(e1, q[1], &p[1], x1);
+	project(b, 4, x0, x1, 16, level);
+
+	/* The first index has an implied top bit of 0, if it'd be 1 swap the endpoints around */
+	if (level[0] & 8) {
+		U8 t[4], tp = p[0];
+		memcpy(t, q[0], 4);
+		memcpy(q[0], q[1], 4);
+		memcpy(q[1], t, 4);
+		p[0] = p[1];
+		p[1] = tp;
+		for (INAT i = 0; i < 16; i++) level[i] = 15 - level[i];
+	}
+
+	memset(out, 0, 16);
+	put_bits(out, &pos, 1 << 6, 7); /* Mode 6 */
+	for (INAT c = 0; c < 4; c++) {
+		put_bits(out, &pos, q[0][c], 7);
+		put_bits(out, &pos, q[1][c], 7);
+	}
+	put_bits(out, &pos, p[0], 1);
+	put_bits(out, &pos, p[1], 1);
+	put_bits(out, &pos, level[0], 3);
+	for (INAT i = 1; i < 16; i++) put_bits(out, &pos, level[i], 4);
+}
+
+struct bcjob {
+	enum hzbcformat format;
+	const U8 *rgba;
+	U32 w, h;
+	U8 *out;
+	U32 rows_per_job;
+};
+
+static X0 compress_rows(X0 *data, INAT index)
+{
+	struct bcjob *j = data;
+	U32 bw = (j->w + 3) / 4, bh = (j->h + 3) / 4, block_size = j->format == HZ_BC1 ? 8 : 16;
+	U32 end = (index + 1) * j->rows_per_job < bh ? (index + 1) * j->rows_per_job : bh;
+	struct bcblock b;
+
+	for (U32 by = index * j->rows_per_job; by < end; by++) {
+		for (U32 bx = 0; bx < bw; bx++) {
+			U8 *dst = j->out + ((size_t)by * bw + bx) * block_size;
+			load_block(j->rgba, j->w, j->h, bx, by, &b);
+			switch (j->format) {
+			case HZ_BC1: encode_color(&b, dst); break;
+			case HZ_BC3: encode_alpha(&b, dst); encode_color(&b, dst + 8); break;
+			case HZ_BC7: encode_bc7(&b, dst); break;
+			}
+		}
+	}
+}
+
+X0 hz_bc_compress(enum hzbcformat format, const U8 *rgba, U32 w, U32 h, U8 *out)
+{
+	/* A few jobs per thread, blocks near edges or with alpha aren't all the same amount of work */
+	U32 rows = (h + 3) / 4, jobs = hz_jobs_threads() * 4;
+	if (jobs > rows) jobs = rows;
+	struct bcjob j = { format, rgba, w, h, out, (rows + jobs - 1) / jobs };
+	hz_jobs_run(compress_rows, &j, (rows + j.rows_per_job - 1) / j.rows_per_job);
+}
+
+static X0 decode_color(const U8 *in, U1 four_color, U8 pixels[16][4])
+{
+	U8 colors[4][4];
+	U16 c0 = in[0] | in[1] << 8, c1 = in[2] | in[3] << 8;
+	unpack565(c0, colors[0]);
+	unpack565(c1, colors[1]);
+	for (INAT c = 0; c < 3; c++) {
+		if (four_color || c0 > c1) {
+			colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+			colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+		} else {
+			colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+			colors[3][c] = 0;
+		}
+	}
+	colors[2][3] = 255;
+	colors[3][3] = four_color || c0 > c1 ? 255 : 0;
+
+	U32 indices = in[4] | in[5] << 8 | in[6] << 16 | (U32)in[7] << 24;
+	for (INAT i = 0; i < 16; i++) memcpy(pixels[i], colors[(indices >> (2 * i)) & 3], 4);
+}
+
+static X0 decode_alpha(const U8 *in, U8 pixels[16][4])
+{
+	U8 a[8] = { in[0], in[1] };
+	if (a[0] > a[1]) {
+		for (INAT k = 2; k < 8; k++) a[k] = ((8 - k) * a[0] + (k - 1) * a[1]) / 7;
+	} else {
+		for (INAT k = 2; k < 6; k++) a[k] = ((6 - k) * a[0] + (k - 1) * a[1]) / 5;
+		a[6] = 0;
+		a[7] = 255;
+	}
+
+	U64 indices = 0;
+	for (INAT i = 0; i < 6; i++) indices |= (U64)in[2 + i] << (8 * i);
+	for (INAT i = 0; i < 16; i++) pixels[i][3] = a[(indices >> (3 * i)) & 7];
+}
+
+static X0 decode_bc7(const U8 *in, U8 pixels[16][4])
+{
+	U8 e[2][4];
+	U32 pos = 7;
+
+	/* Anything but mode 6 isn't ours, show it as black so it stands out in a PSNR */
+	if ((in[0] & 0x7f) != 1 << 6) {
+		memset(pixels, 0, 16 * 4);
+		return;
+	}
+	for (INAT c = 0; c < 4; c++) {
+		e[0][c] = get_bits(in, &pos, 7) << 1;
+		e[1][c] = get_bits(in, &pos, 7) << 1;
+	}
+	U8 p0 = get_bits(in, &pos, 1), p1 = get_bits(in, &pos, 1);
+	for (INAT c = 0; c < 4; c++) {
+		e[0][c] |= p0;
+		e[1][c] |= p1;
+	}
+	for (INAT i = 0; i < 16; i++) {
+		U32 w = bc7_weights[get_bits(in, &pos, i ? 4 : 3)];
+		for (INAT c = 0; c < 4; c++) pixels[i][c] = ((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6;
+	}
+}
+
+X0 hz_bc_decompress(enum hzbcformat format, const U8 *blocks, U32 w, U32 h, U8 *rgba)
+{
+	U32 bw = (w + 3) / 4, bh = (h + 3) / 4, block_size = format == HZ_BC1 ? 8 : 16;
+	U8 pixels[16][4];
+
+	for (U32 by = 0; by < bh; by++) {
+		for (U32 bx = 0; bx < bw; bx++) {
+			const U8 *in = blocks + ((size_t)by * bw + bx) * block_size;
+			switch (format) {
+			case HZ_BC1: decode_color(in, false, pixels); break;
+			case HZ_BC3: decode_color(in + 8, true, pixels); decode_alpha(in, pixels); break;
+			case HZ_BC7: decode_bc7(in, pixels); break;
+			}
+
+			for (U32 y = 0; y < 4 && by * 4 + y < h; y++) {
+				for (U32 x = 0; x < 4 && bx * 4 + x < w; x++) {
+					memcpy(rgba + ((size_t)(by * 4 + y) * w + bx * 4 + x) * 4, pixels[y * 4 + x], 4);
+				}
+			}
+		}
+	}
+}
+
+R64 hz_bc_psnr(enum hzbcformat format, const U8 *rgba, U32 w, U32 h, const U8 *blocks)
+{
+	U8 *decoded = malloc((size_t)w * h * 4);
+	if (!decoded) return -1.0;
+	hz_bc_decompress(format, blocks, w, h, decoded);
+
+	INAT channels = format == HZ_BC1 ? 3 : 4;
+	R64 sum = 0.0;
+	for (size_t i = 0; i < (size_t)w * h; i++) {
+		for (INAT c = 0; c < channels; c++) {
+			R64 d = (R64)rgba[i * 4 + c] - decoded[i * 4 + c];
+			sum += d * d;
+		}
+	}
+	free(decoded);
+
+	R64 mse = sum / ((R64)w * h * channels);
+	return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+}
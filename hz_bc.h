@@ -0,0 +1,40 @@
+#ifndef HZ_BC_H
+#define HZ_BC_H
+
+#include "holyh/src/holy.h"
+
+/* Block compression of RGBA8 images into the formats every desktop GPU samples natively: BC1 (S3TC DXT1, RGB at 4
+ * bits per pixel), BC3 (DXT5, RGBA at 8 bits per pixel) and BC7 (BPTC, RGBA at 8 bits per pixel, much better colour
+ * than BC3). Textures stay compressed in VRAM, so they take 4x (BC3, BC7) to 8x (BC1) less room than RGBA8.
+ *
+ * The encoders go for speed over the last dB: endpoints come from the principal axis of each block, refined once by
+ * least squares, with SSE2 doing the per-pixel index fits. BC7 only ever uses mode 6 (one RGBA line, 16 levels), which
+ * is the mode that fits smooth blocks best. Block rows are spread over the hz_jobs pool, whenever it's running.
+ *
+ * Images are tightly packed rows of RGBA8, any size. Edge blocks are padded by repeating the last row and column.
+ */
+
+enum hzbcformat {
+	HZ_BC1, /* Opaque, alpha is ignored */
+	HZ_BC3,
+	HZ_BC7,
+};
+
+/* Bytes of compressed data for a w x h image. */
+size_t hz_bc_size(enum hzbcformat format, U32 w, U32 h);
+/* The glCompressedTexImage2D() internal format, sRGB or linear. */
+UNAT hz_bc_gl_format(enum hzbcformat format, U1 srgb);
+const CHR *hz_bc_name(enum hzbcformat format);
+/* Looks up a format by name ("bc1", "bc3", "bc7"). Returns false if there's no such format. */
+U1 hz_bc_parse(const CHR *name, enum hzbcformat *format);
+
+/* Compresses `rgba` (w x h) into `out`, which takes hz_bc_size() bytes. */
+X0 hz_bc_compress(enum hzbcformat format, const U8 *rgba, U32 w, U32 h, U8 *out);
+/* Decompresses `blocks` back to RGBA8, the way a GPU would. Only handles BC7 mode 6, which is all we write. */
+X0 hz_bc_decompress(enum hzbcformat format, const U8 *blocks, U32 w, U32 h, U8 *rgba);
+/* Peak signal to noise ratio of `blocks` against the original `rgba`, in dB, over RGB for BC1 and RGBA otherwise.
+ * Returns INFINITY for a perfect match, or a negative number if it's out of memory.
+ */
+R64 hz_bc_psnr(enum hzbcformat format, const U8 *rgba, U32 w, U32 h, const U8 *blocks);
+
+#endif
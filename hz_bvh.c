@@ -0,0 +1,374 @@
+#include "hz_bvh.h"
+#include <math.h>
+
+#define STACK (HZ_BVH_MAX_DEPTH + 2) /* Depth first, one sibling waiting per level */
+
+/* A range of boxes waiting to become a node, and the node whose second child it is, if any */
+struct buildtask {
+	U32 first, count, depth;
+	INAT parent;
+};
+
+struct bin {
+	R32 min[3], max[3];
+	U32 count;
+};
+
+static X0 bounds_empty(R32 *min, R32 *max)
+{
+	for (INAT c = 0; c < 3; c++) {
+		min[c] = INFINITY;
+		max[c] = -INFINITY;
+	}
+}
+
+static X0 bounds_grow(R32 *min, R32 *max, const R32 *box_min, const R32 *box_max)
+{
+	for (INAT c = 0; c < 3; c++) {
+		if (box_min[c] < min[c]) min[c] = box_min[c];
+		if (box_max[c] > max[c]) max[c] = box_max[c];
+	}
+}
+
+/* Half the surface area, which is all the heuristic needs */
+static R32 area(const R32 *min, const R32 *max)
+{
+	if (min[0] > max[0]) return 0.0f;
+	R32 x = max[0] - min[0], y = max[1] - min[1], z = max[2] - min[2];
+	return x * y + y * z + z * x;
+}
+
+/* Where to split `count` boxes with centres spanning cmin..cmax: returns how many go to the first child after
+ * partitioning `index` accordingly.
+ */
+static U32 split(U32 *index, U32 count, const R32 *boxes, const R32 *centre, const R32 *cmin, const R32 *cmax)
+{
+	/* One pass over the boxes bins them along all three axes at once. Near the leaves there are more bins than boxes,
+	 * and setting them up and sweeping them is most of the work, so there it's a bin per box.
+	 */
+	U32 nbins = count < HZ_BVH_BINS ? count : HZ_BVH_BINS;
+	struct bin bins[3][HZ_BVH_BINS];
+	R32 scale[3];
+	for (INAT a = 0; a < 3; a++) {
+		R32 extent = cmax[a] - cmin[a];
+		scale[a] = extent > 0.0f ? nbins / extent : 0.0f;
+		for (U32 i = 0; i < nbins; i++) {
+			bounds_empty(bins[a][i].min, bins[a][i].max);
+			bins[a][i].count = 0;
+		}
+	}
+	for (U32 i = 0; i < count; i++) {
+		const R32 *box = &boxes[index[i] * 6], *c = &centre[index[i] * 3];
+		for (INAT a = 0; a < 3; a++) {
+			U32 k = (U32)((c[a] - cmin[a]) * scale[a]);
+			if (k >= nbins) k = nbins - 1;
+			bounds_grow(bins[a][k].min, bins[a][k].max, box, box + 3);
+			bins[a][k].count++;
+		}
+	}
+
+	R32 best = INFINITY;
+	INAT best_axis = -1;
+	U32 best_bin = 0;
+	for (INAT a = 0; a < 3; a++) {
+		if (scale[a] == 0.0f) continue;
+		/* Everything left of each split from one side, everything right of it from the other */
+		const struct bin *bin = bins[a];
+		R32 right_area[HZ_BVH_BINS], min[3], max[3];
+		U32 right_count[HZ_BVH_BINS], n = 0;
+		bounds_empty(min, max);
+		for (U32 i = nbins - 1; i > 0; i--) {
+			bounds_grow(min, max, bin[i].min, bin[i].max);
+			n += bin[i].count;
+			right_area[i] = area(min, max);
+			right_count[i] = n;
+		}
+		bounds_empty(min, max);
+		n = 0;
+		for (U32 i = 1; i < nbins; i++) {
+			bounds_grow(min, max, bin[i - 1].min, bin[i - 1].max);
+			n += bin[i - 1].count;
+			if (!n || !right_count[i]) continue;
+			R32 cost = n * area(min, max) + right_count[i] * right_area[i];
+			if (cost < best) {
+				best = cost;
+				best_axis = a;
+				best_bin = i;
+			}
+		}
+	}
+
+	/* All the centres in one spot: nothing to tell them apart by, so just halve them */
+	if (best_axis < 0) return count / 2;
+
+	U32 i = 0, j = count;
+	while (i < j) {
+		U32 k = (U32)((centre[index[i] * 3 + best_axis] - cmin[best_axis]) * scale[best_axis]);
+		if (k >= nbins) k = nbins - 1;
+		if (k < best_bin) {
+			i++;
+		} else {
+			U32 t = index[i];
+			index[i] = index[--j];
+			index[j] = t;
+		}
+	}
+	return i;
+}
+
+U1 hz_bvh_build(struct hzbvh *b, const R32 *boxes, U32 count)
+{
+	hz_bvh_destroy(b);
+	if (!count) return true;
+
+	b->node = malloc(((size_t)count * 2 - 1) * sizeof(*b->node));
+	b->index = malloc((size_t)count * sizeof(U32));
+	b->box = malloc((size_t)count * 6 * sizeof(R32));
+	R32 *centre = malloc((size_t)count * 3 * sizeof(R32));
+	if (!b->node || !b->index || !b->box || !centre) {
+		fprintf(stderr, "bvh: out of memory for %u boxes\n", count);
+		free(centre);
+		hz_bvh_destroy(b);
+		return false;
+	}
+	b->count = count;
+	for (U32 i = 0; i < count; i++) {
+		b->index[i] = i;
+		for (INAT c = 0; c < 3; c++) centre[i * 3 + c] = (boxes[i * 6 + c] + boxes[i * 6 + 3 + c]) * 0.5f;
+	}
+
+	/* Taking the first child before the second is what puts it right after its parent */
+	struct buildtask stack[STACK];
+	U32 top = 0;
+	stack[top++] = (struct buildtask){ 0, count, 0, -1 };
+	while (top) {
+		struct buildtask t = stack[--top];
+		U32 n = b->nodes++;
+		if (t.parent >= 0) b->node[t.parent].first = n;
+
+		struct hzbvhnode *node = &b->node[n];
+		R32 cmin[3], cmax[3];
+		bounds_empty(node->min, node->max);
+		bounds_empty(cmin, cmax);
+		for (U32 i = t.first; i < t.first + t.count; i++) {
+			U32 k = b->index[i];
+			bounds_grow(node->min, node->max, &boxes[k * 6], &boxes[k * 6 + 3]);
+			bounds_grow(cmin, cmax, &centre[k * 3], &centre[k * 3]);
+		}
+
+		/* Testing a leaf's few boxes, one after the other in memory, is about as cheap as testing one more node */
+		if (t.count <= HZ_BVH_LEAF || t.depth == HZ_BVH_MAX_DEPTH) {
+			node->first = t.first;
+			node->count = t.count;
+			continue;
+		}
+		U32 left = split(b->index + t.first, t.count, boxes, centre, cmin, cmax);
+		node->count = 0;
+		stack[top++] = (struct buildtask){ t.first + left, t.count - left, t.depth + 1, n };
+		stack[top++] = (struct buildtask){ t.first, left, t.depth + 1, -1 };
+	}
+	free(centre);
+
+	/* Shrink to fit, it's usually well under the worst case */
+	struct hzbvhnode *node = realloc(b->node, (size_t)b->nodes * sizeof(*node));
+	if (node) b->node = node;
+	for (U32 i = 0; i < count; i++) memcpy(&b->box[i * 6], &boxes[b->index[i] * 6], 6 * sizeof(R32));
+	return true;
+}
+
+X0 hz_bvh_refit(struct hzbvh *b, const R32 *boxes)
+{
+	for (U32 i = 0; i < b->count; i++) memcpy(&b->box[i * 6], &boxes[b->index[i] * 6], 6 * sizeof(R32));
+	/* Children always come after their parent, so backwards is bottom up */
+	for (U32 n = b->nodes; n-- > 0;) {
+		struct hzbvhnode *node = &b->node[n];
+		bounds_empty(node->min, node->max);
+		if (node->count) {
+			for (U32 i = node->first; i < node->first + node->count; i++) {
+				bounds_grow(node->min, node->max, &b->box[i * 6], &b->box[i * 6 + 3]);
+			}
+		} else {
+			bounds_grow(node->min, node->max, b->node[n + 1].min, b->node[n + 1].max);
+			bounds_grow(node->min, node->max, b->node[node->first].min, b->node[node->first].max);
+		}
+	}
+}
+
+X0 hz_bvh_destroy(struct hzbvh *b)
+{
+	free(b->node);
+	free(b->index);
+	free(b->box);
+	memset(b, 0, sizeof(*b));
+}
+
+/* Copies the caller's indices of boxes first..first + count to what's left of `out` */
+static X0 emit(const struct hzbvh *b, U32 first, U32 count, U32 *out, U32 max, U32 found)
+{
+	if (found >= max) return;
+	if (count > max - found) count = max - found;
+	memcpy(out + found, b->index + first, count * sizeof(U32));
+}
+
+/* Tests a box against the planes still in `*mask`, and takes out the ones it's entirely inside. False if it's
+ * entirely outside one.
+ */
+static U1 frustum_test(const struct hzfrustum *f, const R32 *min, const R32 *max, U32 *mask)
+{
+	for (INAT i = 0; i < 6; i++) {
+		if (!(*mask & 1u << i)) continue;
+		const R32 *p = f->plane[i];
+		/* The corners furthest along the normal and furthest against it */
+		R32 d_max = p[3], d_min = p[3];
+		for (INAT c = 0; c < 3; c++) {
+			d_max += p[c] * (p[c] >= 0.0f ? max[c] : min[c]);
+			d_min += p[c] * (p[c] >= 0.0f ? min[c] : max[c]);
+		}
+		if (d_max < 0.0f) return false;
+		if (d_min >= 0.0f) *mask &= ~(1u << i);
+	}
+	return true;
+}
+
+U32 hz_bvh_frustum(const struct hzbvh *b, const struct hzfrustum *f, U32 *out, U32 max)
+{
+	if (!b->nodes) return 0;
+	struct { U32 node, mask; } stack[STACK];
+	U32 top = 0, found = 0;
+	stack[top].node = 0;
+	stack[top++].mask = 0x3f;
+	while (top) {
+		top--;
+		U32 n = stack[top].node, mask = stack[top].mask;
+		for (;;) {
+			const struct hzbvhnode *node = &b->node[n];
+			if (!frustum_test(f, node->min, node->max, &mask)) break;
+			if (!mask) {
+				/* All in: the subtree's boxes run from its leftmost leaf's first to its rightmost leaf's last */
+				U32 l = n, r = n;
+				while (!b->node[l].count) l++;
+				while (!b->node[r].count) r = b->node[r].first;
+				U32 first = b->node[l].first, count = b->node[r].first + b->node[r].count - first;
+				emit(b, first, count, out, max, found);
+				found += count;
+				break;
+			}
+			if (node->count) {
+				for (U32 i = node->first; i < node->first + node->count; i++) {
+					U32 m = mask;
+					if (!frustum_test(f, &b->box[i * 6], &b->box[i * 6 + 3], &m)) continue;
+					if (found < max) out[found] = b->index[i];
+					found++;
+				}
+				break;
+			}
+			stack[top].node = node->first;
+			stack[top++].mask = mask;
+			n++;
+		}
+	}
+	return found;
+}
+
+static U1 overlaps(const R32 *min_a, const R32 *max_a, const R32 *min_b, const R32 *max_b)
+{
+	return min_a[0] <= max_b[0] && max_a[0] >= min_b[0] && min_a[1] <= max_b[1] && max_a[1] >= min_b[1]
+		&& min_a[2] <= max_b[2] && max_a[2] >= min_b[2];
+}
+
+U32 hz_bvh_aabb(const struct hzbvh *b, const R32 min[3], const R32 max[3], U32 *out, U32 max_out)
+{
+	if (!b->nodes) return 0;
+	U32 stack[STACK], top = 0, found = 0;
+	stack[top++] = 0;
+	while (top) {
+		U32 n = stack[--top];
+		for (;;) {
+			const struct hzbvhnode *node = &b->node[n];
+			if (!overlaps(node->min, node->max, min, max)) break;
+			if (node->count) {
+				for (U32 i = node->first; i < node->first + node->count; i++) {
+					if (!overlaps(&b->box[i * 6], &b->box[i * 6 + 3], min, max)) continue;
+					if (found < max_out) out[found] = b->index[i];
+					found++;
+				}
+				break;
+			}
+			stack[top++] = node->first;
+			n++;
+		}
+	}
+	return found;
+}
+
+/* Where a ray enters a box (0 if it starts inside), or INFINITY if it misses it before `t_max` */
+static R32 ray_box(const R32 *origin, const R32 *inv_dir, const R32 *min, const R32 *max, R32 t_max)
+{
+	R32 t0 = 0.0f, t1 = t_max;
+	for (INAT c = 0; c < 3; c++) {
+		R32 a = (min[c] - origin[c]) * inv_dir[c], b = (max[c] - origin[c]) * inv_dir[c];
+		if (a > b) {
+			R32 t = a;
+			a = b;
+			b = t;
+		}
+		/* Written so that a NaN (a ray in the plane of a face) leaves the interval alone */
+		t0 = a > t0 ? a : t0;
+		t1 = b < t1 ? b : t1;
+	}
+	return t0 <= t1 ? t0 : INFINITY;
+}
+
+INAT hz_bvh_ray(const struct hzbvh *b, const R32 origin[3], const R32 dir[3], R32 max_t, hzbvhrayfn hit, X0 *data,
+	R32 *t)
+{
+	if (!b->nodes) return -1;
+	R32 inv_dir[3] = { 1.0f / dir[0], 1.0f / dir[1], 1.0f / dir[2] };
+	R32 best = max_t;
+	INAT found = -1;
+
+	struct { U32 node; R32 t; } stack[STACK];
+	U32 top = 0;
+	stack[top].node = 0;
+	stack[top++].t = ray_box(origin, inv_dir, b->node[0].min, b->node[0].max, best);
+	while (top) {
+		/* Anything queued before a closer hit turned up can be dropped */
+		top--;
+		U32 n = stack[top].node;
+		if (!(stack[top].t <= best)) continue;
+		for (;;) {
+			const struct hzbvhnode *node = &b->node[n];
+			if (node->count) {
+				for (U32 i = node->first; i < node->first + node->count; i++) {
+					R32 d = ray_box(origin, inv_dir, &b->box[i * 6], &b->box[i * 6 + 3], best);
+					if (!(d <= best)) continue;
+					if (hit) d = hit(data, b->index[i], origin, dir);
+					if (d < 0.0f || d > best) continue;
+					best = d;
+					found = b->index[i];
+				}
+				break;
+			}
+			/* The nearer child first, so the farther one has a better chance of being skipped */
+			U32 closer = n + 1, farther = node->first;
+			R32 t_closer = ray_box(origin, inv_dir, b->node[closer].min, b->node[closer].max, best);
+			R32 t_farther = ray_box(origin, inv_dir, b->node[farther].min, b->node[farther].max, best);
+			if (t_farther < t_closer) {
+				U32 s = closer;
+				closer = farther;
+				farther = s;
+				R32 d = t_closer;
+				t_closer = t_farther;
+				t_farther = d;
+			}
+			if (!(t_closer <= best)) break;
+			if (t_farther <= best) {
+				stack[top].node = farther;
+				stack[top++].t = t_farther;
+			}
+			n = closer;
+		}
+	}
+	if (found >= 0 && t) *t = best;
+	return found;
+}
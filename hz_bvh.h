@@ -0,0 +1,74 @@
+#ifndef HZ_BVH_H
+#define HZ_BVH_H
+
+#include "holyh/src/holy.h"
+#include "hz_frustum.h"
+
+/* A bounding volume hierarchy over a set of boxes, for when there are too many objects to test every one of them each
+ * frame. The boxes are whatever the caller has (a world space AABB per instance, usually) and are only ever referred
+ * to by their index, so the queries hand back indices into the caller's own arrays.
+ *
+ * hz_bvh_build() splits the boxes top down along the axis and position that minimise the surface area heuristic,
+ * evaluated over HZ_BVH_BINS bins of their centres rather than every possible split, which is a lot cheaper and nearly
+ * as good. Nodes are stored flat, 32 bytes each, in depth first order: a node's first child is the node right after
+ * it and it holds the index of the second, so going down the left side of the tree is walking forward through memory.
+ * The boxes are reordered to match the leaves, so a leaf's boxes are one contiguous run too.
+ *
+ * Objects that move don't need a rebuild: hz_bvh_refit() takes the new boxes and fixes every node's bounds up from the
+ * leaves, in one pass backwards over the nodes. The tree keeps its shape, so it gets worse the further things move
+ * from where they were at the last hz_bvh_build(); rebuild once in a while (or when things teleport).
+ *
+ * The frustum query skips a subtree as soon as its node is outside a plane, and stops testing planes the node is
+ * inside of, so a subtree entirely in view goes out as a whole with no tests at all. Either way the cost grows with
+ * the number of nodes the frustum's planes cut through, not with the number of boxes.
+ */
+
+#define HZ_BVH_BINS 16 /* Candidate split positions per axis are the edges between these */
+#define HZ_BVH_LEAF 4 /* Boxes a leaf gets, at most, unless the tree's too deep already */
+#define HZ_BVH_MAX_DEPTH 48 /* Deeper than this and the rest go in one leaf, which keeps the query stacks fixed */
+
+struct hzbvhnode {
+	R32 min[3];
+	U32 first; /* A leaf's first box (in hzbvh.index order), an inner node's second child */
+	R32 max[3];
+	U32 count; /* A leaf's boxes, 0 for inner nodes */
+};
+
+struct hzbvh {
+	struct hzbvhnode *node;
+	U32 nodes;
+	U32 *index; /* The caller's index of each box, in leaf order */
+	R32 *box; /* The boxes themselves, min and max, in leaf order */
+	U32 count;
+};
+
+/* Tests a ray against box `index` of the caller's, more closely than its bounding box. Returns the distance along
+ * `dir` to the hit, or a negative number if it misses.
+ */
+typedef R32 (*hzbvhrayfn)(X0 *data, U32 index, const R32 origin[3], const R32 dir[3]);
+
+/* Builds the tree over `count` boxes, each six floats: min x, y, z then max x, y, z. Anything already in `b` is
+ * freed first. Returns false (with a message on stderr) if we're out of memory, leaving `b` empty.
+ */
+U1 hz_bvh_build(struct hzbvh *b, const R32 *boxes, U32 count);
+/* Takes new boxes for the same objects, laid out as for hz_bvh_build(), and fixes the bounds of every node to match */
+X0 hz_bvh_refit(struct hzbvh *b, const R32 *boxes);
+X0 hz_bvh_destroy(struct hzbvh *b);
+
+/* Queries. Each writes the indices of the boxes it finds to `out`, up to `max` of them, in no particular order, and
+ * returns how many it found, which can be more than `max`.
+ */
+
+/* Boxes not entirely outside a plane of the frustum, with the same leniency as hz_frustum_aabb() */
+U32 hz_bvh_frustum(const struct hzbvh *b, const struct hzfrustum *f, U32 *out, U32 max);
+/* Boxes that overlap the box from `min` to `max` (touching counts) */
+U32 hz_bvh_aabb(const struct hzbvh *b, const R32 min[3], const R32 max[3], U32 *out, U32 max_out);
+
+/* The nearest box a ray from `origin` along `dir` hits within `max_t` (in units of `dir`), tested more closely with
+ * `hit` if that isn't NULL. Returns its index, and the distance in `*t` if `t` isn't NULL, or -1 if there's nothing.
+ * Picking is hz_bvh_ray() with a ray through the cursor, unprojected with the inverse view-projection.
+ */
+INAT hz_bvh_ray(const struct hzbvh *b, const R32 origin[3], const R32 dir[3], R32 max_t, hzbvhrayfn hit, X0 *data,
+	R32 *t);
+
+#endif
@@ -0,0 +1,474 @@
+#include "hz_capture.h"
+#include "hz_gpumem.h"
+#include "hz_png.h"
+#include <GL/glew.h>
+#include <pthread.h>
+
+#define HZ_CAPTURE_RAW 0
+#define HZ_CAPTURE_Y4M 1
+#define HZ_CAPTURE_PNG 2
+
+/* One PBO in the readback ring */
+struct capslot {
+	GLuint pbo;
+	GLsync fence;
+	size_t size; /* Bytes allocated for the PBO's data store */
+	INAT width;
+	INAT height;
+	U32 frame;
+	U1 pending; /* glReadPixels has been issued but we haven't mapped it yet */
+};
+
+/* One CPU-side frame on its way to the writer thread */
+struct capframe {
+	U8 *pixels; /* Bottom-up RGBA8, exactly as glReadPixels gave it to us */
+	size_t size;
+	INAT width;
+	INAT height;
+	U32 frame;
+};
+
+static struct {
+	U1 enabled;
+	U1 failed; /* Sticky, set by either thread if anything at all went wrong */
+	INAT format;
+	const CHR *path;
+	U32 skip;
+	U32 max_frames;
+	U32 frame; /* Frames seen so far, captured or not */
+
+	struct capslot ring[HZ_CAPTURE_RING];
+	U32 head; /* Next slot glReadPixels goes into */
+	U32 tail; /* Oldest slot still in flight */
+	U32 inflight; /* Slots between tail and head that haven't been mapped yet */
+	U32 stalls; /* Times we had to block on a fence because the GPU was a whole ring behind */
+
+	struct capframe pool[HZ_CAPTURE_POOL];
+	INAT free_list[HZ_CAPTURE_POOL];
+	INAT nfree;
+	INAT queue[HZ_CAPTURE_POOL];
+	INAT queue_head;
+	INAT queue_count;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t work_ready; /* Signalled when the queue gets a frame, or when we want the writer to stop */
+	pthread_cond_t buffer_free; /* Signalled when the writer hands a pool buffer back */
+	U1 thread_running;
+	U1 stopping;
+
+	/* Writer thread state. Only touched by the writer once it's running. */
+	FILE *stream;
+	INAT stream_width;
+	INAT stream_height;
+	U8 *scratch;
+	size_t scratch_size;
+	U32 written;
+	U32 dropped;
+
+	/* Frame timing, for --stats. Measured between consecutive hz_capture_frame() calls. */
+	const CHR *stats_path;
+	U64 last_tick;
+	R64 *frame_ms;
+	U32 nframe_ms;
+	U32 frame_ms_cap;
+} cap;
+
+static const CHR *arg_value(const CHR *arg, const CHR *name)
+{
+	size_t len = strlen(name);
+	if (strncmp(arg, name, len) == 0 && arg[len] == '=') return arg + len + 1;
+	return NULL;
+}
+
+static U1 ensure_scratch(size_t size)
+{
+	if (cap.scratch_size >= size) return true;
+	U8 *n = realloc(cap.scratch, size);
+	if (!n) return false;
+	cap.scratch = n;
+	cap.scratch_size = size;
+	return true;
+}
+
+/* BT.601 limited range, the thing every Y4M consumer assumes */
+static U8 rgb_to_y(INAT r, INAT g, INAT b)
+{
+	return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+}
+
+static U8 rgb_to_u(INAT r, INAT g, INAT b)
+{
+	return ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+}
+
+static U8 rgb_to_v(INAT r, INAT g, INAT b)
+{
+	return ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+static U1 write_y4m(const struct capframe *f)
+{
+	INAT w = f->width, h = f->height;
+	INAT cw = (w + 1) / 2, ch = (h + 1) / 2;
+	size_t ysize = (size_t)w * h, csize = (size_t)cw * ch;
+	if (!ensure_scratch(ysize + csize * 2)) return false;
+
+	U8 *yp = cap.scratch, *up = yp + ysize, *vp = up + csize;
+	size_t stride = (size_t)w * 4;
+
+	/* Rows come in bottom-up, Y4M wants them top-down */
+	for (INAT y = 0; y < h; y++) {
+		const U8 *row = f->pixels + (size_t)(h - 1 - y) * stride;
+		for (INAT x = 0; x < w; x++) yp[(size_t)y * w + x] = rgb_to_y(row[x * 4], row[x * 4 + 1], row[x * 4 + 2]);
+	}
+
+	/* 4:2:0 chroma from the average of each 2x2 block, clamping at odd edges */
+	for (INAT cy = 0; cy < ch; cy++) {
+		INAT y0 = cy * 2, y1 = y0 + 1 < h ? y0 + 1 : y0;
+		const U8 *r0 = f->pixels + (size_t)(h - 1 - y0) * stride;
+		const U8 *r1 = f->pixels + (size_t)(h - 1 - y1) * stride;
+		for (INAT cx = 0; cx < cw; cx++) {
+			INAT x0 = cx * 8, x1 = cx * 2 + 1 < w ? x0 + 4 : x0;
+			INAT r = (r0[x0] + r0[x1] + r1[x0] + r1[x1] + 2) >> 2;
+			INAT g = (r0[x0 + 1] + r0[x1 + 1] + r1[x0 + 1] + r1[x1 + 1] + 2) >> 2;
+			INAT b = (r0[x0 + 2] + r0[x1 + 2] + r1[x0 + 2] + r1[x1 + 2] + 2) >> 2;
+			up[(size_t)cy * cw + cx] = rgb_to_u(r, g, b);
+			vp[(size_t)cy * cw + cx] = rgb_to_v(r, g, b);
+		}
+	}
+
+	return fputs("FRAME\n", cap.stream) >= 0 && fwrite(cap.scratch, 1, ysize + csize * 2, cap.stream) == ysize + csize * 2;
+}
+
+static U1 write_raw(const struct capframe *f)
+{
+	size_t stride = (size_t)f->width * 4;
+	for (INAT y = f->height - 1; y >= 0; y--)
+		if (fwrite(f->pixels + y * stride, 1, stride, cap.stream) != stride) return false;
+	return true;
+}
+
+static U1 write_png(struct capframe *f)
+{
+	CHR path[4096];
+	if (strchr(cap.path, '%')) snprintf(path, sizeof(path), cap.path, f->frame);
+	else snprintf(path, sizeof(path), "%s", cap.path);
+
+	/* Nothing we render has a meaningful alpha channel, so squash RGBA down to RGB in place */
+	size_t n = (size_t)f->width * f->height;
+	for (size_t i = 0; i < n; i++) {
+		f->pixels[i * 3] = f->pixels[i * 4];
+		f->pixels[i * 3 + 1] = f->pixels[i * 4 + 1];
+		f->pixels[i * 3 + 2] = f->pixels[i * 4 + 2];
+	}
+
+	return hz_png_write(path, f->pixels, f->width, f->height, 3, 0, true);
+}
+
+static U1 write_frame(struct capframe *f)
+{
+	if (cap.format == HZ_CAPTURE_PNG) return write_png(f);
+
+	/* Streams have a fixed frame size, so the first frame decides it */
+	if (!cap.stream) {
+		if (!(cap.stream = fopen(cap.path, "wb"))) {
+			fprintf(stderr, "capture: unable to open %s for writing\n", cap.path);
+			return false;
+		}
+		cap.stream_width = f->width;
+		cap.stream_height = f->height;
+		if (cap.format == HZ_CAPTURE_Y4M)
+			fprintf(cap.stream, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C420jpeg\n", f->width, f->height);
+	}
+
+	if (f->width != cap.stream_width || f->height != cap.stream_height) {
+		cap.dropped++;
+		return true;
+	}
+
+	return cap.format == HZ_CAPTURE_Y4M ? write_y4m(f) : write_raw(f);
+}
+
+static X0 *writer_main(X0 *unused)
+{
+	(X0)unused;
+
+	pthread_mutex_lock(&cap.lock);
+	for (;;) {
+		while (!cap.queue_count && !cap.stopping) pthread_cond_wait(&cap.work_ready, &cap.lock);
+		if (!cap.queue_count) break;
+
+		INAT idx = cap.queue[cap.queue_head];
+		cap.queue_head = (cap.queue_head + 1) % HZ_CAPTURE_POOL;
+		cap.queue_count--;
+
+		/* Encoding and IO happen without the lock held, that's the whole point of having this thread */
+		pthread_mutex_unlock(&cap.lock);
+		U1 ok = write_frame(&cap.pool[idx]);
+		pthread_mutex_lock(&cap.lock);
+
+		if (ok) cap.written++;
+		else cap.failed = true;
+		cap.free_list[cap.nfree++] = idx;
+		pthread_cond_signal(&cap.buffer_free);
+	}
+	pthread_mutex_unlock(&cap.lock);
+
+	return NULL;
+}
+
+/* Maps a slot whose readback has been issued, copies it out and hands it to the writer. If `block` is false and the
+ * fence hasn't signalled yet, nothing happens and false is returned.
+ */
+static U1 harvest(struct capslot *s, U1 block)
+{
+	GLenum status = glClientWaitSync(s->fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		if (!block) return false;
+		cap.stalls++;
+		do status = glClientWaitSync(s->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);
+		while (status == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(s->fence);
+	s->fence = NULL;
+	s->pending = false;
+
+	if (status == GL_WAIT_FAILED) {
+		cap.failed = true;
+		return true;
+	}
+
+	/* Grab a pool buffer, waiting for the writer if it's fallen behind */
+	pthread_mutex_lock(&cap.lock);
+	while (!cap.nfree) pthread_cond_wait(&cap.buffer_free, &cap.lock);
+	INAT idx = cap.free_list[--cap.nfree];
+	pthread_mutex_unlock(&cap.lock);
+
+	struct capframe *f = &cap.pool[idx];
+	size_t size = (size_t)s->width * s->height * 4;
+	U1 ok = true;
+	if (f->size < size) {
+		U8 *n = realloc(f->pixels, size);
+		if (n) {
+			f->pixels = n;
+			f->size = size;
+		} else {
+			ok = false;
+		}
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+	const U8 *mapped = ok ? glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT) : NULL;
+	if (mapped) {
+		memcpy(f->pixels, mapped, size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	pthread_mutex_lock(&cap.lock);
+	if (mapped) {
+		f->width = s->width;
+		f->height = s->height;
+		f->frame = s->frame;
+		cap.queue[(cap.queue_head + cap.queue_count) % HZ_CAPTURE_POOL] = idx;
+		cap.queue_count++;
+		pthread_cond_signal(&cap.work_ready);
+	} else {
+		cap.failed = true;
+		cap.free_list[cap.nfree++] = idx;
+	}
+	pthread_mutex_unlock(&cap.lock);
+
+	return true;
+}
+
+U1 hz_capture_init(INAT argc, CHR *argv[])
+{
+	for (INAT i = 1; i < argc; i++) {
+		const CHR *v;
+		if ((v = arg_value(argv[i], "--capture"))) {
+			cap.path = v;
+		} else if ((v = arg_value(argv[i], "--capture-format"))) {
+			if (!strcmp(v, "raw")) cap.format = HZ_CAPTURE_RAW;
+			else if (!strcmp(v, "y4m")) cap.format = HZ_CAPTURE_Y4M;
+			else if (!strcmp(v, "png")) cap.format = HZ_CAPTURE_PNG;
+			else fprintf(stderr, "capture: unknown format '%s', using raw\n", v);
+		} else if ((v = arg_value(argv[i], "--capture-skip"))) {
+			cap.skip = strtoul(v, NULL, 10);
+		} else if ((v = arg_value(argv[i], "--frames"))) {
+			cap.max_frames = strtoul(v, NULL, 10);
+		} else if ((v = arg_value(argv[i], "--stats"))) {
+			cap.stats_path = v;
+		} else if (!strcmp(argv[i], "--no-vsync")) {
+			/* Benchmarks want to know how long a frame takes, not how fast the monitor is */
+			SDL_GL_SetSwapInterval(0);
+		}
+	}
+
+	if (!cap.path) return false;
+
+	pthread_mutex_init(&cap.lock, NULL);
+	pthread_cond_init(&cap.work_ready, NULL);
+	pthread_cond_init(&cap.buffer_free, NULL);
+	for (INAT i = 0; i < HZ_CAPTURE_POOL; i++) cap.free_list[i] = i;
+	cap.nfree = HZ_CAPTURE_POOL;
+
+	if (pthread_create(&cap.thread, NULL, writer_main, NULL) != 0) {
+		fprintf(stderr, "capture: unable to start the writer thread\n");
+		cap.failed = true;
+		return false;
+	}
+	cap.thread_running = true;
+
+	for (INAT i = 0; i < HZ_CAPTURE_RING; i++) glGenBuffers(1, &cap.ring[i].pbo);
+
+	cap.enabled = true;
+	return true;
+}
+
+static X0 record_frame_time()
+{
+	U64 now = SDL_GetPerformanceCounter();
+	if (cap.last_tick) {
+		if (cap.nframe_ms == cap.frame_ms_cap) {
+			U32 ncap = cap.frame_ms_cap ? cap.frame_ms_cap * 2 : 1024;
+			R64 *n = realloc(cap.frame_ms, ncap * sizeof(R64));
+			if (!n) return;
+			cap.frame_ms = n;
+			cap.frame_ms_cap = ncap;
+		}
+		cap.frame_ms[cap.nframe_ms++] = (R64)(now - cap.last_tick) * 1000.0 / SDL_GetPerformanceFrequency();
+	}
+	cap.last_tick = now;
+}
+
+static INAT compare_r64(const X0 *a, const X0 *b)
+{
+	R64 x = *(const R64*)a, y = *(const R64*)b;
+	return (x > y) - (x < y);
+}
+
+/* Writes the frame time distribution as a flat JSON object, so tools can pick values out of it without a parser */
+static U1 write_stats()
+{
+	R64 sum = 0, *t = cap.frame_ms;
+	U32 n = cap.nframe_ms;
+	if (!n) {
+		fprintf(stderr, "capture: not enough frames rendered to produce timing stats\n");
+		return false;
+	}
+
+	qsort(t, n, sizeof(R64), compare_r64);
+	for (U32 i = 0; i < n; i++) sum += t[i];
+
+	FILE *f = fopen(cap.stats_path, "w");
+	if (!f) {
+		fprintf(stderr, "capture: unable to open %s for writing\n", cap.stats_path);
+		return false;
+	}
+	fprintf(f, "{\n"
+		"\t\"frames\": %u,\n"
+		"\t\"mean_ms\": %.4f,\n"
+		"\t\"min_ms\": %.4f,\n"
+		"\t\"median_ms\": %.4f,\n"
+		"\t\"p95_ms\": %.4f,\n"
+		"\t\"p99_ms\": %.4f,\n"
+		"\t\"max_ms\": %.4f\n"
+		"}\n",
+		n, sum / n, t[0], t[n / 2], t[(U32)(n * 0.95)], t[(U32)(n * 0.99)], t[n - 1]);
+	return fclose(f) == 0;
+}
+
+X0 hz_capture_frame(SDL_Window *window)
+{
+	if (cap.stats_path) record_frame_time();
+
+	U32 frame = cap.frame++;
+	if (!cap.enabled || frame < cap.skip) return;
+
+	/* Pick up anything the GPU has already finished, oldest first, without waiting on anything */
+	while (cap.inflight && harvest(&cap.ring[cap.tail], false)) {
+		cap.tail = (cap.tail + 1) % HZ_CAPTURE_RING;
+		cap.inflight--;
+	}
+
+	struct capslot *s = &cap.ring[cap.head];
+	/* If the slot we're about to reuse is still in flight, the GPU is a whole ring behind us. Nothing for it. */
+	if (s->pending) {
+		harvest(s, true);
+		cap.tail = (cap.tail + 1) % HZ_CAPTURE_RING;
+		cap.inflight--;
+	}
+
+	INAT w, h;
+	SDL_GL_GetDrawableSize(window, &w, &h);
+	size_t size = (size_t)w * h * 4;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+	if (s->size != size) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		hz_gpumem_buffer(s->pbo, size, "capture");
+		s->size = size;
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadBuffer(GL_BACK);
+	/* With a PBO bound, the last argument is an offset into it, and this returns without waiting for the GPU */
+	glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, (X0*)0);
+	s->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	s->width = w;
+	s->height = h;
+	s->frame = frame;
+	s->pending = true;
+	cap.head = (cap.head + 1) % HZ_CAPTURE_RING;
+	cap.inflight++;
+}
+
+U1 hz_capture_done()
+{
+	return cap.max_frames && cap.frame >= cap.max_frames;
+}
+
+U1 hz_capture_shutdown()
+{
+	if (cap.stats_path) {
+		if (!write_stats()) cap.failed = true;
+		free(cap.frame_ms);
+		cap.frame_ms = NULL;
+		cap.stats_path = NULL;
+	}
+
+	if (!cap.enabled) return !cap.failed;
+	cap.enabled = false;
+
+	while (cap.inflight) {
+		harvest(&cap.ring[cap.tail], true);
+		cap.tail = (cap.tail + 1) % HZ_CAPTURE_RING;
+		cap.inflight--;
+	}
+	for (INAT i = 0; i < HZ_CAPTURE_RING; i++) {
+		glDeleteBuffers(1, &cap.ring[i].pbo);
+		hz_gpumem_free(HZ_GPUMEM_BUFFER, cap.ring[i].pbo);
+	}
+
+	if (cap.thread_running) {
+		pthread_mutex_lock(&cap.lock);
+		cap.stopping = true;
+		pthread_cond_signal(&cap.work_ready);
+		pthread_mutex_unlock(&cap.lock);
+		pthread_join(cap.thread, NULL);
+		cap.thread_running = false;
+	}
+
+	if (cap.stream && fclose(cap.stream) != 0) cap.failed = true;
+	cap.stream = NULL;
+	for (INAT i = 0; i < HZ_CAPTURE_POOL; i++) free(cap.pool[i].pixels);
+	free(cap.scratch);
+
+	printf("capture: %u frames written to %s, %u dropped (size changed), %u readback stalls\n",
+		cap.written, cap.path, cap.dropped, cap.stalls);
+
+	return !cap.failed;
+}
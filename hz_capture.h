@@ -0,0 +1,48 @@
+#ifndef HZ_CAPTURE_H
+#define HZ_CAPTURE_H
+
+#include "holyh/src/holy.h"
+#include <SDL2/SDL.h>
+
+/* Asynchronous framebuffer readback, for video capture and golden-image tests.
+ *
+ * Every frame, glReadPixels() goes into one of a small ring of GL_PIXEL_PACK_BUFFER objects and a fence is dropped
+ * behind it. We only map a PBO once the fence for it has signalled (normally HZ_CAPTURE_RING - 1 frames later), so
+ * the GPU never has to drain its queue just so the CPU can look at a frame. The mapped pixels are copied into a pool
+ * buffer and a writer thread takes care of the (slow) encoding and disk IO.
+ *
+ * It's driven entirely from the command line, so the demos only need three calls:
+ *   --capture=PATH         Where to write. For png, a printf pattern like "cap_%05d.png" gives one file per frame,
+ *                          otherwise the same file is overwritten and you end up with the last frame captured.
+ *   --capture-format=FMT   raw (tightly packed top-down RGBA8 frames), y4m (YUV4MPEG2 4:2:0) or png.
+ *   --capture-skip=N       Don't capture the first N frames.
+ *   --frames=N             Quit after rendering N frames, capture or not.
+ *   --stats=PATH           Write frame time statistics (mean/median/p95/...) to PATH as JSON on shutdown.
+ *   --no-vsync             Turn off the swap interval the demos set, so the frame times mean something.
+ */
+
+#ifndef HZ_CAPTURE_RING
+#define HZ_CAPTURE_RING 3 /* PBOs in flight. 3 means we map frame N-2 while reading frame N. */
+#endif
+
+#ifndef HZ_CAPTURE_POOL
+#define HZ_CAPTURE_POOL 8 /* CPU-side frames waiting for the writer thread before we apply backpressure */
+#endif
+
+/* Parses the capture options out of argv. Needs a current GL context, and has to come after the demo sets its swap
+ * interval so --no-vsync wins. Returns true if capturing was requested.
+ */
+U1 hz_capture_init(INAT argc, CHR *argv[]);
+
+/* Queues a readback of the current back buffer. Call it right before SDL_GL_SwapWindow(). */
+X0 hz_capture_frame(SDL_Window *window);
+
+/* True once --frames worth of frames have gone through hz_capture_frame(). */
+U1 hz_capture_done();
+
+/* Drains every PBO still in flight, waits for the writer thread, closes the output and writes --stats. Safe to call
+ * twice. Returns false if any frame failed to read back or write out.
+ */
+U1 hz_capture_shutdown();
+
+#endif
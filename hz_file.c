@@ -0,0 +1,53 @@
+#include "hz_file.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+U1 hz_file_map(struct hzfile *f, const CHR *path, UNAT flags)
+{
+	f->data = NULL;
+	f->size = 0;
+
+	INAT fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "file: unable to open %s: %s\n", path, strerror(errno));
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+		fprintf(stderr, "file: %s is not a regular, non-empty file\n", path);
+		close(fd);
+		return false;
+	}
+
+	/* The mapping keeps its own reference to the file, the descriptor isn't needed past this */
+	X0 *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		fprintf(stderr, "file: unable to map %s: %s\n", path, strerror(errno));
+		return false;
+	}
+
+	f->data = p;
+	f->size = st.st_size;
+	if (flags & HZ_FILE_SEQUENTIAL) madvise(p, f->size, MADV_SEQUENTIAL);
+	if ((flags & HZ_FILE_WILLNEED) || ((flags & HZ_FILE_WILLNEED_LARGE) && f->size >= HZ_FILE_PREFETCH_SIZE)) {
+		hz_file_prefetch(f);
+	}
+	return true;
+}
+
+X0 hz_file_prefetch(const struct hzfile *f)
+{
+	if (f->data) madvise((X0*)f->data, f->size, MADV_WILLNEED);
+}
+
+X0 hz_file_unmap(struct hzfile *f)
+{
+	if (f->data) munmap((X0*)f->data, f->size);
+	f->data = NULL;
+	f->size = 0;
+}
@@ -0,0 +1,34 @@
+#ifndef HZ_FILE_H
+#define HZ_FILE_H
+
+#include "holyh/src/holy.h"
+
+/* Read-only memory mapped files. Loaders that take a buffer (stbi_load_from_memory and co.) can decode straight out
+ * of the page cache this way, instead of going through stdio and copying everything into a buffer of their own.
+ */
+
+struct hzfile {
+	const U8 *data;
+	size_t size;
+};
+
+enum {
+	HZ_FILE_SEQUENTIAL = 1, /* We're going to read it front to back once: bigger readahead, drop pages behind us */
+	HZ_FILE_WILLNEED = 2, /* Start reading the whole file in now, see hz_file_prefetch() */
+	HZ_FILE_WILLNEED_LARGE = 4, /* HZ_FILE_WILLNEED, but only for files of at least HZ_FILE_PREFETCH_SIZE */
+};
+
+/* Past this, one big read beats the kernel ramping its readahead up while we parse */
+#define HZ_FILE_PREFETCH_SIZE (1024 * 1024)
+
+/* Maps all of `path`. Returns false (with a message on stderr) if the file can't be opened or mapped, empty files
+ * included. `flags` is a mix of HZ_FILE_*.
+ */
+U1 hz_file_map(struct hzfile *f, const CHR *path, UNAT flags);
+/* Asks the kernel to page the file in in the background. Doesn't block, so it's worth doing as early as possible -
+ * map the next assets before decoding the current one, say.
+ */
+X0 hz_file_prefetch(const struct hzfile *f);
+X0 hz_file_unmap(struct hzfile *f);
+
+#endif
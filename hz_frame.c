@@ -0,0 +1,65 @@
+#include "hz_frame.h"
+
+static struct {
+	struct hzarena arena[2];
+	U32 current; /* The one this frame allocates from */
+	U1 ready;
+	struct hzframestats stats;
+} frame;
+
+static struct hzarena *current()
+{
+	/* No keep limit: a scene that needed it once will need it again */
+	if (!frame.ready) {
+		hz_arena_init(&frame.arena[0], HZ_FRAME_INITIAL, 0);
+		hz_arena_init(&frame.arena[1], HZ_FRAME_INITIAL, 0);
+		frame.ready = true;
+	}
+	return &frame.arena[frame.current];
+}
+
+X0 *hz_frame_alloc(size_t size)
+{
+	return hz_arena_alloc(current(), size);
+}
+
+X0 *hz_frame_calloc(size_t count, size_t size)
+{
+	if (size && count > SIZE_MAX / size) return NULL;
+	X0 *p = hz_frame_alloc(count * size);
+	if (p) memset(p, 0, count * size);
+	return p;
+}
+
+X0 hz_frame_end()
+{
+	frame.stats.frames++;
+	/* Nothing's been allocated yet, don't set the arenas up just to reset them */
+	if (!frame.ready) return;
+
+	struct hzarena *a = current();
+	frame.stats.last = a->used;
+	if (a->used > frame.stats.peak) frame.stats.peak = a->used;
+
+	/* This frame's allocations are still good for the next one, so check them now rather than at their reset */
+	hz_arena_check(a);
+	frame.current ^= 1;
+	hz_arena_reset(&frame.arena[frame.current]);
+	frame.stats.heap_allocs = frame.arena[0].stats.heap_allocs + frame.arena[1].stats.heap_allocs;
+}
+
+const struct hzframestats *hz_frame_stats()
+{
+	return &frame.stats;
+}
+
+X0 hz_frame_shutdown()
+{
+	if (!frame.ready) return;
+	printf("frame: peak %zu KiB over %llu frames, %llu heap blocks\n", frame.stats.peak / 1024,
+		(unsigned long long)frame.stats.frames, (unsigned long long)frame.stats.heap_allocs);
+	hz_arena_destroy(&frame.arena[0]);
+	hz_arena_destroy(&frame.arena[1]);
+	frame.ready = false;
+	frame.current = 0;
+}
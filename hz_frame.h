@@ -0,0 +1,48 @@
+#ifndef HZ_FRAME_H
+#define HZ_FRAME_H
+
+#include "holyh/src/holy.h"
+#include "hz_arena.h"
+
+/* Per-frame scratch memory: draw packets, culled lists, matrices, anything that's built during a frame and thrown
+ * away after. hz_frame_alloc() is a pointer bump (see hz_arena.h), and there's nothing to free.
+ *
+ * Two arenas take turns. Everything allocated during frame N stays valid until the end of frame N+1, so a frame can
+ * still read what the previous one built (last frame's visibility, say), and is released in one go when frame N+2
+ * starts allocating. The frame loop calls hz_frame_end() right after SDL_GL_SwapWindow(), and hz_frame_shutdown() on
+ * the way out. The arenas are set up by the first allocation, so there's nothing to initialise.
+ *
+ * The arenas keep their size from one frame to the next, so once a scene has warmed up it never touches the heap.
+ * In debug builds (HZ_ARENA_DEBUG) overruns are caught at the end of the frame and released memory is poisoned, so a
+ * pointer kept past its two frames reads garbage rather than plausible stale data.
+ *
+ * Main thread only. Jobs that want scratch memory should get it handed to them.
+ */
+
+#define HZ_FRAME_INITIAL (256 * 1024) /* First block of each arena, they grow as needed */
+
+struct hzframestats {
+	U64 frames; /* Frames ended */
+	size_t last; /* Bytes the last finished frame allocated, headers and padding included */
+	size_t peak; /* Most any frame allocated */
+	U64 heap_allocs; /* Blocks the arenas had to malloc(), which stops going up once they've grown to fit */
+};
+
+/* Returns `size` bytes aligned to HZ_ARENA_ALIGN that live until the end of the next frame, or NULL if the heap is
+ * out. The contents are undefined.
+ */
+X0 *hz_frame_alloc(size_t size);
+/* hz_frame_alloc() for `count` elements of `size` bytes each, zeroed. NULL if that overflows too. */
+X0 *hz_frame_calloc(size_t count, size_t size);
+
+/* Ends the frame: records its high-water mark, then switches to the other arena and releases what it held, which
+ * is everything from the frame before this one. Call it once a frame, after the swap.
+ */
+X0 hz_frame_end();
+
+const struct hzframestats *hz_frame_stats();
+
+/* Prints the stats (if anything was ever allocated) and gives both arenas back to the heap */
+X0 hz_frame_shutdown();
+
+#endif
@@ -0,0 +1,39 @@
+#include "hz_frustum.h"
+#include <math.h>
+
+X0 hz_frustum_from_matrix(struct hzfrustum *f, const R32 m[16])
+{
+	/* Clip space x, y and z each have to be within -w..w, and row 3 is w. Left, right, bottom, top, near, far. */
+	for (INAT i = 0; i < 6; i++) {
+		INAT row = i / 2;
+		R32 sign = i & 1 ? -1.0f : 1.0f, len = 0.0f;
+		for (INAT c = 0; c < 4; c++) {
+			f->plane[i][c] = m[c * 4 + 3] + sign * m[c * 4 + row];
+			if (c < 3) len += f->plane[i][c] * f->plane[i][c];
+		}
+		/* Normalised, so a plane's d is a distance and the sphere test works */
+		len = len > 0.0f ? 1.0f / sqrtf(len) : 0.0f;
+		for (INAT c = 0; c < 4; c++) f->plane[i][c] *= len;
+	}
+}
+
+U1 hz_frustum_aabb(const struct hzfrustum *f, const R32 min[3], const R32 max[3])
+{
+	for (INAT i = 0; i < 6; i++) {
+		/* The corner furthest along the normal. If even that's outside, the whole box is. */
+		const R32 *p = f->plane[i];
+		R32 d = p[3];
+		for (INAT c = 0; c < 3; c++) d += p[c] * (p[c] >= 0.0f ? max[c] : min[c]);
+		if (d < 0.0f) return false;
+	}
+	return true;
+}
+
+U1 hz_frustum_sphere(const struct hzfrustum *f, const R32 center[3], R32 radius)
+{
+	for (INAT i = 0; i < 6; i++) {
+		const R32 *p = f->plane[i];
+		if (p[0] * center[0] + p[1] * center[1] + p[2] * center[2] + p[3] < -radius) return false;
+	}
+	return true;
+}
@@ -0,0 +1,23 @@
+#ifndef HZ_FRUSTUM_H
+#define HZ_FRUSTUM_H
+
+#include "holyh/src/holy.h"
+
+/* View frustum culling. The six planes come straight out of the rows of the view-projection matrix (Gribb and
+ * Hartmann), in whatever space that matrix maps from, so a world space view-projection gives world space planes.
+ */
+
+struct hzfrustum {
+	R32 plane[6][4]; /* a, b, c, d with a normal pointing inwards: inside is a*x + b*y + c*z + d >= 0 */
+};
+
+/* Extracts the planes from a column major (cglm style) view-projection matrix. */
+X0 hz_frustum_from_matrix(struct hzfrustum *f, const R32 m[16]);
+/* False if the box is entirely on the outside of one of the planes. Boxes that straddle two planes just outside a
+ * corner get through, which costs a draw now and then but never a missing object.
+ */
+U1 hz_frustum_aabb(const struct hzfrustum *f, const R32 min[3], const R32 max[3]);
+/* The same for a sphere. */
+U1 hz_frustum_sphere(const struct hzfrustum *f, const R32 center[3], R32 radius);
+
+#endif
@@ -0,0 +1,302 @@
+#include "hz_gpumem.h"
+#include <GL/glew.h>
+
+struct record {
+	enum hzgpumemkind kind;
+	UNAT name;
+	size_t size;
+	UNAT format; /* Textures only, like the rest */
+	U32 width, height, layers, levels;
+	CHR tag[HZ_GPUMEM_TAG];
+};
+
+static struct {
+	struct record *rec;
+	U32 count, cap;
+	size_t total[HZ_GPUMEM_KINDS];
+	size_t peak;
+	size_t budget; /* --gpumem-budget, 0 for none */
+	U1 over; /* Over the budget right now, so we only complain once per trip over it */
+	U1 exceeded; /* Ever was */
+	U1 dump; /* --gpumem */
+} mem;
+
+static const CHR *kind_names[HZ_GPUMEM_KINDS] = { "buffer", "texture" };
+
+X0 hz_gpumem_init(INAT argc, CHR *argv[])
+{
+	for (INAT i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--gpumem")) mem.dump = true;
+		else if (!strncmp(argv[i], "--gpumem-budget=", 16)) mem.budget = (size_t)atoi(argv[i] + 16) * 1024 * 1024;
+	}
+}
+
+/* Bytes per 4x4 block for the block compressed formats, or 0 */
+static U32 block_size(UNAT format)
+{
+	switch (format) {
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RED_RGTC1: case GL_COMPRESSED_SIGNED_RED_RGTC1:
+		return 8;
+	case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+	case GL_COMPRESSED_RG_RGTC2: case GL_COMPRESSED_SIGNED_RG_RGTC2:
+	case GL_COMPRESSED_RGBA_BPTC_UNORM: case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+	case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT: case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+static U32 texel_size(UNAT format)
+{
+	switch (format) {
+	case GL_RED: case GL_R8: case GL_STENCIL_INDEX8:
+		return 1;
+	case GL_RG: case GL_RG8: case GL_R16: case GL_R16F: case GL_DEPTH_COMPONENT16:
+		return 2;
+	case GL_RGBA16: case GL_RGBA16F: case GL_RGB16F: case GL_RG32F: case GL_DEPTH32F_STENCIL8:
+		return 8;
+	case GL_RGB32F: case GL_RGBA32F:
+		return 16;
+	default: /* RGBA8 and friends, RGB8 (padded to 4), RG16, R32F, 24 and 32 bit depth, and anything we don't know */
+		return 4;
+	}
+}
+
+size_t hz_gpumem_texture_size(UNAT internal_format, U32 width, U32 height, U32 layers, U32 levels)
+{
+	U32 block = block_size(internal_format), texel = texel_size(internal_format);
+	size_t size = 0;
+	for (U32 i = 0; levels ? i < levels : 1; i++) {
+		if (block) size += (size_t)((width + 3) / 4) * ((height + 3) / 4) * block;
+		else size += (size_t)width * height * texel;
+		if (width == 1 && height == 1) break;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return size * (layers ? layers : 1);
+}
+
+static struct record *find(enum hzgpumemkind kind, UNAT name)
+{
+	for (U32 i = 0; i < mem.count; i++) {
+		if (mem.rec[i].kind == kind && mem.rec[i].name == name) return &mem.rec[i];
+	}
+	return NULL;
+}
+
+static X0 check_budget()
+{
+	size_t total = hz_gpumem_total(HZ_GPUMEM_KINDS);
+	if (total > mem.peak) mem.peak = total;
+	if (!mem.budget || total <= mem.budget) {
+		mem.over = false;
+		return;
+	}
+	if (mem.over) return;
+	mem.over = mem.exceeded = true;
+	fprintf(stderr, "gpumem: %zu KiB allocated, over the %zu KiB budget\n", total / 1024, mem.budget / 1024);
+	hz_gpumem_dump(stderr, 10);
+}
+
+/* The record for `name`, a fresh one if it had none. Takes whatever it had off the totals. */
+static struct record *record(enum hzgpumemkind kind, UNAT name, const CHR *tag)
+{
+	struct record *r = find(kind, name);
+	if (r) {
+		mem.total[kind] -= r->size;
+	} else {
+		if (mem.count == mem.cap) {
+			U32 cap = mem.cap ? mem.cap * 2 : 64;
+			struct record *rec = realloc(mem.rec, cap * sizeof(*rec));
+			if (!rec) return NULL; /* Only the accounting suffers */
+			mem.rec = rec;
+			mem.cap = cap;
+		}
+		r = &mem.rec[mem.count++];
+	}
+	memset(r, 0, sizeof(*r));
+	r->kind = kind;
+	r->name = name;
+	snprintf(r->tag, sizeof(r->tag), "%s", tag ? tag : "?");
+	return r;
+}
+
+X0 hz_gpumem_buffer(UNAT buffer, size_t size, const CHR *tag)
+{
+	struct record *r = record(HZ_GPUMEM_BUFFER, buffer, tag);
+	if (!r) return;
+	r->size = size;
+	mem.total[HZ_GPUMEM_BUFFER] += size;
+	check_budget();
+}
+
+X0 hz_gpumem_texture(UNAT texture, UNAT internal_format, U32 width, U32 height, U32 layers, U32 levels,
+	const CHR *tag)
+{
+	struct record *r = record(HZ_GPUMEM_TEXTURE, texture, tag);
+	if (!r) return;
+	r->format = internal_format;
+	r->width = width;
+	r->height = height;
+	r->layers = layers;
+	r->size = hz_gpumem_texture_size(internal_format, width, height, layers, levels);
+	r->levels = levels;
+	if (!levels) {
+		for (r->levels = 1; width > 1 || height > 1; r->levels++) {
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+	}
+	mem.total[HZ_GPUMEM_TEXTURE] += r->size;
+	check_budget();
+}
+
+X0 hz_gpumem_free(enum hzgpumemkind kind, UNAT name)
+{
+	struct record *r = find(kind, name);
+	if (!r) return;
+	mem.total[kind] -= r->size;
+	*r = mem.rec[--mem.count];
+	check_budget();
+}
+
+X0 hz_gpumem_upload_begin()
+{
+	while (glGetError() != GL_NO_ERROR);
+}
+
+UNAT hz_gpumem_upload_end()
+{
+	return glGetError();
+}
+
+size_t hz_gpumem_total(enum hzgpumemkind kind)
+{
+	if (kind < HZ_GPUMEM_KINDS) return mem.total[kind];
+	size_t total = 0;
+	for (INAT i = 0; i < HZ_GPUMEM_KINDS; i++) total += mem.total[i];
+	return total;
+}
+
+U1 hz_gpumem_query(struct hzgpumeminfo *info)
+{
+	memset(info, 0, sizeof(*info));
+	/* Both report KiB */
+	if (GLEW_NVX_gpu_memory_info) {
+		GLint v;
+		info->nvx = true;
+		glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &v);
+		info->dedicated = (size_t)v * 1024;
+		glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &v);
+		info->total_available = (size_t)v * 1024;
+		glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &v);
+		info->available = (size_t)v * 1024;
+		glGetIntegerv(GL_GPU_MEMORY_INFO_EVICTED_MEMORY_NVX, &v);
+		info->evicted = (size_t)v * 1024;
+		glGetIntegerv(GL_GPU_MEMORY_INFO_EVICTION_COUNT_NVX, &v);
+		info->evictions = v;
+	}
+	if (GLEW_ATI_meminfo) {
+		/* Each is total free, largest free block, then the same for auxiliary (shared) memory. We want the first. */
+		GLint v[4];
+		info->ati = true;
+		glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, v);
+		info->texture_free = (size_t)v[0] * 1024;
+		glGetIntegerv(GL_VBO_FREE_MEMORY_ATI, v);
+		info->buffer_free = (size_t)v[0] * 1024;
+		glGetIntegerv(GL_RENDERBUFFER_FREE_MEMORY_ATI, v);
+		info->renderbuffer_free = (size_t)v[0] * 1024;
+	}
+	return info->nvx || info->ati;
+}
+
+static INAT by_size(const X0 *a, const X0 *b)
+{
+	const struct record *ra = a, *rb = b;
+	return (ra->size < rb->size) - (ra->size > rb->size);
+}
+
+X0 hz_gpumem_dump(FILE *f, U32 top)
+{
+	fprintf(f, "gpumem: %zu KiB in %u objects (peak %zu KiB)", hz_gpumem_total(HZ_GPUMEM_KINDS) / 1024, mem.count,
+		mem.peak / 1024);
+	if (mem.budget) fprintf(f, ", budget %zu KiB", mem.budget / 1024);
+	fprintf(f, "\n");
+	for (INAT k = 0; k < HZ_GPUMEM_KINDS; k++) {
+		U32 n = 0;
+		for (U32 i = 0; i < mem.count; i++) n += mem.rec[i].kind == (enum hzgpumemkind)k;
+		fprintf(f, "  %-8s %10zu KiB in %u\n", kind_names[k], mem.total[k] / 1024, n);
+	}
+
+	/* Sorting a copy keeps hz_gpumem_free()'s swap-with-last cheap */
+	struct record *sorted = malloc((mem.count ? mem.count : 1) * sizeof(*sorted));
+	struct record *tags = malloc((mem.count ? mem.count : 1) * sizeof(*tags));
+	if (!sorted || !tags) {
+		free(sorted);
+		free(tags);
+		return;
+	}
+	memcpy(sorted, mem.rec, mem.count * sizeof(*sorted));
+	qsort(sorted, mem.count, sizeof(*sorted), by_size);
+
+	/* One record per tag, with the size summed and `name` counting the objects */
+	U32 ntags = 0;
+	for (U32 i = 0; i < mem.count; i++) {
+		U32 t = 0;
+		while (t < ntags && strcmp(tags[t].tag, sorted[i].tag)) t++;
+		if (t == ntags) {
+			tags[ntags] = sorted[i];
+			tags[ntags++].name = 0;
+			tags[t].size = 0;
+		}
+		tags[t].size += sorted[i].size;
+		tags[t].name++;
+	}
+	qsort(tags, ntags, sizeof(*tags), by_size);
+	fprintf(f, "  by owner:\n");
+	for (U32 t = 0; t < ntags && t < top; t++) {
+		fprintf(f, "    %10zu KiB  %s (%u)\n", tags[t].size / 1024, tags[t].tag, tags[t].name);
+	}
+
+	fprintf(f, "  biggest:\n");
+	for (U32 i = 0; i < mem.count && i < top; i++) {
+		const struct record *r = &sorted[i];
+		fprintf(f, "    %10zu KiB  %s %u, %s", r->size / 1024, kind_names[r->kind], r->name, r->tag);
+		if (r->kind == HZ_GPUMEM_TEXTURE) {
+			fprintf(f, ", %ux%u", r->width, r->height);
+			if (r->layers > 1) fprintf(f, "x%u", r->layers);
+			fprintf(f, " format 0x%x, %u level%s", r->format, r->levels, r->levels == 1 ? "" : "s");
+		}
+		fprintf(f, "\n");
+	}
+	free(sorted);
+	free(tags);
+
+	struct hzgpumeminfo info;
+	if (!hz_gpumem_query(&info)) {
+		fprintf(f, "  driver: no GL_NVX_gpu_memory_info or GL_ATI_meminfo\n");
+		return;
+	}
+	if (info.nvx) {
+		fprintf(f, "  driver: %zu of %zu KiB available (%zu KiB dedicated), %u evictions, %zu KiB evicted\n",
+			info.available / 1024, info.total_available / 1024, info.dedicated / 1024, info.evictions,
+			info.evicted / 1024);
+	}
+	if (info.ati) {
+		fprintf(f, "  driver: %zu KiB free for textures, %zu KiB for buffers, %zu KiB for renderbuffers\n",
+			info.texture_free / 1024, info.buffer_free / 1024, info.renderbuffer_free / 1024);
+	}
+}
+
+U1 hz_gpumem_shutdown()
+{
+	if (mem.dump) hz_gpumem_dump(stdout, 20);
+	U1 ok = !mem.exceeded;
+	free(mem.rec);
+	memset(&mem, 0, sizeof(mem));
+	return ok;
+}
@@ -0,0 +1,79 @@
+#ifndef HZ_GPUMEM_H
+#define HZ_GPUMEM_H
+
+#include "holyh/src/holy.h"
+#include <stdio.h>
+
+/* GPU memory accounting. GL won't tell you what a buffer or texture costs, so whoever allocates one records it here
+ * right after the glBufferData()/glTexImage*() that gave it storage, with an owner tag ("sprites", the path it was
+ * loaded from, ...), and calls hz_gpumem_free() when it's deleted. Recording the same object again replaces the old
+ * record, which is how a texture that gains or loses levels is kept up to date.
+ *
+ * Texture sizes are worked out from the internal format, so they're what the data takes, not what the driver makes of
+ * it: RGB8 is counted as 4 bytes a texel, since that's how everybody stores it, and alignment and tiling padding
+ * aren't counted at all. Formats we don't know are counted as 4 bytes a texel.
+ *
+ * What the driver itself says is free comes from GL_NVX_gpu_memory_info or GL_ATI_meminfo, when it has either.
+ *
+ * Driven from the command line like hz_capture.h:
+ *   --gpumem               Print hz_gpumem_dump() on shutdown.
+ *   --gpumem-budget=MiB    Complain (with a dump) the moment the recorded total goes over MiB, and make
+ *                          hz_gpumem_shutdown() return false if it ever did.
+ */
+
+#define HZ_GPUMEM_TAG 48 /* Longest tag kept, longer ones are cut short */
+
+enum hzgpumemkind {
+	HZ_GPUMEM_BUFFER,
+	HZ_GPUMEM_TEXTURE,
+	HZ_GPUMEM_KINDS,
+};
+
+struct hzgpumeminfo {
+	U1 nvx; /* The GL_NVX_gpu_memory_info fields are filled in */
+	U1 ati; /* The GL_ATI_meminfo ones are */
+	size_t dedicated; /* NVX: dedicated VRAM */
+	size_t total_available; /* NVX: VRAM the driver will hand out in total */
+	size_t available; /* NVX: of which this much is free right now */
+	size_t evicted; /* NVX: bytes evicted to make room, ever */
+	U32 evictions; /* NVX: and how many times */
+	size_t texture_free; /* ATI: free memory in the texture pool */
+	size_t buffer_free; /* ATI: in the buffer pool */
+	size_t renderbuffer_free; /* ATI: in the renderbuffer pool */
+};
+
+/* Parses the options out of argv. Recording works whether this is called or not. */
+X0 hz_gpumem_init(INAT argc, CHR *argv[]);
+
+/* Records `buffer` as having `size` bytes of storage. */
+X0 hz_gpumem_buffer(UNAT buffer, size_t size, const CHR *tag);
+/* Records `texture` as having `levels` mip levels in `internal_format`, the finest one `width` by `height` and each
+ * `layers` deep (1 for a plain 2D texture). A `levels` of 0 means the whole chain down to 1x1.
+ */
+X0 hz_gpumem_texture(UNAT texture, UNAT internal_format, U32 width, U32 height, U32 layers, U32 levels,
+	const CHR *tag);
+/* Forgets `name`, call it when deleting it. Names that were never recorded are fine. */
+X0 hz_gpumem_free(enum hzgpumemkind kind, UNAT name);
+
+/* Bracket an upload so its GL errors can be told apart from ones somebody else left pending. hz_gpumem_upload_begin()
+ * throws away whatever errors are queued up, hz_gpumem_upload_end() returns the first one raised since, or
+ * GL_NO_ERROR if the upload went through.
+ */
+X0 hz_gpumem_upload_begin();
+UNAT hz_gpumem_upload_end();
+
+/* Bytes a texture like that takes, as hz_gpumem_texture() counts them. */
+size_t hz_gpumem_texture_size(UNAT internal_format, U32 width, U32 height, U32 layers, U32 levels);
+/* Bytes recorded for one kind of object, or for all of them with HZ_GPUMEM_KINDS. */
+size_t hz_gpumem_total(enum hzgpumemkind kind);
+
+/* Asks the driver how much memory it has. Returns false if it supports neither extension. */
+U1 hz_gpumem_query(struct hzgpumeminfo *info);
+
+/* Prints the totals per kind and per tag, the `top` biggest objects, and what the driver says. */
+X0 hz_gpumem_dump(FILE *f, U32 top);
+
+/* Dumps for --gpumem and forgets everything. Returns false if --gpumem-budget was ever exceeded. */
+U1 hz_gpumem_shutdown();
+
+#endif
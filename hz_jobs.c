@@ -0,0 +1,122 @@
+#include "hz_jobs.h"
+#include <pthread.h>
+#include <unistd.h>
+
+#define HZ_JOBS_MAX_THREADS 64
+
+static struct {
+	pthread_t threads[HZ_JOBS_MAX_THREADS];
+	INAT nthreads; /* Workers, not counting whoever calls hz_jobs_run() */
+	pthread_mutex_t run_lock; /* Held for a whole hz_jobs_run(), one batch at a time */
+	pthread_mutex_t lock; /* Everything below */
+	pthread_cond_t work; /* Signalled when a batch starts, or when the workers should exit */
+	pthread_cond_t done; /* Signalled when the last job of a batch finishes */
+	hzjobfn fn;
+	X0 *data;
+	INAT count, next, finished;
+	U1 stopping;
+} pool = { .run_lock = PTHREAD_MUTEX_INITIALIZER, .lock = PTHREAD_MUTEX_INITIALIZER,
+	.work = PTHREAD_COND_INITIALIZER, .done = PTHREAD_COND_INITIALIZER };
+
+static _Thread_local U1 in_job;
+
+/* Runs jobs from the current batch until there are none left to claim. Called and returns with the lock held. */
+static X0 drain()
+{
+	while (pool.fn && pool.next < pool.count) {
+		INAT index = pool.next++;
+		hzjobfn fn = pool.fn;
+		X0 *data = pool.data;
+		pthread_mutex_unlock(&pool.lock);
+
+		in_job = true;
+		fn(data, index);
+		in_job = false;
+
+		pthread_mutex_lock(&pool.lock);
+		if (++pool.finished == pool.count) pthread_cond_broadcast(&pool.done);
+	}
+}
+
+static X0 *worker_main(X0 *arg)
+{
+	(X0)arg;
+	pthread_mutex_lock(&pool.lock);
+	while (!pool.stopping) {
+		drain();
+		if (!pool.stopping) pthread_cond_wait(&pool.work, &pool.lock);
+	}
+	pthread_mutex_unlock(&pool.lock);
+	return NULL;
+}
+
+U1 hz_jobs_init(INAT threads)
+{
+	pthread_mutex_lock(&pool.run_lock);
+	if (pool.nthreads) {
+		pthread_mutex_unlock(&pool.run_lock);
+		return true;
+	}
+
+	if (threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads > HZ_JOBS_MAX_THREADS + 1) threads = HZ_JOBS_MAX_THREADS + 1;
+
+	pool.stopping = false;
+	for (INAT i = 0; i < threads - 1; i++) {
+		if (pthread_create(&pool.threads[pool.nthreads], NULL, worker_main, NULL) != 0) {
+			fprintf(stderr, "jobs: unable to start worker thread %d, going with %d\n", i + 1, pool.nthreads);
+			break;
+		}
+		pool.nthreads++;
+	}
+	pthread_mutex_unlock(&pool.run_lock);
+	return pool.nthreads > 0 || threads <= 1;
+}
+
+X0 hz_jobs_run(hzjobfn fn, X0 *data, INAT count)
+{
+	/* From inside a job the pool is busy with our own batch, waiting on it would deadlock */
+	if (in_job || count <= 1) {
+		for (INAT i = 0; i < count; i++) fn(data, i);
+		return;
+	}
+
+	pthread_mutex_lock(&pool.run_lock);
+	if (!pool.nthreads) {
+		pthread_mutex_unlock(&pool.run_lock);
+		for (INAT i = 0; i < count; i++) fn(data, i);
+		return;
+	}
+
+	pthread_mutex_lock(&pool.lock);
+	pool.fn = fn;
+	pool.data = data;
+	pool.count = count;
+	pool.next = 0;
+	pool.finished = 0;
+	pthread_cond_broadcast(&pool.work);
+
+	drain();
+	while (pool.finished < pool.count) pthread_cond_wait(&pool.done, &pool.lock);
+	pool.fn = NULL;
+	pthread_mutex_unlock(&pool.lock);
+	pthread_mutex_unlock(&pool.run_lock);
+}
+
+INAT hz_jobs_threads()
+{
+	return pool.nthreads + 1;
+}
+
+X0 hz_jobs_shutdown()
+{
+	pthread_mutex_lock(&pool.run_lock);
+	pthread_mutex_lock(&pool.lock);
+	pool.stopping = true;
+	pthread_cond_broadcast(&pool.work);
+	pthread_mutex_unlock(&pool.lock);
+
+	for (INAT i = 0; i < pool.nthreads; i++) pthread_join(pool.threads[i], NULL);
+	pool.nthreads = 0;
+	pthread_mutex_unlock(&pool.run_lock);
+}
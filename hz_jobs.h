@@ -0,0 +1,31 @@
+#ifndef HZ_JOBS_H
+#define HZ_JOBS_H
+
+#include "holyh/src/holy.h"
+
+/* A fixed pool of worker threads for splitting one piece of work into independent jobs (image bands, restart
+ * intervals, mip levels...). There's one pool per process. hz_jobs_run() blocks, and the calling thread works
+ * through jobs too, so a pool of N threads has N - 1 workers.
+ */
+
+typedef X0 (*hzjobfn)(X0 *data, INAT index);
+
+/* Starts the pool with `threads` threads in total, counting the caller, or one per online CPU if `threads` is 0. Does
+ * nothing if the pool is already running. Returns false if no worker could be started, in which case hz_jobs_run()
+ * still works, it just runs everything on the calling thread.
+ */
+U1 hz_jobs_init(INAT threads);
+
+/* Calls fn(data, i) for every i in [0, count) and returns once they have all finished. Jobs may run in any order, on
+ * any thread. Calls from inside a job, or from a second thread while the pool is busy, run on the calling thread or
+ * wait their turn respectively.
+ */
+X0 hz_jobs_run(hzjobfn fn, X0 *data, INAT count);
+
+/* Threads a hz_jobs_run() can spread over, the caller included. 1 if the pool isn't running. */
+INAT hz_jobs_threads();
+
+/* Stops and joins the workers. hz_jobs_init() can start the pool again afterwards. */
+X0 hz_jobs_shutdown();
+
+#endif
@@ -0,0 +1,213 @@
+#include "hz_ktx.h"
+#include <GL/glew.h>
+#include <errno.h>
+
+static const U8 identifier[12] = { 0xab, 'K', 'T', 'X', ' ', '1', '1', 0xbb, '\r', '\n', 0x1a, '\n' };
+
+#define KTX_ENDIAN 0x04030201
+#define KTX_HEADER_SIZE 64
+
+/* The header fields after the identifier, in file order */
+enum {
+	F_ENDIANNESS, F_GL_TYPE, F_GL_TYPE_SIZE, F_GL_FORMAT, F_GL_INTERNAL_FORMAT, F_GL_BASE_INTERNAL_FORMAT,
+	F_WIDTH, F_HEIGHT, F_DEPTH, F_ARRAY_ELEMENTS, F_FACES, F_LEVELS, F_KEY_VALUE_BYTES, F_COUNT
+};
+
+static const CHR orientation[] = "KTXorientation\0S=r,T=u";
+
+static U32 read_u32(const U8 *p)
+{
+	U32 v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static size_t pad4(size_t n)
+{
+	return (n + 3) & ~(size_t)3;
+}
+
+U1 hz_ktx_is_ktx(const U8 *data, size_t size)
+{
+	return size >= sizeof(identifier) && !memcmp(data, identifier, sizeof(identifier));
+}
+
+U32 hz_ktx_mip_count(U32 width, U32 height)
+{
+	U32 levels = 1, size = width > height ? width : height;
+	while (size > 1) {
+		size >>= 1;
+		levels++;
+	}
+	return levels;
+}
+
+/* Bytes per 4x4 block of a compressed format, 0 if we don't know it */
+static U32 block_size(U32 internal_format)
+{
+	switch (internal_format) {
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RED_RGTC1:
+	case GL_COMPRESSED_SIGNED_RED_RGTC1:
+		return 8;
+	case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+	case GL_COMPRESSED_RG_RGTC2:
+	case GL_COMPRESSED_SIGNED_RG_RGTC2:
+	case GL_COMPRESSED_RGBA_BPTC_UNORM:
+	case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+	case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+	case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+		return 16;
+	}
+	return 0;
+}
+
+/* Bytes per pixel glTexImage2D() reads for a format and type, 0 if we don't know them */
+static U32 pixel_size(U32 format, U32 type)
+{
+	switch (type) {
+	case GL_UNSIGNED_BYTE_3_3_2:
+	case GL_UNSIGNED_BYTE_2_3_3_REV:
+		return 1;
+	case GL_UNSIGNED_SHORT_5_6_5:
+	case GL_UNSIGNED_SHORT_5_6_5_REV:
+	case GL_UNSIGNED_SHORT_4_4_4_4:
+	case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+	case GL_UNSIGNED_SHORT_5_5_5_1:
+	case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+		return 2;
+	case GL_UNSIGNED_INT_8_8_8_8:
+	case GL_UNSIGNED_INT_8_8_8_8_REV:
+	case GL_UNSIGNED_INT_10_10_10_2:
+	case GL_UNSIGNED_INT_2_10_10_10_REV:
+	case GL_UNSIGNED_INT_10F_11F_11F_REV:
+	case GL_UNSIGNED_INT_5_9_9_9_REV:
+		return 4;
+	}
+
+	U32 component;
+	switch (type) {
+	case GL_UNSIGNED_BYTE: case GL_BYTE: component = 1; break;
+	case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: component = 2; break;
+	case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT: component = 4; break;
+	default: return 0;
+	}
+	switch (format) {
+	case GL_RED: case GL_GREEN: case GL_BLUE: case GL_ALPHA: case GL_LUMINANCE: case GL_RED_INTEGER:
+		return component;
+	case GL_RG: case GL_LUMINANCE_ALPHA: case GL_RG_INTEGER:
+		return component * 2;
+	case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: case GL_BGR_INTEGER:
+		return component * 3;
+	case GL_RGBA: case GL_BGRA: case GL_RGBA_INTEGER: case GL_BGRA_INTEGER:
+		return component * 4;
+	}
+	return 0;
+}
+
+static U1 fail(const CHR *name, const CHR *why)
+{
+	fprintf(stderr, "ktx: %s: %s\n", name, why);
+	return false;
+}
+
+U1 hz_ktx_parse(struct hzktx *k, const U8 *data, size_t size, const CHR *name)
+{
+	U32 h[F_COUNT];
+	memset(k, 0, sizeof(*k));
+	if (size < KTX_HEADER_SIZE || !hz_ktx_is_ktx(data, size)) return fail(name, "Not a KTX 1 file");
+	for (INAT i = 0; i < F_COUNT; i++) h[i] = read_u32(data + sizeof(identifier) + i * 4);
+
+	/* We only ever write these on little endian machines, and only ever read them there */
+	if (h[F_ENDIANNESS] != KTX_ENDIAN) return fail(name, "Byte order doesn't match ours");
+	if (!h[F_WIDTH] || !h[F_HEIGHT] || h[F_DEPTH] || h[F_ARRAY_ELEMENTS] || h[F_FACES] != 1) {
+		return fail(name, "Only plain 2D textures are supported");
+	}
+	if (!h[F_GL_INTERNAL_FORMAT] || (!h[F_GL_TYPE]) != (!h[F_GL_FORMAT])) return fail(name, "Bad GL format");
+
+	/* 0 levels means "make the mipmaps yourself", which is one level as far as the file is concerned */
+	U32 levels = h[F_LEVELS] ? h[F_LEVELS] : 1;
+	if (levels > HZ_KTX_MAX_LEVELS || levels > hz_ktx_mip_count(h[F_WIDTH], h[F_HEIGHT])) {
+		return fail(name, "Too many mip levels");
+	}
+	if (hz_ktx_mip_count(h[F_WIDTH], h[F_HEIGHT]) > HZ_KTX_MAX_LEVELS) return fail(name, "Too big");
+
+	/* GL reads however much the format says a level takes, whatever the file says, so the two have to agree */
+	U32 pixel = h[F_GL_TYPE] ? pixel_size(h[F_GL_FORMAT], h[F_GL_TYPE]) : 0;
+	U32 block = h[F_GL_TYPE] ? 0 : block_size(h[F_GL_INTERNAL_FORMAT]);
+	if (!pixel && !block) return fail(name, "Unsupported GL format");
+
+	size_t pos = KTX_HEADER_SIZE;
+	if (h[F_KEY_VALUE_BYTES] > size - pos) return fail(name, "Truncated key/value data");
+	pos += pad4(h[F_KEY_VALUE_BYTES]);
+
+	for (U32 i = 0; i < levels; i++) {
+		if (pos > size || size - pos < 4) return fail(name, "Truncated level");
+		U32 level_size = read_u32(data + pos);
+		pos += 4;
+		if (!level_size || level_size > size - pos) return fail(name, "Truncated level");
+		size_t w = h[F_WIDTH] >> i ? h[F_WIDTH] >> i : 1, ht = h[F_HEIGHT] >> i ? h[F_HEIGHT] >> i : 1;
+		size_t expected = pixel ? pad4(w * pixel) * ht : ((w + 3) / 4) * ((ht + 3) / 4) * block;
+		if (level_size != expected) return fail(name, "Level size doesn't match its format");
+		k->level_data[i] = data + pos;
+		k->level_size[i] = level_size;
+		pos += pad4(level_size);
+	}
+
+	k->gl_type = h[F_GL_TYPE];
+	k->gl_type_size = h[F_GL_TYPE_SIZE];
+	k->gl_format = h[F_GL_FORMAT];
+	k->gl_internal_format = h[F_GL_INTERNAL_FORMAT];
+	k->gl_base_internal_format = h[F_GL_BASE_INTERNAL_FORMAT];
+	k->width = h[F_WIDTH];
+	k->height = h[F_HEIGHT];
+	k->levels = levels;
+	return true;
+}
+
+U1 hz_ktx_write(const struct hzktx *k, const CHR *path)
+{
+	static const U8 zero[4] = { 0 };
+	U32 h[F_COUNT] = { 0 };
+	U32 kv_size = sizeof(orientation); /* The key, the value and both their terminators */
+
+	h[F_ENDIANNESS] = KTX_ENDIAN;
+	h[F_GL_TYPE] = k->gl_type;
+	h[F_GL_TYPE_SIZE] = k->gl_type_size;
+	h[F_GL_FORMAT] = k->gl_format;
+	h[F_GL_INTERNAL_FORMAT] = k->gl_internal_format;
+	h[F_GL_BASE_INTERNAL_FORMAT] = k->gl_base_internal_format;
+	h[F_WIDTH] = k->width;
+	h[F_HEIGHT] = k->height;
+	h[F_FACES] = 1;
+	h[F_LEVELS] = k->levels;
+	h[F_KEY_VALUE_BYTES] = 4 + pad4(kv_size);
+
+	FILE *f = fopen(path, "wb");
+	if (!f) {
+		fprintf(stderr, "ktx: unable to open %s for writing: %s\n", path, strerror(errno));
+		return false;
+	}
+
+	U1 ok = fwrite(identifier, sizeof(identifier), 1, f) == 1
+		&& fwrite(h, sizeof(h), 1, f) == 1
+		&& fwrite(&kv_size, 4, 1, f) == 1
+		&& fwrite(orientation, kv_size, 1, f) == 1
+		&& fwrite(zero, pad4(kv_size) - kv_size, 1, f) <= 1;
+	for (U32 i = 0; ok && i < k->levels; i++) {
+		U32 size = k->level_size[i];
+		ok = fwrite(&size, 4, 1, f) == 1
+			&& fwrite(k->level_data[i], size, 1, f) == 1
+			&& (pad4(size) == size || fwrite(zero, pad4(size) - size, 1, f) == 1);
+	}
+
+	if (fclose(f) != 0) ok = false;
+	if (!ok) fprintf(stderr, "ktx: unable to write %s: %s\n", path, strerror(errno));
+	return ok;
+}
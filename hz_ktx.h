@@ -0,0 +1,44 @@
+#ifndef HZ_KTX_H
+#define HZ_KTX_H
+
+#include "holyh/src/holy.h"
+
+/* KTX 1.1 containers (https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html), the subset we cook: one 2D image,
+ * no array layers or cube faces, any number of mip levels. The header is made of the GL enums the data is meant to
+ * be uploaded with, so loading one is a glTexImage2D() (or glCompressedTexImage2D(), for gl_type 0) per level, with
+ * no decoding and no conversion.
+ *
+ * Levels are stored bottom row first, the way GL wants them, and the files say so (KTXorientation "S=r,T=u").
+ * Uncompressed rows are padded to 4 bytes, the default GL_UNPACK_ALIGNMENT.
+ *
+ * Every level has to be exactly the size its format and dimensions make it, since that's how much GL is going to
+ * read, so only formats we know the size of (the usual uncompressed ones, S3TC, RGTC and BPTC) are accepted.
+ */
+
+#define HZ_KTX_MAX_LEVELS 16 /* Enough for a 32768x32768 chain */
+
+struct hzktx {
+	U32 gl_type; /* 0 for compressed formats */
+	U32 gl_type_size;
+	U32 gl_format; /* 0 for compressed formats */
+	U32 gl_internal_format;
+	U32 gl_base_internal_format;
+	U32 width;
+	U32 height;
+	U32 levels;
+	const U8 *level_data[HZ_KTX_MAX_LEVELS];
+	U32 level_size[HZ_KTX_MAX_LEVELS];
+};
+
+/* True if `data` starts with the KTX 1 identifier. */
+U1 hz_ktx_is_ktx(const U8 *data, size_t size);
+/* Fills in `k` from a KTX file in memory. level_data[] points into `data`, nothing is copied. Returns false (with a
+ * message on stderr mentioning `name`) for anything that isn't a well formed file of the kind described above.
+ */
+U1 hz_ktx_parse(struct hzktx *k, const U8 *data, size_t size, const CHR *name);
+/* Writes `k` out to `path`, level_data[] and level_size[] included. */
+U1 hz_ktx_write(const struct hzktx *k, const CHR *path);
+/* Number of levels in a full mip chain down to 1x1. */
+U32 hz_ktx_mip_count(U32 width, U32 height);
+
+#endif
@@ -0,0 +1,45 @@
+#include "hz_lod.h"
+#include "hz_frame.h"
+#include "hz_stream.h"
+
+R32 hz_lod_pixels_per_unit(const R32 modelview[16], const R32 projection[16], INAT viewport_height)
+{
+	/* That's the height of something a unit in radius, so twice what we're after */
+	return hz_stream_screen_size(modelview, projection, 1.0f, viewport_height) * 0.5f;
+}
+
+U32 hz_lod_select(const R32 *error, U32 lods, R32 pixels_per_unit, R32 threshold, U32 current)
+{
+	if (!lods) return 0;
+	U32 l = current < lods ? current : lods - 1;
+	/* Finer straight away if this one shows */
+	if (l > 0 && error[l] * pixels_per_unit > threshold) {
+		while (l > 0 && error[l] * pixels_per_unit > threshold) l--;
+		return l;
+	}
+	/* Coarser only with some room to spare, or we'd be straight back */
+	while (l + 1 < lods && error[l + 1] * pixels_per_unit <= threshold * (1.0f - HZ_LOD_HYSTERESIS)) l++;
+	return l;
+}
+
+U1 hz_lod_bucket(struct hzlodbuckets *b, const U32 *bucket, U32 count, U32 buckets)
+{
+	b->buckets = buckets;
+	b->first = hz_frame_calloc((size_t)buckets + 1, sizeof(U32));
+	b->instance = hz_frame_alloc((size_t)(count ? count : 1) * sizeof(U32));
+	U32 *next = hz_frame_alloc((size_t)(buckets ? buckets : 1) * sizeof(U32));
+	if (!b->first || !b->instance || !next) return false;
+
+	/* A counting sort, which keeps the instances of a bucket in order */
+	for (U32 i = 0; i < count; i++) {
+		if (bucket[i] < buckets) b->first[bucket[i] + 1]++;
+	}
+	for (U32 i = 0; i < buckets; i++) {
+		b->first[i + 1] += b->first[i];
+		next[i] = b->first[i];
+	}
+	for (U32 i = 0; i < count; i++) {
+		if (bucket[i] < buckets) b->instance[next[bucket[i]]++] = i;
+	}
+	return true;
+}
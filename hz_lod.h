@@ -0,0 +1,48 @@
+#ifndef HZ_LOD_H
+#define HZ_LOD_H
+
+#include "holyh/src/holy.h"
+
+/* Discrete level of detail. A mesh comes with a few versions of itself, each simplified further than the one before
+ * (hz_meshopt_lods() makes them, cooked meshes carry them), and each with the error that simplifying made, in model
+ * units. An object gets the coarsest one whose error, projected onto the screen, is at most `threshold` pixels, which
+ * far enough away is a fraction of the triangles for no difference anyone can see.
+ *
+ * An object sitting right at a threshold would flip between two levels every time the camera twitched, and the
+ * switch shows (popping). So it takes a margin: a coarser level only once its error has come down to
+ * (1 - HZ_LOD_HYSTERESIS) of the threshold, a finer one as soon as the current level's goes over it. In between, an
+ * object keeps the level it had, which the caller remembers per object from one frame to the next (a byte each, 0 to
+ * start with).
+ *
+ * Instanced drawing wants every instance of a draw to be the same mesh, so once every object has its level,
+ * hz_lod_bucket() sorts them by it (and by mesh), for one instanced draw per bucket: a hz_drawlist_add() with the
+ * bucket's instance count, with each instance's data written out at the draw IDs that hands back.
+ */
+
+#define HZ_LOD_MAX 4 /* Levels a mesh can have, including the full one */
+#define HZ_LOD_PIXELS 1.0f /* A threshold to start from: at most a pixel out */
+#define HZ_LOD_HYSTERESIS 0.4f
+
+/* Instances grouped into buckets. Bucket `i` is instance[first[i]] up to instance[first[i + 1]], in the order the
+ * instances came in.
+ */
+struct hzlodbuckets {
+	U32 buckets;
+	U32 *first; /* buckets + 1 of them */
+	U32 *instance;
+};
+
+/* How many pixels one model unit comes out at, around the model's origin, drawn with these (column major, cglm
+ * style) matrices in a viewport `viewport_height` pixels tall. Huge when the origin is at or behind the eye.
+ */
+R32 hz_lod_pixels_per_unit(const R32 modelview[16], const R32 projection[16], INAT viewport_height);
+/* The level for an object with `lods` levels (error[0] being the full mesh's 0) that had level `current` last frame,
+ * at `pixels_per_unit`.
+ */
+U32 hz_lod_select(const R32 *error, U32 lods, R32 pixels_per_unit, R32 threshold, U32 current);
+/* Sorts `count` instances into `buckets` buckets by bucket[i], mesh * HZ_LOD_MAX + level, say. The lists come out of
+ * the frame arena. Returns false if that's out.
+ */
+U1 hz_lod_bucket(struct hzlodbuckets *b, const U32 *bucket, U32 count, U32 buckets);
+
+#endif
@@ -0,0 +1,146 @@
+#include "hz_lz.h"
+
+#define MIN_MATCH 4
+#define MAX_OFFSET 65535
+/* The format's end conditions: the last 5 bytes are always literals, and no match starts in the last 12 */
+#define LAST_LITERALS 5
+#define MATCH_LIMIT 12
+#define HASH_BITS 16
+
+size_t hz_lz_bound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+static U32 read32(const U8 *p)
+{
+	U32 v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static U32 hash4(U32 v)
+{
+	return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* A literal or match length past what fits in its 4 bits of token goes on in 255s */
+static U8 *put_length(U8 *op, size_t length)
+{
+	for (; length >= 255; length -= 255) *op++ = 255;
+	*op++ = length;
+	return op;
+}
+
+size_t hz_lz_compress(const U8 *data, size_t size, U8 *out, size_t out_size)
+{
+	U32 *table = calloc(1 << HASH_BITS, sizeof(U32));
+	if (!table) return 0;
+
+	const U8 *ip = data, *anchor = data, *end = data + size;
+	const U8 *match_limit = size > MATCH_LIMIT ? end - MATCH_LIMIT : data;
+	U8 *op = out, *op_end = out + out_size;
+
+	while (ip < match_limit) {
+		U32 h = hash4(read32(ip));
+		const U8 *ref = data + table[h];
+		table[h] = ip - data;
+		if (ref >= ip || ip - ref > MAX_OFFSET || read32(ref) != read32(ip)) {
+			ip++;
+			continue;
+		}
+
+		/* Stretch the match back over literals that also match, then forwards as far as it goes */
+		while (ip > anchor && ref > data && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+		const U8 *mp = ip + MIN_MATCH, *mr = ref + MIN_MATCH;
+		while (mp < end - LAST_LITERALS && *mp == *mr) {
+			mp++;
+			mr++;
+		}
+
+		size_t literals = ip - anchor, match = mp - ip - MIN_MATCH;
+		/* Worst case for the sequence: token, both length runs, the literals and the offset */
+		if ((size_t)(op_end - op) < 1 + literals / 255 + 1 + literals + 2 + match / 255 + 1) {
+			free(table);
+			return 0;
+		}
+		U8 *token = op++;
+		*token = (literals < 15 ? literals : 15) << 4 | (match < 15 ? match : 15);
+		if (literals >= 15) op = put_length(op, literals - 15);
+		memcpy(op, anchor, literals);
+		op += literals;
+		U16 offset = ip - ref;
+		*op++ = offset;
+		*op++ = offset >> 8;
+		if (match >= 15) op = put_length(op, match - 15);
+
+		ip = anchor = mp;
+	}
+	free(table);
+
+	/* Whatever's left is the final literal run */
+	size_t literals = end - anchor;
+	if ((size_t)(op_end - op) < 1 + literals / 255 + 1 + literals) return 0;
+	*op++ = (literals < 15 ? literals : 15) << 4;
+	if (literals >= 15) op = put_length(op, literals - 15);
+	memcpy(op, anchor, literals);
+	op += literals;
+	return op - out;
+}
+
+/* Reads the rest of a length whose 4 bits said 15. False if the input runs out first. */
+static U1 get_length(const U8 **ip, const U8 *end, size_t *length)
+{
+	U8 b;
+	do {
+		if (*ip >= end) return false;
+		b = *(*ip)++;
+		if (SIZE_MAX - *length < b) return false;
+		*length += b;
+	} while (b == 255);
+	return true;
+}
+
+U1 hz_lz_decompress(const U8 *data, size_t size, U8 *out, size_t out_size)
+{
+	const U8 *ip = data, *end = data + size;
+	U8 *op = out, *op_end = out + out_size;
+
+	while (ip < end) {
+		U8 token = *ip++;
+		size_t literals = token >> 4;
+		if (literals == 15 && !get_length(&ip, end, &literals)) return false;
+		if (literals > (size_t)(end - ip) || literals > (size_t)(op_end - op)) return false;
+		memcpy(op, ip, literals);
+		ip += literals;
+		op += literals;
+
+		/* The last sequence stops after its literals */
+		if (ip == end) break;
+
+		if (end - ip < 2) return false;
+		size_t offset = ip[0] | ip[1] << 8;
+		ip += 2;
+		if (!offset || offset > (size_t)(op - out)) return false;
+
+		size_t match = token & 15;
+		if (match == 15 && !get_length(&ip, end, &match)) return false;
+		match += MIN_MATCH;
+		if (match > (size_t)(op_end - op)) return false;
+
+		/* Matches can overlap what they're writing (offset < length means a repeating pattern), so byte by byte
+		 * unless they're far enough apart for memcpy().
+		 */
+		const U8 *ref = op - offset;
+		if (offset >= match) {
+			memcpy(op, ref, match);
+			op += match;
+		} else {
+			while (match--) *op++ = *ref++;
+		}
+	}
+	return op == op_end;
+}
@@ -0,0 +1,25 @@
+#ifndef HZ_LZ_H
+#define HZ_LZ_H
+
+#include "holyh/src/holy.h"
+
+/* LZ4 block format compression: byte oriented LZ77 with no entropy coding, so decompression is little more than
+ * memcpy() and runs at memory speed. That's what makes it worth compressing assets at all - reading fewer bytes from
+ * disk has to win back more than the decompression costs.
+ *
+ * Blocks are plain LZ4 blocks (no frame, no checksum), readable by any LZ4 block decoder. The compressor is the
+ * simple greedy kind, one hash table probe per position, which is fine for something that runs at build time.
+ */
+
+/* Largest compressed size of `size` bytes of input, for sizing the output buffer. */
+size_t hz_lz_bound(size_t size);
+/* Compresses `size` bytes into `out`, which has room for `out_size` bytes. Returns the compressed size, or 0 if it
+ * didn't fit.
+ */
+size_t hz_lz_compress(const U8 *data, size_t size, U8 *out, size_t out_size);
+/* Decompresses `size` bytes of block into exactly `out_size` bytes at `out`. Returns false if the block is corrupt
+ * or doesn't decompress to exactly that size. Never reads or writes out of bounds, whatever the input.
+ */
+U1 hz_lz_decompress(const U8 *data, size_t size, U8 *out, size_t out_size);
+
+#endif
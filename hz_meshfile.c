@@ -0,0 +1,194 @@
+#include "hz_meshfile.h"
+#include "hz_gpumem.h"
+#include <GL/glew.h>
+#include <errno.h>
+
+static U1 fail(struct hzmeshfile *m, const CHR *path, const CHR *why)
+{
+	fprintf(stderr, "meshfile: %s: %s\n", path, why);
+	hz_meshfile_close(m);
+	return false;
+}
+
+/* Bytes per component, 0 for anything we don't write */
+static U32 type_size(U32 gl_type)
+{
+	switch (gl_type) {
+	case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+	case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT: return 2;
+	case GL_FLOAT: return 4;
+	default: return 0;
+	}
+}
+
+U1 hz_meshfile_open(struct hzmeshfile *m, const CHR *path)
+{
+	memset(m, 0, sizeof(*m));
+	if (!hz_file_map(&m->file, path, HZ_FILE_SEQUENTIAL | HZ_FILE_WILLNEED_LARGE)) return false;
+
+	const U8 *data = m->file.data;
+	size_t size = m->file.size;
+	if (size < sizeof(struct hzmeshfileheader)) return fail(m, path, "Not a cooked mesh");
+	m->header = (const struct hzmeshfileheader *)data;
+	const struct hzmeshfileheader *h = m->header;
+	if (memcmp(h->magic, HZ_MESHFILE_MAGIC, 4)) return fail(m, path, "Not a cooked mesh");
+	if (h->version != HZ_MESHFILE_VERSION) return fail(m, path, "Unsupported version");
+	if (!h->vertex_count || !h->vertex_size || h->vertex_size > 256 || h->index_count % 3
+		|| (h->index_size != 2 && h->index_size != 4) || (h->index_size == 2 && h->vertex_count > 65536)) {
+		return fail(m, path, "Bad counts");
+	}
+	if (!h->attrib[HZ_MESH_POSITION].components) return fail(m, path, "No positions");
+	for (U32 i = 0; i < HZ_MESH_ATTRIBS; i++) {
+		const struct hzmeshfileattrib *a = &h->attrib[i];
+		if (!a->components) continue;
+		U32 bytes = type_size(a->gl_type) * a->components;
+		if (!bytes || a->components > 4 || a->offset > h->vertex_size || bytes > h->vertex_size - a->offset) {
+			return fail(m, path, "Bad vertex format");
+		}
+	}
+
+	U64 vertex_bytes = (U64)h->vertex_count * h->vertex_size, index_bytes = (U64)h->index_count * h->index_size;
+	if (h->vertex_offset % HZ_MESHFILE_ALIGN || h->vertex_offset > size || vertex_bytes > size - h->vertex_offset
+		|| h->index_offset % HZ_MESHFILE_ALIGN || h->index_offset > size || index_bytes > size - h->index_offset) {
+		return fail(m, path, "Truncated");
+	}
+	if (!h->lods || h->lods > HZ_MESHFILE_MAX_LODS) return fail(m, path, "Bad LODs");
+	for (U32 i = 0; i < h->lods; i++) {
+		const struct hzmeshfilelod *l = &h->lod[i];
+		if (!l->index_count || l->index_count % 3 || l->first_index > h->index_count
+			|| l->index_count > h->index_count - l->first_index || !(l->error >= (i ? l[-1].error : 0.0f))) {
+			return fail(m, path, "Bad LODs");
+		}
+	}
+	m->vertices = data + h->vertex_offset;
+	m->indices = data + h->index_offset;
+
+	/* One pass over the indices, the only thing GL would otherwise trust blindly. They're about to be read for the
+	 * upload anyway, so it costs page faults we'd take regardless.
+	 */
+	U32 worst = 0;
+	if (h->index_size == 2) {
+		const U16 *idx = (const U16 *)m->indices;
+		for (U32 i = 0; i < h->index_count; i++) worst = idx[i] > worst ? idx[i] : worst;
+	} else {
+		const U32 *idx = (const U32 *)m->indices;
+		for (U32 i = 0; i < h->index_count; i++) worst = idx[i] > worst ? idx[i] : worst;
+	}
+	if (h->index_count && worst >= h->vertex_count) return fail(m, path, "Index out of range");
+	return true;
+}
+
+X0 hz_meshfile_close(struct hzmeshfile *m)
+{
+	if (m->file.data) hz_file_unmap(&m->file);
+	memset(m, 0, sizeof(*m));
+}
+
+/* Zeroes up to the next HZ_MESHFILE_ALIGN boundary */
+static U1 pad(FILE *f, U64 *pos)
+{
+	static const U8 zero[HZ_MESHFILE_ALIGN];
+	U64 n = (HZ_MESHFILE_ALIGN - *pos % HZ_MESHFILE_ALIGN) % HZ_MESHFILE_ALIGN;
+	*pos += n;
+	return !n || fwrite(zero, n, 1, f) == 1;
+}
+
+U1 hz_meshfile_write(const CHR *path, const struct hzmeshfileheader *h, const X0 *vertices, const X0 *indices)
+{
+	struct hzmeshfileheader out = *h;
+	U64 vertex_bytes = (U64)h->vertex_count * h->vertex_size, index_bytes = (U64)h->index_count * h->index_size;
+	memcpy(out.magic, HZ_MESHFILE_MAGIC, 4);
+	out.version = HZ_MESHFILE_VERSION;
+	out.vertex_offset = (sizeof(out) + HZ_MESHFILE_ALIGN - 1) / HZ_MESHFILE_ALIGN * HZ_MESHFILE_ALIGN;
+	out.index_offset = (out.vertex_offset + vertex_bytes + HZ_MESHFILE_ALIGN - 1) / HZ_MESHFILE_ALIGN
+		* HZ_MESHFILE_ALIGN;
+
+	FILE *f = fopen(path, "wb");
+	if (!f) {
+		fprintf(stderr, "meshfile: unable to open %s for writing: %s\n", path, strerror(errno));
+		return false;
+	}
+	U64 pos = sizeof(out);
+	U1 ok = fwrite(&out, sizeof(out), 1, f) == 1 && pad(f, &pos)
+		&& (!vertex_bytes || fwrite(vertices, vertex_bytes, 1, f) == 1);
+	pos += vertex_bytes;
+	ok = ok && pad(f, &pos) && (!index_bytes || fwrite(indices, index_bytes, 1, f) == 1);
+
+	if (fclose(f) != 0) ok = false;
+	if (!ok) fprintf(stderr, "meshfile: unable to write %s: %s\n", path, strerror(errno));
+	return ok;
+}
+
+X0 hz_meshfile_dequantize(const struct hzmeshfileheader *h, R32 m[16])
+{
+	memset(m, 0, 16 * sizeof(R32));
+	for (INAT i = 0; i < 3; i++) {
+		m[i * 5] = h->scale[i];
+		m[12 + i] = h->offset[i];
+	}
+	m[15] = 1.0f;
+}
+
+U1 hz_meshfile_load(struct hzmeshgpu *g, const CHR *path)
+{
+	memset(g, 0, sizeof(*g));
+	struct hzmeshfile m;
+	if (!hz_meshfile_open(&m, path)) return false;
+	const struct hzmeshfileheader *h = m.header;
+
+	hz_gpumem_upload_begin();
+
+	glGenVertexArrays(1, &g->vao);
+	glGenBuffers(1, &g->vbo);
+	glGenBuffers(1, &g->ebo);
+	glBindVertexArray(g->vao);
+
+	/* Straight out of the mapping. GL has its own copy once these return, so it can go right after. */
+	size_t vertex_bytes = (size_t)h->vertex_count * h->vertex_size, index_bytes = (size_t)h->index_count * h->index_size;
+	glBindBuffer(GL_ARRAY_BUFFER, g->vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertex_bytes, m.vertices, GL_STATIC_DRAW);
+	hz_gpumem_buffer(g->vbo, vertex_bytes, "mesh");
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g->ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_bytes, m.indices, GL_STATIC_DRAW);
+	hz_gpumem_buffer(g->ebo, index_bytes, "mesh");
+
+	for (U32 i = 0; i < HZ_MESH_ATTRIBS; i++) {
+		const struct hzmeshfileattrib *a = &h->attrib[i];
+		if (!a->components) continue;
+		glVertexAttribPointer(i, a->components, a->gl_type, a->normalized ? GL_TRUE : GL_FALSE, h->vertex_size,
+			(X0*)(size_t)a->offset);
+		glEnableVertexAttribArray(i);
+	}
+
+	g->index_count = h->index_count;
+	g->index_type = h->index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	g->index_size = h->index_size;
+	g->lods = h->lods;
+	memcpy(g->lod, h->lod, sizeof(g->lod));
+	memcpy(g->min, h->min, sizeof(g->min));
+	memcpy(g->max, h->max, sizeof(g->max));
+	memcpy(g->center, h->center, sizeof(g->center));
+	g->radius = h->radius;
+	hz_meshfile_dequantize(h, g->dequantize);
+	hz_meshfile_close(&m);
+
+	UNAT err = hz_gpumem_upload_end();
+	if (err != GL_NO_ERROR) {
+		fprintf(stderr, "meshfile: unable to upload %s: GL error 0x%x\n", path, err);
+		hz_meshfile_unload(g);
+		return false;
+	}
+	return true;
+}
+
+X0 hz_meshfile_unload(struct hzmeshgpu *g)
+{
+	UNAT buffers[] = { g->vbo, g->ebo };
+	for (U32 i = 0; i < sizeof(buffers) / sizeof(buffers[0]); i++) {
+		if (!buffers[i]) continue;
+		glDeleteBuffers(1, &buffers[i]);
+		hz_gpumem_free(HZ_GPUMEM_BUFFER, buffers[i]);
+	}
+	if (g->vao) glDeleteVertexArrays(1, &g->vao);
+	memset(g, 0, sizeof(*g));
+}
@@ -0,0 +1,107 @@
+#ifndef HZ_MESHFILE_H
+#define HZ_MESHFILE_H
+
+#include "holyh/src/holy.h"
+#include "hz_file.h"
+
+/* Cooked meshes (tools/hz_meshcook.c makes them out of OBJ and glTF files): one indexed triangle list, already
+ * quantised, welded and put in vertex cache order, in exactly the layout GL draws it from.
+ *
+ *   header | vertices | indices (LOD 0, LOD 1, ...)
+ *
+ * A mesh comes with up to HZ_MESHFILE_MAX_LODS levels of detail, simplified versions of itself that use fewer of the
+ * same vertices, so they're only more indices (see hz_meshopt_simplify()). Each has the error simplifying it made, in
+ * model units, for hz_lod_select() to pick one by. The first is the full mesh, with an error of 0.
+ *
+ * The header says what's in a vertex (which attributes, their GL types and offsets), the mesh's bounds, and how to
+ * get from the quantised positions back to model space. The vertices and indices each start on an
+ * HZ_MESHFILE_ALIGN boundary, so loading one is an mmap() and two glBufferData() calls straight out of the mapping,
+ * with no parsing and no copies. Everything is little endian, and checked when the file is opened.
+ *
+ * Attributes go to fixed locations, their enum values, whatever mesh they come from:
+ *
+ *   layout (location = 0) in vec3 aPos;
+ *   layout (location = 1) in vec2 aTexCoord;
+ *   layout (location = 2) in vec3 aNormal;
+ *
+ * Quantised positions are signed normalised shorts spanning the bounding box, so a vertex shader sees them in -1..1
+ * and the dequantisation matrix (hzmeshgpu.dequantize) has to be multiplied into the model matrix.
+ */
+
+#define HZ_MESHFILE_MAGIC "HZMS"
+#define HZ_MESHFILE_VERSION 2
+#define HZ_MESHFILE_ALIGN 64
+#define HZ_MESHFILE_MAX_LODS 4
+
+enum hzmeshattrib {
+	HZ_MESH_POSITION,
+	HZ_MESH_TEXCOORD,
+	HZ_MESH_NORMAL,
+	HZ_MESH_ATTRIBS
+};
+
+struct hzmeshfileattrib {
+	U32 gl_type; /* GL_FLOAT, GL_SHORT, ... */
+	U32 components; /* 0 if the mesh doesn't have it */
+	U32 normalized;
+	U32 offset; /* Into a vertex */
+};
+
+struct hzmeshfilelod {
+	U32 first_index;
+	U32 index_count;
+	R32 error; /* Model units, never less than the LOD before's */
+};
+
+struct hzmeshfileheader {
+	CHR magic[4];
+	U32 version;
+	U32 vertex_count;
+	U32 index_count; /* All the LODs' */
+	U32 vertex_size;
+	U32 index_size; /* 2 or 4 */
+	struct hzmeshfileattrib attrib[HZ_MESH_ATTRIBS];
+	R32 min[3], max[3]; /* Model space bounds */
+	R32 center[3], radius; /* A bounding sphere, tighter than the box's */
+	R32 scale[3], offset[3]; /* Model space position = stored position * scale + offset */
+	U64 vertex_offset; /* From the start of the file */
+	U64 index_offset;
+	U32 lods; /* At least 1 */
+	struct hzmeshfilelod lod[HZ_MESHFILE_MAX_LODS];
+};
+
+struct hzmeshfile {
+	struct hzfile file;
+	const struct hzmeshfileheader *header;
+	const U8 *vertices;
+	const U8 *indices;
+};
+
+/* A cooked mesh, in GL */
+struct hzmeshgpu {
+	UNAT vao, vbo, ebo;
+	U32 index_count; /* All the LODs' */
+	U32 index_type; /* GL_UNSIGNED_SHORT or GL_UNSIGNED_INT */
+	U32 index_size;
+	U32 lods;
+	struct hzmeshfilelod lod[HZ_MESHFILE_MAX_LODS]; /* Draw one with its count, at first_index * index_size */
+	R32 min[3], max[3];
+	R32 center[3], radius;
+	R32 dequantize[16]; /* Column major, model matrix * dequantize takes the stored positions to world space */
+};
+
+/* Maps `path` and checks it. Returns false (with a message on stderr) if it's missing or broken. */
+U1 hz_meshfile_open(struct hzmeshfile *m, const CHR *path);
+X0 hz_meshfile_close(struct hzmeshfile *m);
+/* Writes a mesh out. `h` describes the data, its magic, version and offsets are filled in here. */
+U1 hz_meshfile_write(const CHR *path, const struct hzmeshfileheader *h, const X0 *vertices, const X0 *indices);
+/* The column major matrix that takes stored positions to model space. */
+X0 hz_meshfile_dequantize(const struct hzmeshfileheader *h, R32 m[16]);
+
+/* Opens `path` and uploads it: a VAO with the vertex and index buffers and every attribute the mesh has set up. Leaves
+ * the VAO bound. Returns false (with a message on stderr) if that didn't work out.
+ */
+U1 hz_meshfile_load(struct hzmeshgpu *g, const CHR *path);
+X0 hz_meshfile_unload(struct hzmeshgpu *g);
+
+#endif
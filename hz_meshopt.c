@@ -0,0 +1,523 @@
+#include "hz_meshopt.h"
+#include <math.h>
+
+static U64 hash(const U8 *p, U32 size)
+{
+	U64 h = 0xcbf29ce484222325ull;
+	for (U32 i = 0; i < size; i++) h = (h ^ p[i]) * 0x100000001b3ull;
+	return h;
+}
+
+U32 hz_meshopt_weld(U32 *remap, const X0 *vertices, U32 vertex_count, U32 vertex_size)
+{
+	/* Open addressing, at most half full. Slots hold the first vertex seen with some contents. */
+	U32 size = 16;
+	while (size < vertex_count * 2 && size < 1u << 31) size *= 2;
+	U32 *slot = malloc((size_t)size * sizeof(U32));
+	if (!slot) return 0;
+	memset(slot, 0xff, (size_t)size * sizeof(U32));
+
+	const U8 *v = vertices;
+	U32 distinct = 0;
+	for (U32 i = 0; i < vertex_count; i++) {
+		const U8 *vi = v + (size_t)i * vertex_size;
+		for (U32 s = hash(vi, vertex_size) & (size - 1);; s = (s + 1) & (size - 1)) {
+			if (slot[s] == UINT32_MAX) {
+				slot[s] = i;
+				remap[i] = distinct++;
+				break;
+			}
+			if (!memcmp(v + (size_t)slot[s] * vertex_size, vi, vertex_size)) {
+				remap[i] = remap[slot[s]];
+				break;
+			}
+		}
+	}
+	free(slot);
+	return distinct;
+}
+
+X0 hz_meshopt_remap_vertices(X0 *dst, const X0 *src, U32 vertex_count, U32 vertex_size, const U32 *remap)
+{
+	for (U32 i = 0; i < vertex_count; i++) {
+		memcpy((U8*)dst + (size_t)remap[i] * vertex_size, (const U8*)src + (size_t)i * vertex_size, vertex_size);
+	}
+}
+
+X0 hz_meshopt_remap_indices(U32 *indices, U32 index_count, const U32 *remap)
+{
+	for (U32 i = 0; i < index_count; i++) indices[i] = remap[indices[i]];
+}
+
+/* Forsyth's scoring: the last triangle's vertices score a flat 0.75 (so strips don't just double back on themselves),
+ * the rest of the cache less the older they are, and vertices with few triangles left get a boost so they're
+ * finished off rather than left stranded.
+ */
+static R32 vertex_score(INAT cache_pos, U32 remaining)
+{
+	if (!remaining) return -1.0f;
+	R32 score = 0.0f;
+	if (cache_pos >= 0) {
+		if (cache_pos < 3) score = 0.75f;
+		else score = powf(1.0f - (cache_pos - 3) * (1.0f / (HZ_MESHOPT_CACHE_SIZE - 3)), 1.5f);
+	}
+	return score + 2.0f / sqrtf((R32)remaining);
+}
+
+U1 hz_meshopt_vertex_cache(U32 *dst, const U32 *indices, U32 index_count, U32 vertex_count)
+{
+	U32 triangles = index_count / 3;
+	U32 *adj_offset = calloc((size_t)vertex_count + 1, sizeof(U32));
+	U32 *remaining = calloc(vertex_count ? vertex_count : 1, sizeof(U32));
+	U32 *adj = malloc((size_t)(triangles ? triangles : 1) * 3 * sizeof(U32));
+	INAT *cache_pos = malloc((size_t)(vertex_count ? vertex_count : 1) * sizeof(INAT));
+	R32 *vscore = malloc((size_t)(vertex_count ? vertex_count : 1) * sizeof(R32));
+	R32 *tscore = malloc((size_t)(triangles ? triangles : 1) * sizeof(R32));
+	U8 *emitted = calloc(triangles ? triangles : 1, 1);
+	U1 ok = adj_offset && remaining && adj && cache_pos && vscore && tscore && emitted;
+	for (U32 i = 0; ok && i < triangles * 3; i++) ok = indices[i] < vertex_count;
+	if (!ok) {
+		memmove(dst, indices, (size_t)index_count * sizeof(U32));
+		goto done;
+	}
+
+	/* Every vertex's triangles, the live ones kept at the front of its run */
+	for (U32 i = 0; i < triangles * 3; i++) remaining[indices[i]]++;
+	for (U32 v = 0; v < vertex_count; v++) adj_offset[v + 1] = adj_offset[v] + remaining[v];
+	memset(remaining, 0, vertex_count * sizeof(U32));
+	for (U32 i = 0; i < triangles * 3; i++) adj[adj_offset[indices[i]] + remaining[indices[i]]++] = i / 3;
+
+	for (U32 v = 0; v < vertex_count; v++) {
+		cache_pos[v] = -1;
+		vscore[v] = vertex_score(-1, remaining[v]);
+	}
+	INAT best = -1;
+	R32 best_score = -1.0f;
+	for (U32 t = 0; t < triangles; t++) {
+		tscore[t] = vscore[indices[t * 3]] + vscore[indices[t * 3 + 1]] + vscore[indices[t * 3 + 2]];
+		if (tscore[t] > best_score) best_score = tscore[t], best = t;
+	}
+
+	/* Three more than the cache holds, so the vertices that just fell out get their scores updated too */
+	U32 cache[HZ_MESHOPT_CACHE_SIZE + 3], cached = 0, next = 0;
+	for (U32 out = 0; out < triangles; out++) {
+		/* Nothing in the cache has triangles left: start over from the first one that hasn't gone out */
+		if (best < 0) {
+			while (emitted[next]) next++;
+			best = next;
+		}
+		const U32 *tri = &indices[best * 3];
+		memcpy(&dst[out * 3], tri, 3 * sizeof(U32));
+		emitted[best] = 1;
+
+		U32 fresh[HZ_MESHOPT_CACHE_SIZE + 3], count = 0;
+		for (U32 k = 0; k < 3; k++) {
+			U32 v = tri[k], *a = &adj[adj_offset[v]];
+			for (U32 j = 0; j < remaining[v]; j++) {
+				if (a[j] != (U32)best) continue;
+				a[j] = a[--remaining[v]];
+				break;
+			}
+			U1 seen = false;
+			for (U32 j = 0; j < count; j++) seen |= fresh[j] == v;
+			if (!seen) fresh[count++] = v;
+		}
+		for (U32 j = 0; j < cached && count < HZ_MESHOPT_CACHE_SIZE + 3; j++) {
+			if (cache[j] != tri[0] && cache[j] != tri[1] && cache[j] != tri[2]) fresh[count++] = cache[j];
+		}
+
+		for (U32 j = 0; j < count; j++) {
+			U32 v = fresh[j];
+			cache_pos[v] = j < HZ_MESHOPT_CACHE_SIZE ? (INAT)j : -1;
+			vscore[v] = vertex_score(cache_pos[v], remaining[v]);
+		}
+		best = -1;
+		best_score = -1.0f;
+		for (U32 j = 0; j < count; j++) {
+			U32 v = fresh[j];
+			for (U32 a = adj_offset[v]; a < adj_offset[v] + remaining[v]; a++) {
+				U32 t = adj[a];
+				tscore[t] = vscore[indices[t * 3]] + vscore[indices[t * 3 + 1]] + vscore[indices[t * 3 + 2]];
+				if (tscore[t] > best_score) best_score = tscore[t], best = t;
+			}
+		}
+		cached = count < HZ_MESHOPT_CACHE_SIZE ? count : HZ_MESHOPT_CACHE_SIZE;
+		memcpy(cache, fresh, cached * sizeof(U32));
+	}
+	/* A trailing partial triangle, if somebody handed us one */
+	memmove(&dst[triangles * 3], &indices[triangles * 3], (index_count - triangles * 3) * sizeof(U32));
+
+done:
+	free(adj_offset);
+	free(remaining);
+	free(adj);
+	free(cache_pos);
+	free(vscore);
+	free(tscore);
+	free(emitted);
+	return ok;
+}
+
+U32 hz_meshopt_vertex_fetch(X0 *dst, U32 *indices, U32 index_count, const X0 *vertices, U32 vertex_count,
+	U32 vertex_size)
+{
+	U32 *remap = malloc((size_t)(vertex_count ? vertex_count : 1) * sizeof(U32));
+	if (!remap) return 0;
+	memset(remap, 0xff, (size_t)vertex_count * sizeof(U32));
+
+	U32 used = 0;
+	for (U32 i = 0; i < index_count; i++) {
+		U32 v = indices[i];
+		if (remap[v] == UINT32_MAX) {
+			memcpy((U8*)dst + (size_t)used * vertex_size, (const U8*)vertices + (size_t)v * vertex_size, vertex_size);
+			remap[v] = used++;
+		}
+		indices[i] = remap[v];
+	}
+	free(remap);
+	return used;
+}
+
+R32 hz_meshopt_acmr(const U32 *indices, U32 index_count, U32 vertex_count, U32 cache_size)
+{
+	if (index_count < 3) return 0.0f;
+	/* A vertex is in a FIFO cache as long as fewer than cache_size misses came after its own */
+	U32 *stamp = calloc(vertex_count ? vertex_count : 1, sizeof(U32));
+	if (!stamp) return 0.0f;
+	U32 now = cache_size + 1, misses = 0;
+	for (U32 i = 0; i < index_count; i++) {
+		U32 v = indices[i];
+		if (v < vertex_count && now - stamp[v] > cache_size) {
+			stamp[v] = now++;
+			misses++;
+		}
+	}
+	free(stamp);
+	return (R32)misses / (index_count / 3);
+}
+
+/* A sum of weighted planes: the upper half of the symmetric 4x4 matrix Q, with x'Qx the weighted sum of squared
+ * distances from x to them. Doubles, since the terms cancel a lot.
+ */
+struct quadric {
+	R64 a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+	R64 weight;
+};
+
+static X0 quadric_plane(struct quadric *q, R64 a, R64 b, R64 c, R64 d, R64 w)
+{
+	q->a2 += w * a * a, q->ab += w * a * b, q->ac += w * a * c, q->ad += w * a * d;
+	q->b2 += w * b * b, q->bc += w * b * c, q->bd += w * b * d;
+	q->c2 += w * c * c, q->cd += w * c * d;
+	q->d2 += w * d * d;
+	q->weight += w;
+}
+
+static X0 quadric_add(struct quadric *q, const struct quadric *r)
+{
+	R64 *a = &q->a2;
+	const R64 *b = &r->a2;
+	for (U32 i = 0; i < sizeof(*q) / sizeof(R64); i++) a[i] += b[i];
+}
+
+/* Mean squared distance from `p` to the planes */
+static R64 quadric_error(const struct quadric *q, const R32 *p)
+{
+	if (q->weight <= 0.0) return 0.0;
+	R64 x = p[0], y = p[1], z = p[2];
+	R64 e = q->a2 * x * x + q->b2 * y * y + q->c2 * z * z + q->d2
+		+ 2.0 * (q->ab * x * y + q->ac * x * z + q->bc * y * z + q->ad * x + q->bd * y + q->cd * z);
+	return e > 0.0 ? e / q->weight : 0.0;
+}
+
+static X0 cross(R32 *out, const R32 *a, const R32 *b, const R32 *c)
+{
+	R32 u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	out[0] = u[1] * v[2] - u[2] * v[1];
+	out[1] = u[2] * v[0] - u[0] * v[2];
+	out[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+#define LOCKED 1 /* flags: on an attribute seam, or otherwise not to be moved */
+#define BORDER 2 /* flags: on an open edge */
+#define BORDER_WEIGHT 10.0 /* How much more the planes keeping borders in place count than the surface's own */
+
+/* A set of directed edges, open addressing, at most half full */
+struct edgeset {
+	U64 *slot;
+	U32 size;
+};
+
+static U64 edge_key(U32 a, U32 b)
+{
+	return (U64)a << 32 | b;
+}
+
+static U32 edge_hash(U64 key, U32 size)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdull;
+	key ^= key >> 33;
+	return (U32)key & (size - 1);
+}
+
+static X0 edge_insert(struct edgeset *s, U32 a, U32 b)
+{
+	U64 key = edge_key(a, b);
+	for (U32 i = edge_hash(key, s->size);; i = (i + 1) & (s->size - 1)) {
+		if (s->slot[i] == key) return;
+		if (s->slot[i] == UINT64_MAX) {
+			s->slot[i] = key;
+			return;
+		}
+	}
+}
+
+static U1 edge_find(const struct edgeset *s, U32 a, U32 b)
+{
+	U64 key = edge_key(a, b);
+	for (U32 i = edge_hash(key, s->size);; i = (i + 1) & (s->size - 1)) {
+		if (s->slot[i] == key) return true;
+		if (s->slot[i] == UINT64_MAX) return false;
+	}
+}
+
+/* Fills the set with the triangles' edges and flags the vertices on open ones */
+static X0 edge_build(struct edgeset *s, const U32 *indices, U32 triangles, U8 *flags)
+{
+	s->size = 16;
+	while (s->size < triangles * 6 && s->size < 1u << 31) s->size *= 2;
+	memset(s->slot, 0xff, (size_t)s->size * sizeof(U64));
+	for (U32 i = 0; i < triangles * 3; i++) edge_insert(s, indices[i], indices[i - i % 3 + (i + 1) % 3]);
+	for (U32 i = 0; i < triangles * 3; i++) {
+		U32 a = indices[i], b = indices[i - i % 3 + (i + 1) % 3];
+		if (!edge_find(s, b, a)) flags[a] |= BORDER, flags[b] |= BORDER;
+	}
+}
+
+struct collapse {
+	U32 from, to;
+	R32 cost;
+};
+
+static INAT collapse_cmp(const X0 *a, const X0 *b)
+{
+	R32 x = ((const struct collapse*)a)->cost, y = ((const struct collapse*)b)->cost;
+	return (x > y) - (x < y);
+}
+
+/* Whether moving `from` onto `to` keeps the triangles around it the way up they were, and the mesh manifold:
+ * the two may only have the vertices of the triangles they share (the ones that go) as neighbours in common.
+ */
+static U1 collapse_ok(const U32 *indices, const U32 *adj, const U32 *adj_offset, const R32 *pos, U32 stride,
+	U32 from, U32 to, U32 *stamp, U32 mark)
+{
+#define P(v) ((const R32*)((const U8*)pos + (size_t)(v) * stride))
+	U32 shared = 0, common = 0;
+	for (U32 a = adj_offset[from]; a < adj_offset[from + 1]; a++) {
+		const U32 *t = &indices[adj[a] * 3];
+		if (t[0] == t[1] || t[1] == t[2] || t[2] == t[0]) continue;
+		for (U32 k = 0; k < 3; k++) stamp[t[k]] = mark;
+		if (t[0] == to || t[1] == to || t[2] == to) {
+			shared++;
+			continue;
+		}
+		R32 before[3], after[3], moved[3][3];
+		for (U32 k = 0; k < 3; k++) memcpy(moved[k], P(t[k] == from ? to : t[k]), sizeof(moved[k]));
+		cross(before, P(t[0]), P(t[1]), P(t[2]));
+		cross(after, moved[0], moved[1], moved[2]);
+		R32 dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+		R32 len = sqrtf((before[0] * before[0] + before[1] * before[1] + before[2] * before[2])
+			* (after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+		/* Flipped, or near enough to it to make a sliver */
+		if (!(len > 0.0f) || dot < 0.25f * len) return false;
+	}
+	for (U32 a = adj_offset[to]; a < adj_offset[to + 1]; a++) {
+		const U32 *t = &indices[adj[a] * 3];
+		if (t[0] == t[1] || t[1] == t[2] || t[2] == t[0]) continue;
+		for (U32 k = 0; k < 3; k++) {
+			if (t[k] != from && t[k] != to && stamp[t[k]] == mark) {
+				stamp[t[k]] = mark + 1;
+				common++;
+			}
+		}
+	}
+	return shared && common == shared;
+#undef P
+}
+
+U32 hz_meshopt_simplify(U32 *dst, const U32 *indices, U32 index_count, const R32 *positions, U32 vertex_count,
+	U32 stride, U32 target_index_count, R32 *error)
+{
+	*error = 0.0f;
+	/* Without vertices there can't be any (valid) triangles either */
+	if (!vertex_count) return 0;
+	U32 triangles = index_count / 3, tc = triangles ? triangles : 1;
+	memmove(dst, indices, (size_t)triangles * 3 * sizeof(U32));
+	for (U32 i = 0; i < triangles * 3; i++) {
+		if (indices[i] >= vertex_count) return 0;
+	}
+
+	struct quadric *q = calloc(vertex_count, sizeof(*q));
+	U8 *flags = calloc(vertex_count, 1);
+	U32 *remap = malloc((size_t)vertex_count * sizeof(U32));
+	U32 *group = calloc(vertex_count, sizeof(U32));
+	R32 *packed = malloc((size_t)vertex_count * 3 * sizeof(R32));
+	U32 *adj_offset = malloc(((size_t)vertex_count + 1) * sizeof(U32));
+	U32 *adj = malloc((size_t)tc * 3 * sizeof(U32));
+	U32 *stamp = calloc(vertex_count, sizeof(U32));
+	U8 *touched = malloc(vertex_count);
+	struct collapse *cand = malloc((size_t)tc * 6 * sizeof(*cand));
+	struct edgeset edges = { NULL, 16 };
+	while (edges.size < tc * 6 && edges.size < 1u << 31) edges.size *= 2;
+	edges.slot = malloc((size_t)edges.size * sizeof(U64));
+	U32 live = 0;
+	if (!q || !flags || !remap || !group || !packed || !adj_offset || !adj || !stamp || !touched || !cand
+		|| !edges.slot) {
+		goto done;
+	}
+
+#define P(v) ((const R32*)((const U8*)positions + (size_t)(v) * stride))
+	/* Vertices sharing a position with another are on a seam, moving one would open it up */
+	for (U32 v = 0; v < vertex_count; v++) memcpy(&packed[v * 3], P(v), 3 * sizeof(R32));
+	if (!hz_meshopt_weld(remap, packed, vertex_count, 3 * sizeof(R32))) goto done;
+	for (U32 v = 0; v < vertex_count; v++) group[remap[v]]++;
+	for (U32 v = 0; v < vertex_count; v++) {
+		if (group[remap[v]] > 1) flags[v] |= LOCKED;
+	}
+
+	/* Each vertex starts out with the planes of its triangles, weighted by area so slivers don't count for much */
+	for (U32 t = 0; t < triangles; t++) {
+		const U32 *tri = &dst[t * 3];
+		R32 n[3];
+		cross(n, P(tri[0]), P(tri[1]), P(tri[2]));
+		R64 len = sqrt((R64)n[0] * n[0] + (R64)n[1] * n[1] + (R64)n[2] * n[2]);
+		if (len <= 0.0) continue;
+		const R32 *p = P(tri[0]);
+		R64 a = n[0] / len, b = n[1] / len, c = n[2] / len, d = -(a * p[0] + b * p[1] + c * p[2]);
+		for (U32 k = 0; k < 3; k++) quadric_plane(&q[tri[k]], a, b, c, d, len * 0.5);
+	}
+	/* Open edges also get a plane through them at right angles to their triangle, which keeps the outline in place */
+	edge_build(&edges, dst, triangles, flags);
+	for (U32 i = 0; i < triangles * 3; i++) {
+		U32 a = dst[i], b = dst[i - i % 3 + (i + 1) % 3], c = dst[i - i % 3 + (i + 2) % 3];
+		if (edge_find(&edges, b, a)) continue;
+		R32 n[3], e[3] = { P(b)[0] - P(a)[0], P(b)[1] - P(a)[1], P(b)[2] - P(a)[2] }, m[3];
+		cross(n, P(a), P(b), P(c));
+		m[0] = e[1] * n[2] - e[2] * n[1];
+		m[1] = e[2] * n[0] - e[0] * n[2];
+		m[2] = e[0] * n[1] - e[1] * n[0];
+		R64 len = sqrt((R64)m[0] * m[0] + (R64)m[1] * m[1] + (R64)m[2] * m[2]);
+		if (len <= 0.0) continue;
+		R64 x = m[0] / len, y = m[1] / len, z = m[2] / len, d = -(x * P(a)[0] + y * P(a)[1] + z * P(a)[2]);
+		R64 w = ((R64)e[0] * e[0] + (R64)e[1] * e[1] + (R64)e[2] * e[2]) * BORDER_WEIGHT;
+		quadric_plane(&q[a], x, y, z, d, w);
+		quadric_plane(&q[b], x, y, z, d, w);
+	}
+
+	/* Passes of: every edge that may collapse, cheapest first, each vertex touched at most once, so the costs and
+	 * checks of the ones that go ahead are still right. Then the triangles that collapsed go, and round again.
+	 */
+	live = triangles;
+	R64 worst = 0.0;
+	U32 mark = 0;
+	while (live * 3 > target_index_count) {
+		memset(adj_offset, 0, ((size_t)vertex_count + 1) * sizeof(U32));
+		for (U32 i = 0; i < live * 3; i++) adj_offset[dst[i] + 1]++;
+		for (U32 v = 0; v < vertex_count; v++) adj_offset[v + 1] += adj_offset[v];
+		for (U32 i = 0; i < live * 3; i++) adj[adj_offset[dst[i]]++] = i / 3;
+		for (U32 v = vertex_count; v > 0; v--) adj_offset[v] = adj_offset[v - 1];
+		adj_offset[0] = 0;
+		for (U32 v = 0; v < vertex_count; v++) flags[v] &= ~BORDER;
+		edge_build(&edges, dst, live, flags);
+
+		U32 count = 0;
+		for (U32 i = 0; i < live * 3; i++) {
+			U32 a = dst[i], b = dst[i - i % 3 + (i + 1) % 3];
+			U1 open = !edge_find(&edges, b, a);
+			if (!open && a > b) continue;
+			for (U32 k = 0; k < 2; k++) {
+				U32 from = k ? b : a, to = k ? a : b;
+				/* Borders only slide along themselves */
+				if (flags[from] & LOCKED || (flags[from] & BORDER && !open)) continue;
+				struct quadric sum = q[from];
+				quadric_add(&sum, &q[to]);
+				cand[count++] = (struct collapse){ from, to, (R32)quadric_error(&sum, P(to)) };
+			}
+		}
+		qsort(cand, count, sizeof(*cand), collapse_cmp);
+
+		U32 before = live, collapsed = 0;
+		memset(touched, 0, vertex_count);
+		for (U32 c = 0; c < count && live * 3 > target_index_count; c++) {
+			U32 from = cand[c].from, to = cand[c].to;
+			if (touched[from] || touched[to]) continue;
+			mark += 2;
+			if (!collapse_ok(dst, adj, adj_offset, positions, stride, from, to, stamp, mark)) continue;
+			for (U32 a = adj_offset[from]; a < adj_offset[from + 1]; a++) {
+				U32 *t = &dst[adj[a] * 3];
+				if (t[0] == t[1] || t[1] == t[2] || t[2] == t[0]) continue;
+				if (t[0] == to || t[1] == to || t[2] == to) live--;
+				for (U32 k = 0; k < 3; k++) {
+					if (t[k] == from) t[k] = to;
+				}
+			}
+			quadric_add(&q[to], &q[from]);
+			if (cand[c].cost > worst) worst = cand[c].cost;
+			collapsed++;
+			touched[from] = touched[to] = 1;
+		}
+		if (!collapsed) break;
+
+		U32 kept = 0;
+		for (U32 t = 0; t < before; t++) {
+			const U32 *tri = &dst[t * 3];
+			if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0]) continue;
+			memmove(&dst[kept * 3], tri, 3 * sizeof(U32));
+			kept++;
+		}
+		live = kept;
+	}
+	*error = (R32)sqrt(worst);
+#undef P
+
+done:
+	free(q);
+	free(flags);
+	free(remap);
+	free(group);
+	free(packed);
+	free(adj_offset);
+	free(adj);
+	free(stamp);
+	free(touched);
+	free(cand);
+	free(edges.slot);
+	return live * 3;
+}
+
+U32 hz_meshopt_lods(U32 *dst, struct hzmeshlod *lods, U32 max_lods, const U32 *indices, U32 index_count,
+	const R32 *positions, U32 vertex_count, U32 stride)
+{
+	if (!max_lods) return 0;
+	index_count -= index_count % 3;
+	memmove(dst, indices, (size_t)index_count * sizeof(U32));
+	lods[0] = (struct hzmeshlod){ 0, index_count, 0.0f };
+
+	U32 n = 1, next = index_count;
+	while (n < max_lods) {
+		const struct hzmeshlod *prev = &lods[n - 1];
+		U32 target = prev->index_count / 6 * 3;
+		if (!target) break;
+		R32 err;
+		/* From the full mesh every time, so the error is against that rather than piling up */
+		U32 count = hz_meshopt_simplify(dst + next, indices, index_count, positions, vertex_count, stride, target,
+			&err);
+		/* Out of memory, or it's run out of edges it may collapse */
+		if (!count || (U64)count * 10 > (U64)prev->index_count * 9) break;
+		lods[n] = (struct hzmeshlod){ next, count, err > prev->error ? err : prev->error };
+		next += count;
+		n++;
+	}
+	return n;
+}
@@ -0,0 +1,74 @@
+#ifndef HZ_MESHOPT_H
+#define HZ_MESHOPT_H
+
+#include "holyh/src/holy.h"
+
+/* Index and vertex buffer optimisation, for tools/hz_meshcook.c. Vertices are opaque blobs of vertex_size bytes to
+ * all of this (two vertices are the same vertex if their bytes are), and meshes are indexed triangle lists.
+ *
+ * The usual order is: weld, so every vertex is stored once; build the LODs, if any; reorder the triangles (of each
+ * LOD) for the post-transform vertex cache; then reorder the vertices into the order the triangles first use them, so
+ * fetching them walks through memory front to back.
+ *
+ * None of it touches GL, so meshes made up at run time can go through it too.
+ */
+
+#define HZ_MESHOPT_CACHE_SIZE 32 /* Vertices the cache optimisation assumes the GPU keeps around */
+
+/* Finds the distinct vertices. remap[i] is where vertex i goes, distinct vertices numbered in order of first
+ * appearance. Returns how many there are, or 0 if we're out of memory.
+ */
+U32 hz_meshopt_weld(U32 *remap, const X0 *vertices, U32 vertex_count, U32 vertex_size);
+/* Moves vertex i of `src` to remap[i] of `dst`, which doesn't overlap it. */
+X0 hz_meshopt_remap_vertices(X0 *dst, const X0 *src, U32 vertex_count, U32 vertex_size, const U32 *remap);
+/* Replaces every index with remap[index], in place. */
+X0 hz_meshopt_remap_indices(U32 *indices, U32 index_count, const U32 *remap);
+
+/* Reorders the triangles for a post-transform vertex cache of about HZ_MESHOPT_CACHE_SIZE (Tom Forsyth's linear-speed
+ * vertex cache optimisation), from `indices` into `dst`, which may not be the same buffer. Returns false if we're out
+ * of memory, in which case `dst` gets the triangles in their original order.
+ */
+U1 hz_meshopt_vertex_cache(U32 *dst, const U32 *indices, U32 index_count, U32 vertex_count);
+/* Renumbers the vertices in the order the indices first use them, rewriting `indices` in place and writing the
+ * vertices out to `dst`. Vertices nothing uses are dropped. Returns how many vertices are left, or 0 if we're out of
+ * memory.
+ */
+U32 hz_meshopt_vertex_fetch(X0 *dst, U32 *indices, U32 index_count, const X0 *vertices, U32 vertex_count,
+	U32 vertex_size);
+
+/* Simplifies a mesh down to about `target_index_count` indices by collapsing edges, cheapest first, with the cost of
+ * a collapse measured by quadric error metrics (Garland and Heckbert): every vertex carries the planes of the
+ * triangles around it, and moving it costs its squared distance to them. Collapses only ever move a vertex onto one of
+ * its neighbours, so the result indexes a subset of the same vertices and can share their buffer.
+ *
+ * Open borders only collapse along themselves, and vertices on attribute seams (two vertices in the same place, with
+ * different normals or texture coordinates, say) stay where they are, so nothing tears open. Collapses that would flip
+ * a triangle over are skipped. That can leave the result well short of the target on meshes that are mostly seams.
+ *
+ * `positions` is three floats every `stride` bytes. Writes the triangles to `dst` (which may be `indices`) and
+ * returns how many indices that is, and puts the error in `*error`: the RMS distance, in model units, from the moved
+ * vertices to the planes of the triangles they started out on. Returns 0 if we're out of memory.
+ */
+U32 hz_meshopt_simplify(U32 *dst, const U32 *indices, U32 index_count, const R32 *positions, U32 vertex_count,
+	U32 stride, U32 target_index_count, R32 *error);
+
+struct hzmeshlod {
+	U32 first_index;
+	U32 index_count;
+	R32 error; /* From hz_meshopt_simplify(), never less than the LOD before's */
+};
+
+/* A LOD chain: the mesh itself, then each level simplified (from the full mesh) to about half the triangles of the one
+ * before, until there are `max_lods` or simplifying stops getting anywhere. The levels go into `dst` back to back, so
+ * it needs room for `max_lods` times `index_count`. Returns the number of levels, which is at least 1 (the mesh as it
+ * is) for a `max_lods` of 1 or more.
+ */
+U32 hz_meshopt_lods(U32 *dst, struct hzmeshlod *lods, U32 max_lods, const U32 *indices, U32 index_count,
+	const R32 *positions, U32 vertex_count, U32 stride);
+
+/* Average cache miss ratio, vertices transformed per triangle, with a FIFO cache of `cache_size`. 0.5 is about as
+ * good as a regular grid gets, 3 is no reuse at all.
+ */
+R32 hz_meshopt_acmr(const U32 *indices, U32 index_count, U32 vertex_count, U32 cache_size);
+
+#endif
@@ -0,0 +1,221 @@
+#include "hz_meshpool.h"
+#include "hz_frame.h"
+#include "hz_gpumem.h"
+#include <GL/glew.h>
+
+X0 hz_meshpool_init(struct hzmeshpool *p, U32 vertex_size, U1 allow_indirect)
+{
+	memset(p, 0, sizeof(*p));
+	p->vertex_size = vertex_size;
+	/* The draw IDs come out of the base instance, which the indirect commands only honour from GL 4.2 on */
+	p->use_indirect = allow_indirect && GLEW_ARB_multi_draw_indirect && (GLEW_ARB_base_instance || GLEW_VERSION_4_2);
+}
+
+/* Grows `*array` to hold `need` elements of `size` bytes, doubling */
+static U1 reserve(X0 **array, U32 *cap, U32 need, size_t size)
+{
+	if (need <= *cap) return true;
+	U32 n = *cap ? *cap : 1024;
+	while (n < need) n *= 2;
+	X0 *a = realloc(*array, (size_t)n * size);
+	if (!a) return false;
+	*array = a;
+	*cap = n;
+	return true;
+}
+
+INAT hz_meshpool_add(struct hzmeshpool *p, const X0 *vertices, U32 vertex_count, const U32 *indices,
+	U32 index_count)
+{
+	if (vertex_count > UINT32_MAX / 2 - p->vertex_count || index_count > UINT32_MAX / 2 - p->index_count
+		|| !reserve((X0**)&p->vertices, &p->vertex_cap, p->vertex_count + vertex_count, p->vertex_size)
+		|| !reserve((X0**)&p->indices, &p->index_cap, p->index_count + index_count, sizeof(U32))) {
+		fprintf(stderr, "meshpool: out of memory\n");
+		return -1;
+	}
+	struct hzmesh *mesh = realloc(p->mesh, (p->meshes + 1) * sizeof(*mesh));
+	if (!mesh) {
+		fprintf(stderr, "meshpool: out of memory\n");
+		return -1;
+	}
+	p->mesh = mesh;
+
+	/* The indices stay mesh local, the base vertex takes care of where the mesh ended up */
+	mesh[p->meshes] = (struct hzmesh){ p->index_count, index_count, p->vertex_count, vertex_count };
+	memcpy(p->vertices + (size_t)p->vertex_count * p->vertex_size, vertices, (size_t)vertex_count * p->vertex_size);
+	memcpy(p->indices + p->index_count, indices, (size_t)index_count * sizeof(U32));
+	p->vertex_count += vertex_count;
+	p->index_count += index_count;
+	return p->meshes++;
+}
+
+INAT hz_meshpool_add_lod(struct hzmeshpool *p, U32 mesh, const U32 *indices, U32 index_count)
+{
+	if (mesh >= p->meshes) return -1;
+	if (index_count > UINT32_MAX / 2 - p->index_count
+		|| !reserve((X0**)&p->indices, &p->index_cap, p->index_count + index_count, sizeof(U32))) {
+		fprintf(stderr, "meshpool: out of memory\n");
+		return -1;
+	}
+	struct hzmesh *m = realloc(p->mesh, (p->meshes + 1) * sizeof(*m));
+	if (!m) {
+		fprintf(stderr, "meshpool: out of memory\n");
+		return -1;
+	}
+	p->mesh = m;
+
+	/* Same vertices, so the same base vertex */
+	m[p->meshes] = (struct hzmesh){ p->index_count, index_count, m[mesh].base_vertex, m[mesh].vertex_count };
+	memcpy(p->indices + p->index_count, indices, (size_t)index_count * sizeof(U32));
+	p->index_count += index_count;
+	return p->meshes++;
+}
+
+U1 hz_meshpool_upload(struct hzmeshpool *p, U32 max_draws)
+{
+	/* The only thing that can run out here, so get it before there are any GL objects to undo */
+	U32 *ids = NULL;
+	if (max_draws && !(ids = malloc((size_t)max_draws * sizeof(U32)))) {
+		fprintf(stderr, "meshpool: out of memory\n");
+		return false;
+	}
+
+	hz_gpumem_upload_begin();
+
+	glGenVertexArrays(1, &p->vao);
+	glGenBuffers(1, &p->vbo);
+	glGenBuffers(1, &p->ebo);
+	glBindVertexArray(p->vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p->ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)p->index_count * sizeof(U32), p->indices, GL_STATIC_DRAW);
+	hz_gpumem_buffer(p->ebo, (size_t)p->index_count * sizeof(U32), "meshpool");
+
+	p->max_draws = max_draws;
+	if (max_draws) {
+		for (U32 i = 0; i < max_draws; i++) ids[i] = i;
+		glGenBuffers(1, &p->draw_ids);
+		glBindBuffer(GL_ARRAY_BUFFER, p->draw_ids);
+		glBufferData(GL_ARRAY_BUFFER, (size_t)max_draws * sizeof(U32), ids, GL_STATIC_DRAW);
+		hz_gpumem_buffer(p->draw_ids, (size_t)max_draws * sizeof(U32), "meshpool");
+		free(ids);
+		glVertexAttribIPointer(HZ_MESHPOOL_DRAW_ID, 1, GL_UNSIGNED_INT, sizeof(U32), (X0*)0);
+		glVertexAttribDivisor(HZ_MESHPOOL_DRAW_ID, 1);
+		glEnableVertexAttribArray(HZ_MESHPOOL_DRAW_ID);
+	}
+	if (p->use_indirect) glGenBuffers(1, &p->indirect);
+
+	glBindBuffer(GL_ARRAY_BUFFER, p->vbo);
+	glBufferData(GL_ARRAY_BUFFER, (size_t)p->vertex_count * p->vertex_size, p->vertices, GL_STATIC_DRAW);
+	hz_gpumem_buffer(p->vbo, (size_t)p->vertex_count * p->vertex_size, "meshpool");
+
+	free(p->vertices);
+	free(p->indices);
+	p->vertices = NULL;
+	p->indices = NULL;
+	p->vertex_cap = p->index_cap = 0;
+
+	UNAT err = hz_gpumem_upload_end();
+	if (err != GL_NO_ERROR) {
+		fprintf(stderr, "meshpool: unable to upload %u vertices and %u indices: GL error 0x%x\n", p->vertex_count,
+			p->index_count, err);
+		return false;
+	}
+	return true;
+}
+
+X0 hz_meshpool_destroy(struct hzmeshpool *p)
+{
+	UNAT buffers[] = { p->vbo, p->ebo, p->draw_ids, p->indirect };
+	for (U32 i = 0; i < sizeof(buffers) / sizeof(buffers[0]); i++) {
+		if (!buffers[i]) continue;
+		glDeleteBuffers(1, &buffers[i]);
+		hz_gpumem_free(HZ_GPUMEM_BUFFER, buffers[i]);
+	}
+	if (p->vao) glDeleteVertexArrays(1, &p->vao);
+	free(p->vertices);
+	free(p->indices);
+	free(p->mesh);
+	memset(p, 0, sizeof(*p));
+}
+
+U1 hz_drawlist_begin(struct hzdrawlist *l, U32 cap)
+{
+	memset(l, 0, sizeof(*l));
+	l->cmd = hz_frame_alloc((size_t)(cap ? cap : 1) * sizeof(*l->cmd));
+	if (!l->cmd) return false;
+	l->cap = cap;
+	return true;
+}
+
+U32 hz_drawlist_add(struct hzdrawlist *l, const struct hzmeshpool *p, U32 mesh, U32 instances)
+{
+	if (l->count == l->cap || mesh >= p->meshes || !instances) return UINT32_MAX;
+	if (p->max_draws && instances > p->max_draws - l->draw_ids) return UINT32_MAX;
+
+	const struct hzmesh *m = &p->mesh[mesh];
+	U32 id = l->draw_ids;
+	l->cmd[l->count++] = (struct hzdrawcommand){ m->index_count, instances, m->first_index, m->base_vertex, id };
+	l->draw_ids += instances;
+	return id;
+}
+
+U32 hz_meshpool_draw(struct hzmeshpool *p, const struct hzdrawlist *l)
+{
+	if (!l->count) return 0;
+	glBindVertexArray(p->vao);
+
+	if (p->use_indirect) {
+		/* Respecifying the whole buffer every frame orphans the one the GPU may still be reading */
+		size_t size = (size_t)l->count * sizeof(struct hzdrawcommand);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, p->indirect);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, size, l->cmd, GL_STREAM_DRAW);
+		if (size > p->indirect_size) {
+			p->indirect_size = size;
+			hz_gpumem_buffer(p->indirect, size, "meshpool");
+		}
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (X0*)0, l->count, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		return 1;
+	}
+
+	if (p->max_draws) {
+		/* Nothing in a multi-draw says which draw a vertex belongs to, so this is one draw per command */
+		glBindBuffer(GL_ARRAY_BUFFER, p->draw_ids);
+		for (U32 i = 0; i < l->count; i++) {
+			const struct hzdrawcommand *c = &l->cmd[i];
+			glVertexAttribIPointer(HZ_MESHPOOL_DRAW_ID, 1, GL_UNSIGNED_INT, sizeof(U32),
+				(X0*)((size_t)c->base_instance * sizeof(U32)));
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, c->count, GL_UNSIGNED_INT,
+				(X0*)((size_t)c->first_index * sizeof(U32)), c->instance_count, c->base_vertex);
+		}
+		glVertexAttribIPointer(HZ_MESHPOOL_DRAW_ID, 1, GL_UNSIGNED_INT, sizeof(U32), (X0*)0);
+		return l->count;
+	}
+
+	/* No draw IDs: the same commands, as the parallel arrays glMultiDrawElementsBaseVertex() wants. GL 3.3 has no
+	 * instanced multi-draw, so commands with more than one instance go out on their own.
+	 */
+	GLsizei *counts = hz_frame_alloc(l->count * sizeof(GLsizei));
+	const X0 **offsets = hz_frame_alloc(l->count * sizeof(X0*));
+	GLint *base_vertices = hz_frame_alloc(l->count * sizeof(GLint));
+	if (!counts || !offsets || !base_vertices) return 0;
+	U32 n = 0, draws = 0;
+	for (U32 i = 0; i < l->count; i++) {
+		const struct hzdrawcommand *c = &l->cmd[i];
+		if (c->instance_count > 1) {
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, c->count, GL_UNSIGNED_INT,
+				(X0*)((size_t)c->first_index * sizeof(U32)), c->instance_count, c->base_vertex);
+			draws++;
+			continue;
+		}
+		counts[n] = c->count;
+		offsets[n] = (const X0*)((size_t)c->first_index * sizeof(U32));
+		base_vertices[n++] = c->base_vertex;
+	}
+	if (n) {
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts, GL_UNSIGNED_INT, (const X0 *const*)offsets, n,
+			base_vertices);
+		draws++;
+	}
+	return draws;
+}
@@ -0,0 +1,102 @@
+#ifndef HZ_MESHPOOL_H
+#define HZ_MESHPOOL_H
+
+#include "holyh/src/holy.h"
+
+/* Many meshes, one draw call. Every mesh added to a pool goes into one big vertex buffer and one big index buffer
+ * behind a single VAO, and remembers where: its first index, its index count and the base vertex its (mesh local)
+ * indices are relative to. Drawing a whole scene is then a matter of building a list of those, one
+ * DrawElementsIndirectCommand per object, and handing the list to GL in one go:
+ *
+ *   - with ARB_multi_draw_indirect (and base instance support), the commands go into a GL_DRAW_INDIRECT_BUFFER and
+ *     out in one glMultiDrawElementsIndirect(),
+ *   - otherwise, on plain GL 3.3, in one glMultiDrawElementsBaseVertex(), straight from the CPU side arrays.
+ *
+ * Shaders often need to know which object they're drawing. A pool set up with draw IDs has an extra uint attribute
+ * at HZ_MESHPOOL_DRAW_ID, which is the index of the command in its list (plus the instance, for commands with more
+ * than one), to look the object's transform or material up with, say from a texture buffer. The indirect path gets
+ * that for free out of each command's base instance. GL 3.3 has nothing that tells the draws of one
+ * glMultiDrawElementsBaseVertex() apart, so there the fallback is a glDrawElementsInstancedBaseVertex() per command,
+ * with the draw ID attribute pointed at the command first. Pools without draw IDs (pre-transformed geometry) get
+ * their single call either way.
+ *
+ * Command lists live in the frame arena (see hz_frame.h), so they're built from scratch every frame at no cost.
+ */
+
+#define HZ_MESHPOOL_DRAW_ID 15 /* Attribute location of the draw ID */
+
+/* Where a mesh lives in the pool */
+struct hzmesh {
+	U32 first_index;
+	U32 index_count;
+	U32 base_vertex;
+	U32 vertex_count;
+};
+
+/* Laid out the way glMultiDrawElementsIndirect() reads them */
+struct hzdrawcommand {
+	U32 count;
+	U32 instance_count;
+	U32 first_index;
+	I32 base_vertex;
+	U32 base_instance;
+};
+
+struct hzmeshpool {
+	UNAT vao, vbo, ebo;
+	UNAT draw_ids; /* 0, 1, 2, ... up to max_draws, for the draw ID attribute. 0 if there are none. */
+	UNAT indirect; /* GL_DRAW_INDIRECT_BUFFER, when that's the path we're on */
+	size_t indirect_size;
+	U1 use_indirect;
+	U32 vertex_size;
+	U32 max_draws;
+
+	/* Staged on the CPU until hz_meshpool_upload(), then freed */
+	U8 *vertices;
+	U32 vertex_count, vertex_cap;
+	U32 *indices;
+	U32 index_count, index_cap;
+
+	struct hzmesh *mesh;
+	U32 meshes;
+};
+
+struct hzdrawlist {
+	struct hzdrawcommand *cmd;
+	U32 count;
+	U32 cap;
+	U32 draw_ids; /* Draw IDs handed out so far, the next command's base instance */
+};
+
+/* Sets up an empty pool for vertices of `vertex_size` bytes. `allow_indirect` false forces the GL 3.3 path, to
+ * compare the two on hardware that has both.
+ */
+X0 hz_meshpool_init(struct hzmeshpool *p, U32 vertex_size, U1 allow_indirect);
+/* Adds a mesh, with indices relative to its own first vertex. Returns its index, or -1 if we're out of memory. */
+INAT hz_meshpool_add(struct hzmeshpool *p, const X0 *vertices, U32 vertex_count, const U32 *indices,
+	U32 index_count);
+/* Adds another set of indices over the vertices `mesh` already has, one of its LODs say (see hz_lod.h), which only
+ * differ in their indices. Those are relative to the mesh's first vertex too. Returns the new mesh's index, or -1 if
+ * we're out of memory.
+ */
+INAT hz_meshpool_add_lod(struct hzmeshpool *p, U32 mesh, const U32 *indices, U32 index_count);
+/* Creates the buffers and leaves the VAO bound, with the vertex buffer bound to GL_ARRAY_BUFFER, for the caller to
+ * set its vertex attributes up. `max_draws` is how many draw IDs a list may hand out, 0 for none. Returns false
+ * (with a message on stderr) if we're out of memory, in which case nothing's been created and the meshes are still
+ * staged, or if the buffers couldn't be filled. Either way hz_meshpool_destroy() cleans up whatever there is.
+ */
+U1 hz_meshpool_upload(struct hzmeshpool *p, U32 max_draws);
+X0 hz_meshpool_destroy(struct hzmeshpool *p);
+
+/* Starts an empty list with room for `cap` commands, out of the frame arena. Returns false if that's out. */
+U1 hz_drawlist_begin(struct hzdrawlist *l, U32 cap);
+/* Queues `instances` instances of a mesh. Returns the draw ID of the first one, or UINT32_MAX if the list or the
+ * pool's draw IDs are full.
+ */
+U32 hz_drawlist_add(struct hzdrawlist *l, const struct hzmeshpool *p, U32 mesh, U32 instances);
+/* Draws the list as triangles, with whatever program is current. Binds the pool's VAO. Returns the number of draw
+ * calls that took.
+ */
+U32 hz_meshpool_draw(struct hzmeshpool *p, const struct hzdrawlist *l);
+
+#endif
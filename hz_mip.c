@@ -0,0 +1,233 @@
+#include "hz_mip.h"
+#include "hz_jobs.h"
+#include <math.h>
+#include <pthread.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define MIP_PI 3.14159265358979f
+#define KAISER_RADIUS 2.0f /* Support either side of a destination pixel, in destination pixels */
+#define KAISER_BETA 4.0f
+
+/* Linear light back to sRGB goes through a table indexed by 16 bits of linear value. That's fine enough that the
+ * darkest steps still round the same as powf() would.
+ */
+#define SRGB_TABLE_BITS 16
+
+static R32 unorm_to_float[256];
+static R32 srgb_to_linear[256];
+static U8 linear_to_srgb[1 << SRGB_TABLE_BITS];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static X0 build_tables()
+{
+	for (INAT i = 0; i < 256; i++) {
+		R32 c = i / 255.0f;
+		unorm_to_float[i] = c;
+		srgb_to_linear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+	for (INAT i = 0; i < 1 << SRGB_TABLE_BITS; i++) {
+		R32 c = i / (R32)((1 << SRGB_TABLE_BITS) - 1);
+		c = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+		linear_to_srgb[i] = (U8)(c * 255.0f + 0.5f);
+	}
+}
+
+U32 hz_mip_next_size(U32 size)
+{
+	return size > 1 ? size / 2 : 1;
+}
+
+size_t hz_mip_chain_size(U32 w, U32 h, U32 levels)
+{
+	size_t size = 0;
+	for (U32 i = 0; i < levels; i++, w = hz_mip_next_size(w), h = hz_mip_next_size(h)) size += (size_t)w * h * 4;
+	return size;
+}
+
+/* The filter along one axis: every destination pixel is sum(weight[k] * source[index[k]]) over `taps` taps. Pixels
+ * that need fewer taps than the widest one are padded out with zero weights.
+ */
+struct mipaxis {
+	U32 taps;
+	U32 *index;
+	R32 *weight;
+};
+
+static R32 bessel_i0(R32 x)
+{
+	R32 sum = 1.0f, term = 1.0f;
+	for (INAT k = 1; k < 16; k++) {
+		term *= (x / (2.0f * k)) * (x / (2.0f * k));
+		sum += term;
+	}
+	return sum;
+}
+
+static R32 kaiser_sinc(R32 x)
+{
+	R32 t = x / KAISER_RADIUS;
+	if (t <= -1.0f || t >= 1.0f) return 0.0f;
+	R32 sinc = fabsf(x) < 1e-5f ? 1.0f : sinf(MIP_PI * x) / (MIP_PI * x);
+	return sinc * bessel_i0(KAISER_BETA * sqrtf(1.0f - t * t)) / bessel_i0(KAISER_BETA);
+}
+
+/* Source pixel i covers [i, i + 1), destination pixel d covers [d * scale, (d + 1) * scale) of the same axis */
+static U1 build_axis(struct mipaxis *a, U32 src, U32 dst, U1 kaiser)
+{
+	R32 scale = (R32)src / dst;
+	R32 support = kaiser ? KAISER_RADIUS * scale : 0.0f;
+	a->taps = (U32)ceilf(2.0f * support) + 1;
+	if (!kaiser) {
+		/* Exact, so an even size gets the 2 taps it needs rather than 3 */
+		a->taps = 1;
+		for (U32 d = 0; d < dst; d++) {
+			U32 taps = (U32)(ceilf((d + 1) * scale) - floorf(d * scale));
+			if (taps > a->taps) a->taps = taps;
+		}
+	}
+	a->index = malloc((size_t)dst * a->taps * sizeof(U32));
+	a->weight = calloc((size_t)dst * a->taps, sizeof(R32));
+	if (!a->index || !a->weight) return false;
+
+	for (U32 d = 0; d < dst; d++) {
+		U32 *index = a->index + (size_t)d * a->taps;
+		R32 *weight = a->weight + (size_t)d * a->taps;
+		R32 lo = d * scale, hi = (d + 1) * scale, center = (lo + hi) * 0.5f, sum = 0.0f;
+		INAT first = (INAT)floorf(kaiser ? center - support : lo);
+
+		for (U32 k = 0; k < a->taps; k++) {
+			INAT i = first + (INAT)k;
+			R32 w;
+			if (kaiser) {
+				w = kaiser_sinc((i + 0.5f - center) / scale);
+			} else {
+				/* How much of the source pixel falls inside the destination one */
+				R32 l = i > lo ? i : lo, r = i + 1 < hi ? i + 1 : hi;
+				w = r > l ? r - l : 0.0f;
+			}
+			/* Past the edges, repeat the edge pixel */
+			index[k] = i < 0 ? 0 : i >= (INAT)src ? src - 1 : (U32)i;
+			weight[k] = w;
+			sum += w;
+		}
+		for (U32 k = 0; k < a->taps; k++) weight[k] /= sum;
+	}
+	return true;
+}
+
+static X0 free_axis(struct mipaxis *a)
+{
+	free(a->index);
+	free(a->weight);
+}
+
+struct mipjob {
+	const U8 *src;
+	U8 *dst;
+	U32 sw, sh, dw, dh;
+	U1 srgb;
+	struct mipaxis x, y;
+	U32 rows_per_job;
+	R32 *columns; /* sw pixels of RGBA floats per job, the vertical pass for one destination row */
+};
+
+static X0 downsample_rows(X0 *data, INAT index)
+{
+	struct mipjob *j = data;
+	const R32 *lut = j->srgb ? srgb_to_linear : unorm_to_float;
+	R32 *columns = j->columns + (size_t)index * j->sw * 4;
+	U32 end = (index + 1) * j->rows_per_job < j->dh ? (index + 1) * j->rows_per_job : j->dh;
+
+	for (U32 y = index * j->rows_per_job; y < end; y++) {
+		const U32 *ry = j->y.index + (size_t)y * j->y.taps;
+		const R32 *wy = j->y.weight + (size_t)y * j->y.taps;
+		U8 *out = j->dst + (size_t)y * j->dw * 4;
+
+		/* Vertical pass: the source rows this destination row covers, converted to linear floats and filtered */
+		for (U32 x = 0; x < j->sw; x++) {
+#ifdef __SSE2__
+			__m128 acc = _mm_setzero_ps();
+			for (U32 k = 0; k < j->y.taps; k++) {
+				const U8 *p = j->src + ((size_t)ry[k] * j->sw + x) * 4;
+				__m128 v = _mm_setr_ps(lut[p[0]], lut[p[1]], lut[p[2]], unorm_to_float[p[3]]);
+				acc = _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(wy[k])));
+			}
+			_mm_storeu_ps(columns + x * 4, acc);
+#else
+			R32 acc[4] = { 0 };
+			for (U32 k = 0; k < j->y.taps; k++) {
+				const U8 *p = j->src + ((size_t)ry[k] * j->sw + x) * 4;
+				for (INAT c = 0; c < 4; c++) acc[c] += (c < 3 ? lut[p[c]] : unorm_to_float[p[c]]) * wy[k];
+			}
+			memcpy(columns + x * 4, acc, sizeof(acc));
+#endif
+		}
+
+		/* Horizontal pass, then back to 8 bits */
+		for (U32 x = 0; x < j->dw; x++) {
+			const U32 *rx = j->x.index + (size_t)x * j->x.taps;
+			const R32 *wx = j->x.weight + (size_t)x * j->x.taps;
+			INAT q[4];
+#ifdef __SSE2__
+			__m128 acc = _mm_setzero_ps();
+			for (U32 k = 0; k < j->x.taps; k++) {
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(columns + rx[k] * 4), _mm_set1_ps(wx[k])));
+			}
+			/* Kaiser lobes can overshoot */
+			acc = _mm_min_ps(_mm_max_ps(acc, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+			__m128 range = j->srgb ? _mm_setr_ps(65535.0f, 65535.0f, 65535.0f, 255.0f) : _mm_set1_ps(255.0f);
+			_mm_storeu_si128((__m128i *)q, _mm_cvtps_epi32(_mm_mul_ps(acc, range)));
+#else
+			R32 acc[4] = { 0 };
+			for (U32 k = 0; k < j->x.taps; k++) {
+				for (INAT c = 0; c < 4; c++) acc[c] += columns[rx[k] * 4 + c] * wx[k];
+			}
+			for (INAT c = 0; c < 4; c++) {
+				R32 v = acc[c] < 0.0f ? 0.0f : acc[c] > 1.0f ? 1.0f : acc[c];
+				q[c] = (INAT)(v * (j->srgb && c < 3 ? 65535.0f : 255.0f) + 0.5f);
+			}
+#endif
+			for (INAT c = 0; c < 3; c++) out[x * 4 + c] = j->srgb ? linear_to_srgb[q[c]] : (U8)q[c];
+			out[x * 4 + 3] = (U8)q[3];
+		}
+	}
+}
+
+U1 hz_mip_chain(U8 *pixels, U32 w, U32 h, U32 levels, UNAT flags)
+{
+	pthread_once(&tables_once, build_tables);
+
+	for (U32 i = 1; i < levels; i++) {
+		struct mipjob j = {
+			.src = pixels,
+			.dst = pixels + (size_t)w * h * 4,
+			.sw = w,
+			.sh = h,
+			.dw = hz_mip_next_size(w),
+			.dh = hz_mip_next_size(h),
+			.srgb = flags & HZ_MIP_SRGB,
+		};
+
+		/* Small levels aren't worth waking the pool for */
+		U32 jobs = (size_t)j.dw * j.dh >= 64 * 64 ? hz_jobs_threads() * 2 : 1;
+		if (jobs > j.dh) jobs = j.dh;
+		j.rows_per_job = (j.dh + jobs - 1) / jobs;
+		jobs = (j.dh + j.rows_per_job - 1) / j.rows_per_job;
+		j.columns = malloc((size_t)jobs * w * 4 * sizeof(R32));
+
+		U1 ok = j.columns && build_axis(&j.x, w, j.dw, flags & HZ_MIP_KAISER)
+			&& build_axis(&j.y, h, j.dh, flags & HZ_MIP_KAISER);
+		if (ok) hz_jobs_run(downsample_rows, &j, jobs);
+		free_axis(&j.x);
+		free_axis(&j.y);
+		free(j.columns);
+		if (!ok) return false;
+
+		pixels = j.dst;
+		w = j.dw;
+		h = j.dh;
+	}
+	return true;
+}
@@ -0,0 +1,33 @@
+#ifndef HZ_MIP_H
+#define HZ_MIP_H
+
+#include "holyh/src/holy.h"
+
+/* CPU mipmap generation for RGBA8 images, for when glGenerateMipmap() isn't an option (cooking textures offline) or
+ * isn't good enough: drivers box filter sRGB textures in sRGB space, which darkens every level, and software GL
+ * implementations are slow at it.
+ *
+ * Each level is filtered from the one above it in linear light (with HZ_MIP_SRGB, the colour channels are decoded from
+ * sRGB first and encoded back after), one SSE2 register per pixel. Odd sizes are handled properly: every destination
+ * pixel averages exactly the area of the level above that it covers, rather than dropping the last row or column.
+ * Rows are spread over the hz_jobs pool, whenever it's running.
+ *
+ * Images are tightly packed RGBA8, w * 4 bytes per row.
+ */
+
+enum {
+	HZ_MIP_SRGB = 1, /* RGB is sRGB encoded. Alpha is always linear. */
+	HZ_MIP_KAISER = 2, /* Kaiser windowed sinc instead of a box filter: sharper, at about three times the cost */
+};
+
+/* Size of the level below a w x h one: halved, rounded down, never less than 1. */
+U32 hz_mip_next_size(U32 size);
+
+/* Bytes taken by the first `levels` levels of a w x h image's mip chain, stored back to back. */
+size_t hz_mip_chain_size(U32 w, U32 h, U32 levels);
+/* Builds levels 1 to `levels` - 1 from level 0 at the start of `pixels`, each level right after the one before.
+ * `flags` is a mix of HZ_MIP_*. Returns false if it ran out of memory, the levels built by then are still valid.
+ */
+U1 hz_mip_chain(U8 *pixels, U32 w, U32 h, U32 levels, UNAT flags);
+
+#endif
@@ -0,0 +1,291 @@
+#include "hz_occlusion.h"
+#include "hz_jobs.h"
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define GUARD_BAND 2.0f /* Triangles get clipped to this many screens across, so the edge functions stay small */
+#define MAX_CLIPPED 9 /* A triangle clipped by five planes */
+
+/* A triangle ready to rasterise: pixel coordinates (y up), depth, and the pixels whose centres its bounds cover */
+struct hzocctri {
+	R32 x[3], y[3], z[3];
+	INAT x0, y0, x1, y1;
+};
+
+static U32 level_size(U32 size, U32 level)
+{
+	return size >> level ? size >> level : 1;
+}
+
+U1 hz_occlusion_init(struct hzocclusion *o)
+{
+	memset(o, 0, sizeof(*o));
+	size_t total = 0;
+	for (U32 l = 0;; l++) {
+		total += (size_t)level_size(HZ_OCCLUSION_WIDTH, l) * level_size(HZ_OCCLUSION_HEIGHT, l);
+		o->levels++;
+		if (level_size(HZ_OCCLUSION_WIDTH, l) == 1 && level_size(HZ_OCCLUSION_HEIGHT, l) == 1) break;
+	}
+	R32 *mem = malloc(total * sizeof(R32));
+	if (!mem) {
+		fprintf(stderr, "occlusion: out of memory\n");
+		return false;
+	}
+	for (U32 l = 0; l < o->levels; l++) {
+		o->level[l] = mem;
+		mem += (size_t)level_size(HZ_OCCLUSION_WIDTH, l) * level_size(HZ_OCCLUSION_HEIGHT, l);
+	}
+	hz_jobs_init(0);
+	return true;
+}
+
+X0 hz_occlusion_destroy(struct hzocclusion *o)
+{
+	free(o->level[0]);
+	free(o->tri);
+	memset(o, 0, sizeof(*o));
+}
+
+X0 hz_occlusion_begin(struct hzocclusion *o, const R32 viewproj[16])
+{
+	memcpy(o->viewproj, viewproj, sizeof(o->viewproj));
+	for (U32 i = 0; i < HZ_OCCLUSION_WIDTH * HZ_OCCLUSION_HEIGHT; i++) o->level[0][i] = 1.0f;
+	o->tris = 0;
+	o->tested = o->hidden = 0;
+}
+
+/* out = a * b, column major */
+static X0 mat4_mul(const R32 *a, const R32 *b, R32 *out)
+{
+	for (INAT c = 0; c < 4; c++) {
+		for (INAT r = 0; r < 4; r++) {
+			out[c * 4 + r] = a[r] * b[c * 4] + a[4 + r] * b[c * 4 + 1] + a[8 + r] * b[c * 4 + 2]
+				+ a[12 + r] * b[c * 4 + 3];
+		}
+	}
+}
+
+/* How far inside clip plane `p` a clip space vertex is: near, then the guard band's left, right, bottom and top */
+static R32 plane_distance(const R32 *v, INAT p)
+{
+	switch (p) {
+	case 0: return v[2] + v[3];
+	case 1: return v[0] + GUARD_BAND * v[3];
+	case 2: return GUARD_BAND * v[3] - v[0];
+	case 3: return v[1] + GUARD_BAND * v[3];
+	default: return GUARD_BAND * v[3] - v[1];
+	}
+}
+
+/* Sutherland-Hodgman, one plane at a time. Returns the number of vertices left in `poly`. */
+static U32 clip(R32 poly[MAX_CLIPPED][4], U32 n)
+{
+	R32 tmp[MAX_CLIPPED][4];
+	for (INAT p = 0; p < 5 && n >= 3; p++) {
+		U32 m = 0;
+		for (U32 i = 0; i < n; i++) {
+			const R32 *a = poly[i], *b = poly[(i + 1) % n];
+			R32 da = plane_distance(a, p), db = plane_distance(b, p);
+			if (da >= 0.0f) memcpy(tmp[m++], a, sizeof(tmp[0]));
+			if ((da >= 0.0f) != (db >= 0.0f)) {
+				R32 t = da / (da - db);
+				for (INAT k = 0; k < 4; k++) tmp[m][k] = a[k] + (b[k] - a[k]) * t;
+				m++;
+			}
+		}
+		memcpy(poly, tmp, m * sizeof(tmp[0]));
+		n = m;
+	}
+	return n;
+}
+
+U1 hz_occlusion_add(struct hzocclusion *o, const R32 *positions, U32 stride, const U32 *indices, U32 index_count,
+	const R32 model[16])
+{
+	R32 mvp[16];
+	if (model) mat4_mul(o->viewproj, model, mvp);
+	else memcpy(mvp, o->viewproj, sizeof(mvp));
+
+	for (U32 i = 0; i + 2 < index_count; i += 3) {
+		R32 poly[MAX_CLIPPED][4];
+		U32 outside[6] = { 0 };
+		for (U32 k = 0; k < 3; k++) {
+			const R32 *p = (const R32*)((const U8*)positions + (size_t)indices[i + k] * stride);
+			for (INAT r = 0; r < 4; r++) {
+				poly[k][r] = mvp[r] * p[0] + mvp[4 + r] * p[1] + mvp[8 + r] * p[2] + mvp[12 + r];
+			}
+			for (INAT pl = 0; pl < 5; pl++) outside[pl] += plane_distance(poly[k], pl) < 0.0f;
+			outside[5] += poly[k][2] > poly[k][3];
+		}
+		/* All three past one plane (or the far one) is nothing to draw */
+		U1 skip = false;
+		for (INAT pl = 0; pl < 6; pl++) skip |= outside[pl] == 3;
+		if (skip) continue;
+		U32 n = outside[0] + outside[1] + outside[2] + outside[3] + outside[4] ? clip(poly, 3) : 3;
+
+		/* Into pixels, then a fan */
+		R32 sx[MAX_CLIPPED], sy[MAX_CLIPPED], sz[MAX_CLIPPED];
+		for (U32 k = 0; k < n; k++) {
+			R32 inv = 1.0f / poly[k][3];
+			sx[k] = (poly[k][0] * inv * 0.5f + 0.5f) * HZ_OCCLUSION_WIDTH;
+			sy[k] = (poly[k][1] * inv * 0.5f + 0.5f) * HZ_OCCLUSION_HEIGHT;
+			sz[k] = poly[k][2] * inv * 0.5f + 0.5f;
+		}
+		for (U32 k = 1; k + 1 < n; k++) {
+			U32 v[3] = { 0, k, k + 1 };
+			struct hzocctri t;
+			R32 minx = INFINITY, maxx = -INFINITY, miny = INFINITY, maxy = -INFINITY;
+			for (U32 j = 0; j < 3; j++) {
+				t.x[j] = sx[v[j]], t.y[j] = sy[v[j]], t.z[j] = sz[v[j]];
+				minx = fminf(minx, t.x[j]), maxx = fmaxf(maxx, t.x[j]);
+				miny = fminf(miny, t.y[j]), maxy = fmaxf(maxy, t.y[j]);
+			}
+			R32 area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+			t.x0 = (INAT)ceilf(minx - 0.5f), t.x1 = (INAT)floorf(maxx - 0.5f);
+			t.y0 = (INAT)ceilf(miny - 0.5f), t.y1 = (INAT)floorf(maxy - 0.5f);
+			t.x0 = t.x0 < 0 ? 0 : t.x0, t.y0 = t.y0 < 0 ? 0 : t.y0;
+			t.x1 = t.x1 >= HZ_OCCLUSION_WIDTH ? HZ_OCCLUSION_WIDTH - 1 : t.x1;
+			t.y1 = t.y1 >= HZ_OCCLUSION_HEIGHT ? HZ_OCCLUSION_HEIGHT - 1 : t.y1;
+			if (area == 0.0f || t.x0 > t.x1 || t.y0 > t.y1) continue;
+
+			if (o->tris == o->tri_cap) {
+				U32 cap = o->tri_cap ? o->tri_cap * 2 : 256;
+				struct hzocctri *tri = realloc(o->tri, cap * sizeof(*tri));
+				if (!tri) {
+					fprintf(stderr, "occlusion: out of memory\n");
+					return false;
+				}
+				o->tri = tri;
+				o->tri_cap = cap;
+			}
+			o->tri[o->tris++] = t;
+		}
+	}
+	return true;
+}
+
+/* Rasterises every triangle that touches one band of HZ_OCCLUSION_BAND rows. Bands don't share pixels, so the jobs
+ * don't need to talk to each other.
+ */
+static X0 raster_band(X0 *data, INAT index)
+{
+	const struct hzocclusion *o = data;
+	INAT band0 = index * HZ_OCCLUSION_BAND, band1 = band0 + HZ_OCCLUSION_BAND - 1;
+	R32 *depth = o->level[0];
+
+	for (U32 i = 0; i < o->tris; i++) {
+		const struct hzocctri *t = &o->tri[i];
+		if (t->y1 < band0 || t->y0 > band1) continue;
+
+		/* Edge functions, signed so the inside is positive whichever way round the triangle is, and the depth plane */
+		R32 area = (t->x[1] - t->x[0]) * (t->y[2] - t->y[0]) - (t->x[2] - t->x[0]) * (t->y[1] - t->y[0]);
+		R32 sign = area > 0.0f ? 1.0f : -1.0f, a[3], b[3], c[3];
+		for (INAT e = 0; e < 3; e++) {
+			INAT n = (e + 1) % 3;
+			a[e] = (t->y[e] - t->y[n]) * sign;
+			b[e] = (t->x[n] - t->x[e]) * sign;
+			c[e] = -(a[e] * t->x[e] + b[e] * t->y[e]);
+		}
+		R32 dzdx = ((t->z[1] - t->z[0]) * (t->y[2] - t->y[0]) - (t->z[2] - t->z[0]) * (t->y[1] - t->y[0])) / area;
+		R32 dzdy = ((t->x[1] - t->x[0]) * (t->z[2] - t->z[0]) - (t->x[2] - t->x[0]) * (t->z[1] - t->z[0])) / area;
+		R32 dz = t->z[0] - dzdx * t->x[0] - dzdy * t->y[0];
+
+		INAT y0 = t->y0 > band0 ? t->y0 : band0, y1 = t->y1 < band1 ? t->y1 : band1;
+		for (INAT y = y0; y <= y1; y++) {
+			R32 py = y + 0.5f, *row = depth + (size_t)y * HZ_OCCLUSION_WIDTH;
+			R32 r0 = b[0] * py + c[0], r1 = b[1] * py + c[1], r2 = b[2] * py + c[2], rz = dzdy * py + dz;
+#ifdef __SSE2__
+			/* Four pixels at a time from a multiple of 4, which the width is too. The edge functions, not the
+			 * bounds, decide what's covered, so the extra pixels either side are safe.
+			 */
+			__m128 step = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f), zero = _mm_setzero_ps();
+			__m128 a0 = _mm_set1_ps(a[0]), a1 = _mm_set1_ps(a[1]), a2 = _mm_set1_ps(a[2]), az = _mm_set1_ps(dzdx);
+			__m128 e0r = _mm_set1_ps(r0), e1r = _mm_set1_ps(r1), e2r = _mm_set1_ps(r2), zr = _mm_set1_ps(rz);
+			for (INAT x = t->x0 & ~3; x <= t->x1; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps((R32)x), step);
+				__m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), e0r), e1 = _mm_add_ps(_mm_mul_ps(a1, px), e1r);
+				__m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), e2r), z = _mm_add_ps(_mm_mul_ps(az, px), zr);
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+					_mm_cmpge_ps(e2, zero));
+				__m128 d = _mm_loadu_ps(row + x);
+				d = _mm_or_ps(_mm_and_ps(inside, _mm_min_ps(d, z)), _mm_andnot_ps(inside, d));
+				_mm_storeu_ps(row + x, d);
+			}
+#else
+			for (INAT x = t->x0; x <= t->x1; x++) {
+				R32 px = x + 0.5f;
+				if (a[0] * px + r0 < 0.0f || a[1] * px + r1 < 0.0f || a[2] * px + r2 < 0.0f) continue;
+				R32 z = dzdx * px + rz;
+				if (z < row[x]) row[x] = z;
+			}
+#endif
+		}
+	}
+}
+
+X0 hz_occlusion_finish(struct hzocclusion *o)
+{
+	hz_jobs_run(raster_band, o, HZ_OCCLUSION_HEIGHT / HZ_OCCLUSION_BAND);
+
+	/* Each level up keeps the farthest of the four below it, so it never claims to hide more than they do */
+	for (U32 l = 1; l < o->levels; l++) {
+		U32 sw = level_size(HZ_OCCLUSION_WIDTH, l - 1), sh = level_size(HZ_OCCLUSION_HEIGHT, l - 1);
+		U32 w = level_size(HZ_OCCLUSION_WIDTH, l), h = level_size(HZ_OCCLUSION_HEIGHT, l);
+		const R32 *src = o->level[l - 1];
+		R32 *dst = o->level[l];
+		for (U32 y = 0; y < h; y++) {
+			const R32 *r0 = src + (size_t)(y * 2 < sh ? y * 2 : sh - 1) * sw;
+			const R32 *r1 = src + (size_t)(y * 2 + 1 < sh ? y * 2 + 1 : sh - 1) * sw;
+			for (U32 x = 0; x < w; x++) {
+				U32 x0 = x * 2 < sw ? x * 2 : sw - 1, x1 = x * 2 + 1 < sw ? x * 2 + 1 : sw - 1;
+				dst[y * w + x] = fmaxf(fmaxf(r0[x0], r0[x1]), fmaxf(r1[x0], r1[x1]));
+			}
+		}
+	}
+}
+
+U1 hz_occlusion_aabb(struct hzocclusion *o, const R32 min[3], const R32 max[3])
+{
+	o->tested++;
+	const R32 *m = o->viewproj;
+	R32 minx = INFINITY, maxx = -INFINITY, miny = INFINITY, maxy = -INFINITY, nearest = INFINITY;
+	for (INAT i = 0; i < 8; i++) {
+		R32 p[3] = { i & 1 ? max[0] : min[0], i & 2 ? max[1] : min[1], i & 4 ? max[2] : min[2] }, c[4];
+		for (INAT r = 0; r < 4; r++) c[r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r];
+		/* Reaching past the near plane, so it's around the camera */
+		if (c[3] <= 1e-6f || c[2] < -c[3]) return true;
+		R32 inv = 1.0f / c[3];
+		minx = fminf(minx, c[0] * inv), maxx = fmaxf(maxx, c[0] * inv);
+		miny = fminf(miny, c[1] * inv), maxy = fmaxf(maxy, c[1] * inv);
+		nearest = fminf(nearest, c[2] * inv * 0.5f + 0.5f);
+	}
+	/* Off the screen is the frustum's business */
+	if (maxx < -1.0f || minx > 1.0f || maxy < -1.0f || miny > 1.0f) return true;
+
+	/* The pixels it touches, then the finest level where that's at most HZ_OCCLUSION_TEST texels across. Coarser
+	 * would be fewer reads, but the texels around the box's edges would take in more of what's beside it.
+	 */
+	INAT x0 = (INAT)floorf((minx * 0.5f + 0.5f) * HZ_OCCLUSION_WIDTH);
+	INAT x1 = (INAT)floorf((maxx * 0.5f + 0.5f) * HZ_OCCLUSION_WIDTH);
+	INAT y0 = (INAT)floorf((miny * 0.5f + 0.5f) * HZ_OCCLUSION_HEIGHT);
+	INAT y1 = (INAT)floorf((maxy * 0.5f + 0.5f) * HZ_OCCLUSION_HEIGHT);
+	x0 = x0 < 0 ? 0 : x0, y0 = y0 < 0 ? 0 : y0;
+	x1 = x1 >= HZ_OCCLUSION_WIDTH ? HZ_OCCLUSION_WIDTH - 1 : x1;
+	y1 = y1 >= HZ_OCCLUSION_HEIGHT ? HZ_OCCLUSION_HEIGHT - 1 : y1;
+	U32 l = 0;
+	while ((x1 >> l) - (x0 >> l) >= HZ_OCCLUSION_TEST || (y1 >> l) - (y0 >> l) >= HZ_OCCLUSION_TEST) l++;
+
+	const R32 *level = o->level[l];
+	U32 w = level_size(HZ_OCCLUSION_WIDTH, l);
+	R32 farthest = 0.0f;
+	for (INAT y = y0 >> l; y <= y1 >> l; y++) {
+		for (INAT x = x0 >> l; x <= x1 >> l; x++) farthest = fmaxf(farthest, level[y * w + x]);
+	}
+	if (nearest > farthest) {
+		o->hidden++;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,68 @@
+#ifndef HZ_OCCLUSION_H
+#define HZ_OCCLUSION_H
+
+#include "holyh/src/holy.h"
+
+/* Occlusion culling on the CPU, with a hierarchical depth buffer. Frustum culling still draws everything in view,
+ * including the whole town behind the wall in front of the camera. So every frame, a few big, simple occluders (the
+ * walls, the hills, the buildings' boxes) are rasterised into a small depth buffer, HZ_OCCLUSION_WIDTH x
+ * HZ_OCCLUSION_HEIGHT, with the same view-projection matrix the frame is drawn with. Then every object's bounding box
+ * is tested against it before it goes into a draw list, and anything entirely behind the occluders never gets drawn,
+ * so costs neither vertex nor fragment work.
+ *
+ *   hz_occlusion_begin(&o, viewproj);
+ *   hz_occlusion_add(&o, ...);              for every occluder
+ *   hz_occlusion_finish(&o);
+ *   if (hz_occlusion_aabb(&o, min, max))    for every object, draw it
+ *
+ * The rasteriser only does depth: triangles are clipped against the near plane (and a guard band around the screen),
+ * then the buffer's rows are split into bands, one job each (see hz_jobs.h), which walk the triangles four pixels at a
+ * time with SSE2 where there is some. hz_occlusion_finish() then builds a pyramid out of the buffer, each level's
+ * texel the farthest depth of the four under it, so testing a box is a handful of reads whatever size it is on
+ * screen: the nearest depth of the box against the farthest of the texels it covers, on the finest level where that's
+ * at most HZ_OCCLUSION_TEST texels across.
+ *
+ * Occluders are sampled at pixel centres, so at this resolution they can hide an object that peeks out from behind
+ * them by less than one of their pixels. Tested boxes are conservative otherwise: anything that crosses the near
+ * plane, or that we can't tell about, is visible.
+ */
+
+#define HZ_OCCLUSION_WIDTH 256 /* Powers of two */
+#define HZ_OCCLUSION_HEIGHT 128
+#define HZ_OCCLUSION_BAND 8 /* Rows per rasterisation job */
+#define HZ_OCCLUSION_TEST 8 /* Texels across a box test reads, at most */
+
+struct hzocctri;
+
+struct hzocclusion {
+	R32 viewproj[16];
+	R32 *level[16]; /* The pyramid, level[0] being the depth buffer itself. 0 is the near plane, 1 the far one. */
+	U32 levels;
+
+	/* This frame's occluder triangles, in screen space */
+	struct hzocctri *tri;
+	U32 tris, tri_cap;
+
+	U32 tested, hidden; /* hz_occlusion_aabb() calls since hz_occlusion_begin(), and how many said no */
+};
+
+/* Allocates the buffers and starts the job pool if it isn't running. Returns false if we're out of memory. */
+U1 hz_occlusion_init(struct hzocclusion *o);
+X0 hz_occlusion_destroy(struct hzocclusion *o);
+
+/* Starts a frame: clears the depth buffer and takes the column major (cglm style) view-projection matrix everything
+ * is going to be drawn with.
+ */
+X0 hz_occlusion_begin(struct hzocclusion *o, const R32 viewproj[16]);
+/* Adds an occluder: indexed triangles, with a position (three floats) every `stride` bytes, placed by a column major
+ * model matrix, or in world space already if that's NULL. Occluders should be solid, and no bigger than what they
+ * stand in for. Returns false if we're out of memory, in which case the occluder's left out.
+ */
+U1 hz_occlusion_add(struct hzocclusion *o, const R32 *positions, U32 stride, const U32 *indices, U32 index_count,
+	const R32 model[16]);
+/* Rasterises the occluders and builds the pyramid. */
+X0 hz_occlusion_finish(struct hzocclusion *o);
+/* False if a world space box is certainly hidden behind the occluders. */
+U1 hz_occlusion_aabb(struct hzocclusion *o, const R32 min[3], const R32 max[3]);
+
+#endif
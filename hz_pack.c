@@ -0,0 +1,101 @@
+#include "hz_pack.h"
+#include "hz_lz.h"
+
+U64 hz_pack_hash(const X0 *data, size_t size)
+{
+	const U8 *p = data;
+	U64 h = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < size; i++) {
+		h ^= p[i];
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+static U1 fail(struct hzpack *p, const CHR *path, const CHR *why)
+{
+	fprintf(stderr, "pack: %s: %s\n", path, why);
+	hz_pack_unmount(p);
+	return false;
+}
+
+U1 hz_pack_mount(struct hzpack *p, const CHR *path)
+{
+	memset(p, 0, sizeof(*p));
+	if (!hz_file_map(&p->file, path, 0)) return false;
+
+	const U8 *data = p->file.data;
+	size_t size = p->file.size;
+	if (size < sizeof(struct hzpackheader)) return fail(p, path, "Not an asset pack");
+	p->header = (const struct hzpackheader *)data;
+	const struct hzpackheader *h = p->header;
+	if (memcmp(h->magic, HZ_PACK_MAGIC, 4)) return fail(p, path, "Not an asset pack");
+	if (h->version != HZ_PACK_VERSION) return fail(p, path, "Unsupported version");
+	if (h->bucket_bits > 24) return fail(p, path, "Bad bucket count");
+
+	/* Buckets follow the header, entries follow the buckets, 8 byte aligned */
+	size_t buckets = ((size_t)1 << h->bucket_bits) + 1;
+	size_t entries_offset = (sizeof(*h) + buckets * 4 + 7) & ~(size_t)7;
+	if (entries_offset > size || h->entries > (size - entries_offset) / sizeof(struct hzpackentry)) {
+		return fail(p, path, "Truncated entry table");
+	}
+	p->buckets = (const U32 *)(data + sizeof(*h));
+	p->entries = (const struct hzpackentry *)(data + entries_offset);
+
+	if (h->names_offset > size || h->names_size > size - h->names_offset) return fail(p, path, "Truncated names");
+	if (h->names_size && data[h->names_offset + h->names_size - 1]) return fail(p, path, "Unterminated names");
+	p->names = (const CHR *)data + h->names_offset;
+
+	/* Everything a lookup or a read trusts gets checked once here, so they don't have to */
+	for (size_t i = 0; i < buckets; i++) {
+		if (p->buckets[i] > h->entries || (i && p->buckets[i] < p->buckets[i - 1])) return fail(p, path, "Bad buckets");
+	}
+	if (p->buckets[buckets - 1] != h->entries) return fail(p, path, "Bad buckets");
+	for (U32 i = 0; i < h->entries; i++) {
+		const struct hzpackentry *e = &p->entries[i];
+		U64 bucket = h->bucket_bits ? e->hash >> (64 - h->bucket_bits) : 0;
+		if (i < p->buckets[bucket] || i >= p->buckets[bucket + 1] || (i && e->hash < p->entries[i - 1].hash)) {
+			return fail(p, path, "Entries out of order");
+		}
+		if (e->offset > size || e->stored_size > size - e->offset) return fail(p, path, "Truncated payload");
+		if (e->name >= h->names_size) return fail(p, path, "Bad name");
+		if (!(e->flags & HZ_PACK_LZ) && e->size != e->stored_size) return fail(p, path, "Bad payload size");
+	}
+	return true;
+}
+
+X0 hz_pack_unmount(struct hzpack *p)
+{
+	if (p->file.data) hz_file_unmap(&p->file);
+	memset(p, 0, sizeof(*p));
+}
+
+const struct hzpackentry *hz_pack_find(const struct hzpack *p, const CHR *name)
+{
+	U64 hash = hz_pack_hash(name, strlen(name));
+	U32 bits = p->header->bucket_bits;
+	U64 bucket = bits ? hash >> (64 - bits) : 0;
+
+	for (U32 i = p->buckets[bucket]; i < p->buckets[bucket + 1] && p->entries[i].hash <= hash; i++) {
+		/* The tool refuses to pack two names with the same hash, but a name that isn't in the pack can collide */
+		if (p->entries[i].hash == hash && !strcmp(p->names + p->entries[i].name, name)) return &p->entries[i];
+	}
+	return NULL;
+}
+
+const CHR *hz_pack_name(const struct hzpack *p, const struct hzpackentry *e)
+{
+	return p->names + e->name;
+}
+
+const U8 *hz_pack_data(const struct hzpack *p, const struct hzpackentry *e)
+{
+	return p->file.data + e->offset;
+}
+
+U1 hz_pack_read(const struct hzpack *p, const struct hzpackentry *e, U8 *out)
+{
+	if (e->flags & HZ_PACK_LZ) return hz_lz_decompress(hz_pack_data(p, e), e->stored_size, out, e->size);
+	memcpy(out, hz_pack_data(p, e), e->size);
+	return true;
+}
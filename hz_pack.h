@@ -0,0 +1,71 @@
+#ifndef HZ_PACK_H
+#define HZ_PACK_H
+
+#include "holyh/src/holy.h"
+#include "hz_file.h"
+
+/* Asset packs: many files in one, mounted with a single mmap() (see hz_file.h) instead of an open() per asset.
+ * tools/hz_pack.c makes them.
+ *
+ *   header | buckets | entries | names | payloads
+ *
+ * Entries are sorted by the hash of their name, and the top bits of the hash index a bucket table that says where
+ * each run of equal top bits starts, so a lookup is one bucket read and a scan of about one entry. Payloads start on
+ * HZ_PACK_ALIGN byte boundaries. A payload is either stored as is, in which case it can go from the mapping straight
+ * to GL (or a decoder) without being copied, or compressed with hz_lz.h when that saves enough to be worth it.
+ * Payloads are content addressed as well: entries whose bytes are identical share one copy.
+ *
+ * Everything is little endian, and checked on mount, so a truncated or corrupt pack is turned away up front.
+ */
+
+#define HZ_PACK_MAGIC "HZPK"
+#define HZ_PACK_VERSION 1
+#define HZ_PACK_ALIGN 64
+
+enum {
+	HZ_PACK_LZ = 1, /* Payload is an hz_lz block, hz_pack_read() it */
+};
+
+struct hzpackheader {
+	CHR magic[4];
+	U32 version;
+	U32 entries;
+	U32 bucket_bits; /* 1 << bucket_bits buckets, plus one past the end */
+	U64 names_offset; /* The names, each NUL terminated, from the start of the file */
+	U64 names_size;
+};
+
+struct hzpackentry {
+	U64 hash; /* hz_pack_hash() of the name */
+	U64 content; /* hz_pack_hash() of the uncompressed bytes */
+	U64 offset; /* Of the payload, from the start of the file */
+	U64 stored_size; /* Bytes in the file */
+	U64 size; /* Bytes once decompressed, the same as stored_size for uncompressed payloads */
+	U32 flags; /* HZ_PACK_* */
+	U32 name; /* Offset into the names */
+};
+
+struct hzpack {
+	struct hzfile file;
+	const struct hzpackheader *header;
+	const U32 *buckets;
+	const struct hzpackentry *entries;
+	const CHR *names;
+};
+
+/* 64-bit FNV-1a, for names and contents alike. */
+U64 hz_pack_hash(const X0 *data, size_t size);
+
+/* Maps the pack at `path` and checks it. Returns false (with a message on stderr) if it's missing or broken. */
+U1 hz_pack_mount(struct hzpack *p, const CHR *path);
+X0 hz_pack_unmount(struct hzpack *p);
+
+/* The entry called `name`, or NULL if there isn't one. */
+const struct hzpackentry *hz_pack_find(const struct hzpack *p, const CHR *name);
+const CHR *hz_pack_name(const struct hzpack *p, const struct hzpackentry *e);
+/* The payload as stored, inside the mapping: the asset itself unless e->flags has HZ_PACK_LZ. */
+const U8 *hz_pack_data(const struct hzpack *p, const struct hzpackentry *e);
+/* Copies or decompresses the asset into `out`, which takes e->size bytes. Returns false if the payload is corrupt. */
+U1 hz_pack_read(const struct hzpack *p, const struct hzpackentry *e, U8 *out);
+
+#endif
@@ -0,0 +1,484 @@
+#include "hz_png.h"
+#include <pthread.h>
+
+/* A growable byte buffer, used for both the deflate stream and the final PNG file. */
+struct hzbytes {
+	U8 *data;
+	size_t len;
+	size_t cap;
+	U1 failed; /* Set if an allocation ever failed, so callers only need to check once at the end */
+};
+
+static X0 bytes_reserve(struct hzbytes *b, size_t extra)
+{
+	if (b->failed || b->len + extra <= b->cap) return;
+
+	size_t ncap = b->cap ? b->cap : 4096;
+	while (ncap < b->len + extra) ncap *= 2;
+
+	U8 *ndata = realloc(b->data, ncap);
+	if (!ndata) {
+		b->failed = true;
+		return;
+	}
+	b->data = ndata;
+	b->cap = ncap;
+}
+
+static X0 bytes_put(struct hzbytes *b, const X0 *src, size_t len)
+{
+	if (!len) return;
+	bytes_reserve(b, len);
+	if (b->failed) return;
+	memcpy(b->data + b->len, src, len);
+	b->len += len;
+}
+
+static X0 bytes_put_be32(struct hzbytes *b, U32 v)
+{
+	U8 tmp[4] = { v >> 24, v >> 16, v >> 8, v };
+	bytes_put(b, tmp, 4);
+}
+
+static U32 crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static X0 build_crc_table()
+{
+	for (U32 n = 0; n < 256; n++) {
+		U32 c = n;
+		for (INAT k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+		crc_table[n] = c;
+	}
+}
+
+U32 hz_crc32(U32 crc, const U8 *data, size_t len)
+{
+	pthread_once(&crc_once, build_crc_table);
+
+	crc = ~crc;
+	for (size_t i = 0; i < len; i++) crc = crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static U32 adler32(const U8 *data, size_t len)
+{
+	U32 a = 1, b = 0;
+	while (len) {
+		/* 5552 is the largest block that can't overflow b before the modulo */
+		size_t block = len < 5552 ? len : 5552;
+		len -= block;
+		while (block--) {
+			a += *data++;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return (b << 16) | a;
+}
+
+/* Deflate writes Huffman codes LSB-first, so we keep a 64-bit accumulator and flush whole bytes. */
+struct bitwriter {
+	struct hzbytes *out;
+	U64 acc;
+	INAT count;
+};
+
+static X0 bits_put(struct bitwriter *w, U32 value, INAT n)
+{
+	w->acc |= (U64)value << w->count;
+	w->count += n;
+	while (w->count >= 8) {
+		U8 byte = w->acc & 0xff;
+		bytes_put(w->out, &byte, 1);
+		w->acc >>= 8;
+		w->count -= 8;
+	}
+}
+
+static X0 bits_flush(struct bitwriter *w)
+{
+	if (w->count > 0) bits_put(w, 0, 8 - w->count);
+}
+
+static U32 bit_reverse(U32 code, INAT n)
+{
+	U32 r = 0;
+	while (n--) {
+		r = (r << 1) | (code & 1);
+		code >>= 1;
+	}
+	return r;
+}
+
+/* Literal/length symbols with the fixed Huffman table from RFC 1951 section 3.2.6 */
+static X0 put_litlen(struct bitwriter *w, INAT sym)
+{
+	if (sym <= 143)      bits_put(w, bit_reverse(0x30 + sym, 8), 8);
+	else if (sym <= 255) bits_put(w, bit_reverse(0x190 + sym - 144, 9), 9);
+	else if (sym <= 279) bits_put(w, bit_reverse(sym - 256, 7), 7);
+	else                 bits_put(w, bit_reverse(0xc0 + sym - 280, 8), 8);
+}
+
+static const U16 len_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const U8 len_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const U16 dist_base[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+	6145, 8193, 12289, 16385, 24577
+};
+static const U8 dist_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static X0 put_match(struct bitwriter *w, INAT len, INAT dist)
+{
+	INAT li = 28;
+	while (len_base[li] > len) li--;
+	put_litlen(w, 257 + li);
+	if (len_extra[li]) bits_put(w, len - len_base[li], len_extra[li]);
+
+	INAT di = 29;
+	while (dist_base[di] > dist) di--;
+	bits_put(w, bit_reverse(di, 5), 5);
+	if (dist_extra[di]) bits_put(w, dist - dist_base[di], dist_extra[di]);
+}
+
+#define HZ_DEFLATE_WINDOW 32768
+#define HZ_DEFLATE_HASH_BITS 15
+#define HZ_DEFLATE_MAX_MATCH 258
+
+static X0 deflate_stored(struct hzbytes *out, const U8 *data, size_t len)
+{
+	/* Stored blocks are at most 65535 bytes each. An empty input still needs one final block. */
+	do {
+		size_t block = len < 65535 ? len : 65535;
+		len -= block;
+		U8 hdr[5] = { len == 0, block & 0xff, block >> 8, ~block & 0xff, (~block >> 8) & 0xff };
+		bytes_put(out, hdr, 5);
+		bytes_put(out, data, block);
+		data += block;
+	} while (len);
+}
+
+static X0 deflate_fixed(struct hzbytes *out, const U8 *data, size_t len, INAT level)
+{
+	INAT *head = malloc(sizeof(INAT) << HZ_DEFLATE_HASH_BITS);
+	INAT *prev = malloc(sizeof(INAT) * HZ_DEFLATE_WINDOW);
+	if (!head || !prev) {
+		free(head);
+		free(prev);
+		deflate_stored(out, data, len);
+		return;
+	}
+	for (INAT i = 0; i < (1 << HZ_DEFLATE_HASH_BITS); i++) head[i] = -1;
+
+	/* Higher levels walk the hash chain for longer. Past ~128 links it's mostly wasted time on image data. */
+	INAT max_chain = level >= 9 ? 128 : level * 8;
+
+	struct bitwriter w = { out, 0, 0 };
+	bits_put(&w, 1, 1); /* BFINAL - everything goes in one block */
+	bits_put(&w, 1, 2); /* BTYPE = 01, fixed Huffman */
+
+	size_t i = 0;
+	while (i < len) {
+		INAT best_len = 0, best_dist = 0;
+
+		if (i + 3 <= len) {
+			U32 h = ((data[i] << 16) | (data[i + 1] << 8) | data[i + 2]) * 2654435761u >> (32 - HZ_DEFLATE_HASH_BITS);
+			INAT cand = head[h];
+			INAT chain = max_chain;
+			size_t limit = len - i < HZ_DEFLATE_MAX_MATCH ? len - i : HZ_DEFLATE_MAX_MATCH;
+
+			while (cand >= 0 && i - cand <= HZ_DEFLATE_WINDOW && chain--) {
+				const U8 *a = data + cand, *b = data + i;
+				if (a[best_len] == b[best_len]) {
+					INAT l = 0;
+					while ((size_t)l < limit && a[l] == b[l]) l++;
+					if (l > best_len) {
+						best_len = l;
+						best_dist = i - cand;
+						if ((size_t)l == limit) break;
+					}
+				}
+				cand = prev[cand % HZ_DEFLATE_WINDOW];
+			}
+
+			prev[i % HZ_DEFLATE_WINDOW] = head[h];
+			head[h] = i;
+		}
+
+		if (best_len >= 3) {
+			put_match(&w, best_len, best_dist);
+			/* Insert the skipped positions so later matches can still find them */
+			for (size_t j = i + 1; j < i + best_len && j + 3 <= len; j++) {
+				U32 h = ((data[j] << 16) | (data[j + 1] << 8) | data[j + 2]) * 2654435761u
+					>> (32 - HZ_DEFLATE_HASH_BITS);
+				prev[j % HZ_DEFLATE_WINDOW] = head[h];
+				head[h] = j;
+			}
+			i += best_len;
+		} else {
+			put_litlen(&w, data[i]);
+			i++;
+		}
+	}
+
+	put_litlen(&w, 256);
+	bits_flush(&w);
+
+	free(head);
+	free(prev);
+}
+
+U8 *hz_zlib_compress(const U8 *data, size_t len, INAT level, size_t *out_len)
+{
+	struct hzbytes out = { 0 };
+	U8 hdr[2] = { 0x78, 0x01 }; /* 32K window, deflate, no dictionary, "fastest" level hint */
+	bytes_put(&out, hdr, 2);
+
+	if (level <= 0) deflate_stored(&out, data, len);
+	else deflate_fixed(&out, data, len, level);
+
+	bytes_put_be32(&out, adler32(data, len));
+
+	if (out.failed) {
+		free(out.data);
+		return NULL;
+	}
+	*out_len = out.len;
+	return out.data;
+}
+
+static U8 paeth(INAT a, INAT b, INAT c)
+{
+	INAT p = a + b - c;
+	INAT pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	if (pa <= pb && pa <= pc) return a;
+	if (pb <= pc) return b;
+	return c;
+}
+
+/* Filters one row into `dst`, `prior` is the unfiltered previous row (or NULL for the first row). */
+static X0 filter_row(U8 *dst, const U8 *row, const U8 *prior, size_t len, INAT bpp, INAT filter)
+{
+	for (size_t i = 0; i < len; i++) {
+		INAT a = i >= (size_t)bpp ? row[i - bpp] : 0;
+		INAT b = prior ? prior[i] : 0;
+		INAT c = (prior && i >= (size_t)bpp) ? prior[i - bpp] : 0;
+		switch (filter) {
+		case HZ_PNG_FILTER_SUB:   dst[i] = row[i] - a; break;
+		case HZ_PNG_FILTER_UP:    dst[i] = row[i] - b; break;
+		case HZ_PNG_FILTER_AVG:   dst[i] = row[i] - ((a + b) >> 1); break;
+		case HZ_PNG_FILTER_PAETH: dst[i] = row[i] - paeth(a, b, c); break;
+		default:                  dst[i] = row[i]; break;
+		}
+	}
+}
+
+static X0 put_chunk(struct hzbytes *out, const CHR *type, const U8 *data, size_t len)
+{
+	bytes_put_be32(out, len);
+	size_t start = out->len;
+	bytes_put(out, type, 4);
+	bytes_put(out, data, len);
+	if (out->failed) return;
+	bytes_put_be32(out, hz_crc32(0, out->data + start, len + 4));
+}
+
+/* Adam7 passes: x origin, y origin, x step, y step */
+static const U8 adam7[7][4] = {
+	{ 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+};
+static const U8 no_interlace[1][4] = { { 0, 0, 1, 1 } };
+
+/* Replaces `comp` channel pixels with palette indices. Returns the number of palette entries (RGBA, alpha is 255 when
+ * the source has none), or 0 if the image uses more than 256 colours.
+ */
+static INAT palettize(U8 *dst, const U8 *src, INAT width, INAT comp, U8 *palette, INAT npal, U32 *hash)
+{
+	for (INAT x = 0; x < width; x++) {
+		const U8 *p = src + x * comp;
+		U8 rgba[4] = { p[0], p[comp > 2], p[comp > 2 ? 2 : 0], comp == 2 || comp == 4 ? p[comp - 1] : 255 };
+		U32 key = ((U32)rgba[0] << 24 | rgba[1] << 16 | rgba[2] << 8 | rgba[3]);
+
+		/* Open addressing over 1024 slots, each holding (colour, index + 1). Plenty for 256 colours. */
+		U32 slot = (key * 2654435761u) >> 22;
+		while (hash[slot * 2 + 1] && hash[slot * 2] != key) slot = (slot + 1) & 1023;
+		if (!hash[slot * 2 + 1]) {
+			if (npal == 256) return 0;
+			memcpy(palette + npal * 4, rgba, 4);
+			hash[slot * 2] = key;
+			hash[slot * 2 + 1] = ++npal;
+		}
+		dst[x] = hash[slot * 2 + 1] - 1;
+	}
+	return npal;
+}
+
+U8 *hz_png_encode(const U8 *pixels, INAT width, INAT height, INAT comp, INAT stride, U1 flip,
+	const struct hzpngopts *opts, size_t *out_len)
+{
+	static const U8 colour_types[5] = { 0, 0, 4, 2, 6 };
+	struct hzpngopts defaults = { HZ_PNG_FILTER_ADAPTIVE, 6, 8, false, false };
+
+	if (width <= 0 || height <= 0 || comp < 1 || comp > 4) return NULL;
+	if (!opts) opts = &defaults;
+
+	INAT depth = opts->bit_depth == 16 ? 16 : 8;
+	if (opts->palette && depth != 8) return NULL;
+	INAT bpp = opts->palette ? 1 : comp * depth / 8;
+	if (!stride) stride = width * comp * depth / 8;
+
+	/* First flatten everything into top-down rows of PNG samples: big-endian 16-bit values, or palette indices */
+	size_t row_len = (size_t)width * bpp;
+	U8 *img = malloc(row_len * height);
+	U32 *hash = opts->palette ? calloc(1024 * 2, sizeof(U32)) : NULL;
+	U8 palette[256 * 4];
+	INAT npal = 0;
+	if (!img || (opts->palette && !hash)) {
+		free(img);
+		free(hash);
+		return NULL;
+	}
+
+	for (INAT y = 0; y < height; y++) {
+		const U8 *src = pixels + (size_t)(flip ? height - 1 - y : y) * stride;
+		U8 *dst = img + y * row_len;
+		if (opts->palette) {
+			if (!(npal = palettize(dst, src, width, comp, palette, npal, hash))) {
+				free(img);
+				free(hash);
+				return NULL;
+			}
+		} else if (depth == 16) {
+			for (INAT i = 0; i < width * comp; i++) {
+				U16 v;
+				memcpy(&v, src + i * 2, 2);
+				dst[i * 2] = v >> 8;
+				dst[i * 2 + 1] = v & 0xff;
+			}
+		} else {
+			memcpy(dst, src, row_len);
+		}
+	}
+	free(hash);
+
+	/* Work out how big the filtered stream is, which depends on the size of each interlace pass */
+	const U8 (*passes)[4] = opts->interlace ? adam7 : no_interlace;
+	INAT npasses = opts->interlace ? 7 : 1;
+	size_t total = 0;
+	for (INAT p = 0; p < npasses; p++) {
+		size_t pw = (width - passes[p][0] + passes[p][2] - 1) / passes[p][2];
+		size_t ph = (height - passes[p][1] + passes[p][3] - 1) / passes[p][3];
+		if (width > passes[p][0] && height > passes[p][1]) total += ph * (pw * bpp + 1);
+	}
+
+	U8 *filtered = malloc(total);
+	U8 *cur = malloc(row_len), *prev = malloc(row_len), *scratch = malloc(row_len);
+	if (!filtered || !cur || !prev || !scratch) {
+		free(img);
+		free(filtered);
+		free(cur);
+		free(prev);
+		free(scratch);
+		return NULL;
+	}
+
+	U8 *dst = filtered;
+	for (INAT p = 0; p < npasses; p++) {
+		INAT x0 = passes[p][0], y0 = passes[p][1], dx = passes[p][2], dy = passes[p][3];
+		if (width <= x0 || height <= y0) continue;
+		size_t pass_len = (size_t)((width - x0 + dx - 1) / dx) * bpp;
+
+		for (INAT y = y0, row = 0; y < height; y += dy, row++) {
+			/* Gather this pass's pixels of the row. Without interlacing it's just a copy. */
+			const U8 *src = img + y * row_len;
+			for (INAT x = x0, i = 0; x < width; x += dx, i += bpp) memcpy(cur + i, src + x * bpp, bpp);
+
+			const U8 *prior = row > 0 ? prev : NULL;
+			INAT filter = opts->filter;
+			if (filter == HZ_PNG_FILTER_ADAPTIVE) {
+				/* Minimum sum of absolute differences (treating bytes as signed) - the heuristic libpng uses */
+				U64 best = ~0ull;
+				for (INAT f = 0; f < 5; f++) {
+					filter_row(scratch, cur, prior, pass_len, bpp, f);
+					U64 sum = 0;
+					for (size_t i = 0; i < pass_len; i++) sum += abs((I8)scratch[i]);
+					if (sum < best) {
+						best = sum;
+						filter = f;
+					}
+				}
+			}
+
+			*dst++ = filter;
+			filter_row(dst, cur, prior, pass_len, bpp, filter);
+			dst += pass_len;
+
+			U8 *t = prev;
+			prev = cur;
+			cur = t;
+		}
+	}
+	free(img);
+	free(cur);
+	free(prev);
+	free(scratch);
+
+	size_t zlen;
+	U8 *zdata = hz_zlib_compress(filtered, total, opts->level, &zlen);
+	free(filtered);
+	if (!zdata) return NULL;
+
+	struct hzbytes out = { 0 };
+	static const U8 signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	bytes_put(&out, signature, 8);
+
+	U8 ihdr[13] = {
+		width >> 24, width >> 16, width >> 8, width,
+		height >> 24, height >> 16, height >> 8, height,
+		depth, opts->palette ? 3 : colour_types[comp], 0, 0, opts->interlace
+	};
+	put_chunk(&out, "IHDR", ihdr, 13);
+
+	if (opts->palette) {
+		U8 plte[256 * 3], trns[256];
+		U1 has_alpha = false;
+		for (INAT i = 0; i < npal; i++) {
+			memcpy(plte + i * 3, palette + i * 4, 3);
+			trns[i] = palette[i * 4 + 3];
+			if (trns[i] != 255) has_alpha = true;
+		}
+		put_chunk(&out, "PLTE", plte, npal * 3);
+		if (has_alpha) put_chunk(&out, "tRNS", trns, npal);
+	}
+
+	put_chunk(&out, "IDAT", zdata, zlen);
+	put_chunk(&out, "IEND", NULL, 0);
+	free(zdata);
+
+	if (out.failed) {
+		free(out.data);
+		return NULL;
+	}
+	*out_len = out.len;
+	return out.data;
+}
+
+U1 hz_png_write(const CHR *path, const U8 *pixels, INAT width, INAT height, INAT comp, INAT stride, U1 flip)
+{
+	size_t len;
+	U8 *png = hz_png_encode(pixels, width, height, comp, stride, flip, NULL, &len);
+	if (!png) return false;
+
+	FILE *f = fopen(path, "wb");
+	U1 ok = f && fwrite(png, 1, len, f) == len;
+	if (f && fclose(f) != 0) ok = false;
+	free(png);
+	return ok;
+}
@@ -0,0 +1,42 @@
+#ifndef HZ_PNG_H
+#define HZ_PNG_H
+
+#include "holyh/src/holy.h"
+
+/* A tiny PNG writer. stb_image only reads images, so anything that needs to put pixels on disk (frame capture,
+ * golden images, cooked test corpora) goes through here instead. The deflate stream uses fixed Huffman codes
+ * with a greedy LZ77 matcher - it won't beat zlib, but it's small, it's ours, and it's fast enough.
+ */
+
+/* Filter selection. HZ_PNG_FILTER_ADAPTIVE picks a filter per row using the usual minimum-sum heuristic. */
+#define HZ_PNG_FILTER_NONE 0
+#define HZ_PNG_FILTER_SUB 1
+#define HZ_PNG_FILTER_UP 2
+#define HZ_PNG_FILTER_AVG 3
+#define HZ_PNG_FILTER_PAETH 4
+#define HZ_PNG_FILTER_ADAPTIVE -1
+
+struct hzpngopts {
+	INAT filter; /* One of the HZ_PNG_FILTER_* values */
+	INAT level; /* 0 = stored blocks (no compression at all), anything else = LZ77 + fixed Huffman */
+	INAT bit_depth; /* 8 (also what 0 means) or 16. For 16, `pixels` holds native-endian U16 samples. */
+	U1 palette; /* Write an indexed image. Encoding fails if the pixels use more than 256 distinct colours. */
+	U1 interlace; /* Adam7 */
+};
+
+/* Encodes `comp` channel (1-4) pixels to an in-memory PNG. `stride` is the distance in bytes between rows, pass 0
+ * for tightly packed rows. `opts` may be NULL for adaptive filtering of 8-bit, non-interlaced samples. If `flip` is
+ * set, the rows are written bottom-up, which is handy for pixels that came straight out of glReadPixels. Returns a
+ * malloc()'d buffer or NULL, and the length in `out_len`.
+ */
+U8 *hz_png_encode(const U8 *pixels, INAT width, INAT height, INAT comp, INAT stride, U1 flip,
+	const struct hzpngopts *opts, size_t *out_len);
+
+/* Same as hz_png_encode, but writes the result straight to a file. Returns true on success. */
+U1 hz_png_write(const CHR *path, const U8 *pixels, INAT width, INAT height, INAT comp, INAT stride, U1 flip);
+
+/* Raw zlib stream helpers, exposed so other writers don't have to grow their own. */
+U8 *hz_zlib_compress(const U8 *data, size_t len, INAT level, size_t *out_len);
+U32 hz_crc32(U32 crc, const U8 *data, size_t len);
+
+#endif
@@ -0,0 +1,207 @@
+#include "hz_sprite.h"
+#include "hz_gpumem.h"
+#include <GL/glew.h>
+#include <math.h>
+#include <stddef.h>
+
+static const CHR *vertex_source = "#version 330 core\n"
+	"layout (location = 0) in vec2 position;\n"
+	"layout (location = 1) in vec2 uv;\n"
+	"layout (location = 2) in vec4 color;\n"
+	"uniform vec2 screen;\n"
+	"out vec2 TexCoord;\n"
+	"out vec4 Color;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = vec4(position / screen * 2.0 - 1.0, 0.0, 1.0);\n"
+	"	TexCoord = uv;\n"
+	"	Color = color;\n"
+	"}\n";
+
+static const CHR *fragment_source = "#version 330 core\n"
+	"in vec2 TexCoord;\n"
+	"in vec4 Color;\n"
+	"out vec4 FragColor;\n"
+	"uniform sampler2D page;\n"
+	"void main()\n"
+	"{\n"
+	"	FragColor = texture(page, TexCoord) * Color;\n"
+	"}\n";
+
+static UNAT compile(GLenum type, const CHR *source)
+{
+	UNAT shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	GLint ok;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+	if (!ok) {
+		CHR log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		fprintf(stderr, "sprite: %s shader didn't compile: %s\n", type == GL_VERTEX_SHADER ? "vertex" : "fragment",
+			log);
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+U1 hz_sprite_init(struct hzspritebatch *b)
+{
+	memset(b, 0, sizeof(*b));
+
+	UNAT vs = compile(GL_VERTEX_SHADER, vertex_source), fs = compile(GL_FRAGMENT_SHADER, fragment_source);
+	if (vs && fs) {
+		b->program = glCreateProgram();
+		glAttachShader(b->program, vs);
+		glAttachShader(b->program, fs);
+		glLinkProgram(b->program);
+	}
+	if (vs) glDeleteShader(vs);
+	if (fs) glDeleteShader(fs);
+	if (!b->program) return false;
+
+	GLint ok;
+	glGetProgramiv(b->program, GL_LINK_STATUS, &ok);
+	if (!ok) {
+		CHR log[1024];
+		glGetProgramInfoLog(b->program, sizeof(log), NULL, log);
+		fprintf(stderr, "sprite: shaders didn't link: %s\n", log);
+		glDeleteProgram(b->program);
+		b->program = 0;
+		return false;
+	}
+	b->screen_uniform = glGetUniformLocation(b->program, "screen");
+
+	/* Every batch uses the same quad indices, glDrawElementsBaseVertex() moves them to where the batch starts */
+	U16 *indices = malloc(HZ_SPRITE_BATCH * 6 * sizeof(U16));
+	if (!indices) {
+		fprintf(stderr, "sprite: out of memory\n");
+		hz_sprite_destroy(b);
+		return false;
+	}
+	for (U32 i = 0; i < HZ_SPRITE_BATCH; i++) {
+		U16 v = i * 4;
+		U16 quad[6] = { v, v + 1, v + 2, v, v + 2, v + 3 };
+		memcpy(indices + i * 6, quad, sizeof(quad));
+	}
+
+	glGenVertexArrays(1, &b->vao);
+	glGenBuffers(1, &b->vbo);
+	glGenBuffers(1, &b->ebo);
+	glBindVertexArray(b->vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, b->ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, HZ_SPRITE_BATCH * 6 * sizeof(U16), indices, GL_STATIC_DRAW);
+	hz_gpumem_buffer(b->ebo, HZ_SPRITE_BATCH * 6 * sizeof(U16), "sprites");
+	free(indices);
+
+	glBindBuffer(GL_ARRAY_BUFFER, b->vbo);
+	glBufferData(GL_ARRAY_BUFFER, (size_t)HZ_SPRITE_RING * HZ_SPRITE_BATCH * 4 * sizeof(struct hzspritevertex), NULL,
+		GL_STREAM_DRAW);
+	hz_gpumem_buffer(b->vbo, (size_t)HZ_SPRITE_RING * HZ_SPRITE_BATCH * 4 * sizeof(struct hzspritevertex), "sprites");
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(struct hzspritevertex),
+		(X0*)offsetof(struct hzspritevertex, x));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(struct hzspritevertex),
+		(X0*)offsetof(struct hzspritevertex, u));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(struct hzspritevertex),
+		(X0*)offsetof(struct hzspritevertex, rgba));
+	glEnableVertexAttribArray(2);
+	return true;
+}
+
+X0 hz_sprite_begin(struct hzspritebatch *b, INAT width, INAT height)
+{
+	b->draws = 0;
+	b->sprites = 0;
+	glUseProgram(b->program);
+	glUniform2f(b->screen_uniform, width, height);
+	glBindVertexArray(b->vao);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+static X0 map_batch(struct hzspritebatch *b)
+{
+	const size_t batch = HZ_SPRITE_BATCH * 4 * sizeof(struct hzspritevertex);
+	GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
+
+	/* Nothing we've drawn from lives past `offset`, so writing there doesn't have to wait for the GPU */
+	if ((b->offset + HZ_SPRITE_BATCH * 4) * sizeof(struct hzspritevertex) > HZ_SPRITE_RING * batch) {
+		b->offset = 0;
+		access |= GL_MAP_INVALIDATE_BUFFER_BIT;
+	} else {
+		access |= GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, b->vbo);
+	b->mapped = glMapBufferRange(GL_ARRAY_BUFFER, b->offset * sizeof(struct hzspritevertex), batch, access);
+}
+
+static X0 flush(struct hzspritebatch *b)
+{
+	if (!b->mapped) return;
+	size_t size = (size_t)b->count * 4 * sizeof(struct hzspritevertex);
+	glBindBuffer(GL_ARRAY_BUFFER, b->vbo);
+	if (size) glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, size);
+	/* A lost buffer (mode switch and such) means garbage vertices, better to drop the batch */
+	U1 ok = glUnmapBuffer(GL_ARRAY_BUFFER);
+	b->mapped = NULL;
+
+	if (ok && b->count) {
+		glBindTexture(GL_TEXTURE_2D, b->texture);
+		glDrawElementsBaseVertex(GL_TRIANGLES, b->count * 6, GL_UNSIGNED_SHORT, (X0*)0, b->offset);
+		b->draws++;
+	}
+	b->offset += b->count * 4;
+	b->count = 0;
+}
+
+X0 hz_sprite_draw(struct hzspritebatch *b, const struct hzsprite *s, R32 x, R32 y, R32 scale, R32 angle, U32 rgba)
+{
+	if (b->mapped && (s->texture != b->texture || b->count == HZ_SPRITE_BATCH)) flush(b);
+	if (!b->mapped) {
+		map_batch(b);
+		if (!b->mapped) return;
+		b->texture = s->texture;
+	}
+
+	R32 hw = s->width * scale * 0.5f, hh = s->height * scale * 0.5f, c = cosf(angle), sn = sinf(angle);
+	const R32 corner[4][2] = { { -hw, -hh }, { hw, -hh }, { hw, hh }, { -hw, hh } };
+	const U16 uv[4][2] = { { s->u0, s->v0 }, { s->u1, s->v0 }, { s->u1, s->v1 }, { s->u0, s->v1 } };
+	struct hzspritevertex *v = b->mapped + b->count * 4;
+	for (INAT i = 0; i < 4; i++) {
+		v[i].x = x + corner[i][0] * c - corner[i][1] * sn;
+		v[i].y = y + corner[i][0] * sn + corner[i][1] * c;
+		v[i].u = uv[i][0];
+		v[i].v = uv[i][1];
+		v[i].rgba[0] = rgba >> 24;
+		v[i].rgba[1] = rgba >> 16;
+		v[i].rgba[2] = rgba >> 8;
+		v[i].rgba[3] = rgba;
+	}
+	b->count++;
+	b->sprites++;
+}
+
+X0 hz_sprite_end(struct hzspritebatch *b)
+{
+	flush(b);
+}
+
+X0 hz_sprite_destroy(struct hzspritebatch *b)
+{
+	if (b->mapped) {
+		glBindBuffer(GL_ARRAY_BUFFER, b->vbo);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	if (b->program) glDeleteProgram(b->program);
+	if (b->vao) glDeleteVertexArrays(1, &b->vao);
+	if (b->vbo) glDeleteBuffers(1, &b->vbo);
+	if (b->ebo) glDeleteBuffers(1, &b->ebo);
+	hz_gpumem_free(HZ_GPUMEM_BUFFER, b->vbo);
+	hz_gpumem_free(HZ_GPUMEM_BUFFER, b->ebo);
+	memset(b, 0, sizeof(*b));
+}
@@ -0,0 +1,52 @@
+#ifndef HZ_SPRITE_H
+#define HZ_SPRITE_H
+
+#include "holyh/src/holy.h"
+#include "hz_atlas.h"
+
+/* Batched 2D sprites. Every hz_sprite_draw() writes one quad (4 vertices of 16 bytes) straight into a mapped range
+ * of a single streaming vertex buffer, and the whole run goes out in one glDrawElementsBaseVertex() when the atlas
+ * page changes, the batch is full or the frame ends. Draw sprites grouped by page and it's one draw call per page.
+ *
+ * The buffer is a ring of HZ_SPRITE_RING batches, mapped unsynchronized: we only ever write past what earlier
+ * batches used, so the GPU can still be reading those. Once it wraps, the buffer is orphaned and the driver hands
+ * us fresh storage instead of stalling.
+ */
+
+#define HZ_SPRITE_BATCH 16384 /* Most sprites per draw call. 4 vertices each keeps the indices within 16 bits. */
+#define HZ_SPRITE_RING 8 /* Batches the vertex buffer holds before it's orphaned */
+
+struct hzspritevertex {
+	R32 x, y;
+	U16 u, v;
+	U8 rgba[4];
+};
+
+struct hzspritebatch {
+	UNAT vao, vbo, ebo, program;
+	INAT screen_uniform;
+	struct hzspritevertex *mapped; /* The range we're writing into, NULL between batches */
+	UNAT texture; /* Page the current batch samples */
+	U32 count; /* Sprites in the current batch */
+	size_t offset; /* Where in the buffer the current batch starts, in vertices */
+	U32 draws; /* Draw calls since hz_sprite_begin() */
+	U32 sprites; /* Sprites since hz_sprite_begin() */
+};
+
+/* Compiles the shader and creates the buffers. Needs a current GL 3.3 context. Returns false (with a message on
+ * stderr) if something didn't work out.
+ */
+U1 hz_sprite_init(struct hzspritebatch *b);
+/* Starts a frame. Positions are in pixels from the bottom left corner of a width x height viewport. Changes the
+ * current program, vertex array and blend state.
+ */
+X0 hz_sprite_begin(struct hzspritebatch *b, INAT width, INAT height);
+/* Queues sprite `s` centred on x, y, scaled by `scale`, rotated by `angle` radians anticlockwise and multiplied by
+ * `rgba` (0xRRGGBBAA).
+ */
+X0 hz_sprite_draw(struct hzspritebatch *b, const struct hzsprite *s, R32 x, R32 y, R32 scale, R32 angle, U32 rgba);
+/* Draws whatever's still queued. b->draws and b->sprites hold the totals for the frame afterwards. */
+X0 hz_sprite_end(struct hzspritebatch *b);
+X0 hz_sprite_destroy(struct hzspritebatch *b);
+
+#endif
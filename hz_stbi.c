@@ -0,0 +1,161 @@
+/* The one stb_image implementation everything in the tree links against. Include "stb_image.h" anywhere else for
+ * the declarations only, or "hz_stbi.h" for the arena loaders. (bench/ builds its own private copies on purpose, to
+ * compare SIMD and scalar builds.)
+ */
+#include "hz_stbi.h"
+#include "hz_file.h"
+#include "hz_jobs.h"
+#include <limits.h>
+#include <pthread.h>
+
+static X0 *hz_stbi_malloc(size_t size);
+static X0 *hz_stbi_realloc(X0 *p, size_t size);
+static X0 hz_stbi_free(X0 *p);
+
+#define STBI_MALLOC(sz) hz_stbi_malloc(sz)
+#define STBI_REALLOC(p, newsz) hz_stbi_realloc(p, newsz)
+#define STBI_FREE(p) hz_stbi_free(p)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+/* The arena grows to fit the biggest image a thread has decoded, but a one-off giant shouldn't pin that much memory
+ * forever
+ */
+#define ARENA_INITIAL (4 * 1024 * 1024)
+#define ARENA_KEEP (64 * 1024 * 1024)
+
+static pthread_once_t threads_once = PTHREAD_ONCE_INIT;
+static U1 threads_set;
+
+static _Thread_local struct hzarena arena;
+static _Thread_local U1 arena_on;
+static _Thread_local struct hzarenastats heap, last_decode;
+
+static X0 *hz_stbi_malloc(size_t size)
+{
+	if (arena_on) return hz_arena_alloc(&arena, size);
+	heap.allocs++;
+	heap.heap_allocs++;
+	heap.bytes += size;
+	return malloc(size);
+}
+
+static X0 *hz_stbi_realloc(X0 *p, size_t size)
+{
+	if (arena_on) return hz_arena_realloc(&arena, p, size);
+	heap.reallocs++;
+	heap.heap_allocs++;
+	heap.bytes += size;
+	return realloc(p, size);
+}
+
+static X0 hz_stbi_free(X0 *p)
+{
+	if (!p) return;
+	/* Arena memory is only ever handed out inside an _into call, and never leaves it */
+	if (arena_on) {
+		hz_arena_free(&arena, p);
+		return;
+	}
+	heap.frees++;
+	free(p);
+}
+
+static X0 run_jobs(X0 *user, stbi_job_func *fn, X0 *data, INAT count)
+{
+	(X0)user;
+	hz_jobs_run(fn, data, count);
+}
+
+X0 hz_stbi_set_threads(INAT threads)
+{
+	threads_set = true;
+	if (threads == 1) {
+		stbi_set_job_runner(NULL, NULL, 1);
+		return;
+	}
+	hz_jobs_init(threads);
+	stbi_set_job_runner(run_jobs, NULL, hz_jobs_threads());
+}
+
+static X0 default_threads()
+{
+	if (!threads_set) hz_stbi_set_threads(0);
+}
+
+static X0 arena_begin(struct hzarenastats *before)
+{
+	pthread_once(&threads_once, default_threads);
+	if (!arena.initial) hz_arena_init(&arena, ARENA_INITIAL, ARENA_KEEP);
+	*before = arena.stats;
+	arena.stats.peak = 0;
+	arena_on = true;
+}
+
+static X0 arena_end(const struct hzarenastats *before)
+{
+	arena_on = false;
+	hz_arena_reset(&arena);
+
+	const struct hzarenastats *s = &arena.stats;
+	last_decode = (struct hzarenastats){
+		.allocs = s->allocs - before->allocs,
+		.reallocs = s->reallocs - before->reallocs,
+		.frees = s->frees - before->frees,
+		.grown_in_place = s->grown_in_place - before->grown_in_place,
+		.heap_allocs = s->heap_allocs - before->heap_allocs,
+		.bytes = s->bytes - before->bytes,
+		.peak = s->peak,
+	};
+	/* The arena's own peak is per decode, keep the all-time one in `before` */
+	if (before->peak > arena.stats.peak) arena.stats.peak = before->peak;
+}
+
+U1 hz_stbi_load_into(const CHR *path, U8 *out, size_t out_size, INAT stride, INAT *x, INAT *y, INAT *comp,
+	INAT req_comp)
+{
+	struct hzfile f;
+	if (!hz_file_map(&f, path, HZ_FILE_SEQUENTIAL | HZ_FILE_WILLNEED_LARGE)) {
+		return stbi__err("can't fopen", "Unable to open file");
+	}
+	if (f.size > INT_MAX) {
+		hz_file_unmap(&f);
+		return stbi__err("too large", "File too large");
+	}
+
+	U1 ok = hz_stbi_load_from_memory_into(f.data, f.size, out, out_size, stride, x, y, comp, req_comp);
+	hz_file_unmap(&f);
+	return ok;
+}
+
+U1 hz_stbi_load_from_memory_into(const U8 *data, INAT len, U8 *out, size_t out_size, INAT stride, INAT *x, INAT *y,
+	INAT *comp, INAT req_comp)
+{
+	struct hzarenastats before;
+	arena_begin(&before);
+	U1 ok = stbi_load_from_memory_into(data, len, out, out_size, stride, x, y, comp, req_comp);
+	arena_end(&before);
+	return ok;
+}
+
+X0 hz_stbi_stats(struct hzarenastats *last, struct hzarenastats *total)
+{
+	if (last) *last = last_decode;
+	if (!total) return;
+
+	const struct hzarenastats *s = &arena.stats;
+	*total = (struct hzarenastats){
+		.allocs = s->allocs + heap.allocs,
+		.reallocs = s->reallocs + heap.reallocs,
+		.frees = s->frees + heap.frees,
+		.grown_in_place = s->grown_in_place,
+		.heap_allocs = s->heap_allocs + heap.heap_allocs,
+		.bytes = s->bytes + heap.bytes,
+		.peak = s->peak,
+	};
+}
+
+X0 hz_stbi_release()
+{
+	hz_arena_destroy(&arena);
+}
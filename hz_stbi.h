@@ -0,0 +1,44 @@
+#ifndef HZ_STBI_H
+#define HZ_STBI_H
+
+#include "holyh/src/holy.h"
+#include "hz_arena.h"
+
+/* stb_image with its allocations routed through us (STBI_MALLOC and friends, see hz_stbi.c).
+ *
+ * The *_into loaders below decode through a per-thread arena: every scratch buffer the decoder asks for (zlib
+ * output, JPEG component planes, the pre-conversion image, ...) is carved out of it, and the whole lot is dropped in
+ * one go once the image is in `out`. Nothing the decoder allocates can escape an _into call, which is what makes
+ * that safe. After the first couple of images a thread decodes, it stops calling malloc() altogether.
+ *
+ * Everything else (stbi_load() and co.) still goes to the C heap, since the caller owns and frees what those return.
+ * The allocations are counted either way.
+ */
+
+/* Same as stbi_load_into() / stbi_load_from_memory_into(), but through the arena. hz_stbi_load_into() also reads the
+ * file through a memory mapping (see hz_file.h) rather than stdio, so the decoder parses straight out of the page
+ * cache.
+ */
+U1 hz_stbi_load_into(const CHR *path, U8 *out, size_t out_size, INAT stride, INAT *x, INAT *y, INAT *comp,
+	INAT req_comp);
+U1 hz_stbi_load_from_memory_into(const U8 *data, INAT len, U8 *out, size_t out_size, INAT stride, INAT *x, INAT *y,
+	INAT *comp, INAT req_comp);
+
+/* Lets stb_image split big JPEG decodes over the shared job pool (hz_jobs.h), starting the pool if it isn't running.
+ * `threads` is passed on to hz_jobs_init(), 1 turns threaded decoding off again. If nobody calls this before the
+ * first hz_stbi_load_*into(), that does hz_stbi_set_threads(0): one thread per CPU.
+ */
+X0 hz_stbi_set_threads(INAT threads);
+
+/* Allocation counters for the calling thread: `last` covers the most recent hz_stbi_load_*into() call only, `total`
+ * everything stb_image did on this thread, heap allocations from plain stbi_load() included. Either may be NULL.
+ * heap_allocs counts the calls that actually reached malloc()/realloc().
+ */
+X0 hz_stbi_stats(struct hzarenastats *last, struct hzarenastats *total);
+
+/* Gives the calling thread's arena back to the heap. Call it before a decoding thread exits, a later decode on the
+ * same thread just sets up a new one.
+ */
+X0 hz_stbi_release();
+
+#endif
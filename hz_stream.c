@@ -0,0 +1,251 @@
+#include "hz_stream.h"
+#include "hz_gpumem.h"
+#include "hz_mip.h"
+#include "hz_stbi.h"
+#include "stb_image.h"
+#include <GL/glew.h>
+#include <limits.h>
+#include <math.h>
+
+X0 hz_stream_init(struct hzstreamer *s, size_t budget)
+{
+	memset(s, 0, sizeof(*s));
+	s->budget = budget;
+}
+
+/* Anything that isn't a KTX file gets decoded and mipmapped up front, the chain is what we stream from */
+static U1 load_chain(struct hzstreamtex *t, const CHR *path)
+{
+	INAT w, h, comp;
+	const struct hzfile *f = &t->file;
+	if (f->size > INT_MAX || !stbi_info_from_memory(f->data, f->size, &w, &h, &comp)) {
+		fprintf(stderr, "stream: unable to load %s: %s\n", path,
+			f->size > INT_MAX ? "File too large" : stbi_failure_reason());
+		return false;
+	}
+
+	U32 levels = hz_ktx_mip_count(w, h);
+	if (levels > HZ_KTX_MAX_LEVELS) levels = HZ_KTX_MAX_LEVELS;
+	t->pixels = malloc(hz_mip_chain_size(w, h, levels));
+	stbi_set_flip_vertically_on_load(1);
+	if (!t->pixels || !hz_stbi_load_from_memory_into(f->data, f->size, t->pixels, (size_t)w * h * 4, w * 4, &w, &h,
+		NULL, 4) || !hz_mip_chain(t->pixels, w, h, levels, 0)) {
+		fprintf(stderr, "stream: unable to load %s: %s\n", path, t->pixels ? stbi_failure_reason() : "Out of memory");
+		return false;
+	}
+
+	struct hzktx *k = &t->source;
+	k->gl_type = GL_UNSIGNED_BYTE;
+	k->gl_type_size = 1;
+	k->gl_format = GL_RGBA;
+	k->gl_internal_format = GL_RGBA8;
+	k->gl_base_internal_format = GL_RGBA;
+	k->width = w;
+	k->height = h;
+	k->levels = levels;
+	const U8 *level = t->pixels;
+	for (U32 i = 0, lw = w, lh = h; i < levels; i++) {
+		k->level_data[i] = level;
+		k->level_size[i] = lw * lh * 4;
+		level += k->level_size[i];
+		lw = hz_mip_next_size(lw);
+		lh = hz_mip_next_size(lh);
+	}
+	return true;
+}
+
+static U32 level_width(const struct hzstreamtex *t, U32 level)
+{
+	return t->source.width >> level ? t->source.width >> level : 1;
+}
+
+static U32 level_height(const struct hzstreamtex *t, U32 level)
+{
+	return t->source.height >> level ? t->source.height >> level : 1;
+}
+
+/* With `data` NULL and a size of 0x0, this is how a level's storage is given back */
+static X0 specify_level(const struct hzstreamtex *t, U32 level, U32 w, U32 h, const U8 *data, U32 size)
+{
+	const struct hzktx *k = &t->source;
+	if (k->gl_type) glTexImage2D(GL_TEXTURE_2D, level, k->gl_internal_format, w, h, 0, k->gl_format, k->gl_type, data);
+	else glCompressedTexImage2D(GL_TEXTURE_2D, level, k->gl_internal_format, w, h, 0, size, data);
+}
+
+static X0 upload_level(struct hzstreamer *s, struct hzstreamtex *t, U32 level)
+{
+	specify_level(t, level, level_width(t, level), level_height(t, level), t->source.level_data[level],
+		t->source.level_size[level]);
+	t->resident += t->source.level_size[level];
+	s->resident += t->source.level_size[level];
+	if (s->resident > s->stats.peak) s->stats.peak = s->resident;
+	s->stats.uploads++;
+}
+
+/* GL_TEXTURE_MIN_LOD counts from the base level, t->lod from level 0 */
+static X0 set_lod(const struct hzstreamtex *t)
+{
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, t->lod - t->base);
+}
+
+/* Clamps GL to the levels from t->base down, which are all there is storage for. Every change of t->base goes
+ * through here, so this is where hz_gpumem hears about it too.
+ */
+static X0 clamp_levels(struct hzstreamtex *t)
+{
+	if (t->lod < t->base) t->lod = t->base;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, t->base);
+	set_lod(t);
+	hz_gpumem_texture(t->texture, t->source.gl_internal_format, level_width(t, t->base), level_height(t, t->base), 1,
+		t->source.levels - t->base, "stream");
+}
+
+INAT hz_stream_add(struct hzstreamer *s, const CHR *path)
+{
+	struct hzstreamtex t = { 0 };
+	if (!hz_file_map(&t.file, path, HZ_FILE_WILLNEED_LARGE)) return -1;
+
+	/* KTX levels are used right out of the mapping, so that stays. A decoded image has no use for it. */
+	U1 ktx = hz_ktx_is_ktx(t.file.data, t.file.size);
+	U1 ok = ktx ? hz_ktx_parse(&t.source, t.file.data, t.file.size, path) : load_chain(&t, path);
+	if (!ktx) hz_file_unmap(&t.file);
+	struct hzstreamtex *tex = ok ? realloc(s->tex, (s->count + 1) * sizeof(*tex)) : NULL;
+	if (!tex) {
+		if (ok) fprintf(stderr, "stream: unable to load %s: Out of memory\n", path);
+		if (ktx) hz_file_unmap(&t.file);
+		free(t.pixels);
+		return -1;
+	}
+	s->tex = tex;
+
+	t.floor = t.source.levels - 1;
+	while (t.floor > 0 && level_width(&t, t.floor - 1) <= HZ_STREAM_MIN_SIZE
+		&& level_height(&t, t.floor - 1) <= HZ_STREAM_MIN_SIZE) t.floor--;
+	t.base = t.wanted = t.floor;
+	t.lod = t.floor;
+	t.last_used = s->frame;
+
+	glGenTextures(1, &t.texture);
+	glBindTexture(GL_TEXTURE_2D, t.texture);
+	for (U32 level = t.source.levels; level-- > t.floor;) upload_level(s, &t, level);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, t.source.levels - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	clamp_levels(&t);
+
+	s->tex[s->count] = t;
+	return s->count++;
+}
+
+UNAT hz_stream_texture(const struct hzstreamer *s, INAT index)
+{
+	return index >= 0 && (U32)index < s->count ? s->tex[index].texture : 0;
+}
+
+R32 hz_stream_screen_size(const R32 modelview[16], const R32 projection[16], R32 radius, INAT viewport_height)
+{
+	/* The model's origin in view space, and the biggest scale the model matrix applies */
+	R32 x = modelview[12], y = modelview[13], z = modelview[14], scale = 0.0f;
+	for (INAT c = 0; c < 3; c++) {
+		const R32 *col = modelview + c * 4;
+		R32 len = sqrtf(col[0] * col[0] + col[1] * col[1] + col[2] * col[2]);
+		if (len > scale) scale = len;
+	}
+
+	/* Clip space w is the depth the perspective divide uses (1 for orthographic) */
+	R32 w = projection[3] * x + projection[7] * y + projection[11] * z + projection[15];
+	if (w <= 1e-4f) return (R32)INT_MAX; /* Around or behind the eye, needs everything */
+	return radius * scale * projection[5] / w * viewport_height;
+}
+
+X0 hz_stream_request(struct hzstreamer *s, INAT index, R32 pixels)
+{
+	if (index < 0 || (U32)index >= s->count) return;
+	struct hzstreamtex *t = &s->tex[index];
+	U32 size = t->source.width > t->source.height ? t->source.width : t->source.height;
+
+	/* The coarsest level that still has at least as many texels as pixels across */
+	U32 level = t->source.levels - 1;
+	if (pixels >= 1.0f) {
+		R32 ratio = log2f(size / pixels);
+		level = ratio <= 0.0f ? 0 : (U32)ratio < level ? (U32)ratio : level;
+	}
+	if (t->last_used != s->frame || level < t->wanted) t->wanted = level;
+	t->last_used = s->frame;
+}
+
+static X0 drop_level(struct hzstreamer *s, struct hzstreamtex *t)
+{
+	U32 level = t->base++;
+	glBindTexture(GL_TEXTURE_2D, t->texture);
+	clamp_levels(t);
+	specify_level(t, level, 0, 0, NULL, 0);
+	t->resident -= t->source.level_size[level];
+	s->resident -= t->source.level_size[level];
+	s->stats.evictions++;
+}
+
+/* Evicts until `bytes` more fit in the budget, never touching `keep`. Returns false if it can't. */
+static U1 make_room(struct hzstreamer *s, size_t bytes, const struct hzstreamtex *keep)
+{
+	while (s->resident + bytes > s->budget) {
+		/* Least recently used first, then whoever has the most detail it didn't ask for */
+		struct hzstreamtex *victim = NULL;
+		for (U32 i = 0; i < s->count; i++) {
+			struct hzstreamtex *t = &s->tex[i];
+			if (t == keep || t->base >= t->floor) continue;
+			if (t->last_used == s->frame && t->base >= t->wanted) continue;
+			if (!victim || t->last_used < victim->last_used || (t->last_used == victim->last_used
+				&& (INAT)t->wanted - (INAT)t->base > (INAT)victim->wanted - (INAT)victim->base)) victim = t;
+		}
+		if (!victim) return false;
+		drop_level(s, victim);
+	}
+	return true;
+}
+
+X0 hz_stream_update(struct hzstreamer *s)
+{
+	size_t uploaded = 0;
+	for (U32 i = 0; i < s->count; i++) {
+		struct hzstreamtex *t = &s->tex[i];
+		if (t->last_used != s->frame || t->wanted >= t->base) continue;
+
+		/* One level at a time, and a whole level even if it blows this frame's upload budget on its own */
+		U32 level = t->base - 1;
+		size_t bytes = t->source.level_size[level];
+		if (uploaded && uploaded + bytes > HZ_STREAM_UPLOAD_BUDGET) continue;
+		if (!make_room(s, bytes, t)) continue;
+
+		glBindTexture(GL_TEXTURE_2D, t->texture);
+		upload_level(s, t, level);
+		t->base = level;
+		clamp_levels(t);
+		uploaded += bytes;
+	}
+
+	/* Blend newly arrived levels in rather than snapping to them */
+	for (U32 i = 0; i < s->count; i++) {
+		struct hzstreamtex *t = &s->tex[i];
+		if (t->lod <= t->base) continue;
+		t->lod = t->lod - HZ_STREAM_FADE > t->base ? t->lod - HZ_STREAM_FADE : t->base;
+		glBindTexture(GL_TEXTURE_2D, t->texture);
+		set_lod(t);
+	}
+
+	/* In case the budget shrank, or the textures' small levels alone are over it */
+	make_room(s, 0, NULL);
+	s->frame++;
+}
+
+X0 hz_stream_destroy(struct hzstreamer *s)
+{
+	for (U32 i = 0; i < s->count; i++) {
+		glDeleteTextures(1, &s->tex[i].texture);
+		hz_gpumem_free(HZ_GPUMEM_TEXTURE, s->tex[i].texture);
+		if (s->tex[i].file.data) hz_file_unmap(&s->tex[i].file);
+		free(s->tex[i].pixels);
+	}
+	free(s->tex);
+	memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,76 @@
+#ifndef HZ_STREAM_H
+#define HZ_STREAM_H
+
+#include "holyh/src/holy.h"
+#include "hz_file.h"
+#include "hz_ktx.h"
+
+/* Texture streaming: only the mip levels that are actually needed get to live in VRAM.
+ *
+ * Every texture starts out with just its small levels resident (HZ_STREAM_MIN_SIZE and below), which cost next to
+ * nothing. Each frame, the caller says how big each texture is on screen (hz_stream_screen_size() works that out from
+ * the matrices it's drawn with), and hz_stream_update() uploads the next finer level of whatever wants more detail,
+ * one level per texture per frame and HZ_STREAM_UPLOAD_BUDGET bytes per frame in total, so a burst of requests
+ * doesn't turn into a hitch. The levels GL may sample are clamped to the resident ones with GL_TEXTURE_BASE_LEVEL.
+ *
+ * When the resident levels add up to more than the VRAM budget, the finest level of the least recently requested
+ * texture is dropped (its storage respecified as 0x0) until they fit again. Textures that were used this frame only
+ * give up detail they didn't ask for.
+ *
+ * A new level doesn't pop in: GL_TEXTURE_MIN_LOD starts at the old level and eases down to the new one over a few
+ * frames, so trilinear filtering blends it in.
+ *
+ * Levels come straight out of a mapped KTX file (see hz_ktx.h), or, for any other image, out of a mip chain built on
+ * the CPU at load time (see hz_mip.h), which stays in RAM to be streamed from.
+ */
+
+#define HZ_STREAM_MIN_SIZE 64 /* Levels at most this wide and high are uploaded at load, and never evicted */
+#define HZ_STREAM_UPLOAD_BUDGET (4 * 1024 * 1024) /* Most bytes uploaded per hz_stream_update() */
+#define HZ_STREAM_FADE 0.125f /* GL_TEXTURE_MIN_LOD steps per frame while a new level blends in */
+
+struct hzstreamtex {
+	UNAT texture;
+	struct hzktx source; /* Every level, in RAM or in the mapping */
+	struct hzfile file; /* The mapping, for KTX sources */
+	U8 *pixels; /* The mip chain, for everything else */
+	U32 base; /* Finest level resident */
+	U32 floor; /* Coarsest level that's ever evicted, everything from here down stays */
+	U32 wanted; /* Finest level asked for since the last update */
+	R32 lod; /* GL_TEXTURE_MIN_LOD */
+	U64 last_used; /* Frame it was last asked for in */
+	size_t resident; /* Bytes of VRAM its resident levels take */
+};
+
+struct hzstreamstats {
+	U64 uploads; /* Levels uploaded, counting the ones uploaded at load */
+	U64 evictions; /* Levels dropped */
+	size_t peak; /* Most bytes resident at once */
+};
+
+struct hzstreamer {
+	struct hzstreamtex *tex;
+	U32 count;
+	size_t budget; /* Bytes of VRAM the resident levels may take */
+	size_t resident;
+	U64 frame;
+	struct hzstreamstats stats;
+};
+
+/* Sets up an empty streamer that keeps the resident levels within `budget` bytes. */
+X0 hz_stream_init(struct hzstreamer *s, size_t budget);
+/* Loads `path` for streaming. Returns its index, or -1 (with a message on stderr) if it couldn't be loaded. Leaves
+ * the texture bound to GL_TEXTURE_2D.
+ */
+INAT hz_stream_add(struct hzstreamer *s, const CHR *path);
+UNAT hz_stream_texture(const struct hzstreamer *s, INAT index);
+/* How many pixels tall an object of bounding radius `radius`, drawn with these (column major, cglm style) matrices,
+ * comes out in a viewport `viewport_height` pixels tall.
+ */
+R32 hz_stream_screen_size(const R32 modelview[16], const R32 projection[16], R32 radius, INAT viewport_height);
+/* Asks for texture `index` to be sharp at `pixels` pixels across. Call it for every texture drawn, every frame. */
+X0 hz_stream_request(struct hzstreamer *s, INAT index, R32 pixels);
+/* Uploads and evicts levels according to this frame's requests. Call it once a frame. */
+X0 hz_stream_update(struct hzstreamer *s);
+X0 hz_stream_destroy(struct hzstreamer *s);
+
+#endif
@@ -0,0 +1,168 @@
+#include "hz_texset.h"
+#include "hz_gpumem.h"
+#include "hz_file.h"
+#include "hz_stbi.h"
+#include "stb_image.h"
+#include <GL/glew.h>
+#include <limits.h>
+
+X0 hz_texset_init(struct hztexset *s, U1 allow_bindless)
+{
+	memset(s, 0, sizeof(*s));
+	/* The extension is written against GLSL 4.00, so its shaders can't be any older than that */
+	s->bindless = allow_bindless && GLEW_ARB_bindless_texture && GLEW_VERSION_4_0;
+}
+
+static X0 set_filtering(GLenum target)
+{
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+/* A texture's state is frozen once it has a handle, so it has to be complete, mipmaps and all, before we ask */
+static U1 add_bindless(struct hztexset *s, const U8 *rgba, U32 w, U32 h, struct hztexref *ref)
+{
+	UNAT *textures = realloc(s->texture, (s->textures + 1) * sizeof(*textures));
+	if (textures) s->texture = textures;
+	U64 *handles = realloc(s->handle, (s->textures + 1) * sizeof(*handles));
+	if (handles) s->handle = handles;
+	if (!textures || !handles) {
+		fprintf(stderr, "texset: out of memory\n");
+		return false;
+	}
+
+	UNAT tex;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	set_filtering(GL_TEXTURE_2D);
+
+	U64 handle = glGetTextureHandleARB(tex);
+	if (!handle) {
+		fprintf(stderr, "texset: no bindless handle for a %ux%u texture\n", w, h);
+		glDeleteTextures(1, &tex);
+		return false;
+	}
+	glMakeTextureHandleResidentARB(handle);
+	hz_gpumem_texture(tex, GL_RGBA8, w, h, 1, 0, "texset");
+
+	s->texture[s->textures] = tex;
+	s->handle[s->textures] = handle;
+	s->textures++;
+	ref->array = 0;
+	ref->layer = 0;
+	ref->handle = handle;
+	return true;
+}
+
+static struct hztexarray *find_array(struct hztexset *s, U32 w, U32 h, U32 *index)
+{
+	for (U32 i = 0; i < s->arrays; i++) {
+		if (s->array[i].width == w && s->array[i].height == h && s->array[i].layers < HZ_TEXSET_LAYERS) {
+			*index = i;
+			return &s->array[i];
+		}
+	}
+
+	struct hztexarray *arrays = realloc(s->array, (s->arrays + 1) * sizeof(*arrays));
+	if (!arrays) return NULL;
+	s->array = arrays;
+
+	/* The storage for every layer goes in now, so an array costs HZ_TEXSET_LAYERS textures of VRAM from the start */
+	struct hztexarray *a = &arrays[s->arrays];
+	memset(a, 0, sizeof(*a));
+	a->width = w;
+	a->height = h;
+	glGenTextures(1, &a->texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, a->texture);
+	for (U32 level = 0, lw = w, lh = h;; level++) {
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, lw, lh, HZ_TEXSET_LAYERS, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+			NULL);
+		if (lw == 1 && lh == 1) break;
+		lw = lw > 1 ? lw / 2 : 1;
+		lh = lh > 1 ? lh / 2 : 1;
+	}
+	set_filtering(GL_TEXTURE_2D_ARRAY);
+	hz_gpumem_texture(a->texture, GL_RGBA8, w, h, HZ_TEXSET_LAYERS, 0, "texset array");
+	*index = s->arrays++;
+	return a;
+}
+
+U1 hz_texset_add(struct hztexset *s, const U8 *rgba, U32 w, U32 h, struct hztexref *ref)
+{
+	if (s->bindless) return add_bindless(s, rgba, w, h, ref);
+
+	U32 index;
+	struct hztexarray *a = find_array(s, w, h, &index);
+	if (!a) {
+		fprintf(stderr, "texset: out of memory\n");
+		return false;
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, a->texture);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, a->layers, w, h, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	a->dirty = true;
+
+	ref->array = index;
+	ref->layer = a->layers++;
+	ref->handle = 0;
+	return true;
+}
+
+U1 hz_texset_add_file(struct hztexset *s, const CHR *path, struct hztexref *ref)
+{
+	INAT w, h, comp;
+	struct hzfile f;
+	if (!hz_file_map(&f, path, HZ_FILE_SEQUENTIAL)) return false;
+	if (f.size > INT_MAX || !stbi_info_from_memory(f.data, f.size, &w, &h, &comp)) {
+		fprintf(stderr, "texset: unable to load %s: %s\n", path,
+			f.size > INT_MAX ? "File too large" : stbi_failure_reason());
+		hz_file_unmap(&f);
+		return false;
+	}
+
+	U8 *pixels = malloc((size_t)w * h * 4);
+	stbi_set_flip_vertically_on_load(1);
+	U1 ok = pixels && hz_stbi_load_from_memory_into(f.data, f.size, pixels, (size_t)w * h * 4, w * 4, &w, &h, NULL, 4);
+	hz_file_unmap(&f);
+	if (!ok) fprintf(stderr, "texset: unable to load %s: %s\n", path, pixels ? stbi_failure_reason() : "Out of memory");
+	else ok = hz_texset_add(s, pixels, w, h, ref);
+	free(pixels);
+	return ok;
+}
+
+X0 hz_texset_finish(struct hztexset *s)
+{
+	for (U32 i = 0; i < s->arrays; i++) {
+		if (!s->array[i].dirty) continue;
+		glBindTexture(GL_TEXTURE_2D_ARRAY, s->array[i].texture);
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		s->array[i].dirty = false;
+	}
+}
+
+X0 hz_texset_bind(const struct hztexset *s, U32 array, U32 unit)
+{
+	if (s->bindless || array >= s->arrays) return;
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, s->array[array].texture);
+}
+
+X0 hz_texset_destroy(struct hztexset *s)
+{
+	for (U32 i = 0; i < s->textures; i++) {
+		glMakeTextureHandleNonResidentARB(s->handle[i]);
+		glDeleteTextures(1, &s->texture[i]);
+		hz_gpumem_free(HZ_GPUMEM_TEXTURE, s->texture[i]);
+	}
+	for (U32 i = 0; i < s->arrays; i++) {
+		glDeleteTextures(1, &s->array[i].texture);
+		hz_gpumem_free(HZ_GPUMEM_TEXTURE, s->array[i].texture);
+	}
+	free(s->texture);
+	free(s->handle);
+	free(s->array);
+	memset(s, 0, sizeof(*s));
+}
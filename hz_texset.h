@@ -0,0 +1,60 @@
+#ifndef HZ_TEXSET_H
+#define HZ_TEXSET_H
+
+#include "holyh/src/holy.h"
+
+/* A set of textures that instanced draws can pick from per instance, without a glBindTexture() in between.
+ *
+ * With ARB_bindless_texture (on GL 4.0 and up), every texture stays a plain GL_TEXTURE_2D, made resident up front,
+ * and an instance just carries its 64-bit handle: the shader turns that back into a sampler2D, so any mix of textures
+ * goes out in one draw.
+ *
+ * Without it, textures of the same size share a GL_TEXTURE_2D_ARRAY, one layer each, and an instance carries its
+ * layer. A draw call can only sample one array, so instances have to be drawn grouped by hztexref.array: one draw
+ * per distinct texture size instead of one per texture.
+ *
+ * Both ways, every texture gets mipmaps and trilinear filtering, and rows are bottom-up like hz_texture_load().
+ */
+
+#define HZ_TEXSET_LAYERS 64 /* Layers allocated for each array, they can't grow once they exist */
+
+struct hztexarray {
+	UNAT texture;
+	U32 width, height;
+	U32 layers; /* Used so far, out of HZ_TEXSET_LAYERS */
+	U1 dirty; /* Layers were added since the mipmaps were last built */
+};
+
+struct hztexset {
+	U1 bindless;
+	U32 arrays;
+	struct hztexarray *array;
+	U32 textures; /* Bindless mode: every texture, so they can be made non-resident again */
+	UNAT *texture;
+	U64 *handle;
+};
+
+/* Where a texture ended up. In bindless mode only `handle` means anything, otherwise only `array` and `layer` do. */
+struct hztexref {
+	U32 array;
+	U32 layer;
+	U64 handle;
+};
+
+/* Sets up an empty set, bindless if `allow_bindless` and GL is 4.0 or up with ARB_bindless_texture (so the shaders
+ * can be #version 400). Needs a current GL context.
+ */
+X0 hz_texset_init(struct hztexset *s, U1 allow_bindless);
+/* Adds a w x h image of tightly packed RGBA8, bottom row first. Changes the GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+ * binding. Returns false (with a message on stderr) if GL couldn't take it.
+ */
+U1 hz_texset_add(struct hztexset *s, const U8 *rgba, U32 w, U32 h, struct hztexref *ref);
+/* Loads an image file through hz_stbi and adds it. */
+U1 hz_texset_add_file(struct hztexset *s, const CHR *path, struct hztexref *ref);
+/* Builds the mipmaps of every array that changed. Call it once after adding textures, before drawing with them. */
+X0 hz_texset_finish(struct hztexset *s);
+/* Array mode: binds array `array` to texture unit `unit`. Does nothing in bindless mode. */
+X0 hz_texset_bind(const struct hztexset *s, U32 array, U32 unit);
+X0 hz_texset_destroy(struct hztexset *s);
+
+#endif
@@ -0,0 +1,282 @@
+#include "hz_texture.h"
+#include "hz_gpumem.h"
+#include "hz_bc.h"
+#include "hz_stbi.h"
+#include "hz_file.h"
+#include "hz_ktx.h"
+#include "hz_mip.h"
+#include "hz_pack.h"
+#include "stb_image.h"
+#include <GL/glew.h>
+#include <limits.h>
+
+/* --compress-textures, see hz_texture_init() */
+static struct {
+	U1 on;
+	U1 pick; /* No format given, choose per texture */
+	enum hzbcformat format;
+} compression;
+
+/* --pack, the asset pack hz_texture_load() looks in before the file system */
+static struct hzpack pack;
+
+/* --cpu-mipmaps, likewise */
+static struct {
+	U1 on;
+	UNAT flags; /* HZ_MIP_*, also used by the compressed path */
+} cpu_mips;
+
+static U1 bc_supported(enum hzbcformat format)
+{
+	return format == HZ_BC7 ? GLEW_ARB_texture_compression_bptc : GLEW_EXT_texture_compression_s3tc;
+}
+
+X0 hz_texture_init(INAT argc, CHR *argv[])
+{
+	for (INAT i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--compress-textures")) {
+			compression.on = compression.pick = true;
+		} else if (!strncmp(argv[i], "--compress-textures=", 20)) {
+			compression.on = hz_bc_parse(argv[i] + 20, &compression.format);
+			compression.pick = false;
+			if (!compression.on) fprintf(stderr, "texture: unknown compression format '%s'\n", argv[i] + 20);
+		} else if (!strncmp(argv[i], "--pack=", 7)) {
+			if (pack.file.data) hz_pack_unmount(&pack);
+			if (hz_pack_mount(&pack, argv[i] + 7)) printf("texture: loading from %s\n", argv[i] + 7);
+		} else if (!strcmp(argv[i], "--cpu-mipmaps")) {
+			cpu_mips.on = true;
+		} else if (!strcmp(argv[i], "--cpu-mipmaps=kaiser")) {
+			cpu_mips.on = true;
+			cpu_mips.flags |= HZ_MIP_KAISER;
+		}
+	}
+
+	if (compression.on && compression.pick && !bc_supported(HZ_BC7) && !bc_supported(HZ_BC1)) {
+		fprintf(stderr, "texture: GL supports neither S3TC nor BPTC, textures stay uncompressed\n");
+		compression.on = false;
+	} else if (compression.on && !compression.pick && !bc_supported(compression.format)) {
+		fprintf(stderr, "texture: GL doesn't support %s, textures stay uncompressed\n",
+			hz_bc_name(compression.format));
+		compression.on = false;
+	}
+}
+
+/* Decodes to RGBA8, builds the mips and block compresses every level on the CPU. Slower to load than uploading the
+ * pixels as they are, but the texture takes a quarter (or an eighth) of the VRAM.
+ */
+static UNAT load_compressed(const struct hzfile *f, const CHR *path, INAT w, INAT h, INAT comp)
+{
+	enum hzbcformat format = compression.format;
+	if (compression.pick) format = bc_supported(HZ_BC7) ? HZ_BC7 : comp == 2 || comp == 4 ? HZ_BC3 : HZ_BC1;
+
+	U32 levels = hz_ktx_mip_count(w, h);
+	size_t size = hz_mip_chain_size(w, h, levels), compressed = hz_bc_size(format, w, h);
+	U8 *pixels = malloc(size), *blocks = malloc(compressed);
+	stbi_set_flip_vertically_on_load(1);
+	if (!pixels || !blocks || !hz_stbi_load_from_memory_into(f->data, f->size, pixels, (size_t)w * h * 4, w * 4, &w,
+		&h, NULL, 4)) {
+		fprintf(stderr, "texture: unable to load %s: %s\n", path, pixels && blocks ? stbi_failure_reason() :
+			"Out of memory");
+		free(pixels);
+		free(blocks);
+		return 0;
+	}
+	if (!hz_mip_chain(pixels, w, h, levels, cpu_mips.flags)) {
+		fprintf(stderr, "texture: unable to load %s: Out of memory\n", path);
+		free(pixels);
+		free(blocks);
+		return 0;
+	}
+
+	/* The first level is the biggest, so its buffer fits every other level too */
+	UNAT tex;
+	R64 psnr = 0.0;
+	size_t total = 0;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	const U8 *level = pixels;
+	for (U32 i = 0, lw = w, lh = h; i < levels; i++) {
+		size_t level_size = hz_bc_size(format, lw, lh);
+		hz_bc_compress(format, level, lw, lh, blocks);
+		if (!i) psnr = hz_bc_psnr(format, level, lw, lh, blocks);
+		glCompressedTexImage2D(GL_TEXTURE_2D, i, hz_bc_gl_format(format, false), lw, lh, 0, level_size, blocks);
+		total += level_size;
+		level += (size_t)lw * lh * 4;
+		lw = hz_mip_next_size(lw);
+		lh = hz_mip_next_size(lh);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	hz_gpumem_texture(tex, hz_bc_gl_format(format, false), w, h, 1, levels, path);
+	free(pixels);
+	free(blocks);
+
+	printf("texture: %s as %s, %zu KiB of VRAM instead of %zu KiB (%.1fx less), PSNR %.2f dB\n", path,
+		hz_bc_name(format), total / 1024, size / 1024, (R64)size / total, psnr);
+	return tex;
+}
+
+/* Decodes to RGBA8 and builds the mips on the CPU, in linear light and spread over the job pool, then uploads every
+ * level as it is. Costs a heap copy of the chain instead of the PBO, but doesn't depend on the driver's filter.
+ */
+static UNAT load_mipmapped(const struct hzfile *f, const CHR *path, INAT w, INAT h)
+{
+	U32 levels = hz_ktx_mip_count(w, h);
+	U8 *pixels = malloc(hz_mip_chain_size(w, h, levels));
+	stbi_set_flip_vertically_on_load(1);
+	if (!pixels || !hz_stbi_load_from_memory_into(f->data, f->size, pixels, (size_t)w * h * 4, w * 4, &w, &h, NULL,
+		4) || !hz_mip_chain(pixels, w, h, levels, cpu_mips.flags)) {
+		fprintf(stderr, "texture: unable to load %s: %s\n", path, pixels ? stbi_failure_reason() : "Out of memory");
+		free(pixels);
+		return 0;
+	}
+
+	UNAT tex;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	const U8 *level = pixels;
+	for (U32 i = 0, lw = w, lh = h; i < levels; i++) {
+		glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, lw, lh, 0, GL_RGBA, GL_UNSIGNED_BYTE, level);
+		level += (size_t)lw * lh * 4;
+		lw = hz_mip_next_size(lw);
+		lh = hz_mip_next_size(lh);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	hz_gpumem_texture(tex, GL_RGBA8, w, h, 1, levels, path);
+	free(pixels);
+	return tex;
+}
+
+/* Cooked textures need no decoding, every level goes from the mapping straight to GL */
+static UNAT load_ktx(const struct hzfile *f, const CHR *path, INAT *width, INAT *height)
+{
+	struct hzktx k;
+	if (!hz_ktx_parse(&k, f->data, f->size, path)) return 0;
+
+	hz_gpumem_upload_begin();
+
+	UNAT tex;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	for (U32 i = 0; i < k.levels; i++) {
+		INAT w = k.width >> i ? k.width >> i : 1, h = k.height >> i ? k.height >> i : 1;
+		if (k.gl_type) {
+			glTexImage2D(GL_TEXTURE_2D, i, k.gl_internal_format, w, h, 0, k.gl_format, k.gl_type, k.level_data[i]);
+		} else {
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, k.gl_internal_format, w, h, 0, k.level_size[i],
+				k.level_data[i]);
+		}
+	}
+
+	/* A chain that stops short of 1x1 is still complete, as long as GL knows where it stops. An uncompressed file
+	 * with just the one level gets its mipmaps the old way, drivers can't be relied on to generate compressed ones.
+	 */
+	if (k.levels == 1 && k.gl_type) glGenerateMipmap(GL_TEXTURE_2D);
+	else glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, k.levels - 1);
+
+	UNAT err = hz_gpumem_upload_end();
+	if (err != GL_NO_ERROR) {
+		fprintf(stderr, "texture: unable to upload %s: GL error 0x%x (format 0x%x not supported?)\n", path, err,
+			k.gl_internal_format);
+		glDeleteTextures(1, &tex);
+		return 0;
+	}
+	hz_gpumem_texture(tex, k.gl_internal_format, k.width, k.height, 1, k.levels == 1 && k.gl_type ? 0 : k.levels,
+		path);
+
+	if (width) *width = k.width;
+	if (height) *height = k.height;
+	return tex;
+}
+
+/* Everything but the KTX path, for an image file that's somewhere in memory: mapped on its own, or in the pack */
+static UNAT load_image(const struct hzfile *f, const CHR *path, INAT *width, INAT *height)
+{
+	static const GLenum formats[] = { 0, GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	INAT w, h, comp;
+
+	if (hz_ktx_is_ktx(f->data, f->size)) return load_ktx(f, path, width, height);
+	if (f->size > INT_MAX || !stbi_info_from_memory(f->data, f->size, &w, &h, &comp) || comp < 1 || comp > 4) {
+		fprintf(stderr, "texture: unable to load %s: %s\n", path,
+			f->size > INT_MAX ? "File too large" : stbi_failure_reason());
+		return 0;
+	}
+	if (compression.on || cpu_mips.on) {
+		UNAT tex = compression.on ? load_compressed(f, path, w, h, comp) : load_mipmapped(f, path, w, h);
+		if (tex && width) *width = w;
+		if (tex && height) *height = h;
+		return tex;
+	}
+
+	/* GL_UNPACK_ALIGNMENT defaults to 4, so pad the rows out to that instead of fiddling with pixel store state */
+	INAT stride = (w * comp + 3) & ~3;
+	size_t size = (size_t)stride * h;
+
+	UNAT pbo, tex = 0;
+	glGenBuffers(1, &pbo);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	hz_gpumem_buffer(pbo, size, "texture upload");
+	U8 *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+	stbi_set_flip_vertically_on_load(1);
+	U1 ok = dst && hz_stbi_load_from_memory_into(f->data, f->size, dst, size, stride, &w, &h, NULL, comp);
+	if (!dst) fprintf(stderr, "texture: unable to map a %zu byte upload buffer for %s\n", size, path);
+	else if (!ok) fprintf(stderr, "texture: unable to load %s: %s\n", path, stbi_failure_reason());
+
+	/* An unmap can fail if the buffer got trashed behind our back (mode switch and such), in which case the
+	 * contents are undefined and we just give up.
+	 */
+	if (dst && !glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) && ok) {
+		fprintf(stderr, "texture: upload buffer for %s was lost\n", path);
+		ok = false;
+	}
+
+	if (ok) {
+		glGenTextures(1, &tex);
+		glBindTexture(GL_TEXTURE_2D, tex);
+		glTexImage2D(GL_TEXTURE_2D, 0, formats[comp], w, h, 0, formats[comp], GL_UNSIGNED_BYTE, (X0*)0);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		hz_gpumem_texture(tex, formats[comp], w, h, 1, 0, path);
+		if (width) *width = w;
+		if (height) *height = h;
+	}
+
+	/* GL holds on to the storage until the upload is done, deleting the name now is fine */
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers(1, &pbo);
+	hz_gpumem_free(HZ_GPUMEM_BUFFER, pbo);
+	return tex;
+}
+
+/* Assets stored as is are used right where they sit in the pack's mapping, only compressed ones need a buffer */
+static UNAT load_packed(const struct hzpackentry *e, const CHR *path, INAT *width, INAT *height)
+{
+	if (!(e->flags & HZ_PACK_LZ)) {
+		struct hzfile f = { hz_pack_data(&pack, e), e->size };
+		return load_image(&f, path, width, height);
+	}
+
+	U8 *data = malloc(e->size ? e->size : 1);
+	if (!data || !hz_pack_read(&pack, e, data)) {
+		fprintf(stderr, "texture: unable to load %s: %s\n", path, data ? "Corrupt asset pack" : "Out of memory");
+		free(data);
+		return 0;
+	}
+	struct hzfile f = { data, e->size };
+	UNAT tex = load_image(&f, path, width, height);
+	free(data);
+	return tex;
+}
+
+UNAT hz_texture_load(const CHR *path, INAT *width, INAT *height)
+{
+	const struct hzpackentry *e = pack.file.data ? hz_pack_find(&pack, path) : NULL;
+	if (e) return load_packed(e, path, width, height);
+
+	/* Map the file once, both the header peek and the decode read it straight from the page cache */
+	struct hzfile f;
+	if (!hz_file_map(&f, path, HZ_FILE_SEQUENTIAL | HZ_FILE_WILLNEED_LARGE)) return 0;
+	UNAT tex = load_image(&f, path, width, height);
+	hz_file_unmap(&f);
+	return tex;
+}
@@ -0,0 +1,37 @@
+#ifndef HZ_TEXTURE_H
+#define HZ_TEXTURE_H
+
+#include "holyh/src/holy.h"
+
+/* Texture loading. Images are decoded straight into a mapped GL_PIXEL_UNPACK_BUFFER with stbi_load_into(), so the
+ * CPU writes every pixel exactly once: no stbi_load() result, no format conversion copy, no separate flip pass, and
+ * the driver can DMA the upload from the PBO. The decoder's own scratch memory comes from hz_stbi's per-thread arena.
+ */
+
+/* Loads `path` into a new GL_TEXTURE_2D with mipmaps, in whatever channel count the file has (GL_RED, GL_RG, GL_RGB
+ * or GL_RGBA). Rows are flipped to GL's bottom-up order, which turns on stbi_set_flip_vertically_on_load() for
+ * everyone else too. Leaves the texture bound to GL_TEXTURE_2D and returns its name, or 0 on failure (the reason is
+ * printed). `width` and `height` may be NULL.
+ *
+ * KTX files (see hz_ktx.h, and tools/hz_texcook.c for making them) are recognised by their contents, whatever they're
+ * called. Those skip all of the above: every level in the file goes straight from the mapping to glTexImage2D() or
+ * glCompressedTexImage2D(), in whatever format it was cooked to. Only an uncompressed single level file gets
+ * glGenerateMipmap().
+ */
+UNAT hz_texture_load(const CHR *path, INAT *width, INAT *height);
+
+/* Parses the texture options out of argv. Needs a current GL context, to see which formats it supports.
+ *   --compress-textures       Block compress images on the CPU as they're loaded (see hz_bc.h): BC7 if GL has it,
+ *                             otherwise BC1, or BC3 for images with alpha. The mips are built on the CPU and every
+ *                             level is compressed, then the VRAM saved and the PSNR get printed. KTX files are
+ *                             uploaded as they are.
+ *   --compress-textures=FMT   The same, with FMT (bc1, bc3 or bc7) for everything.
+ *   --cpu-mipmaps             Build the mips on the CPU with hz_mip.h instead of glGenerateMipmap(), and upload every
+ *                             level as RGBA8. Slower to load, but the filtering is the same on every driver.
+ *   --cpu-mipmaps=kaiser      The same, with the Kaiser filter. Also applies to --compress-textures.
+ *   --pack=PATH               Mount the asset pack at PATH (see hz_pack.h). hz_texture_load() looks every path up
+ *                             in it first, and only goes to the file system for what isn't there.
+ */
+X0 hz_texture_init(INAT argc, CHR *argv[]);
+
+#endif
@@ -0,0 +1,515 @@
+#include "holyh/src/holy.h"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_error.h>
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/glu.h>
+#include <cglm/cglm.h>
+#include <cglm/struct.h>
+#include "hz_capture.h"
+#include "hz_frame.h"
+#include "hz_gpumem.h"
+#include "hz_texset.h"
+#include <math.h>
+#include <stddef.h>
+
+/* A grid of CROWD x CROWD cubes */
+#define CROWD 32
+/* Generated textures on top of puckface.png, half at its size and half smaller, so the array path gets two arrays */
+#define PATTERNS 15
+
+/* What each cube gets on top of the shared cube mesh, see the attributes set up in main() */
+struct crowdinstance {
+	R32 offset[3];
+	R32 phase;
+	U32 layer;
+	U32 handle[2];
+};
+
+/* This struct contains all of the properties for a window - borrowed from HAZE. */
+struct hzwinprop {
+	SDL_Window *window; /* The SDL window. Pain in the ass to access, so we just have a reference here */
+	SDL_GLContext glcontext; /* The GL context. We don't use this much, but it's good to have a ref to it. */
+	U32 winflags; /* The flags we gave the window. */
+	INAT width; /* The window width and height. They're useful things to know. */
+	INAT height;
+	U1 quit; /* is the window in a quitting state? (e.g did the user click close) */
+	U1 fullscreen; /* Is the window fullscreen or not? Not used here, but used in HAZE. */
+};
+
+/* We create a global declaration of a window struct to use elsewhere in the program. This is our primary window. */
+struct hzwinprop primarywin;
+
+/* This is a cleanup step, which destroys the primary SDL window and quits SDL. */
+X0 cleanup()
+{
+	if(SDL_WasInit(SDL_INIT_VIDEO)) {
+		/* Basically just exits fullscreen if it was enabled and frees the mouse if it was grabbed. */
+		SDL_ShowCursor(SDL_TRUE);
+		SDL_SetRelativeMouseMode(SDL_FALSE);
+		if(primarywin.window) SDL_SetWindowGrab(primarywin.window, SDL_FALSE);
+		#ifdef __APPLE__
+		if(primarywin.window) SDL_SetWindowFullscreen(screen, 0);
+		#endif
+
+		/* Destroy the primary window */
+		if(primarywin.window) SDL_DestroyWindow(primarywin.window);
+	}
+
+	/* Quit SDL (Does not quit the whole program, just presumably gets SDL to clean up) */
+	SDL_Quit();
+}
+
+/* This function prints an error to both the terminal and an SDL window. Can be called at any point.
+ * Arguments are the same as printf();
+ */
+X0 errwindow(const CHR *s, ...)
+{
+	#ifndef HZ_MAX_ERROR_LENGTH
+	#define HZ_MAX_ERROR_LENGTH 4096
+	#endif
+
+	/* We create a buffer to store the final error message in, with a maximum length of 4096 characters.
+	 * That's just over 2 whole Discord messages worth of error!
+	 */
+	CHR buffer[HZ_MAX_ERROR_LENGTH];
+
+	/* This stuff is just fancy variadic argument stuff. 
+	 * See... uh.. this, maybe? https://www.thegeekstuff.com/2017/05/c-variadic-functions/
+	 */
+	va_list args;
+	va_start(args, s);
+
+	/* This uses the vsnprintf function to replicate printf's functionality without actually printing anything.
+	 * If vsnprintf failed for some reason, it will return a number below 0. If it does, we create a new error.
+	 */
+	if (vsnprintf(buffer, HZ_MAX_ERROR_LENGTH, s, args) < 0)
+		strcpy(buffer,
+			"errwindow() was unable to format the fatal exception message while handling an exception.\0");
+	/* We then print the fully formatted error to the stderr output.
+	 * This is just in case the user is unable to read the SDL error window.
+	 */
+	fprintf(stderr, "FATAL ERROR: %s\n", buffer);
+
+	/* Call the global cleanup function to ensure everything is.. well, clean. */
+	cleanup();
+
+	/* Show an SDL message box in case the user cannot read the terminal.
+	 * ShowSimpleMessageBox will work even after you've called SDL_Quit or before you've called SDL_Init.
+	 * It's especially designed for situations like this.
+	 */
+	SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Fatal Exception", buffer, NULL);
+	
+	va_end(args);
+
+	/* Return the failure exit code and terminate (code 1 (failure), aka not 0, which is success) */
+	exit(EXIT_FAILURE);
+}
+
+/* Stripes, rings or checks in a couple of colours, anything so the cubes don't all look the same */
+static X0 make_pattern(U8 *rgba, U32 size, U32 seed)
+{
+	const U8 colors[6][3] = { { 230, 60, 50 }, { 250, 200, 40 }, { 60, 170, 90 }, { 50, 120, 220 },
+		{ 150, 70, 200 }, { 240, 240, 240 } };
+	const U8 *a = colors[seed % 6], *b = colors[(seed / 6 + seed + 1) % 6];
+	U32 cell = size / (4 + seed % 5);
+	for (U32 y = 0; y < size; y++) {
+		for (U32 x = 0; x < size; x++) {
+			INAT dx = x - size / 2, dy = y - size / 2;
+			U32 pick = seed % 3 == 0 ? (x + y) / cell : seed % 3 == 1 ? (U32)sqrtf(dx * dx + dy * dy) / cell :
+				x / cell + y / cell;
+			memcpy(rgba + ((size_t)y * size + x) * 4, pick & 1 ? a : b, 3);
+			rgba[((size_t)y * size + x) * 4 + 3] = 255;
+		}
+	}
+}
+
+static INAT by_array(const X0 *a, const X0 *b)
+{
+	const U32 *ga = a, *gb = b;
+	return (*ga > *gb) - (*ga < *gb);
+}
+
+/* The main function. This is always the function that is automatically called first, so this
+ * is our engine's "entrypoint"
+ */
+INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments, argv is the array of arguments */
+{
+	/* Initialize SDL. If this fails, we can probably determine that the user does not have a
+	 * [supported] graphical backend. */
+	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+		/* This might look stupid, but keep in mind that errwindow() does a printf() as a fallback too */
+		errwindow("Unable to initialize video!\n SDL Error: %s", SDL_GetError());
+	}
+
+	/* Set the window flags and OpenGL version
+	 * This tells SDL what features we want. 
+	 * SDL_WINDOW_OPENGL - Tells SDL we want to use OpenGL in our window
+	 * SDL_WINDOW_REISIZABLE - Tells SDL we want the user to be able to resize the window at will
+	 * SDL_WINDOW_SHOWN - Tells SDL we want the window to be visible on launch
+	 * Full list of flags: https://wiki.libsdl.org/SDL_WindowFlags
+	 */
+	primarywin.winflags = SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN;
+
+	/* Tell SDL we want to use OpenGL major version 3 minor version 3 (OpenGL 3.3), with the core profile
+	 * See the bottom of this template for a link to a place you can learn about what that means.
+	 * There are some big differences between OpenGL 3.3 and previous versions.
+	 * We need to do this before we create the window or the GL context.
+	 */
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+	/* Finally, actually create the window. We give it a title, a starting position, a width, a height, and our
+	 * previously defined flags. If the window cannot be created, we display the error SDL gave us.
+	 */
+	if (!(primarywin.window = SDL_CreateWindow(
+		"OpenGL 3.3 + SDL Template",
+		SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+		640, 480,
+		primarywin.winflags)))
+		errwindow("Unable to create the primary window!\n SDL Error: %s", SDL_GetError());
+
+	/* Create the OpenGL context. If this fails, the user cannot use OpenGL [probably]. Still, we print the SDL
+	 * error too just in case.
+	 *
+	 * Since OpenGL is one big state machine, you need a context to be able to keep track of all the states.
+	 * This context is bound to our primary window. When the user looks at the window, they'll be looking at the
+	 * OpenGL context we created here.
+	 */
+	if (!(primarywin.glcontext = SDL_GL_CreateContext(primarywin.window)))
+		errwindow("Unable to create GL context! Does your device support OpenGL?\n"
+			"Are you sure you're using the very latest versions of your graphics drivers?\n"
+			"You might be able to resolve this by using Mesa software rendering.\n\n"
+			"SDL Error: %s", SDL_GetError());
+
+	/* Initialize GLEW */
+	glewExperimental = GL_TRUE;
+	GLenum glewError = glewInit();
+	if(glewError != GLEW_OK) errwindow("Error initializing GLEW! %s\n", glewGetErrorString(glewError));
+
+	/* This makes our buffer swap syncronized with the monitor's vertical refresh. In other words, V-Sync.
+	 * You'll see this in action a bit later.
+	 */
+	SDL_GL_SetSwapInterval(1);
+
+	/* Frame capture and fixed frame counts, if they were asked for on the command line. See hz_capture.h */
+	hz_capture_init(argc, argv);
+	/* --gpumem and --gpumem-budget, see hz_gpumem.h */
+	hz_gpumem_init(argc, argv);
+	
+	/* --no-bindless forces the texture array path, to compare the two on hardware that has both */
+	U1 allow_bindless = true;
+	for (INAT i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--no-bindless")) allow_bindless = false;
+	}
+	struct hztexset texset;
+	hz_texset_init(&texset, allow_bindless);
+
+	/* the shaders. the vertex shader spins every cube on its own, so the instances need no matrices */
+	const CHR *vertex_shader_source = "#version 330 core\n"
+		"layout (location = 0) in vec3 aPos;\n"
+		"layout (location = 1) in vec2 aTexCoord;\n"
+		"layout (location = 2) in vec4 aOffset;\n"
+		"layout (location = 3) in uint aLayer;\n"
+		"layout (location = 4) in uvec2 aHandle;\n"
+		"out vec2 TexCoord;\n"
+		"flat out uint Layer;\n"
+		"flat out uvec2 Handle;\n"
+		"uniform mat4 view;\n"
+		"uniform mat4 projection;\n"
+		"uniform float theta;\n"
+		"void main()\n"
+		"{\n"
+		"	float t = theta + aOffset.w, c = cos(t), s = sin(t);\n"
+		"	vec3 p = vec3(c * aPos.x + s * aPos.z, aPos.y, -s * aPos.x + c * aPos.z);\n"
+		"	p = vec3(c * p.x - s * p.y, s * p.x + c * p.y, p.z);\n"
+		"	gl_Position = projection * view * vec4(p * 0.6 + aOffset.xyz, 1.0f);\n"
+		"	TexCoord = aTexCoord;\n"
+		"	Layer = aLayer;\n"
+		"	Handle = aHandle;\n"
+		"}\0";
+	const CHR *array_fragment_source = "#version 330 core\n"
+		"out vec4 FragColor;\n"
+		"in vec2 TexCoord;\n"
+		"flat in uint Layer;\n"
+		"flat in uvec2 Handle;\n"
+		"uniform sampler2DArray textures;\n"
+		"void main()\n"
+		"{\n"
+		"	FragColor = texture(textures, vec3(TexCoord, Layer));\n"
+		"}\0";
+	/* ARB_bindless_texture needs GLSL 4.00, hz_texset only goes bindless when GL is 4.0 or up */
+	const CHR *bindless_fragment_source = "#version 400 core\n"
+		"#extension GL_ARB_bindless_texture : require\n"
+		"out vec4 FragColor;\n"
+		"in vec2 TexCoord;\n"
+		"flat in uint Layer;\n"
+		"flat in uvec2 Handle;\n"
+		"void main()\n"
+		"{\n"
+		"	FragColor = texture(sampler2D(Handle), TexCoord);\n"
+		"}\0";
+	const CHR *fragment_shader_source = texset.bindless ? bindless_fragment_source : array_fragment_source;
+
+	UNAT vertex_shader;
+	vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertex_shader, 1, &vertex_shader_source, NULL);
+	glCompileShader(vertex_shader);
+
+	UNAT fragment_shader;
+	fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragment_shader, 1, &fragment_shader_source, NULL);
+	glCompileShader(fragment_shader);
+
+	GLint vs_success;
+	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &vs_success);
+	if (!vs_success) errwindow("vertex_shader didn't compile.");
+
+	GLint fs_success;
+	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &fs_success);
+	if (!fs_success) errwindow("fragment_shader didn't compile.");
+
+	UNAT shader_program;
+	shader_program = glCreateProgram();
+	glAttachShader(shader_program, vertex_shader);
+	glAttachShader(shader_program, fragment_shader);
+	glLinkProgram(shader_program);
+
+	GLint sp_success;
+	glGetProgramiv(shader_program, GL_LINK_STATUS, &sp_success);
+	if (!sp_success) errwindow("shaders didn't link.");
+
+	glEnable(GL_DEPTH_TEST);
+
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+
+	/* the same cube as puck_cube */
+	RNAT vertices[] = {
+		-0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+		 0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+		-0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+
+		-0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		-0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		-0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+
+		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		-0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
+		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f
+	};
+
+	/* the textures: the puck and a pile of patterns, in two sizes */
+	struct hztexref refs[PATTERNS + 1];
+	if (!hz_texset_add_file(&texset, "assets/puckface.png", &refs[0])) {
+		errwindow("Unable to load assets/puckface.png! Check the terminal output for details.");
+	}
+	U8 *pattern = malloc(512 * 512 * 4);
+	if (!pattern) errwindow("Out of memory!");
+	for (U32 i = 1; i <= PATTERNS; i++) {
+		U32 size = i <= PATTERNS / 2 ? 512 : 256;
+		make_pattern(pattern, size, i);
+		if (!hz_texset_add(&texset, pattern, size, size, &refs[i])) {
+			errwindow("Unable to create the textures! Check the terminal output for details.");
+		}
+	}
+	free(pattern);
+	hz_texset_finish(&texset);
+
+	/* the crowd. each instance is tagged with its array first, so sorting groups them for the array path */
+	struct { U32 array; struct crowdinstance instance; } crowd[CROWD * CROWD];
+	for (U32 i = 0; i < CROWD * CROWD; i++) {
+		const struct hztexref *ref = &refs[(i * 7 + i / CROWD) % (PATTERNS + 1)];
+		crowd[i].array = ref->array;
+		crowd[i].instance = (struct crowdinstance){
+			.offset = { (R32)(i % CROWD) - (CROWD - 1) * 0.5f, (R32)(i / CROWD) - (CROWD - 1) * 0.5f, 0.0f },
+			.phase = i * 0.37f,
+			.layer = ref->layer,
+			.handle = { (U32)ref->handle, (U32)(ref->handle >> 32) },
+		};
+	}
+	qsort(crowd, CROWD * CROWD, sizeof(crowd[0]), by_array);
+
+	struct crowdinstance instances[CROWD * CROWD];
+	U32 group_start[PATTERNS + 2] = { 0 }, groups = 0;
+	for (U32 i = 0; i < CROWD * CROWD; i++) {
+		instances[i] = crowd[i].instance;
+		if (i && crowd[i].array != crowd[i - 1].array) group_start[++groups] = i;
+	}
+	group_start[++groups] = CROWD * CROWD;
+	/* bindless doesn't care which array anything is in, it's all one draw */
+	if (texset.bindless) {
+		group_start[1] = CROWD * CROWD;
+		groups = 1;
+	}
+
+	/* declare vertex buffers, and vertex array */
+	UNAT VBO, instance_VBO, VAO;
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &instance_VBO);
+	glGenVertexArrays(1, &VAO);
+
+	/* bind them */
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	hz_gpumem_buffer(VBO, sizeof(vertices), "cube");
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(RNAT), (X0*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(RNAT), (X0*)(3 * sizeof(RNAT)));
+	glEnableVertexAttribArray(1);
+
+	/* the per instance attributes, which advance once per cube instead of once per vertex */
+	glBindBuffer(GL_ARRAY_BUFFER, instance_VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(instances), instances, GL_STATIC_DRAW);
+	hz_gpumem_buffer(instance_VBO, sizeof(instances), "instances");
+	for (UNAT attrib = 2; attrib <= 4; attrib++) {
+		glEnableVertexAttribArray(attrib);
+		glVertexAttribDivisor(attrib, 1);
+	}
+
+	glUseProgram(shader_program);
+	glUniform1i(glGetUniformLocation(shader_program, "textures"), 0);
+	printf("crowd: %u cubes, %u textures, %s: %u draw call%s a frame\n", CROWD * CROWD, PATTERNS + 1,
+		texset.bindless ? "bindless" : "texture arrays", groups, groups == 1 ? "" : "s");
+
+	while (!primarywin.quit) {
+		/* Poll SDL for events. If SDL has no events for us to collect, continue rendering instead. */
+		SDL_Event Event;
+		while (SDL_PollEvent(&Event)) {
+			/* Check the event type. This could be many things, e.g a mouse movement or a key press. */
+			switch (Event.type) {
+			/* This event is triggered when SDL thinks we need to quit, e.g when you
+			 * click the close button on the window */
+			case SDL_QUIT:
+				/* If we do need to quit, we set that as a window property, so next time we're about
+				 * to re-enter the main loop, it simply decides not to loop again.
+				 * Hence this condition: `while (!primarywin.quit) {`
+				 */
+				primarywin.quit = true;
+				break;
+			default:
+				/* If the event is anything else, we simply ignore it.
+				 * You can implement your own events above this. Here's the full list:
+				 * https://wiki.libsdl.org/SDL_EventType
+				 */
+				break;
+			}
+		}
+
+		/* Check if the window size has changed and record it in the primarywin properties for use elsewhere
+		 * (Not strictly neccessary in this template, but it's used in HAZE)
+		 */
+		SDL_GetWindowSize(primarywin.window, &primarywin.width, &primarywin.height);
+
+		/* Specifies clear values for the colour buffers. We want the whole colour buffer to be magenta, so
+		 * we set the colour buffer's clear value to magenta.
+		 */
+		glClearColor(0.f, 0.f, 0.f, 1.f);
+
+		/* Then we clear the colour buffer, making everything magenta. */
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		
+		/* cube */
+		glUseProgram(shader_program);
+
+		static RNAT theta = 0.0f;
+		theta += 0.02;
+
+		mat4 view_matrix = {
+			1, 0, 0, 0,
+			0, 1, 0, 0,
+			0, 0, 1, 0,
+			0, 0, 0, 1
+		};
+		mat4 proj_matrix;
+		glm_translate_z(view_matrix, -40.0f);
+		glm_perspective(0.7854f, 1.3333f, 0.100f, 100.0f, proj_matrix);
+		glUniformMatrix4fv(glGetUniformLocation(shader_program, "view"), 1, GL_FALSE, (RNAT*)view_matrix);
+		glUniformMatrix4fv(glGetUniformLocation(shader_program, "projection"), 1, GL_FALSE, (RNAT*)proj_matrix);
+		glUniform1f(glGetUniformLocation(shader_program, "theta"), theta);
+
+		/* One draw per group. GL 3.3 has no base instance, so the instance attributes are pointed at the group. */
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, instance_VBO);
+		for (U32 g = 0; g < groups; g++) {
+			size_t start = group_start[g] * sizeof(struct crowdinstance);
+			hz_texset_bind(&texset, crowd[group_start[g]].array, 0);
+			glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(struct crowdinstance), (X0*)start);
+			glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(struct crowdinstance),
+				(X0*)(start + offsetof(struct crowdinstance, layer)));
+			glVertexAttribIPointer(4, 2, GL_UNSIGNED_INT, sizeof(struct crowdinstance),
+				(X0*)(start + offsetof(struct crowdinstance, handle)));
+			glDrawArraysInstanced(GL_TRIANGLES, 0, 36, group_start[g + 1] - group_start[g]);
+		}
+
+		/* Queue a readback of this frame if we're capturing. It has to happen before the swap. */
+		hz_capture_frame(primarywin.window);
+		if (hz_capture_done()) primarywin.quit = true;
+
+		/* Swap our buffer to display the current contents of buffer on screen.
+		 * Since we set SDL_GL_SetSwapInterval(1), this will use the monitor's refresh rate.
+		 */
+		SDL_GL_SwapWindow(primarywin.window);
+		hz_frame_end();
+	}
+
+	/* Dump GPU memory before the capture buffers go, so they're in it */
+	U1 within_budget = hz_gpumem_shutdown();
+	/* Flush out any frames still being read back. A capture that silently lost frames is worse than no capture. */
+	if (!hz_capture_shutdown()) errwindow("Frame capture failed! Check the terminal output for details.");
+	if (!within_budget) errwindow("Went over the GPU memory budget! Check the terminal output for details.");
+
+	hz_texset_destroy(&texset);
+
+	/* Gives the frame arenas back and reports the most a frame needed */
+	hz_frame_shutdown();
+
+	/* Cleanup before exit, just in case. */
+	cleanup();
+
+	/* Nothing bad happened (we think), so return the success code and bugger off. */
+	return EXIT_SUCCESS;
+}
+
+/* You can learn more things about SDL2 here: https://wiki.libsdl.org/FrontPage 
+ * And I think you might be able to get some knowledge about OpenGL here: https://learnopengl.com/
+ * That guy uses GLFW, GLAD and a bunch of other weird things. We're using SDL2, so you should just ignore all of that,
+ * SDL2 does it all for us. The only things you need to look at are the OpenGL function calls, in other words, the
+ * things beginning with `gl`.
+ *
+ * See if you can complete the Hello Triangle task (https://learnopengl.com/Getting-started/Hello-Triangle) using this
+ * template, by adding code just before `while (!primarywin.quit) {` and replacing the `glClearColor`/`glClear` bits.
+ * Those should be the only sections you need to change - just before the main loop, and just inside the main loop.
+ */
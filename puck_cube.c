@@ -6,8 +6,14 @@
 #include <GL/glu.h>
 #include <cglm/cglm.h>
 #include <cglm/struct.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include <math.h>
+#include "hz_capture.h"
+#include "hz_frame.h"
+#include "hz_gpumem.h"
+#include "hz_lod.h"
+#include "hz_meshfile.h"
+#include "hz_stream.h"
+#include "hz_texture.h"
 
 /* This struct contains all of the properties for a window - borrowed from HAZE. */
 struct hzwinprop {
@@ -151,6 +157,13 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 	 * You'll see this in action a bit later.
 	 */
 	SDL_GL_SetSwapInterval(1);
+
+	/* Frame capture and fixed frame counts, if they were asked for on the command line. See hz_capture.h */
+	hz_capture_init(argc, argv);
+	/* --gpumem and --gpumem-budget, see hz_gpumem.h */
+	hz_gpumem_init(argc, argv);
+	/* --compress-textures, see hz_texture.h */
+	hz_texture_init(argc, argv);
 	
 	/* the shaders */
 	/* i think this is dumb. how do i include a shader as a separate file? */
@@ -275,6 +288,7 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 	glBindVertexArray(VAO);
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	hz_gpumem_buffer(VBO, sizeof(vertices), "cube");
 	
 	/* vertex position attrib */
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(RNAT), (X0*)0);
@@ -283,21 +297,47 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(RNAT), (X0*)(3 * sizeof(RNAT)));
 	glEnableVertexAttribArray(1);
 	
+	/* --mesh=PATH draws a cooked mesh (see hz_meshfile.h) instead of the cube above, at whichever of its LODs suits
+	 * the distance. Its attributes land on the same locations, so the shaders don't care which it is.
+	 */
+	struct hzmeshgpu mesh = { 0 };
+	for (INAT i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--mesh=", 7)) continue;
+		if (mesh.vao) hz_meshfile_unload(&mesh);
+		if (!hz_meshfile_load(&mesh, argv[i] + 7)) {
+			errwindow("Unable to load %s! Check the terminal output for details.", argv[i] + 7);
+		}
+	}
+
+	/* --stream[=KiB] streams the texture's mips in and out under that VRAM budget (see hz_stream.h), and sends the
+	 * cube off into the distance and back so there's something to stream. The last one given wins.
+	 */
+	struct hzstreamer streamer;
+	INAT streamed = -1;
+	U1 stream = false;
+	size_t stream_budget = 0;
+	for (INAT i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--stream")) stream_budget = 64 * 1024 * 1024;
+		else if (!strncmp(argv[i], "--stream=", 9)) stream_budget = (size_t)atoi(argv[i] + 9) * 1024;
+		else continue;
+		stream = true;
+	}
+	if (stream) {
+		hz_stream_init(&streamer, stream_budget);
+		streamed = hz_stream_add(&streamer, "assets/puckface.png");
+		if (streamed < 0) errwindow("Unable to load assets/puckface.png! Check the terminal output for details.");
+	}
+
 	/* load da tex */
-	INAT tex_width, tex_height, nr_channels;
-	stbi_set_flip_vertically_on_load(1);
-	U8 *tex_data = stbi_load("assets/puckface.png", &tex_width, &tex_height, &nr_channels, 0);
-	UNAT puck_texture;
-	glGenTextures(1, &puck_texture);
-	glBindTexture(GL_TEXTURE_2D, puck_texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tex_width, tex_height, 0, GL_RGB, GL_UNSIGNED_BYTE, tex_data);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	stbi_image_free(tex_data);
+	UNAT puck_texture = streamed >= 0 ? hz_stream_texture(&streamer, streamed)
+		: hz_texture_load("assets/puckface.png", NULL, NULL);
+	if (!puck_texture) errwindow("Unable to load assets/puckface.png! Check the terminal output for details.");
 	
-	/* texture wrap + scale behavior */
+	/* texture wrap + scale behavior. streamed levels blend in, which takes trilinear filtering */
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, streamed >= 0 ? GL_LINEAR_MIPMAP_LINEAR :
+		GL_LINEAR_MIPMAP_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	
 	while (!primarywin.quit) {
@@ -368,7 +408,7 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 		
 		glm_rotate_y(model_matrix, theta, model_matrix);
 		glm_rotate_z(model_matrix, theta, model_matrix);
-		glm_translate_z(view_matrix, -3.0f);
+		glm_translate_z(view_matrix, streamed >= 0 ? -3.0f - 12.0f * (1.0f - cosf(theta * 0.25f)) : -3.0f);
 		glm_perspective(0.7854f, 1.3333f, 0.100f, 100.0f, proj_matrix);
 		
 		/* pass matrices to vertex shader */
@@ -376,19 +416,72 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 		model_loc = glGetUniformLocation(shader_program, "model");
 		view_loc = glGetUniformLocation(shader_program, "view");
 		proj_loc = glGetUniformLocation(shader_program, "projection");
-		glUniformMatrix4fv(model_loc, 1, GL_FALSE, (RNAT*)model_matrix);
 		glUniformMatrix4fv(view_loc, 1, GL_FALSE, (RNAT*)view_matrix);
 		glUniformMatrix4fv(proj_loc, 1, GL_FALSE, (RNAT*)proj_matrix);
 		
-		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
+		if (mesh.vao) {
+			/* the cooked mesh's positions are quantised, its dequantisation goes in front of the model matrix.
+			 * copied, cglm wants its matrices aligned.
+			 */
+			mat4 dequantize, mesh_matrix;
+			memcpy(dequantize, mesh.dequantize, sizeof(dequantize));
+			glm_mat4_mul(model_matrix, dequantize, mesh_matrix);
+			glUniformMatrix4fv(model_loc, 1, GL_FALSE, (RNAT*)mesh_matrix);
+
+			/* the coarsest of its LODs that's no more than a pixel out at this distance (see hz_lod.h) */
+			static U32 lod = 0;
+			mat4 modelview;
+			R32 error[HZ_MESHFILE_MAX_LODS];
+			for (U32 l = 0; l < mesh.lods; l++) error[l] = mesh.lod[l].error;
+			glm_mat4_mul(view_matrix, model_matrix, modelview);
+			lod = hz_lod_select(error, mesh.lods, hz_lod_pixels_per_unit((R32*)modelview, (R32*)proj_matrix,
+				primarywin.height), HZ_LOD_PIXELS, lod);
+			glBindVertexArray(mesh.vao);
+			glDrawElements(GL_TRIANGLES, mesh.lod[lod].index_count, mesh.index_type,
+				(X0*)((size_t)mesh.lod[lod].first_index * mesh.index_size));
+		} else {
+			glUniformMatrix4fv(model_loc, 1, GL_FALSE, (RNAT*)model_matrix);
+			glBindVertexArray(VAO);
+			glDrawArrays(GL_TRIANGLES, 0, 36);
+		}
+
+		/* ask for the detail the cube needs at this distance, it shows up from the next frame on */
+		if (streamed >= 0) {
+			mat4 modelview_matrix;
+			glm_mat4_mul(view_matrix, model_matrix, modelview_matrix);
+			hz_stream_request(&streamer, streamed, hz_stream_screen_size((R32*)modelview_matrix,
+				(R32*)proj_matrix, 0.866f, primarywin.height));
+			hz_stream_update(&streamer);
+		}
 		
+		/* Queue a readback of this frame if we're capturing. It has to happen before the swap. */
+		hz_capture_frame(primarywin.window);
+		if (hz_capture_done()) primarywin.quit = true;
+
 		/* Swap our buffer to display the current contents of buffer on screen.
 		 * Since we set SDL_GL_SetSwapInterval(1), this will use the monitor's refresh rate.
 		 */
 		SDL_GL_SwapWindow(primarywin.window);
+		hz_frame_end();
 	}
 
+	/* Dump GPU memory before the capture buffers go, so they're in it */
+	U1 within_budget = hz_gpumem_shutdown();
+	/* Flush out any frames still being read back. A capture that silently lost frames is worse than no capture. */
+	if (!hz_capture_shutdown()) errwindow("Frame capture failed! Check the terminal output for details.");
+	if (!within_budget) errwindow("Went over the GPU memory budget! Check the terminal output for details.");
+
+	if (mesh.vao) hz_meshfile_unload(&mesh);
+	if (streamed >= 0) {
+		printf("stream: %llu uploads, %llu evictions, peak %zu KiB resident\n",
+			(unsigned long long)streamer.stats.uploads, (unsigned long long)streamer.stats.evictions,
+			streamer.stats.peak / 1024);
+		hz_stream_destroy(&streamer);
+	}
+
+	/* Gives the frame arenas back and reports the most a frame needed */
+	hz_frame_shutdown();
+
 	/* Cleanup before exit, just in case. */
 	cleanup();
 
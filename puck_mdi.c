@@ -0,0 +1,512 @@
+#include "holyh/src/holy.h"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_error.h>
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/glu.h>
+#include <cglm/cglm.h>
+#include <cglm/struct.h>
+#include "hz_capture.h"
+#include "hz_frame.h"
+#include "hz_gpumem.h"
+#include "hz_meshpool.h"
+#include <math.h>
+
+/* A grid of FIELD x FIELD objects, each one of the MESHES shapes built below */
+#define FIELD 64
+#define MESHES 5
+
+struct mdivertex {
+	R32 pos[3];
+	R32 normal[3];
+};
+
+/* Room for the biggest of the shapes */
+struct builder {
+	struct mdivertex v[1024];
+	U32 index[4096];
+	U32 vertices, indices;
+};
+
+/* This struct contains all of the properties for a window - borrowed from HAZE. */
+struct hzwinprop {
+	SDL_Window *window; /* The SDL window. Pain in the ass to access, so we just have a reference here */
+	SDL_GLContext glcontext; /* The GL context. We don't use this much, but it's good to have a ref to it. */
+	U32 winflags; /* The flags we gave the window. */
+	INAT width; /* The window width and height. They're useful things to know. */
+	INAT height;
+	U1 quit; /* is the window in a quitting state? (e.g did the user click close) */
+	U1 fullscreen; /* Is the window fullscreen or not? Not used here, but used in HAZE. */
+};
+
+/* We create a global declaration of a window struct to use elsewhere in the program. This is our primary window. */
+struct hzwinprop primarywin;
+
+/* This is a cleanup step, which destroys the primary SDL window and quits SDL. */
+X0 cleanup()
+{
+	if(SDL_WasInit(SDL_INIT_VIDEO)) {
+		/* Basically just exits fullscreen if it was enabled and frees the mouse if it was grabbed. */
+		SDL_ShowCursor(SDL_TRUE);
+		SDL_SetRelativeMouseMode(SDL_FALSE);
+		if(primarywin.window) SDL_SetWindowGrab(primarywin.window, SDL_FALSE);
+		#ifdef __APPLE__
+		if(primarywin.window) SDL_SetWindowFullscreen(screen, 0);
+		#endif
+
+		/* Destroy the primary window */
+		if(primarywin.window) SDL_DestroyWindow(primarywin.window);
+	}
+
+	/* Quit SDL (Does not quit the whole program, just presumably gets SDL to clean up) */
+	SDL_Quit();
+}
+
+/* This function prints an error to both the terminal and an SDL window. Can be called at any point.
+ * Arguments are the same as printf();
+ */
+X0 errwindow(const CHR *s, ...)
+{
+	#ifndef HZ_MAX_ERROR_LENGTH
+	#define HZ_MAX_ERROR_LENGTH 4096
+	#endif
+
+	/* We create a buffer to store the final error message in, with a maximum length of 4096 characters.
+	 * That's just over 2 whole Discord messages worth of error!
+	 */
+	CHR buffer[HZ_MAX_ERROR_LENGTH];
+
+	/* This stuff is just fancy variadic argument stuff. 
+	 * See... uh.. this, maybe? https://www.thegeekstuff.com/2017/05/c-variadic-functions/
+	 */
+	va_list args;
+	va_start(args, s);
+
+	/* This uses the vsnprintf function to replicate printf's functionality without actually printing anything.
+	 * If vsnprintf failed for some reason, it will return a number below 0. If it does, we create a new error.
+	 */
+	if (vsnprintf(buffer, HZ_MAX_ERROR_LENGTH, s, args) < 0)
+		strcpy(buffer,
+			"errwindow() was unable to format the fatal exception message while handling an exception.\0");
+	/* We then print the fully formatted error to the stderr output.
+	 * This is just in case the user is unable to read the SDL error window.
+	 */
+	fprintf(stderr, "FATAL ERROR: %s\n", buffer);
+
+	/* Call the global cleanup function to ensure everything is.. well, clean. */
+	cleanup();
+
+	/* Show an SDL message box in case the user cannot read the terminal.
+	 * ShowSimpleMessageBox will work even after you've called SDL_Quit or before you've called SDL_Init.
+	 * It's especially designed for situations like this.
+	 */
+	SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Fatal Exception", buffer, NULL);
+	
+	va_end(args);
+
+	/* Return the failure exit code and terminate (code 1 (failure), aka not 0, which is success) */
+	exit(EXIT_FAILURE);
+}
+
+static U32 add_vertex(struct builder *b, vec3 pos, vec3 normal)
+{
+	struct mdivertex *v = &b->v[b->vertices];
+	glm_vec3_copy(pos, v->pos);
+	glm_vec3_copy(normal, v->normal);
+	return b->vertices++;
+}
+
+/* A flat shaded triangle of a shape that's convex around the origin, so its normal points away from that */
+static X0 add_face(struct builder *b, vec3 p0, vec3 p1, vec3 p2)
+{
+	vec3 e1, e2, n, center;
+	glm_vec3_sub(p1, p0, e1);
+	glm_vec3_sub(p2, p0, e2);
+	glm_vec3_cross(e1, e2, n);
+	glm_vec3_normalize(n);
+	glm_vec3_add(p0, p1, center);
+	glm_vec3_add(center, p2, center);
+	if (glm_vec3_dot(n, center) < 0.0f) glm_vec3_negate(n);
+	b->index[b->indices++] = add_vertex(b, p0, n);
+	b->index[b->indices++] = add_vertex(b, p1, n);
+	b->index[b->indices++] = add_vertex(b, p2, n);
+}
+
+static X0 make_cube(struct builder *b)
+{
+	/* Each face is the two triangles between one axis' corners */
+	for (INAT axis = 0; axis < 3; axis++) {
+		for (INAT side = -1; side <= 1; side += 2) {
+			vec3 c[4];
+			for (INAT i = 0; i < 4; i++) {
+				c[i][axis] = side * 0.4f;
+				c[i][(axis + 1) % 3] = (i == 1 || i == 2 ? 0.4f : -0.4f);
+				c[i][(axis + 2) % 3] = (i >= 2 ? 0.4f : -0.4f);
+			}
+			add_face(b, c[0], c[1], c[2]);
+			add_face(b, c[0], c[2], c[3]);
+		}
+	}
+}
+
+static X0 make_octahedron(struct builder *b)
+{
+	for (INAT i = 0; i < 8; i++) {
+		vec3 x = { i & 1 ? 0.55f : -0.55f, 0, 0 }, y = { 0, i & 2 ? 0.55f : -0.55f, 0 };
+		vec3 z = { 0, 0, i & 4 ? 0.55f : -0.55f };
+		add_face(b, x, y, z);
+	}
+}
+
+static X0 make_cone(struct builder *b, U32 segments)
+{
+	vec3 tip = { 0, 0.5f, 0 }, base = { 0, -0.4f, 0 };
+	for (U32 i = 0; i < segments; i++) {
+		R32 a0 = 2.0f * GLM_PIf * i / segments, a1 = 2.0f * GLM_PIf * (i + 1) / segments;
+		vec3 p0 = { 0.45f * cosf(a0), -0.4f, 0.45f * sinf(a0) }, p1 = { 0.45f * cosf(a1), -0.4f, 0.45f * sinf(a1) };
+		add_face(b, tip, p0, p1);
+		add_face(b, base, p1, p0);
+	}
+}
+
+/* A sphere or a torus, as a grid wrapped around, sharing vertices along the seams of the faces */
+static X0 make_round(struct builder *b, U1 torus, U32 segments, U32 rings)
+{
+	for (U32 r = 0; r <= rings; r++) {
+		for (U32 s = 0; s <= segments; s++) {
+			R32 u = 2.0f * GLM_PIf * s / segments, v = (torus ? 2.0f : 1.0f) * GLM_PIf * r / rings;
+			vec3 n, p;
+			if (torus) {
+				glm_vec3_copy((vec3){ cosf(u) * cosf(v), sinf(v), sinf(u) * cosf(v) }, n);
+				glm_vec3_copy((vec3){ cosf(u) * (0.35f + 0.15f * cosf(v)), 0.15f * sinf(v),
+					sinf(u) * (0.35f + 0.15f * cosf(v)) }, p);
+			} else {
+				glm_vec3_copy((vec3){ cosf(u) * sinf(v), cosf(v), sinf(u) * sinf(v) }, n);
+				glm_vec3_scale(n, 0.5f, p);
+			}
+			add_vertex(b, p, n);
+		}
+	}
+	for (U32 r = 0; r < rings; r++) {
+		for (U32 s = 0; s < segments; s++) {
+			U32 a = r * (segments + 1) + s, c = a + segments + 1;
+			U32 quad[6] = { a, c, a + 1, a + 1, c, c + 1 };
+			memcpy(b->index + b->indices, quad, sizeof(quad));
+			b->indices += 6;
+		}
+	}
+}
+
+/* The main function. This is always the function that is automatically called first, so this
+ * is our engine's "entrypoint"
+ */
+INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments, argv is the array of arguments */
+{
+	/* Initialize SDL. If this fails, we can probably determine that the user does not have a
+	 * [supported] graphical backend. */
+	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+		/* This might look stupid, but keep in mind that errwindow() does a printf() as a fallback too */
+		errwindow("Unable to initialize video!\n SDL Error: %s", SDL_GetError());
+	}
+
+	/* Set the window flags and OpenGL version
+	 * This tells SDL what features we want. 
+	 * SDL_WINDOW_OPENGL - Tells SDL we want to use OpenGL in our window
+	 * SDL_WINDOW_REISIZABLE - Tells SDL we want the user to be able to resize the window at will
+	 * SDL_WINDOW_SHOWN - Tells SDL we want the window to be visible on launch
+	 * Full list of flags: https://wiki.libsdl.org/SDL_WindowFlags
+	 */
+	primarywin.winflags = SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN;
+
+	/* Tell SDL we want to use OpenGL major version 3 minor version 3 (OpenGL 3.3), with the core profile
+	 * See the bottom of this template for a link to a place you can learn about what that means.
+	 * There are some big differences between OpenGL 3.3 and previous versions.
+	 * We need to do this before we create the window or the GL context.
+	 */
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+	/* Finally, actually create the window. We give it a title, a starting position, a width, a height, and our
+	 * previously defined flags. If the window cannot be created, we display the error SDL gave us.
+	 */
+	if (!(primarywin.window = SDL_CreateWindow(
+		"OpenGL 3.3 + SDL Template",
+		SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+		640, 480,
+		primarywin.winflags)))
+		errwindow("Unable to create the primary window!\n SDL Error: %s", SDL_GetError());
+
+	/* Create the OpenGL context. If this fails, the user cannot use OpenGL [probably]. Still, we print the SDL
+	 * error too just in case.
+	 *
+	 * Since OpenGL is one big state machine, you need a context to be able to keep track of all the states.
+	 * This context is bound to our primary window. When the user looks at the window, they'll be looking at the
+	 * OpenGL context we created here.
+	 */
+	if (!(primarywin.glcontext = SDL_GL_CreateContext(primarywin.window)))
+		errwindow("Unable to create GL context! Does your device support OpenGL?\n"
+			"Are you sure you're using the very latest versions of your graphics drivers?\n"
+			"You might be able to resolve this by using Mesa software rendering.\n\n"
+			"SDL Error: %s", SDL_GetError());
+
+	/* Initialize GLEW */
+	glewExperimental = GL_TRUE;
+	GLenum glewError = glewInit();
+	if(glewError != GLEW_OK) errwindow("Error initializing GLEW! %s\n", glewGetErrorString(glewError));
+
+	/* This makes our buffer swap syncronized with the monitor's vertical refresh. In other words, V-Sync.
+	 * You'll see this in action a bit later.
+	 */
+	SDL_GL_SetSwapInterval(1);
+
+	/* Frame capture and fixed frame counts, if they were asked for on the command line. See hz_capture.h */
+	hz_capture_init(argc, argv);
+	/* --gpumem and --gpumem-budget, see hz_gpumem.h */
+	hz_gpumem_init(argc, argv);
+
+	/* --no-indirect forces the GL 3.3 path, to compare the two on hardware that has both */
+	U1 allow_indirect = true;
+	for (INAT i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--no-indirect")) allow_indirect = false;
+	}
+
+	/* the shaders. every object's place and colour come out of a texture buffer, two texels each, by draw ID.
+	 * location 15 is HZ_MESHPOOL_DRAW_ID.
+	 */
+	const CHR *vertex_shader_source = "#version 330 core\n"
+		"layout (location = 0) in vec3 aPos;\n"
+		"layout (location = 1) in vec3 aNormal;\n"
+		"layout (location = 15) in uint aDrawID;\n"
+		"out vec3 Color;\n"
+		"uniform samplerBuffer objects;\n"
+		"uniform mat4 view;\n"
+		"uniform mat4 projection;\n"
+		"uniform float theta;\n"
+		"vec3 spin(vec3 v, float c, float s)\n"
+		"{\n"
+		"	v = vec3(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);\n"
+		"	return vec3(c * v.x - s * v.y, s * v.x + c * v.y, v.z);\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"	vec4 place = texelFetch(objects, int(aDrawID) * 2);\n"
+		"	vec4 look = texelFetch(objects, int(aDrawID) * 2 + 1);\n"
+		"	float t = theta + place.w, c = cos(t), s = sin(t);\n"
+		"	gl_Position = projection * view * vec4(spin(aPos, c, s) * look.w + place.xyz, 1.0f);\n"
+		"	float light = max(dot(spin(aNormal, c, s), normalize(vec3(0.4f, 0.6f, 0.7f))), 0.0f);\n"
+		"	Color = look.rgb * (0.25f + 0.75f * light);\n"
+		"}\0";
+	const CHR *fragment_shader_source = "#version 330 core\n"
+		"out vec4 FragColor;\n"
+		"in vec3 Color;\n"
+		"void main()\n"
+		"{\n"
+		"	FragColor = vec4(Color, 1.0f);\n"
+		"}\0";
+
+	UNAT vertex_shader;
+	vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertex_shader, 1, &vertex_shader_source, NULL);
+	glCompileShader(vertex_shader);
+
+	UNAT fragment_shader;
+	fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragment_shader, 1, &fragment_shader_source, NULL);
+	glCompileShader(fragment_shader);
+
+	GLint vs_success;
+	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &vs_success);
+	if (!vs_success) errwindow("vertex_shader didn't compile.");
+
+	GLint fs_success;
+	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &fs_success);
+	if (!fs_success) errwindow("fragment_shader didn't compile.");
+
+	UNAT shader_program;
+	shader_program = glCreateProgram();
+	glAttachShader(shader_program, vertex_shader);
+	glAttachShader(shader_program, fragment_shader);
+	glLinkProgram(shader_program);
+
+	GLint sp_success;
+	glGetProgramiv(shader_program, GL_LINK_STATUS, &sp_success);
+	if (!sp_success) errwindow("shaders didn't link.");
+
+	glEnable(GL_DEPTH_TEST);
+
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+
+	/* the shapes, all in one pool */
+	struct hzmeshpool pool;
+	hz_meshpool_init(&pool, sizeof(struct mdivertex), allow_indirect);
+	static struct builder shape;
+	for (U32 i = 0; i < MESHES; i++) {
+		shape.vertices = shape.indices = 0;
+		if (i == 0) make_cube(&shape);
+		else if (i == 1) make_octahedron(&shape);
+		else if (i == 2) make_cone(&shape, 24);
+		else make_round(&shape, i == 4, 24, 16);
+		if (hz_meshpool_add(&pool, shape.v, shape.vertices, shape.index, shape.indices) < 0) {
+			errwindow("Out of memory!");
+		}
+	}
+	if (!hz_meshpool_upload(&pool, FIELD * FIELD)) {
+		errwindow("Unable to create the mesh pool! Check the terminal output for details.");
+	}
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(struct mdivertex), (X0*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(struct mdivertex), (X0*)(3 * sizeof(RNAT)));
+	glEnableVertexAttribArray(1);
+
+	/* the texture buffer the objects go into, refilled every frame */
+	UNAT object_buffer, object_texture;
+	size_t object_size = FIELD * FIELD * 8 * sizeof(R32);
+	glGenBuffers(1, &object_buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, object_buffer);
+	glBufferData(GL_TEXTURE_BUFFER, object_size, NULL, GL_STREAM_DRAW);
+	hz_gpumem_buffer(object_buffer, object_size, "objects");
+	glGenTextures(1, &object_texture);
+	glBindTexture(GL_TEXTURE_BUFFER, object_texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, object_buffer);
+
+	glUseProgram(shader_program);
+	glUniform1i(glGetUniformLocation(shader_program, "objects"), 0);
+
+	while (!primarywin.quit) {
+		/* Poll SDL for events. If SDL has no events for us to collect, continue rendering instead. */
+		SDL_Event Event;
+		while (SDL_PollEvent(&Event)) {
+			/* Check the event type. This could be many things, e.g a mouse movement or a key press. */
+			switch (Event.type) {
+			/* This event is triggered when SDL thinks we need to quit, e.g when you
+			 * click the close button on the window */
+			case SDL_QUIT:
+				/* If we do need to quit, we set that as a window property, so next time we're about
+				 * to re-enter the main loop, it simply decides not to loop again.
+				 * Hence this condition: `while (!primarywin.quit) {`
+				 */
+				primarywin.quit = true;
+				break;
+			default:
+				/* If the event is anything else, we simply ignore it.
+				 * You can implement your own events above this. Here's the full list:
+				 * https://wiki.libsdl.org/SDL_EventType
+				 */
+				break;
+			}
+		}
+
+		/* Check if the window size has changed and record it in the primarywin properties for use elsewhere
+		 * (Not strictly neccessary in this template, but it's used in HAZE)
+		 */
+		SDL_GetWindowSize(primarywin.window, &primarywin.width, &primarywin.height);
+
+		/* Specifies clear values for the colour buffers. We want the whole colour buffer to be magenta, so
+		 * we set the colour buffer's clear value to magenta.
+		 */
+		glClearColor(0.f, 0.f, 0.f, 1.f);
+
+		/* Then we clear the colour buffer, making everything magenta. */
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		
+		glUseProgram(shader_program);
+
+		static RNAT theta = 0.0f;
+		theta += 0.02;
+
+		mat4 view_matrix = {
+			1, 0, 0, 0,
+			0, 1, 0, 0,
+			0, 0, 1, 0,
+			0, 0, 0, 1
+		};
+		mat4 proj_matrix;
+		glm_translate_z(view_matrix, -60.0f);
+		glm_rotate_x(view_matrix, -0.5f, view_matrix);
+		glm_perspective(0.7854f, 1.3333f, 0.100f, 200.0f, proj_matrix);
+		glUniformMatrix4fv(glGetUniformLocation(shader_program, "view"), 1, GL_FALSE, (RNAT*)view_matrix);
+		glUniformMatrix4fv(glGetUniformLocation(shader_program, "projection"), 1, GL_FALSE, (RNAT*)proj_matrix);
+		glUniform1f(glGetUniformLocation(shader_program, "theta"), theta);
+
+		/* the frame's draw list and object data, built from scratch in the frame arena. every object gets a
+		 * command, and its data goes wherever its draw ID says.
+		 */
+		struct hzdrawlist list;
+		R32 *objects = hz_frame_alloc(object_size);
+		if (!objects || !hz_drawlist_begin(&list, FIELD * FIELD)) errwindow("Out of memory!");
+		for (U32 i = 0; i < FIELD * FIELD; i++) {
+			U32 x = i % FIELD, y = i / FIELD, mesh = (x * 3 + y * 7 + x * y) % MESHES;
+			U32 id = hz_drawlist_add(&list, &pool, mesh, 1);
+			R32 *o = objects + (size_t)id * 8;
+			o[0] = (R32)x - (FIELD - 1) * 0.5f;
+			o[1] = 0.35f * sinf(theta + x * 0.3f) * cosf(theta * 0.7f + y * 0.2f);
+			o[2] = (R32)y - (FIELD - 1) * 0.5f;
+			o[3] = i * 0.37f;
+			o[4] = 0.5f + 0.5f * sinf(i * 0.11f);
+			o[5] = 0.5f + 0.5f * sinf(i * 0.07f + 2.0f);
+			o[6] = 0.5f + 0.5f * sinf(i * 0.05f + 4.0f);
+			o[7] = 0.7f + 0.3f * (mesh % 2);
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, object_buffer);
+		glBufferData(GL_TEXTURE_BUFFER, object_size, objects, GL_STREAM_DRAW);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_BUFFER, object_texture);
+
+		U32 draws = hz_meshpool_draw(&pool, &list);
+		static U1 reported = false;
+		if (!reported) {
+			printf("mdi: %u objects, %u meshes, %s: %u draw call%s a frame\n", list.count, pool.meshes,
+				pool.use_indirect ? "glMultiDrawElementsIndirect" : "GL 3.3 fallback", draws, draws == 1 ? "" : "s");
+			reported = true;
+		}
+
+		/* Queue a readback of this frame if we're capturing. It has to happen before the swap. */
+		hz_capture_frame(primarywin.window);
+		if (hz_capture_done()) primarywin.quit = true;
+
+		/* Swap our buffer to display the current contents of buffer on screen.
+		 * Since we set SDL_GL_SetSwapInterval(1), this will use the monitor's refresh rate.
+		 */
+		SDL_GL_SwapWindow(primarywin.window);
+		hz_frame_end();
+
+		/* Every 5 seconds or so, how much scratch the object list took, so growth shows up before the exit summary */
+		const struct hzframestats *frame_stats = hz_frame_stats();
+		if (frame_stats->frames % 300 == 0) {
+			printf("mdi: frame %llu used %zu KiB of frame memory, peak %zu KiB\n",
+				(unsigned long long)frame_stats->frames, frame_stats->last / 1024, frame_stats->peak / 1024);
+		}
+	}
+
+	/* Dump GPU memory before the capture buffers go, so they're in it */
+	U1 within_budget = hz_gpumem_shutdown();
+	/* Flush out any frames still being read back. A capture that silently lost frames is worse than no capture. */
+	if (!hz_capture_shutdown()) errwindow("Frame capture failed! Check the terminal output for details.");
+	if (!within_budget) errwindow("Went over the GPU memory budget! Check the terminal output for details.");
+
+	glDeleteTextures(1, &object_texture);
+	glDeleteBuffers(1, &object_buffer);
+	hz_meshpool_destroy(&pool);
+
+	/* Gives the frame arenas back and reports the most a frame needed */
+	hz_frame_shutdown();
+
+	/* Cleanup before exit, just in case. */
+	cleanup();
+
+	/* Nothing bad happened (we think), so return the success code and bugger off. */
+	return EXIT_SUCCESS;
+}
+
+/* You can learn more things about SDL2 here: https://wiki.libsdl.org/FrontPage 
+ * And I think you might be able to get some knowledge about OpenGL here: https://learnopengl.com/
+ * That guy uses GLFW, GLAD and a bunch of other weird things. We're using SDL2, so you should just ignore all of that,
+ * SDL2 does it all for us. The only things you need to look at are the OpenGL function calls, in other words, the
+ * things beginning with `gl`.
+ *
+ * See if you can complete the Hello Triangle task (https://learnopengl.com/Getting-started/Hello-Triangle) using this
+ * template, by adding code just before `while (!primarywin.quit) {` and replacing the `glClearColor`/`glClear` bits.
+ * Those should be the only sections you need to change - just before the main loop, and just inside the main loop.
+ */
@@ -0,0 +1,537 @@
+#include "holyh/src/holy.h"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_error.h>
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/glu.h>
+#include <cglm/cglm.h>
+#include <cglm/struct.h>
+#include <math.h>
+#include "hz_batch.h"
+#include "hz_capture.h"
+#include "hz_frame.h"
+#include "hz_gpumem.h"
+#include "hz_occlusion.h"
+#include "hz_texture.h"
+
+#define FIELD 128 /* FIELD x FIELD props */
+#define SPACING 2.0f
+#define MATERIALS 2
+#define CHUNK_SIZE 16.0f
+#define WALLS 8 /* Around the middle of the field, to hide most of it */
+#define WALL_DISTANCE 20.0f
+
+/* This struct contains all of the properties for a window - borrowed from HAZE. */
+struct hzwinprop {
+	SDL_Window *window; /* The SDL window. Pain in the ass to access, so we just have a reference here */
+	SDL_GLContext glcontext; /* The GL context. We don't use this much, but it's good to have a ref to it. */
+	U32 winflags; /* The flags we gave the window. */
+	INAT width; /* The window width and height. They're useful things to know. */
+	INAT height;
+	U1 quit; /* is the window in a quitting state? (e.g did the user click close) */
+	U1 fullscreen; /* Is the window fullscreen or not? Not used here, but used in HAZE. */
+};
+
+/* We create a global declaration of a window struct to use elsewhere in the program. This is our primary window. */
+struct hzwinprop primarywin;
+
+/* This is a cleanup step, which destroys the primary SDL window and quits SDL. */
+X0 cleanup()
+{
+	if(SDL_WasInit(SDL_INIT_VIDEO)) {
+		/* Basically just exits fullscreen if it was enabled and frees the mouse if it was grabbed. */
+		SDL_ShowCursor(SDL_TRUE);
+		SDL_SetRelativeMouseMode(SDL_FALSE);
+		if(primarywin.window) SDL_SetWindowGrab(primarywin.window, SDL_FALSE);
+		#ifdef __APPLE__
+		if(primarywin.window) SDL_SetWindowFullscreen(screen, 0);
+		#endif
+
+		/* Destroy the primary window */
+		if(primarywin.window) SDL_DestroyWindow(primarywin.window);
+	}
+
+	/* Quit SDL (Does not quit the whole program, just presumably gets SDL to clean up) */
+	SDL_Quit();
+}
+
+/* This function prints an error to both the terminal and an SDL window. Can be called at any point.
+ * Arguments are the same as printf();
+ */
+X0 errwindow(const CHR *s, ...)
+{
+	#ifndef HZ_MAX_ERROR_LENGTH
+	#define HZ_MAX_ERROR_LENGTH 4096
+	#endif
+
+	/* We create a buffer to store the final error message in, with a maximum length of 4096 characters.
+	 * That's just over 2 whole Discord messages worth of error!
+	 */
+	CHR buffer[HZ_MAX_ERROR_LENGTH];
+
+	/* This stuff is just fancy variadic argument stuff. 
+	 * See... uh.. this, maybe? https://www.thegeekstuff.com/2017/05/c-variadic-functions/
+	 */
+	va_list args;
+	va_start(args, s);
+
+	/* This uses the vsnprintf function to replicate printf's functionality without actually printing anything.
+	 * If vsnprintf failed for some reason, it will return a number below 0. If it does, we create a new error.
+	 */
+	if (vsnprintf(buffer, HZ_MAX_ERROR_LENGTH, s, args) < 0)
+		strcpy(buffer,
+			"errwindow() was unable to format the fatal exception message while handling an exception.\0");
+	/* We then print the fully formatted error to the stderr output.
+	 * This is just in case the user is unable to read the SDL error window.
+	 */
+	fprintf(stderr, "FATAL ERROR: %s\n", buffer);
+
+	/* Call the global cleanup function to ensure everything is.. well, clean. */
+	cleanup();
+
+	/* Show an SDL message box in case the user cannot read the terminal.
+	 * ShowSimpleMessageBox will work even after you've called SDL_Quit or before you've called SDL_Init.
+	 * It's especially designed for situations like this.
+	 */
+	SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Fatal Exception", buffer, NULL);
+	
+	va_end(args);
+
+	/* Return the failure exit code and terminate (code 1 (failure), aka not 0, which is success) */
+	exit(EXIT_FAILURE);
+}
+
+/* The main function. This is always the function that is automatically called first, so this
+ * is our engine's "entrypoint"
+ */
+INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments, argv is the array of arguments */
+{
+	/* Initialize SDL. If this fails, we can probably determine that the user does not have a
+	 * [supported] graphical backend. */
+	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+		/* This might look stupid, but keep in mind that errwindow() does a printf() as a fallback too */
+		errwindow("Unable to initialize video!\n SDL Error: %s", SDL_GetError());
+	}
+
+	/* Set the window flags and OpenGL version
+	 * This tells SDL what features we want. 
+	 * SDL_WINDOW_OPENGL - Tells SDL we want to use OpenGL in our window
+	 * SDL_WINDOW_REISIZABLE - Tells SDL we want the user to be able to resize the window at will
+	 * SDL_WINDOW_SHOWN - Tells SDL we want the window to be visible on launch
+	 * Full list of flags: https://wiki.libsdl.org/SDL_WindowFlags
+	 */
+	primarywin.winflags = SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN;
+
+	/* Tell SDL we want to use OpenGL major version 3 minor version 3 (OpenGL 3.3), with the core profile
+	 * See the bottom of this template for a link to a place you can learn about what that means.
+	 * There are some big differences between OpenGL 3.3 and previous versions.
+	 * We need to do this before we create the window or the GL context.
+	 */
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+	/* Finally, actually create the window. We give it a title, a starting position, a width, a height, and our
+	 * previously defined flags. If the window cannot be created, we display the error SDL gave us.
+	 */
+	if (!(primarywin.window = SDL_CreateWindow(
+		"OpenGL 3.3 + SDL Template",
+		SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+		640, 480,
+		primarywin.winflags)))
+		errwindow("Unable to create the primary window!\n SDL Error: %s", SDL_GetError());
+
+	/* Create the OpenGL context. If this fails, the user cannot use OpenGL [probably]. Still, we print the SDL
+	 * error too just in case.
+	 *
+	 * Since OpenGL is one big state machine, you need a context to be able to keep track of all the states.
+	 * This context is bound to our primary window. When the user looks at the window, they'll be looking at the
+	 * OpenGL context we created here.
+	 */
+	if (!(primarywin.glcontext = SDL_GL_CreateContext(primarywin.window)))
+		errwindow("Unable to create GL context! Does your device support OpenGL?\n"
+			"Are you sure you're using the very latest versions of your graphics drivers?\n"
+			"You might be able to resolve this by using Mesa software rendering.\n\n"
+			"SDL Error: %s", SDL_GetError());
+
+	/* Initialize GLEW */
+	glewExperimental = GL_TRUE;
+	GLenum glewError = glewInit();
+	if(glewError != GLEW_OK) errwindow("Error initializing GLEW! %s\n", glewGetErrorString(glewError));
+
+	/* This makes our buffer swap syncronized with the monitor's vertical refresh. In other words, V-Sync.
+	 * You'll see this in action a bit later.
+	 */
+	SDL_GL_SetSwapInterval(1);
+
+	/* Frame capture and fixed frame counts, if they were asked for on the command line. See hz_capture.h */
+	hz_capture_init(argc, argv);
+	/* --gpumem and --gpumem-budget, see hz_gpumem.h */
+	hz_gpumem_init(argc, argv);
+	/* --compress-textures, see hz_texture.h */
+	hz_texture_init(argc, argv);
+
+	/* --no-batch draws every prop on its own, the way puck_cube draws its one cube, to compare against.
+	 * --no-occlusion draws whatever's behind the walls too.
+	 */
+	U1 batched = true, occlusion = true;
+	for (INAT i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--no-batch")) batched = false;
+		if (!strcmp(argv[i], "--no-occlusion")) occlusion = false;
+	}
+
+	/* the shaders. the batched props are already in world space, so they get an identity model matrix */
+	const CHR *vertex_shader_source = "#version 330 core\n"
+		"layout (location = 0) in vec3 aPos;\n"
+		"layout (location = 1) in vec2 aTexCoord;\n"
+		"out vec2 TexCoord;\n"
+		"uniform mat4 model;\n"
+		"uniform mat4 view;\n"
+		"uniform mat4 projection;\n"
+		"void main()\n"
+		"{\n"
+		"	gl_Position = projection * view * model * vec4(aPos, 1.0f);\n"
+		"	TexCoord = aTexCoord;\n"
+		"}\0";
+	const CHR *fragment_shader_source = "#version 330 core\n"
+		"out vec4 FragColor;\n"
+		"in vec2 TexCoord;\n"
+		"uniform sampler2D ourTexture;\n"
+		"void main()\n"
+		"{\n"
+		"	FragColor = texture(ourTexture, TexCoord);\n"
+		"}\0";
+
+	UNAT vertex_shader;
+	vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertex_shader, 1, &vertex_shader_source, NULL);
+	glCompileShader(vertex_shader);
+
+	UNAT fragment_shader;
+	fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragment_shader, 1, &fragment_shader_source, NULL);
+	glCompileShader(fragment_shader);
+
+	GLint vs_success;
+	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &vs_success);
+	if (!vs_success) errwindow("vertex_shader didn't compile.");
+
+	GLint fs_success;
+	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &fs_success);
+	if (!fs_success) errwindow("fragment_shader didn't compile.");
+
+	UNAT shader_program;
+	shader_program = glCreateProgram();
+	glAttachShader(shader_program, vertex_shader);
+	glAttachShader(shader_program, fragment_shader);
+	glLinkProgram(shader_program);
+
+	GLint sp_success;
+	glGetProgramiv(shader_program, GL_LINK_STATUS, &sp_success);
+	if (!sp_success) errwindow("shaders didn't link.");
+
+	glEnable(GL_DEPTH_TEST);
+
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+
+	/* the same cube as puck_cube, with indices so it can be batched */
+	RNAT vertices[] = {
+	/*   position             tex coords */
+		-0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+		 0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+		-0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+
+		-0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		-0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		-0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+
+		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+		-0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
+		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f
+	};
+	U32 indices[36];
+	for (U32 i = 0; i < 36; i++) indices[i] = i;
+
+	/* the props: a field of cubes, each turned, scaled and nudged a little, in one of two materials */
+	struct prop {
+		mat4 model;
+		U32 material;
+	};
+	struct prop *props = malloc(FIELD * FIELD * sizeof(*props));
+	if (!props) errwindow("Out of memory!");
+	U32 seed = 12345;
+	for (U32 i = 0; i < FIELD * FIELD; i++) {
+		R32 r[4];
+		for (U32 k = 0; k < 4; k++) {
+			seed = seed * 1664525u + 1013904223u;
+			r[k] = (seed >> 8) / 16777216.0f;
+		}
+		struct prop *p = &props[i];
+		R32 scale = 0.5f + 0.7f * r[2];
+		glm_mat4_identity(p->model);
+		glm_translate(p->model, (vec3){ ((R32)(i % FIELD) - (FIELD - 1) * 0.5f) * SPACING + r[0] - 0.5f,
+			scale * 0.5f, ((R32)(i / FIELD) - (FIELD - 1) * 0.5f) * SPACING + r[1] - 0.5f });
+		glm_rotate_y(p->model, r[3] * 2.0f * GLM_PIf, p->model);
+		glm_scale_uni(p->model, scale);
+		p->material = (i * 7 + i / FIELD) % MATERIALS;
+	}
+
+	/* the walls: big flat cubes in a ring, with gaps to see through. they're also the occluders, see hz_occlusion.h */
+	mat4 walls[WALLS];
+	for (U32 i = 0; i < WALLS; i++) {
+		R32 a = i * 2.0f * GLM_PIf / WALLS;
+		glm_mat4_identity(walls[i]);
+		glm_translate(walls[i], (vec3){ cosf(a) * WALL_DISTANCE, 4.0f, sinf(a) * WALL_DISTANCE });
+		glm_rotate_y(walls[i], -a - GLM_PIf * 0.5f, walls[i]);
+		glm_scale(walls[i], (vec3){ 12.0f, 8.0f, 1.0f });
+	}
+	struct hzocclusion occluders;
+	if (occlusion && !hz_occlusion_init(&occluders)) errwindow("Out of memory!");
+
+	/* ...baked into world space chunks at load time, or left alone in one small vertex buffer */
+	struct hzbatch batch;
+	UNAT VBO = 0, VAO = 0;
+	if (batched) {
+		hz_batch_init(&batch, 5 * sizeof(RNAT), 0, HZ_BATCH_NO_NORMAL, CHUNK_SIZE, true);
+		for (U32 i = 0; i < FIELD * FIELD; i++) {
+			if (!hz_batch_add(&batch, props[i].material, vertices, 36, indices, 36, (R32*)props[i].model)) {
+				errwindow("Out of memory!");
+			}
+		}
+		for (U32 i = 0; i < WALLS; i++) {
+			if (!hz_batch_add(&batch, 1, vertices, 36, indices, 36, (R32*)walls[i])) errwindow("Out of memory!");
+		}
+		if (!hz_batch_build(&batch)) errwindow("Unable to build the batch! Check the terminal output for details.");
+	} else {
+		glGenBuffers(1, &VBO);
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+		hz_gpumem_buffer(VBO, sizeof(vertices), "cube");
+	}
+	/* vertex position and tex coord attribs, on whichever VAO that left bound */
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(RNAT), (X0*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(RNAT), (X0*)(3 * sizeof(RNAT)));
+	glEnableVertexAttribArray(1);
+
+	/* the materials: the puck, and a checkerboard so the two can be told apart */
+	UNAT textures[MATERIALS];
+	textures[0] = hz_texture_load("assets/puckface.png", NULL, NULL);
+	if (!textures[0]) errwindow("Unable to load assets/puckface.png! Check the terminal output for details.");
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	static U8 checker[64 * 64 * 4];
+	for (U32 i = 0; i < 64 * 64; i++) {
+		U8 c = ((i % 64) / 8 + i / 64 / 8) % 2 ? 0xe0 : 0x40;
+		checker[i * 4] = c;
+		checker[i * 4 + 1] = c / 2 + 0x20;
+		checker[i * 4 + 2] = 0x30;
+		checker[i * 4 + 3] = 0xff;
+	}
+	glGenTextures(1, &textures[1]);
+	glBindTexture(GL_TEXTURE_2D, textures[1]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 64, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE, checker);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	hz_gpumem_texture(textures[1], GL_RGBA8, 64, 64, 1, 0, "checker");
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	while (!primarywin.quit) {
+		/* Poll SDL for events. If SDL has no events for us to collect, continue rendering instead. */
+		SDL_Event Event;
+		while (SDL_PollEvent(&Event)) {
+			/* Check the event type. This could be many things, e.g a mouse movement or a key press. */
+			switch (Event.type) {
+			/* This event is triggered when SDL thinks we need to quit, e.g when you
+			 * click the close button on the window */
+			case SDL_QUIT:
+				/* If we do need to quit, we set that as a window property, so next time we're about
+				 * to re-enter the main loop, it simply decides not to loop again.
+				 * Hence this condition: `while (!primarywin.quit) {`
+				 */
+				primarywin.quit = true;
+				break;
+			default:
+				/* If the event is anything else, we simply ignore it.
+				 * You can implement your own events above this. Here's the full list:
+				 * https://wiki.libsdl.org/SDL_EventType
+				 */
+				break;
+			}
+		}
+
+		/* Check if the window size has changed and record it in the primarywin properties for use elsewhere
+		 * (Not strictly neccessary in this template, but it's used in HAZE)
+		 */
+		SDL_GetWindowSize(primarywin.window, &primarywin.width, &primarywin.height);
+
+		/* Specifies clear values for the colour buffers. We want the whole colour buffer to be magenta, so
+		 * we set the colour buffer's clear value to magenta.
+		 */
+		glClearColor(0.f, 0.f, 0.f, 1.f);
+
+		/* Then we clear the colour buffer, making everything magenta. */
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		glUseProgram(shader_program);
+
+		/* stand in the middle of the field and look around, so most of it is behind us at any one time */
+		static RNAT theta = 0.0f;
+		theta += 0.01;
+
+		mat4 view_matrix, proj_matrix, viewproj_matrix;
+		glm_lookat((vec3){ 0.0f, 6.0f, 0.0f }, (vec3){ cosf(theta) * 10.0f, 2.0f, sinf(theta) * 10.0f },
+			(vec3){ 0.0f, 1.0f, 0.0f }, view_matrix);
+		glm_perspective(0.7854f, 1.3333f, 0.100f, 200.0f, proj_matrix);
+		glm_mat4_mul(proj_matrix, view_matrix, viewproj_matrix);
+		struct hzfrustum frustum;
+		hz_frustum_from_matrix(&frustum, (R32*)viewproj_matrix);
+
+		/* the walls' depth, from the same point of view, before anything is drawn */
+		if (occlusion) {
+			hz_occlusion_begin(&occluders, (R32*)viewproj_matrix);
+			for (U32 i = 0; i < WALLS; i++) {
+				hz_occlusion_add(&occluders, vertices, 5 * sizeof(RNAT), indices, 36, (R32*)walls[i]);
+			}
+			hz_occlusion_finish(&occluders);
+		}
+
+		UNAT model_loc = glGetUniformLocation(shader_program, "model");
+		glUniformMatrix4fv(glGetUniformLocation(shader_program, "view"), 1, GL_FALSE, (RNAT*)view_matrix);
+		glUniformMatrix4fv(glGetUniformLocation(shader_program, "projection"), 1, GL_FALSE, (RNAT*)proj_matrix);
+
+		/* a draw per material with whatever chunks are in view, or a draw per prop in view */
+		U32 draws = 0, visible = 0;
+		if (batched) {
+			mat4 identity = GLM_MAT4_IDENTITY_INIT;
+			glUniformMatrix4fv(model_loc, 1, GL_FALSE, (RNAT*)identity);
+			for (U32 m = 0; m < MATERIALS; m++) {
+				glBindTexture(GL_TEXTURE_2D, textures[m]);
+				draws += hz_batch_draw(&batch, m, &frustum, occlusion ? &occluders : NULL, &visible);
+			}
+		} else {
+			glBindVertexArray(VAO);
+			for (U32 m = 0; m < MATERIALS; m++) {
+				glBindTexture(GL_TEXTURE_2D, textures[m]);
+				for (U32 i = 0; i < FIELD * FIELD; i++) {
+					/* the cube's bounding sphere, scale and all, and the box around that */
+					R32 r = 0.866f * glm_vec3_norm(props[i].model[0]);
+					if (props[i].material != m || !hz_frustum_sphere(&frustum, props[i].model[3], r)) continue;
+					if (occlusion) {
+						vec3 min, max;
+						glm_vec3_subs(props[i].model[3], r, min);
+						glm_vec3_adds(props[i].model[3], r, max);
+						if (!hz_occlusion_aabb(&occluders, min, max)) continue;
+					}
+					glUniformMatrix4fv(model_loc, 1, GL_FALSE, (RNAT*)props[i].model);
+					glDrawArrays(GL_TRIANGLES, 0, 36);
+					draws++;
+				}
+			}
+			visible = draws;
+			glBindTexture(GL_TEXTURE_2D, textures[1]);
+			for (U32 i = 0; i < WALLS; i++) {
+				glUniformMatrix4fv(model_loc, 1, GL_FALSE, (RNAT*)walls[i]);
+				glDrawArrays(GL_TRIANGLES, 0, 36);
+				draws++;
+			}
+		}
+
+		static U1 reported = false;
+		if (!reported) {
+			if (batched) {
+				printf("props: %u cubes, %u triangles, in %u chunks of %u materials: %u chunks in view, "
+					"%u draw call%s a frame\n", FIELD * FIELD, batch.triangles, batch.chunks, MATERIALS, visible,
+					draws, draws == 1 ? "" : "s");
+			} else {
+				printf("props: %u cubes, %u in view: %u draw calls a frame\n", FIELD * FIELD, visible, draws);
+			}
+			if (occlusion) {
+				printf("props: %u of %u %s in view hidden behind the walls\n", occluders.hidden, occluders.tested,
+					batched ? "chunks" : "cubes");
+			}
+			reported = true;
+		}
+
+		/* Queue a readback of this frame if we're capturing. It has to happen before the swap. */
+		hz_capture_frame(primarywin.window);
+		if (hz_capture_done()) primarywin.quit = true;
+
+		/* Swap our buffer to display the current contents of buffer on screen.
+		 * Since we set SDL_GL_SetSwapInterval(1), this will use the monitor's refresh rate.
+		 */
+		SDL_GL_SwapWindow(primarywin.window);
+		hz_frame_end();
+	}
+
+	/* Dump GPU memory before the capture buffers go, so they're in it */
+	U1 within_budget = hz_gpumem_shutdown();
+	/* Flush out any frames still being read back. A capture that silently lost frames is worse than no capture. */
+	if (!hz_capture_shutdown()) errwindow("Frame capture failed! Check the terminal output for details.");
+	if (!within_budget) errwindow("Went over the GPU memory budget! Check the terminal output for details.");
+
+	if (batched) {
+		hz_batch_destroy(&batch);
+	} else {
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+	}
+	free(props);
+	if (occlusion) hz_occlusion_destroy(&occluders);
+
+	/* Gives the frame arenas back and reports the most a frame needed */
+	hz_frame_shutdown();
+
+	/* Cleanup before exit, just in case. */
+	cleanup();
+
+	/* Nothing bad happened (we think), so return the success code and bugger off. */
+	return EXIT_SUCCESS;
+}
+
+/* You can learn more things about SDL2 here: https://wiki.libsdl.org/FrontPage 
+ * And I think you might be able to get some knowledge about OpenGL here: https://learnopengl.com/
+ * That guy uses GLFW, GLAD and a bunch of other weird things. We're using SDL2, so you should just ignore all of that,
+ * SDL2 does it all for us. The only things you need to look at are the OpenGL function calls, in other words, the
+ * things beginning with `gl`.
+ *
+ * See if you can complete the Hello Triangle task (https://learnopengl.com/Getting-started/Hello-Triangle) using this
+ * template, by adding code just before `while (!primarywin.quit) {` and replacing the `glClearColor`/`glClear` bits.
+ * Those should be the only sections you need to change - just before the main loop, and just inside the main loop.
+ */
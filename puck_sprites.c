@@ -0,0 +1,378 @@
+#include "holyh/src/holy.h"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_error.h>
+#include <GL/glew.h>
+#include <SDL2/SDL_opengl.h>
+#include <GL/glu.h>
+#include "hz_atlas.h"
+#include "hz_capture.h"
+#include "hz_frame.h"
+#include "hz_gpumem.h"
+#include "hz_sprite.h"
+#include "hz_texture.h"
+#include <math.h>
+
+/* How many sprites to throw around, --sprites=N to change it */
+#define SPRITES 50000
+/* Images generated into the atlas on top of puckface.png, enough to spill over onto a few pages */
+#define BLOBS 300
+#define ATLAS_SIZE 1024
+
+struct sprite {
+	R32 x, y, dx, dy, angle, spin, scale;
+	U32 image;
+	U32 rgba;
+};
+
+/* This struct contains all of the properties for a window - borrowed from HAZE. */
+struct hzwinprop {
+	SDL_Window *window; /* The SDL window. Pain in the ass to access, so we just have a reference here */
+	SDL_GLContext glcontext; /* The GL context. We don't use this much, but it's good to have a ref to it. */
+	U32 winflags; /* The flags we gave the window. */
+	INAT width; /* The window width and height. They're useful things to know. */
+	INAT height;
+	U1 quit; /* is the window in a quitting state? (e.g did the user click close) */
+	U1 fullscreen; /* Is the window fullscreen or not? Not used here, but used in HAZE. */
+};
+
+/* We create a global declaration of a window struct to use elsewhere in the program. This is our primary window. */
+struct hzwinprop primarywin;
+
+/* This is a cleanup step, which destroys the primary SDL window and quits SDL. */
+X0 cleanup()
+{
+	if(SDL_WasInit(SDL_INIT_VIDEO)) {
+		/* Basically just exits fullscreen if it was enabled and frees the mouse if it was grabbed. */
+		SDL_ShowCursor(SDL_TRUE);
+		SDL_SetRelativeMouseMode(SDL_FALSE);
+		if(primarywin.window) SDL_SetWindowGrab(primarywin.window, SDL_FALSE);
+		#ifdef __APPLE__
+		if(primarywin.window) SDL_SetWindowFullscreen(screen, 0);
+		#endif
+
+		/* Destroy the primary window */
+		if(primarywin.window) SDL_DestroyWindow(primarywin.window);
+	}
+
+	/* Quit SDL (Does not quit the whole program, just presumably gets SDL to clean up) */
+	SDL_Quit();
+}
+
+/* This function prints an error to both the terminal and an SDL window. Can be called at any point.
+ * Arguments are the same as printf();
+ */
+X0 errwindow(const CHR *s, ...)
+{
+	#ifndef HZ_MAX_ERROR_LENGTH
+	#define HZ_MAX_ERROR_LENGTH 4096
+	#endif
+
+	/* We create a buffer to store the final error message in, with a maximum length of 4096 characters.
+	 * That's just over 2 whole Discord messages worth of error!
+	 */
+	CHR buffer[HZ_MAX_ERROR_LENGTH];
+
+	/* This stuff is just fancy variadic argument stuff. 
+	 * See... uh.. this, maybe? https://www.thegeekstuff.com/2017/05/c-variadic-functions/
+	 */
+	va_list args;
+	va_start(args, s);
+
+	/* This uses the vsnprintf function to replicate printf's functionality without actually printing anything.
+	 * If vsnprintf failed for some reason, it will return a number below 0. If it does, we create a new error.
+	 */
+	if (vsnprintf(buffer, HZ_MAX_ERROR_LENGTH, s, args) < 0)
+		strcpy(buffer,
+			"errwindow() was unable to format the fatal exception message while handling an exception.\0");
+	/* We then print the fully formatted error to the stderr output.
+	 * This is just in case the user is unable to read the SDL error window.
+	 */
+	fprintf(stderr, "FATAL ERROR: %s\n", buffer);
+
+	/* Call the global cleanup function to ensure everything is.. well, clean. */
+	cleanup();
+
+	/* Show an SDL message box in case the user cannot read the terminal.
+	 * ShowSimpleMessageBox will work even after you've called SDL_Quit or before you've called SDL_Init.
+	 * It's especially designed for situations like this.
+	 */
+	SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Fatal Exception", buffer, NULL);
+	
+	va_end(args);
+
+	/* Return the failure exit code and terminate (code 1 (failure), aka not 0, which is success) */
+	exit(EXIT_FAILURE);
+}
+
+/* Same numbers every run, so the golden test sees the same frame */
+static U32 rng_state = 12345;
+static U32 rng()
+{
+	rng_state = rng_state * 1664525u + 1013904223u;
+	return rng_state >> 8;
+}
+
+static R32 rngf(R32 lo, R32 hi)
+{
+	return lo + (hi - lo) * (rng() & 0xffff) / 65535.0f;
+}
+
+/* A soft edged disc or ring, white so the sprite colour tints it */
+static X0 make_blob(U8 *rgba, U32 size, U1 ring)
+{
+	R32 r = size * 0.5f;
+	for (U32 y = 0; y < size; y++) {
+		for (U32 x = 0; x < size; x++) {
+			R32 d = hypotf(x + 0.5f - r, y + 0.5f - r) / r;
+			R32 a = ring ? 1.0f - fabsf(d - 0.75f) * 6.0f : (1.0f - d) * 4.0f;
+			a = a < 0.0f ? 0.0f : a > 1.0f ? 1.0f : a;
+			U8 *p = rgba + ((size_t)y * size + x) * 4;
+			p[0] = p[1] = p[2] = 255;
+			p[3] = a * 255.0f + 0.5f;
+		}
+	}
+}
+
+/* The atlas the sprites' images live in, for by_page() */
+static const struct hzsprite *sort_images;
+
+static INAT by_page(const X0 *a, const X0 *b)
+{
+	const struct sprite *sa = a, *sb = b;
+	U32 pa = sort_images[sa->image].page, pb = sort_images[sb->image].page;
+	if (pa != pb) return (pa > pb) - (pa < pb);
+	return (sa->image > sb->image) - (sa->image < sb->image);
+}
+
+/* The main function. This is always the function that is automatically called first, so this
+ * is our engine's "entrypoint"
+ */
+INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments, argv is the array of arguments */
+{
+	/* Initialize SDL. If this fails, we can probably determine that the user does not have a
+	 * [supported] graphical backend. */
+	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+		/* This might look stupid, but keep in mind that errwindow() does a printf() as a fallback too */
+		errwindow("Unable to initialize video!\n SDL Error: %s", SDL_GetError());
+	}
+
+	/* Set the window flags and OpenGL version
+	 * This tells SDL what features we want. 
+	 * SDL_WINDOW_OPENGL - Tells SDL we want to use OpenGL in our window
+	 * SDL_WINDOW_REISIZABLE - Tells SDL we want the user to be able to resize the window at will
+	 * SDL_WINDOW_SHOWN - Tells SDL we want the window to be visible on launch
+	 * Full list of flags: https://wiki.libsdl.org/SDL_WindowFlags
+	 */
+	primarywin.winflags = SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN;
+
+	/* Tell SDL we want to use OpenGL major version 3 minor version 3 (OpenGL 3.3), with the core profile
+	 * See the bottom of this template for a link to a place you can learn about what that means.
+	 * There are some big differences between OpenGL 3.3 and previous versions.
+	 * We need to do this before we create the window or the GL context.
+	 */
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+	/* Finally, actually create the window. We give it a title, a starting position, a width, a height, and our
+	 * previously defined flags. If the window cannot be created, we display the error SDL gave us.
+	 */
+	if (!(primarywin.window = SDL_CreateWindow(
+		"OpenGL 3.3 + SDL Template",
+		SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+		640, 480,
+		primarywin.winflags)))
+		errwindow("Unable to create the primary window!\n SDL Error: %s", SDL_GetError());
+
+	/* Create the OpenGL context. If this fails, the user cannot use OpenGL [probably]. Still, we print the SDL
+	 * error too just in case.
+	 *
+	 * Since OpenGL is one big state machine, you need a context to be able to keep track of all the states.
+	 * This context is bound to our primary window. When the user looks at the window, they'll be looking at the
+	 * OpenGL context we created here.
+	 */
+	if (!(primarywin.glcontext = SDL_GL_CreateContext(primarywin.window)))
+		errwindow("Unable to create GL context! Does your device support OpenGL?\n"
+			"Are you sure you're using the very latest versions of your graphics drivers?\n"
+			"You might be able to resolve this by using Mesa software rendering.\n\n"
+			"SDL Error: %s", SDL_GetError());
+
+	/* Initialize GLEW */
+	glewExperimental = GL_TRUE;
+	GLenum glewError = glewInit();
+	if(glewError != GLEW_OK) errwindow("Error initializing GLEW! %s\n", glewGetErrorString(glewError));
+
+	/* This makes our buffer swap syncronized with the monitor's vertical refresh. In other words, V-Sync.
+	 * You'll see this in action a bit later.
+	 */
+	SDL_GL_SetSwapInterval(1);
+
+	/* Frame capture and fixed frame counts, if they were asked for on the command line. See hz_capture.h */
+	hz_capture_init(argc, argv);
+	/* --gpumem and --gpumem-budget, see hz_gpumem.h */
+	hz_gpumem_init(argc, argv);
+	/* --compress-textures, see hz_texture.h */
+	hz_texture_init(argc, argv);
+	
+	/* Everything goes in one atlas: the puck, plus a pile of generated blobs of all sizes */
+	struct hzatlas atlas;
+	hz_atlas_init(&atlas, ATLAS_SIZE);
+	struct hzsprite images[BLOBS + 1];
+	if (!hz_atlas_add_file(&atlas, "assets/puckface.png", &images[0])) {
+		errwindow("Unable to load assets/puckface.png! Check the terminal output for details.");
+	}
+	U8 *blob = malloc(96 * 96 * 4);
+	if (!blob) errwindow("Out of memory!");
+	for (U32 i = 1; i <= BLOBS; i++) {
+		U32 size = 8 + rng() % 89;
+		make_blob(blob, size, rng() & 1);
+		if (!hz_atlas_add(&atlas, blob, size, size, &images[i])) {
+			errwindow("Unable to pack the sprite atlas! Check the terminal output for details.");
+		}
+	}
+	free(blob);
+
+	struct hzspritebatch batch;
+	if (!hz_sprite_init(&batch)) errwindow("Unable to set up the sprite batcher! Check the terminal output for details.");
+
+	INAT count = SPRITES;
+	for (INAT i = 1; i < argc; i++) {
+		if (!strncmp(argv[i], "--sprites=", 10)) count = atoi(argv[i] + 10);
+	}
+	if (count < 0) count = 0;
+	struct sprite *sprites = malloc((count ? count : 1) * sizeof(*sprites));
+	if (!sprites) errwindow("Out of memory!");
+	for (INAT i = 0; i < count; i++) {
+		struct sprite *s = &sprites[i];
+		s->image = i % 64 ? 1 + rng() % BLOBS : 0;
+		s->x = rngf(0.0f, 640.0f);
+		s->y = rngf(0.0f, 480.0f);
+		s->dx = rngf(-2.0f, 2.0f);
+		s->dy = rngf(-2.0f, 2.0f);
+		s->angle = rngf(0.0f, 6.2831853f);
+		s->spin = rngf(-0.05f, 0.05f);
+		s->scale = s->image ? rngf(0.2f, 0.6f) : rngf(0.04f, 0.1f);
+		s->rgba = s->image ? (rng() << 8) | 0xc0 : 0xffffffff;
+	}
+	/* Sorted by page, so the batcher only has to switch textures once per page. Later images can go back and fill
+	 * holes on earlier pages, so that isn't the order they were packed in.
+	 */
+	sort_images = images;
+	qsort(sprites, count, sizeof(*sprites), by_page);
+	/* One draw call per page then, or a few if a page has more sprites than fit in one batch */
+	U32 expected_draws = 0;
+	for (INAT i = 0, run = 0; i < count; i++) {
+		run++;
+		if (i + 1 < count && images[sprites[i + 1].image].page == images[sprites[i].image].page) continue;
+		expected_draws += (run + HZ_SPRITE_BATCH - 1) / HZ_SPRITE_BATCH;
+		run = 0;
+	}
+	U1 reported = false;
+
+	while (!primarywin.quit) {
+		/* Poll SDL for events. If SDL has no events for us to collect, continue rendering instead. */
+		SDL_Event Event;
+		while (SDL_PollEvent(&Event)) {
+			/* Check the event type. This could be many things, e.g a mouse movement or a key press. */
+			switch (Event.type) {
+			/* This event is triggered when SDL thinks we need to quit, e.g when you
+			 * click the close button on the window */
+			case SDL_QUIT:
+				/* If we do need to quit, we set that as a window property, so next time we're about
+				 * to re-enter the main loop, it simply decides not to loop again.
+				 * Hence this condition: `while (!primarywin.quit) {`
+				 */
+				primarywin.quit = true;
+				break;
+			default:
+				/* If the event is anything else, we simply ignore it.
+				 * You can implement your own events above this. Here's the full list:
+				 * https://wiki.libsdl.org/SDL_EventType
+				 */
+				break;
+			}
+		}
+
+		/* Check if the window size has changed and record it in the primarywin properties for use elsewhere
+		 * (Not strictly neccessary in this template, but it's used in HAZE)
+		 */
+		SDL_GetWindowSize(primarywin.window, &primarywin.width, &primarywin.height);
+
+		/* Specifies clear values for the colour buffers. We want the whole colour buffer to be magenta, so
+		 * we set the colour buffer's clear value to magenta.
+		 */
+		glClearColor(0.f, 0.f, 0.f, 1.f);
+
+		/* Then we clear the colour buffer, making everything magenta. */
+		glClear(GL_COLOR_BUFFER_BIT);
+		
+		/* Move everything with the same fixed step every frame, bouncing off the window edges */
+		for (INAT i = 0; i < count; i++) {
+			struct sprite *s = &sprites[i];
+			s->x += s->dx;
+			s->y += s->dy;
+			s->angle += s->spin;
+			if (s->x < 0.0f) s->dx = fabsf(s->dx);
+			if (s->x > primarywin.width) s->dx = -fabsf(s->dx);
+			if (s->y < 0.0f) s->dy = fabsf(s->dy);
+			if (s->y > primarywin.height) s->dy = -fabsf(s->dy);
+		}
+
+		/* sprites */
+		hz_sprite_begin(&batch, primarywin.width, primarywin.height);
+		for (INAT i = 0; i < count; i++) {
+			const struct sprite *s = &sprites[i];
+			hz_sprite_draw(&batch, &images[s->image], s->x, s->y, s->scale, s->angle, s->rgba);
+		}
+		hz_sprite_end(&batch);
+		if (!reported) {
+			printf("sprites: %u sprites in %u draw calls, %u atlas pages of %ux%u (%.0f%% full)\n", batch.sprites,
+				batch.draws, atlas.pages, atlas.size, atlas.size, hz_atlas_occupancy(&atlas) * 100.0);
+			if (batch.draws != expected_draws) {
+				fprintf(stderr, "sprites: expected %u draw calls for %u pages, the sprites aren't sorted by page\n",
+					expected_draws, atlas.pages);
+			}
+			reported = true;
+		}
+
+		/* Queue a readback of this frame if we're capturing. It has to happen before the swap. */
+		hz_capture_frame(primarywin.window);
+		if (hz_capture_done()) primarywin.quit = true;
+
+		/* Swap our buffer to display the current contents of buffer on screen.
+		 * Since we set SDL_GL_SetSwapInterval(1), this will use the monitor's refresh rate.
+		 */
+		SDL_GL_SwapWindow(primarywin.window);
+		hz_frame_end();
+	}
+
+	/* Dump GPU memory before the capture buffers go, so they're in it */
+	U1 within_budget = hz_gpumem_shutdown();
+	/* Flush out any frames still being read back. A capture that silently lost frames is worse than no capture. */
+	if (!hz_capture_shutdown()) errwindow("Frame capture failed! Check the terminal output for details.");
+	if (!within_budget) errwindow("Went over the GPU memory budget! Check the terminal output for details.");
+
+	free(sprites);
+	hz_sprite_destroy(&batch);
+	hz_atlas_destroy(&atlas);
+
+	/* Gives the frame arenas back and reports the most a frame needed */
+	hz_frame_shutdown();
+
+	/* Cleanup before exit, just in case. */
+	cleanup();
+
+	/* Nothing bad happened (we think), so return the success code and bugger off. */
+	return EXIT_SUCCESS;
+}
+
+/* You can learn more things about SDL2 here: https://wiki.libsdl.org/FrontPage 
+ * And I think you might be able to get some knowledge about OpenGL here: https://learnopengl.com/
+ * That guy uses GLFW, GLAD and a bunch of other weird things. We're using SDL2, so you should just ignore all of that,
+ * SDL2 does it all for us. The only things you need to look at are the OpenGL function calls, in other words, the
+ * things beginning with `gl`.
+ *
+ * See if you can complete the Hello Triangle task (https://learnopengl.com/Getting-started/Hello-Triangle) using this
+ * template, by adding code just before `while (!primarywin.quit) {` and replacing the `glClearColor`/`glClear` bits.
+ * Those should be the only sections you need to change - just before the main loop, and just inside the main loop.
+ */
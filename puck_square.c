@@ -4,8 +4,10 @@
 #include <GL/glew.h>
 #include <SDL2/SDL_opengl.h>
 #include <GL/glu.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include "hz_capture.h"
+#include "hz_frame.h"
+#include "hz_gpumem.h"
+#include "hz_texture.h"
 
 /* This struct contains all of the properties for a window - borrowed from HAZE. */
 struct hzwinprop {
@@ -149,6 +151,13 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 	 * You'll see this in action a bit later.
 	 */
 	SDL_GL_SetSwapInterval(1);
+
+	/* Frame capture and fixed frame counts, if they were asked for on the command line. See hz_capture.h */
+	hz_capture_init(argc, argv);
+	/* --gpumem and --gpumem-budget, see hz_gpumem.h */
+	hz_gpumem_init(argc, argv);
+	/* --compress-textures, see hz_texture.h */
+	hz_texture_init(argc, argv);
 	
 	/* the shaders */
 	/* i think this is dumb. how do i include a shader as a separate file? */
@@ -238,8 +247,10 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 	glBindVertexArray(VAO);
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	hz_gpumem_buffer(VBO, sizeof(vertices), "vertices");
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+	hz_gpumem_buffer(EBO, sizeof(indices), "indices");
 	
 	/* vertex position attrib */
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(RNAT), (X0*)0);
@@ -252,15 +263,8 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 	glEnableVertexAttribArray(2);
 	
 	/* load da tex */
-	INAT tex_width, tex_height, nr_channels;
-	stbi_set_flip_vertically_on_load(1);
-	U8 *tex_data = stbi_load("assets/puckface.png", &tex_width, &tex_height, &nr_channels, 0);
-	UNAT puck_texture;
-	glGenTextures(1, &puck_texture);
-	glBindTexture(GL_TEXTURE_2D, puck_texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tex_width, tex_height, 0, GL_RGB, GL_UNSIGNED_BYTE, tex_data);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	stbi_image_free(tex_data);
+	UNAT puck_texture = hz_texture_load("assets/puckface.png", NULL, NULL);
+	if (!puck_texture) errwindow("Unable to load assets/puckface.png! Check the terminal output for details.");
 	
 	/* texture wrap + scale behavior */
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -311,12 +315,32 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 		glBindVertexArray(VAO);
 		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 		
+		/* Queue a readback of this frame if we're capturing. It has to happen before the swap. */
+		hz_capture_frame(primarywin.window);
+		if (hz_capture_done()) primarywin.quit = true;
+
 		/* Swap our buffer to display the current contents of buffer on screen.
 		 * Since we set SDL_GL_SetSwapInterval(1), this will use the monitor's refresh rate.
 		 */
 		SDL_GL_SwapWindow(primarywin.window);
+		hz_frame_end();
 	}
 
+	/* Dump GPU memory before the capture buffers go, so they're in it */
+	U1 within_budget = hz_gpumem_shutdown();
+	/* Flush out any frames still being read back. A capture that silently lost frames is worse than no capture. */
+	if (!hz_capture_shutdown()) errwindow("Frame capture failed! Check the terminal output for details.");
+	if (!within_budget) errwindow("Went over the GPU memory budget! Check the terminal output for details.");
+
+	glDeleteVertexArrays(1, &VAO);
+	hz_gpumem_free(HZ_GPUMEM_BUFFER, VBO);
+	glDeleteBuffers(1, &VBO);
+	hz_gpumem_free(HZ_GPUMEM_BUFFER, EBO);
+	glDeleteBuffers(1, &EBO);
+
+	/* Gives the frame arenas back and reports the most a frame needed */
+	hz_frame_shutdown();
+
 	/* Cleanup before exit, just in case. */
 	cleanup();
 
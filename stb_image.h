@@ -402,6 +402,24 @@ STBIDEF stbi_uc *stbi_load_from_file  (FILE *f, int *x, int *y, int *channels_in
 STBIDEF stbi_uc *stbi_load_gif_from_memory(stbi_uc const *buffer, int len, int **delays, int *x, int *y, int *z, int *comp, int req_comp);
 #endif
 
+// Decode straight into memory you own (a mapped PBO, a region of an atlas...)
+// instead of getting a new buffer back. Rows are 'stride' bytes apart (0 means
+// x*desired_channels), and 'out_size' bytes must cover all of them; get the
+// size up front with stbi_info. desired_channels of 0 means "whatever is in the
+// file", which you'd also need stbi_info for. Channel conversion and the
+// vertical flip happen while writing 'out', so there is no result to free and
+// no extra pass over the image. JPEGs are color converted directly into 'out';
+// other formats decode into their usual internal buffer first. Returns 1 on
+// success, 0 on failure (see stbi_failure_reason); 'out' may be partially
+// written on failure.
+STBIDEF int stbi_load_from_memory_into   (stbi_uc           const *buffer, int len   , stbi_uc *out, size_t out_size, int stride, int *x, int *y, int *channels_in_file, int desired_channels);
+STBIDEF int stbi_load_from_callbacks_into(stbi_io_callbacks const *clbk  , void *user, stbi_uc *out, size_t out_size, int stride, int *x, int *y, int *channels_in_file, int desired_channels);
+
+#ifndef STBI_NO_STDIO
+STBIDEF int stbi_load_into            (char const *filename, stbi_uc *out, size_t out_size, int stride, int *x, int *y, int *channels_in_file, int desired_channels);
+STBIDEF int stbi_load_from_file_into  (FILE *f             , stbi_uc *out, size_t out_size, int stride, int *x, int *y, int *channels_in_file, int desired_channels);
+#endif
+
 #ifdef STBI_WINDOWS_UTF8
 STBIDEF int stbi_convert_wchar_to_utf8(char *buffer, size_t bufferlen, const wchar_t* input);
 #endif
@@ -491,6 +509,20 @@ STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 // calling it will fail to link if your compiler doesn't
 STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_flip);
 
+// multithreaded decoding. stb_image never creates threads itself; it hands
+// batches of independent jobs to a runner you supply, which must call
+// fn(data, i) exactly once for every i in [0,count), on whatever threads it
+// likes, and return only once all of them are done. 'threads' is how many jobs
+// can really run at once, and decides how finely work gets split up. A NULL
+// runner (the default) decodes everything on the calling thread. Jobs never
+// allocate memory. Only the JPEG loader uses this so far: restart intervals of
+// baseline images loaded from memory are decoded in parallel, and the final
+// IDCT of progressive images, upsampling and color conversion are split into
+// row bands. Small images always decode on the calling thread.
+typedef void stbi_job_func(void *data, int index);
+typedef void stbi_job_runner(void *user, stbi_job_func *fn, void *data, int count);
+STBIDEF void stbi_set_job_runner(stbi_job_runner *runner, void *user, int threads);
+
 // ZLIB client - used by PNG, available for other purposes
 
 STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
@@ -610,12 +642,14 @@ typedef unsigned short stbi__uint16;
 typedef   signed short stbi__int16;
 typedef unsigned int   stbi__uint32;
 typedef   signed int   stbi__int32;
+typedef unsigned __int64 stbi__uint64;
 #else
 #include <stdint.h>
 typedef uint16_t stbi__uint16;
 typedef int16_t  stbi__int16;
 typedef uint32_t stbi__uint32;
 typedef int32_t  stbi__int32;
+typedef uint64_t stbi__uint64;
 #endif
 
 // should produce compiler error if size is wrong
@@ -739,6 +773,75 @@ static int stbi__sse2_available(void)
 #endif
 
 #endif
+
+// Extensions past SSE2 are only used from functions compiled for them (STBI__TARGET)
+// and only called after checking cpuid, so the rest of the file stays plain SSE2.
+#define STBI__CPU_SSE2   1
+#define STBI__CPU_SSSE3  2
+#define STBI__CPU_AVX2   4
+
+#if defined(__GNUC__) || defined(__clang__)
+#define STBI__TARGET(t) __attribute__((target(t)))
+#else
+#define STBI__TARGET(t)
+#endif
+
+#include <tmmintrin.h> // SSSE3
+#include <immintrin.h> // AVX2, _xgetbv
+
+#if !defined(STBI_NO_PNG) || !defined(STBI_NO_JPEG)
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+static int stbi__cpu_features_detect(void)
+{
+   int info[4], features, max_leaf;
+   __cpuid(info,0);
+   max_leaf = info[0];
+   __cpuid(info,1);
+   features = ((info[3] >> 26) & 1) ? STBI__CPU_SSE2 : 0;
+   if ((info[2] >> 9) & 1) features |= STBI__CPU_SSSE3;
+#if _MSC_VER >= 1800
+   // AVX2 also needs the OS to save the ymm registers (OSXSAVE, then XCR0 bits 1-2)
+   if (max_leaf >= 7 && ((info[2] >> 27) & 1) && (_xgetbv(0) & 6) == 6) {
+      __cpuidex(info,7,0);
+      if ((info[1] >> 5) & 1) features |= STBI__CPU_AVX2;
+   }
+#endif
+   return features;
+}
+#elif defined(_MSC_VER)
+static int stbi__cpu_features_detect(void)
+{
+   return ((stbi__cpuid3() >> 26) & 1) ? STBI__CPU_SSE2 : 0;
+}
+#else
+#include <cpuid.h>
+static int stbi__cpu_features_detect(void)
+{
+   unsigned int eax, ebx, ecx, edx, max_leaf = __get_cpuid_max(0, 0);
+   int features = STBI__CPU_SSE2; // see stbi__sse2_available
+   if (max_leaf < 1) return features;
+   __cpuid(1, eax, ebx, ecx, edx);
+   if ((ecx >> 9) & 1) features |= STBI__CPU_SSSE3;
+   if (max_leaf >= 7 && ((ecx >> 27) & 1)) {
+      unsigned int xcr0_lo, xcr0_hi;
+      __asm__ __volatile__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+      __cpuid_count(7, 0, eax, ebx, ecx, edx);
+      if ((xcr0_lo & 6) == 6 && ((ebx >> 5) & 1)) features |= STBI__CPU_AVX2;
+   }
+   return features;
+}
+#endif
+
+// cpuid is slow enough to notice when it runs for every image, so only ask once.
+// Threads racing here all store the same value.
+static int stbi__cpu_features(void)
+{
+   static int features = -1;
+   if (features < 0) features = stbi__cpu_features_detect();
+   return features;
+}
+#endif // !STBI_NO_PNG || !STBI_NO_JPEG
+
 #endif
 
 // ARM NEON
@@ -781,6 +884,11 @@ typedef struct
 
    stbi_uc *img_buffer, *img_buffer_end;
    stbi_uc *img_buffer_original, *img_buffer_original_end;
+
+   // stbi_load_*_into target. loaders that can write it themselves set into_written
+   stbi_uc *into;
+   size_t into_size;
+   int into_stride, into_comp, into_flip, into_written;
 } stbi__context;
 
 
@@ -794,6 +902,7 @@ static void stbi__start_mem(stbi__context *s, stbi_uc const *buffer, int len)
    s->callback_already_read = 0;
    s->img_buffer = s->img_buffer_original = (stbi_uc *) buffer;
    s->img_buffer_end = s->img_buffer_original_end = (stbi_uc *) buffer+len;
+   s->into = NULL;
 }
 
 // initialize a callback-based context
@@ -807,6 +916,7 @@ static void stbi__start_callbacks(stbi__context *s, stbi_io_callbacks *c, void *
    s->img_buffer = s->img_buffer_original = s->buffer_start;
    stbi__refill_buffer(s);
    s->img_buffer_original_end = s->img_buffer_end;
+   s->into = NULL;
 }
 
 #ifndef STBI_NO_STDIO
@@ -1080,6 +1190,32 @@ STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_fli
                                          : stbi__vertically_flip_on_load_global)
 #endif // STBI_THREAD_LOCAL
 
+static stbi_job_runner *stbi__job_runner;
+static void *stbi__job_user;
+static int stbi__job_threads = 1;
+
+STBIDEF void stbi_set_job_runner(stbi_job_runner *runner, void *user, int threads)
+{
+   stbi__job_runner = runner;
+   stbi__job_user = user;
+   stbi__job_threads = runner && threads > 1 ? threads : 1;
+}
+
+#ifndef STBI_NO_JPEG
+// images smaller than this aren't worth waking up other threads for
+#define STBI__JOBS_MIN_PIXELS  (256*256)
+
+static void stbi__run_jobs(stbi_job_func *fn, void *data, int count)
+{
+   int i;
+   if (stbi__job_runner && count > 1)
+      stbi__job_runner(stbi__job_user, fn, data, count);
+   else
+      for (i=0; i < count; ++i)
+         fn(data, i);
+}
+#endif
+
 static void *stbi__load_main(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri, int bpc)
 {
    memset(ri, 0, sizeof(*ri)); // make sure it's initialized if we add new fields
@@ -1250,6 +1386,93 @@ static stbi__uint16 *stbi__load_and_postprocess_16bit(stbi__context *s, int *x,
    return (stbi__uint16 *) result;
 }
 
+static int stbi__convert_row(unsigned char *dest, const unsigned char *src, int img_n, int req_comp, unsigned int x);
+#if !defined(STBI_NO_PNG) || !defined(STBI_NO_PSD)
+static stbi__uint16 *stbi__convert_format16(stbi__uint16 *data, int img_n, int req_comp, unsigned int x, unsigned int y);
+#endif
+
+// checks the stbi_load_*_into target can take a w*h image with n channels
+static int stbi__into_check(stbi__context *s, int w, int h, int n)
+{
+   if (s->into_stride == 0) s->into_stride = w*n;
+   if (s->into_stride < w*n) return stbi__err("bad stride", "Output stride is shorter than a row");
+   if ((size_t) s->into_stride * (h-1) + (size_t) w*n > s->into_size)
+      return stbi__err("buffer too small", "Output buffer is too small for the image");
+   return 1;
+}
+
+// where row j of an h row image goes in the stbi_load_*_into target
+static stbi_uc *stbi__into_row(stbi__context *s, int j, int h)
+{
+   return s->into + (size_t) s->into_stride * (s->into_flip ? h-1-j : j);
+}
+
+static int stbi__load_into_8bit(stbi__context *s, stbi_uc *out, size_t out_size, int stride, int *x, int *y, int *comp, int req_comp)
+{
+   stbi__result_info ri;
+   stbi_uc *result;
+   int w, h, img_n, src_n, n, j, loader_comp = 0;
+   size_t row_bytes;
+
+   if (req_comp < 0 || req_comp > 4) return stbi__err("bad req_comp", "Internal error");
+   s->into = out;
+   s->into_size = out_size;
+   s->into_stride = stride;
+   s->into_comp = req_comp;
+   s->into_flip = stbi__vertically_flip_on_load;
+   s->into_written = 0;
+
+   // loaders get req_comp 0 so they don't make a converted copy, we convert while writing 'out'.
+   // except HDR, which has its own idea of grey; that's not a texture path anyway
+   #ifndef STBI_NO_HDR
+   if (stbi__hdr_test(s)) loader_comp = req_comp;
+   #endif
+   result = (stbi_uc *) stbi__load_main(s, &w, &h, &img_n, loader_comp, &ri, 8);
+   if (result == NULL)
+      return 0;
+   if (x) *x = w;
+   if (y) *y = h;
+   if (comp) *comp = img_n;
+   if (s->into_written)
+      return 1;
+
+   STBI_ASSERT(ri.bits_per_channel == 8 || ri.bits_per_channel == 16);
+   src_n = loader_comp ? loader_comp : img_n;
+   n = req_comp ? req_comp : img_n;
+   if (!stbi__into_check(s, w, h, n)) {
+      STBI_FREE(result);
+      return 0;
+   }
+
+   #if !defined(STBI_NO_PNG) || !defined(STBI_NO_PSD)
+   if (ri.bits_per_channel == 16 && n != src_n) {
+      // grey from 16 bit samples rounds differently, so convert those at full depth like
+      // stbi_load does. 16 bit sources are rare enough that the extra copy doesn't matter
+      result = (stbi_uc *) stbi__convert_format16((stbi__uint16 *) result, src_n, n, w, h);
+      if (result == NULL) return 0;
+      src_n = n;
+   }
+   #endif
+
+   row_bytes = (size_t) w * src_n * (ri.bits_per_channel / 8);
+   for (j=0; j < h; ++j) {
+      stbi_uc *src = result + row_bytes * j;
+      if (ri.bits_per_channel == 16) {
+         // keep the top byte, like stbi__convert_16_to_8, packed down in place
+         stbi__uint16 *src16 = (stbi__uint16 *) src;
+         int i;
+         for (i=0; i < w*src_n; ++i)
+            src[i] = (stbi_uc) (src16[i] >> 8);
+      }
+      if (!stbi__convert_row(stbi__into_row(s, j, h), src, src_n, n, w)) {
+         STBI_FREE(result);
+         return stbi__err("unsupported", "Unsupported format conversion");
+      }
+   }
+   STBI_FREE(result);
+   return 1;
+}
+
 #if !defined(STBI_NO_HDR) && !defined(STBI_NO_LINEAR)
 static void stbi__float_postprocess(float *result, int *x, int *y, int *comp, int req_comp)
 {
@@ -1326,6 +1549,29 @@ STBIDEF stbi_uc *stbi_load_from_file(FILE *f, int *x, int *y, int *comp, int req
    return result;
 }
 
+STBIDEF int stbi_load_into(char const *filename, stbi_uc *out, size_t out_size, int stride, int *x, int *y, int *comp, int req_comp)
+{
+   FILE *f = stbi__fopen(filename, "rb");
+   int result;
+   if (!f) return stbi__err("can't fopen", "Unable to open file");
+   result = stbi_load_from_file_into(f,out,out_size,stride,x,y,comp,req_comp);
+   fclose(f);
+   return result;
+}
+
+STBIDEF int stbi_load_from_file_into(FILE *f, stbi_uc *out, size_t out_size, int stride, int *x, int *y, int *comp, int req_comp)
+{
+   int result;
+   stbi__context s;
+   stbi__start_file(&s,f);
+   result = stbi__load_into_8bit(&s,out,out_size,stride,x,y,comp,req_comp);
+   if (result) {
+      // need to 'unget' all the characters in the IO buffer
+      fseek(f, - (int) (s.img_buffer_end - s.img_buffer), SEEK_CUR);
+   }
+   return result;
+}
+
 STBIDEF stbi__uint16 *stbi_load_from_file_16(FILE *f, int *x, int *y, int *comp, int req_comp)
 {
    stbi__uint16 *result;
@@ -1380,6 +1626,20 @@ STBIDEF stbi_uc *stbi_load_from_callbacks(stbi_io_callbacks const *clbk, void *u
    return stbi__load_and_postprocess_8bit(&s,x,y,comp,req_comp);
 }
 
+STBIDEF int stbi_load_from_memory_into(stbi_uc const *buffer, int len, stbi_uc *out, size_t out_size, int stride, int *x, int *y, int *comp, int req_comp)
+{
+   stbi__context s;
+   stbi__start_mem(&s,buffer,len);
+   return stbi__load_into_8bit(&s,out,out_size,stride,x,y,comp,req_comp);
+}
+
+STBIDEF int stbi_load_from_callbacks_into(stbi_io_callbacks const *clbk, void *user, stbi_uc *out, size_t out_size, int stride, int *x, int *y, int *comp, int req_comp)
+{
+   stbi__context s;
+   stbi__start_callbacks(&s, (stbi_io_callbacks *) clbk, user);
+   return stbi__load_into_8bit(&s,out,out_size,stride,x,y,comp,req_comp);
+}
+
 #ifndef STBI_NO_GIF
 STBIDEF stbi_uc *stbi_load_gif_from_memory(stbi_uc const *buffer, int len, int **delays, int *x, int *y, int *z, int *comp, int req_comp)
 {
@@ -1668,9 +1928,6 @@ static stbi__uint32 stbi__get32le(stbi__context *s)
 
 #define STBI__BYTECAST(x)  ((stbi_uc) ((x) & 255))  // truncate int to byte without warnings
 
-#if defined(STBI_NO_JPEG) && defined(STBI_NO_PNG) && defined(STBI_NO_BMP) && defined(STBI_NO_PSD) && defined(STBI_NO_TGA) && defined(STBI_NO_GIF) && defined(STBI_NO_PIC) && defined(STBI_NO_PNM)
-// nothing
-#else
 //////////////////////////////////////////////////////////////////////////////
 //
 //  generic converter from built-in img_n to req_comp
@@ -1681,19 +1938,53 @@ static stbi__uint32 stbi__get32le(stbi__context *s)
 //
 //  assume data buffer is malloced, so malloc a new one and free that one
 //  only failure mode is malloc failing
+//
+//  stbi__convert_row is also the final write of the stbi_load_*_into path,
+//  which works with every format, so it and stbi__compute_y are always built
 
 static stbi_uc stbi__compute_y(int r, int g, int b)
 {
    return (stbi_uc) (((r*77) + (g*150) +  (29*b)) >> 8);
 }
-#endif
+
+// convert one row of x pixels; returns 0 for combinations we don't support
+static int stbi__convert_row(unsigned char *dest, const unsigned char *src, int img_n, int req_comp, unsigned int x)
+{
+   int i;
+   if (req_comp == img_n) {
+      memcpy(dest, src, (size_t) x * img_n);
+      return 1;
+   }
+
+   #define STBI__COMBO(a,b)  ((a)*8+(b))
+   #define STBI__CASE(a,b)   case STBI__COMBO(a,b): for(i=x-1; i >= 0; --i, src += a, dest += b)
+   // convert source image with img_n components to one with req_comp components;
+   // avoid switch per pixel, so use switch per scanline and massive macros
+   switch (STBI__COMBO(img_n, req_comp)) {
+      STBI__CASE(1,2) { dest[0]=src[0]; dest[1]=255;                                     } break;
+      STBI__CASE(1,3) { dest[0]=dest[1]=dest[2]=src[0];                                  } break;
+      STBI__CASE(1,4) { dest[0]=dest[1]=dest[2]=src[0]; dest[3]=255;                     } break;
+      STBI__CASE(2,1) { dest[0]=src[0];                                                  } break;
+      STBI__CASE(2,3) { dest[0]=dest[1]=dest[2]=src[0];                                  } break;
+      STBI__CASE(2,4) { dest[0]=dest[1]=dest[2]=src[0]; dest[3]=src[1];                  } break;
+      STBI__CASE(3,4) { dest[0]=src[0];dest[1]=src[1];dest[2]=src[2];dest[3]=255;        } break;
+      STBI__CASE(3,1) { dest[0]=stbi__compute_y(src[0],src[1],src[2]);                   } break;
+      STBI__CASE(3,2) { dest[0]=stbi__compute_y(src[0],src[1],src[2]); dest[1] = 255;    } break;
+      STBI__CASE(4,1) { dest[0]=stbi__compute_y(src[0],src[1],src[2]);                   } break;
+      STBI__CASE(4,2) { dest[0]=stbi__compute_y(src[0],src[1],src[2]); dest[1] = src[3]; } break;
+      STBI__CASE(4,3) { dest[0]=src[0];dest[1]=src[1];dest[2]=src[2];                    } break;
+      default: STBI_ASSERT(0); return 0;
+   }
+   #undef STBI__CASE
+   return 1;
+}
 
 #if defined(STBI_NO_PNG) && defined(STBI_NO_BMP) && defined(STBI_NO_PSD) && defined(STBI_NO_TGA) && defined(STBI_NO_GIF) && defined(STBI_NO_PIC) && defined(STBI_NO_PNM)
 // nothing
 #else
 static unsigned char *stbi__convert_format(unsigned char *data, int img_n, int req_comp, unsigned int x, unsigned int y)
 {
-   int i,j;
+   int j;
    unsigned char *good;
 
    if (req_comp == img_n) return data;
@@ -1706,29 +1997,11 @@ static unsigned char *stbi__convert_format(unsigned char *data, int img_n, int r
    }
 
    for (j=0; j < (int) y; ++j) {
-      unsigned char *src  = data + j * x * img_n   ;
-      unsigned char *dest = good + j * x * req_comp;
-
-      #define STBI__COMBO(a,b)  ((a)*8+(b))
-      #define STBI__CASE(a,b)   case STBI__COMBO(a,b): for(i=x-1; i >= 0; --i, src += a, dest += b)
-      // convert source image with img_n components to one with req_comp components;
-      // avoid switch per pixel, so use switch per scanline and massive macros
-      switch (STBI__COMBO(img_n, req_comp)) {
-         STBI__CASE(1,2) { dest[0]=src[0]; dest[1]=255;                                     } break;
-         STBI__CASE(1,3) { dest[0]=dest[1]=dest[2]=src[0];                                  } break;
-         STBI__CASE(1,4) { dest[0]=dest[1]=dest[2]=src[0]; dest[3]=255;                     } break;
-         STBI__CASE(2,1) { dest[0]=src[0];                                                  } break;
-         STBI__CASE(2,3) { dest[0]=dest[1]=dest[2]=src[0];                                  } break;
-         STBI__CASE(2,4) { dest[0]=dest[1]=dest[2]=src[0]; dest[3]=src[1];                  } break;
-         STBI__CASE(3,4) { dest[0]=src[0];dest[1]=src[1];dest[2]=src[2];dest[3]=255;        } break;
-         STBI__CASE(3,1) { dest[0]=stbi__compute_y(src[0],src[1],src[2]);                   } break;
-         STBI__CASE(3,2) { dest[0]=stbi__compute_y(src[0],src[1],src[2]); dest[1] = 255;    } break;
-         STBI__CASE(4,1) { dest[0]=stbi__compute_y(src[0],src[1],src[2]);                   } break;
-         STBI__CASE(4,2) { dest[0]=stbi__compute_y(src[0],src[1],src[2]); dest[1] = src[3]; } break;
-         STBI__CASE(4,3) { dest[0]=src[0];dest[1]=src[1];dest[2]=src[2];                    } break;
-         default: STBI_ASSERT(0); STBI_FREE(data); STBI_FREE(good); return stbi__errpuc("unsupported", "Unsupported format conversion");
+      if (!stbi__convert_row(good + j * x * req_comp, data + j * x * img_n, img_n, req_comp, x)) {
+         STBI_FREE(data);
+         STBI_FREE(good);
+         return stbi__errpuc("unsupported", "Unsupported format conversion");
       }
-      #undef STBI__CASE
    }
 
    STBI_FREE(data);
@@ -1932,11 +2205,14 @@ typedef struct
 
    int scan_n, order[4];
    int restart_interval, todo;
+   int bands; // row bands the final IDCT and color conversion get split into
 
 // kernels
    void (*idct_block_kernel)(stbi_uc *out, int out_stride, short data[64]);
    void (*YCbCr_to_RGB_kernel)(stbi_uc *out, const stbi_uc *y, const stbi_uc *pcb, const stbi_uc *pcr, int count, int step);
    stbi_uc *(*resample_row_hv_2_kernel)(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs);
+   // optional: idct of two horizontally adjacent blocks stored back to back, NULL if unavailable
+   void (*idct_block2_kernel)(stbi_uc *out, int out_stride, short data[128]);
 } stbi__jpeg;
 
 static int stbi__build_huffman(stbi__huffman *h, int *count)
@@ -2628,6 +2904,178 @@ static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
 #undef dct_pass
 }
 
+// avx2 version of the above for two horizontally adjacent blocks at once: the
+// first block's rows in the low 128-bit lane, the second's in the high lane.
+// every step is the sse2 one done per lane, so it's bit-identical to it.
+// 'data' holds the two blocks back to back.
+STBI__TARGET("avx2")
+static void stbi__idct_avx2(stbi_uc *out, int out_stride, short data[128])
+{
+   __m256i row0, row1, row2, row3, row4, row5, row6, row7;
+   __m256i tmp;
+
+   #define dct_const(x,y)  _mm256_setr_epi16((x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y))
+
+   #define dct_rot(out0,out1, x,y,c0,c1) \
+      __m256i c0##lo = _mm256_unpacklo_epi16((x),(y)); \
+      __m256i c0##hi = _mm256_unpackhi_epi16((x),(y)); \
+      __m256i out0##_l = _mm256_madd_epi16(c0##lo, c0); \
+      __m256i out0##_h = _mm256_madd_epi16(c0##hi, c0); \
+      __m256i out1##_l = _mm256_madd_epi16(c0##lo, c1); \
+      __m256i out1##_h = _mm256_madd_epi16(c0##hi, c1)
+
+   #define dct_widen(out, in) \
+      __m256i out##_l = _mm256_srai_epi32(_mm256_unpacklo_epi16(_mm256_setzero_si256(), (in)), 4); \
+      __m256i out##_h = _mm256_srai_epi32(_mm256_unpackhi_epi16(_mm256_setzero_si256(), (in)), 4)
+
+   #define dct_wadd(out, a, b) \
+      __m256i out##_l = _mm256_add_epi32(a##_l, b##_l); \
+      __m256i out##_h = _mm256_add_epi32(a##_h, b##_h)
+
+   #define dct_wsub(out, a, b) \
+      __m256i out##_l = _mm256_sub_epi32(a##_l, b##_l); \
+      __m256i out##_h = _mm256_sub_epi32(a##_h, b##_h)
+
+   #define dct_bfly32o(out0, out1, a,b,bias,s) \
+      { \
+         __m256i abiased_l = _mm256_add_epi32(a##_l, bias); \
+         __m256i abiased_h = _mm256_add_epi32(a##_h, bias); \
+         dct_wadd(sum, abiased, b); \
+         dct_wsub(dif, abiased, b); \
+         out0 = _mm256_packs_epi32(_mm256_srai_epi32(sum_l, s), _mm256_srai_epi32(sum_h, s)); \
+         out1 = _mm256_packs_epi32(_mm256_srai_epi32(dif_l, s), _mm256_srai_epi32(dif_h, s)); \
+      }
+
+   #define dct_interleave8(a, b) \
+      tmp = a; \
+      a = _mm256_unpacklo_epi8(a, b); \
+      b = _mm256_unpackhi_epi8(tmp, b)
+
+   #define dct_interleave16(a, b) \
+      tmp = a; \
+      a = _mm256_unpacklo_epi16(a, b); \
+      b = _mm256_unpackhi_epi16(tmp, b)
+
+   #define dct_pass(bias,shift) \
+      { \
+         /* even part */ \
+         dct_rot(t2e,t3e, row2,row6, rot0_0,rot0_1); \
+         __m256i sum04 = _mm256_add_epi16(row0, row4); \
+         __m256i dif04 = _mm256_sub_epi16(row0, row4); \
+         dct_widen(t0e, sum04); \
+         dct_widen(t1e, dif04); \
+         dct_wadd(x0, t0e, t3e); \
+         dct_wsub(x3, t0e, t3e); \
+         dct_wadd(x1, t1e, t2e); \
+         dct_wsub(x2, t1e, t2e); \
+         /* odd part */ \
+         dct_rot(y0o,y2o, row7,row3, rot2_0,rot2_1); \
+         dct_rot(y1o,y3o, row5,row1, rot3_0,rot3_1); \
+         __m256i sum17 = _mm256_add_epi16(row1, row7); \
+         __m256i sum35 = _mm256_add_epi16(row3, row5); \
+         dct_rot(y4o,y5o, sum17,sum35, rot1_0,rot1_1); \
+         dct_wadd(x4, y0o, y4o); \
+         dct_wadd(x5, y1o, y5o); \
+         dct_wadd(x6, y2o, y5o); \
+         dct_wadd(x7, y3o, y4o); \
+         dct_bfly32o(row0,row7, x0,x7,bias,shift); \
+         dct_bfly32o(row1,row6, x1,x6,bias,shift); \
+         dct_bfly32o(row2,row5, x2,x5,bias,shift); \
+         dct_bfly32o(row3,row4, x3,x4,bias,shift); \
+      }
+
+   // one row of each block
+   #define dct_load(r) \
+      _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_load_si128((const __m128i *) (data + (r)*8))), \
+                              _mm_load_si128((const __m128i *) (data + 64 + (r)*8)), 1)
+
+   // rows r and r+1 of both blocks are in p as (a.r, a.r+1 | b.r, b.r+1)
+   #define dct_store2(p) \
+      tmp = _mm256_permute4x64_epi64(p, 0xd8); \
+      _mm_storeu_si128((__m128i *) out, _mm256_castsi256_si128(tmp)); out += out_stride; \
+      _mm_storeu_si128((__m128i *) out, _mm256_extracti128_si256(tmp, 1)); out += out_stride
+
+   __m256i rot0_0 = dct_const(stbi__f2f(0.5411961f), stbi__f2f(0.5411961f) + stbi__f2f(-1.847759065f));
+   __m256i rot0_1 = dct_const(stbi__f2f(0.5411961f) + stbi__f2f( 0.765366865f), stbi__f2f(0.5411961f));
+   __m256i rot1_0 = dct_const(stbi__f2f(1.175875602f) + stbi__f2f(-0.899976223f), stbi__f2f(1.175875602f));
+   __m256i rot1_1 = dct_const(stbi__f2f(1.175875602f), stbi__f2f(1.175875602f) + stbi__f2f(-2.562915447f));
+   __m256i rot2_0 = dct_const(stbi__f2f(-1.961570560f) + stbi__f2f( 0.298631336f), stbi__f2f(-1.961570560f));
+   __m256i rot2_1 = dct_const(stbi__f2f(-1.961570560f), stbi__f2f(-1.961570560f) + stbi__f2f( 3.072711026f));
+   __m256i rot3_0 = dct_const(stbi__f2f(-0.390180644f) + stbi__f2f( 2.053119869f), stbi__f2f(-0.390180644f));
+   __m256i rot3_1 = dct_const(stbi__f2f(-0.390180644f), stbi__f2f(-0.390180644f) + stbi__f2f( 1.501321110f));
+
+   __m256i bias_0 = _mm256_set1_epi32(512);
+   __m256i bias_1 = _mm256_set1_epi32(65536 + (128<<17));
+
+   row0 = dct_load(0);
+   row1 = dct_load(1);
+   row2 = dct_load(2);
+   row3 = dct_load(3);
+   row4 = dct_load(4);
+   row5 = dct_load(5);
+   row6 = dct_load(6);
+   row7 = dct_load(7);
+
+   // column pass
+   dct_pass(bias_0, 10);
+
+   {
+      // 16bit 8x8 transposes, one per lane
+      dct_interleave16(row0, row4);
+      dct_interleave16(row1, row5);
+      dct_interleave16(row2, row6);
+      dct_interleave16(row3, row7);
+
+      dct_interleave16(row0, row2);
+      dct_interleave16(row1, row3);
+      dct_interleave16(row4, row6);
+      dct_interleave16(row5, row7);
+
+      dct_interleave16(row0, row1);
+      dct_interleave16(row2, row3);
+      dct_interleave16(row4, row5);
+      dct_interleave16(row6, row7);
+   }
+
+   // row pass
+   dct_pass(bias_1, 17);
+
+   {
+      __m256i p0 = _mm256_packus_epi16(row0, row1);
+      __m256i p1 = _mm256_packus_epi16(row2, row3);
+      __m256i p2 = _mm256_packus_epi16(row4, row5);
+      __m256i p3 = _mm256_packus_epi16(row6, row7);
+
+      // 8bit 8x8 transposes, one per lane
+      dct_interleave8(p0, p2);
+      dct_interleave8(p1, p3);
+
+      dct_interleave8(p0, p1);
+      dct_interleave8(p2, p3);
+
+      dct_interleave8(p0, p2);
+      dct_interleave8(p1, p3);
+
+      // the two blocks sit side by side, so each output row is 16 contiguous bytes
+      dct_store2(p0);
+      dct_store2(p2);
+      dct_store2(p1);
+      dct_store2(p3);
+   }
+
+#undef dct_const
+#undef dct_rot
+#undef dct_widen
+#undef dct_wadd
+#undef dct_wsub
+#undef dct_bfly32o
+#undef dct_interleave8
+#undef dct_interleave16
+#undef dct_pass
+#undef dct_load
+#undef dct_store2
+}
+
 #endif // STBI_SSE2
 
 #ifdef STBI_NEON
@@ -2872,8 +3320,135 @@ static void stbi__jpeg_reset(stbi__jpeg *j)
    // since we don't even allow 1<<30 pixels
 }
 
+// decode 'count' MCUs of a baseline scan starting at MCU number 'mcu', without
+// any restart handling. used for the restart intervals of a parallel decode
+static int stbi__jpeg_decode_mcus(stbi__jpeg *z, int mcu, int count)
+{
+   STBI_SIMD_ALIGN(short, data[128]);
+   int k,x,y;
+   for (; count > 0; --count, ++mcu) {
+      if (z->scan_n == 1) {
+         int n = z->order[0];
+         int w = (z->img_comp[n].x+7) >> 3;
+         int i = mcu % w, j = mcu / w;
+         int ha = z->img_comp[n].ha;
+         if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+         z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+      } else {
+         int i = mcu % z->img_mcu_x, j = mcu / z->img_mcu_x;
+         for (k=0; k < z->scan_n; ++k) {
+            int n = z->order[k];
+            int pair = z->idct_block2_kernel && !(z->img_comp[n].h & 1);
+            for (y=0; y < z->img_comp[n].v; ++y) {
+               for (x=0; x < z->img_comp[n].h; ++x) {
+                  int x2 = (i*z->img_comp[n].h + x)*8;
+                  int y2 = (j*z->img_comp[n].v + y)*8;
+                  int ha = z->img_comp[n].ha;
+                  short *block = pair ? data + 64*(x & 1) : data;
+                  if (!stbi__jpeg_decode_block(z, block, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+                  if (!pair)
+                     z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
+                  else if (x & 1)
+                     z->idct_block2_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2-8, z->img_comp[n].w2, data);
+               }
+            }
+         }
+      }
+   }
+   return 1;
+}
+
+typedef struct
+{
+   stbi__jpeg *z;
+   stbi_uc **seg;   // interval i is the entropy coded data from seg[i] up to seg[i+1]
+   int *ok;         // one per job
+   int intervals, mcus, per_job;
+} stbi__jpeg_intervals;
+
+static void stbi__jpeg_interval_job(void *data, int index)
+{
+   stbi__jpeg_intervals *iv = (stbi__jpeg_intervals *) data;
+   stbi__context s;
+   stbi__jpeg j = *iv->z; // private bit reader and dc predictors, shared tables and output
+   int r = iv->z->restart_interval;
+   int i = index * iv->per_job;
+   int end = i + iv->per_job < iv->intervals ? i + iv->per_job : iv->intervals;
+   j.s = &s;
+   iv->ok[index] = 1;
+   for (; i < end; ++i) {
+      // each slice ends on the next RST marker, which stops the bit reader just
+      // like it would in a serial decode
+      stbi__start_mem(&s, iv->seg[i], (int) (iv->seg[i+1] - iv->seg[i]));
+      stbi__jpeg_reset(&j);
+      if (!stbi__jpeg_decode_mcus(&j, i * r, r < iv->mcus - i * r ? r : iv->mcus - i * r)) {
+         iv->ok[index] = 0;
+         return;
+      }
+   }
+}
+
+// decode a baseline scan with restart intervals on the job runner. the
+// intervals are found by scanning the (memory) input for RST markers up front.
+// returns -1 if the markers don't add up, so the caller decodes serially and
+// gets to handle the damage the way it always has
+static int stbi__jpeg_parse_parallel(stbi__jpeg *z)
+{
+   stbi__jpeg_intervals iv;
+   stbi_uc *p = z->s->img_buffer, *end = z->s->img_buffer_end, *eoi = NULL;
+   int i, k = 1, jobs, ok = 1;
+
+   if (z->scan_n == 1) {
+      int n = z->order[0];
+      iv.mcus = ((z->img_comp[n].x+7) >> 3) * ((z->img_comp[n].y+7) >> 3);
+   } else
+      iv.mcus = z->img_mcu_x * z->img_mcu_y;
+   iv.intervals = (iv.mcus + z->restart_interval - 1) / z->restart_interval;
+   if (iv.intervals < 2) return -1;
+
+   iv.per_job = (iv.intervals + stbi__job_threads*4 - 1) / (stbi__job_threads*4);
+   jobs = (iv.intervals + iv.per_job - 1) / iv.per_job;
+   iv.seg = (stbi_uc **) stbi__malloc_mad2(iv.intervals + 1, sizeof(stbi_uc *), jobs * sizeof(int));
+   if (!iv.seg) return stbi__err("outofmem", "Out of memory");
+   iv.ok = (int *) (iv.seg + iv.intervals + 1);
+   iv.z = z;
+
+   iv.seg[0] = p;
+   while (p < end && (p = (stbi_uc *) memchr(p, 0xff, end - p)) != NULL) {
+      stbi_uc *q = p + 1;
+      while (q < end && *q == 0xff) ++q; // fill bytes
+      if (q == end) break;
+      if (*q == 0) { p = q + 1; continue; } // stuffed zero
+      if (!STBI__RESTART(*q)) { eoi = q - 1; break; }
+      if (k == iv.intervals) break;
+      iv.seg[k++] = p = q + 1;
+   }
+   if (!eoi || k != iv.intervals) {
+      STBI_FREE(iv.seg);
+      return -1;
+   }
+   iv.seg[k] = eoi;
+
+   stbi__run_jobs(stbi__jpeg_interval_job, &iv, jobs);
+   for (i=0; i < jobs; ++i)
+      ok &= iv.ok[i];
+   STBI_FREE(iv.seg);
+   if (!ok) return stbi__err("bad huffman code","Corrupt JPEG");
+
+   // leave the stream at the 0xff of the marker that ends the scan, which is
+   // where stbi__decode_jpeg_image looks for it when no marker is pending
+   stbi__jpeg_reset(z);
+   z->s->img_buffer = eoi;
+   return 1;
+}
+
 static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
 {
+   if (!z->progressive && z->restart_interval && stbi__job_threads > 1 && !z->s->read_from_callbacks
+       && z->s->img_x * z->s->img_y >= STBI__JOBS_MIN_PIXELS) {
+      int r = stbi__jpeg_parse_parallel(z);
+      if (r >= 0) return r;
+   }
    stbi__jpeg_reset(z);
    if (!z->progressive) {
       if (z->scan_n == 1) {
@@ -2904,12 +3479,15 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
          return 1;
       } else { // interleaved
          int i,j,k,x,y;
-         STBI_SIMD_ALIGN(short, data[64]);
+         STBI_SIMD_ALIGN(short, data[128]);
          for (j=0; j < z->img_mcu_y; ++j) {
             for (i=0; i < z->img_mcu_x; ++i) {
                // scan an interleaved mcu... process scan_n components in order
                for (k=0; k < z->scan_n; ++k) {
                   int n = z->order[k];
+                  // with an even number of blocks across, decode them in pairs so a
+                  // two-block idct kernel can do both at once
+                  int pair = z->idct_block2_kernel && !(z->img_comp[n].h & 1);
                   // scan out an mcu's worth of this component; that's just determined
                   // by the basic H and V specified for the component
                   for (y=0; y < z->img_comp[n].v; ++y) {
@@ -2917,8 +3495,12 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
                         int x2 = (i*z->img_comp[n].h + x)*8;
                         int y2 = (j*z->img_comp[n].v + y)*8;
                         int ha = z->img_comp[n].ha;
-                        if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
+                        short *block = pair ? data + 64*(x & 1) : data;
+                        if (!stbi__jpeg_decode_block(z, block, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+                        if (!pair)
+                           z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
+                        else if (x & 1)
+                           z->idct_block2_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2-8, z->img_comp[n].w2, data);
                      }
                   }
                }
@@ -3003,18 +3585,34 @@ static void stbi__jpeg_dequantize(short *data, stbi__uint16 *dequant)
       data[i] *= dequant[i];
 }
 
-static void stbi__jpeg_finish(stbi__jpeg *z)
-{
-   if (z->progressive) {
-      // dequantize and idct the data
-      int i,j,n;
-      for (n=0; n < z->s->img_n; ++n) {
-         int w = (z->img_comp[n].x+7) >> 3;
-         int h = (z->img_comp[n].y+7) >> 3;
-         for (j=0; j < h; ++j) {
-            for (i=0; i < w; ++i) {
-               short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
-               stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
+// how many row bands to split per-pixel work into, given the job runner
+static int stbi__jpeg_bands(stbi__jpeg *z)
+{
+   int bands = stbi__job_threads * 2;
+   if (stbi__job_threads == 1 || z->s->img_x * z->s->img_y < STBI__JOBS_MIN_PIXELS) return 1;
+   if (bands > (int) z->s->img_y / 16) bands = z->s->img_y / 16; // no slivers
+   return bands > 1 ? bands : 1;
+}
+
+// dequantize and idct block rows of band 'band' of every component
+static void stbi__jpeg_finish_band(void *data, int band)
+{
+   stbi__jpeg *z = (stbi__jpeg *) data;
+   int i,j,n;
+   for (n=0; n < z->s->img_n; ++n) {
+      int w = (z->img_comp[n].x+7) >> 3;
+      int h = (z->img_comp[n].y+7) >> 3;
+      int j0 = h * band / z->bands, j1 = h * (band+1) / z->bands;
+      for (j=j0; j < j1; ++j) {
+         for (i=0; i < w; ++i) {
+            short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
+            stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
+            if (z->idct_block2_kernel && i+1 < w) {
+               // neighbouring blocks are already back to back in coeff
+               stbi__jpeg_dequantize(data+64, z->dequant[z->img_comp[n].tq]);
+               z->idct_block2_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               ++i;
+            } else {
                z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
             }
          }
@@ -3022,6 +3620,14 @@ static void stbi__jpeg_finish(stbi__jpeg *z)
    }
 }
 
+static void stbi__jpeg_finish(stbi__jpeg *z)
+{
+   if (z->progressive) {
+      z->bands = stbi__jpeg_bands(z);
+      stbi__run_jobs(stbi__jpeg_finish_band, z, z->bands);
+   }
+}
+
 static int stbi__process_marker(stbi__jpeg *z, int m)
 {
    int L;
@@ -3542,6 +4148,75 @@ static stbi_uc *stbi__resample_row_hv_2_simd(stbi_uc *out, stbi_uc *in_near, stb
 }
 #endif
 
+#ifdef STBI_SSE2
+// avx2 version of the above, 16 pixels per iteration. the filter is exact in 16 bits,
+// so the scalar tail gives the same results the sse2 loop would.
+STBI__TARGET("avx2")
+static stbi_uc *stbi__resample_row_hv_2_avx2(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
+{
+   int i=0,t0,t1;
+
+   if (w == 1) {
+      out[0] = out[1] = stbi__div4(3*in_near[0] + in_far[0] + 2);
+      return out;
+   }
+
+   t1 = 3*in_near[0] + in_far[0];
+   for (; i < ((w-1) & ~15); i += 16) {
+      // vertical pass, 3*x + y = 4*x + (y - x)
+      __m256i farw  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i)));
+      __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i)));
+      __m256i diff  = _mm256_sub_epi16(farw, nearw);
+      __m256i nears = _mm256_slli_epi16(nearw, 2);
+      __m256i curr  = _mm256_add_epi16(nears, diff);
+
+      // shift by one pixel across the lane boundary: alignr only shifts within
+      // each 128-bit lane, so pair it with the neighbouring lane
+      __m256i lo0  = _mm256_permute2x128_si256(curr, curr, 0x08); // (0, curr.lo)
+      __m256i hi0  = _mm256_permute2x128_si256(curr, curr, 0x81); // (curr.hi, 0)
+      __m256i prv0 = _mm256_alignr_epi8(curr, lo0, 14);
+      __m256i nxt0 = _mm256_alignr_epi8(hi0, curr, 2);
+      __m256i prev = _mm256_insert_epi16(prv0, t1, 0);
+      __m256i next = _mm256_insert_epi16(nxt0, 3*in_near[i+16] + in_far[i+16], 15);
+
+      // horizontal pass, same polyphase filter as the sse2 version
+      __m256i bias = _mm256_set1_epi16(8);
+      __m256i curs = _mm256_slli_epi16(curr, 2);
+      __m256i prvd = _mm256_sub_epi16(prev, curr);
+      __m256i nxtd = _mm256_sub_epi16(next, curr);
+      __m256i curb = _mm256_add_epi16(curs, bias);
+      __m256i even = _mm256_add_epi16(prvd, curb);
+      __m256i odd  = _mm256_add_epi16(nxtd, curb);
+
+      // interleave and pack; each lane ends up holding 8 consecutive output pixel pairs
+      __m256i int0 = _mm256_unpacklo_epi16(even, odd);
+      __m256i int1 = _mm256_unpackhi_epi16(even, odd);
+      __m256i de0  = _mm256_srli_epi16(int0, 4);
+      __m256i de1  = _mm256_srli_epi16(int1, 4);
+      __m256i outv = _mm256_packus_epi16(de0, de1);
+      _mm256_storeu_si256((__m256i *) (out + i*2), outv);
+
+      t1 = 3*in_near[i+15] + in_far[i+15];
+   }
+
+   t0 = t1;
+   t1 = 3*in_near[i] + in_far[i];
+   out[i*2] = stbi__div16(3*t1 + t0 + 8);
+
+   for (++i; i < w; ++i) {
+      t0 = t1;
+      t1 = 3*in_near[i]+in_far[i];
+      out[i*2-1] = stbi__div16(3*t0 + t1 + 8);
+      out[i*2  ] = stbi__div16(3*t1 + t0 + 8);
+   }
+   out[w*2-1] = stbi__div4(t1+2);
+
+   STBI_NOTUSED(hs);
+
+   return out;
+}
+#endif
+
 static stbi_uc *stbi__resample_row_generic(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
 {
    // resample with nearest-neighbor
@@ -3716,18 +4391,92 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 }
 #endif
 
+#ifdef STBI_SSE2
+// avx2 version of the step == 4 case above, 16 pixels per iteration. the math is
+// the sse2 math per 16-bit lane; the rest of the row goes through the sse2 kernel.
+STBI__TARGET("avx2")
+static void stbi__YCbCr_to_RGB_avx2(stbi_uc *out, stbi_uc const *y, stbi_uc const *pcb, stbi_uc const *pcr, int count, int step)
+{
+   int i = 0;
+
+   if (step == 4) {
+      __m128i signflip  = _mm_set1_epi8(-0x80);
+      __m256i cr_const0 = _mm256_set1_epi16(   (short) ( 1.40200f*4096.0f+0.5f));
+      __m256i cr_const1 = _mm256_set1_epi16( - (short) ( 0.71414f*4096.0f+0.5f));
+      __m256i cb_const0 = _mm256_set1_epi16( - (short) ( 0.34414f*4096.0f+0.5f));
+      __m256i cb_const1 = _mm256_set1_epi16(   (short) ( 1.77200f*4096.0f+0.5f));
+      __m256i y_bias = _mm256_set1_epi16(128);
+      __m256i xw = _mm256_set1_epi16(255); // alpha channel
+
+      for (; i+15 < count; i += 16) {
+         // load
+         __m128i y_bytes = _mm_loadu_si128((__m128i *) (y+i));
+         __m128i cr_bytes = _mm_loadu_si128((__m128i *) (pcr+i));
+         __m128i cb_bytes = _mm_loadu_si128((__m128i *) (pcb+i));
+         __m128i cr_biased = _mm_xor_si128(cr_bytes, signflip); // -128
+         __m128i cb_biased = _mm_xor_si128(cb_bytes, signflip); // -128
+
+         // widen to short, byte in the high half like the sse2 unpack does
+         __m256i yw  = _mm256_or_si256(_mm256_slli_epi16(_mm256_cvtepu8_epi16(y_bytes), 8), y_bias);
+         __m256i crw = _mm256_slli_epi16(_mm256_cvtepu8_epi16(cr_biased), 8);
+         __m256i cbw = _mm256_slli_epi16(_mm256_cvtepu8_epi16(cb_biased), 8);
+
+         // color transform
+         __m256i yws = _mm256_srli_epi16(yw, 4);
+         __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+         __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+         __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+         __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+         __m256i rws = _mm256_add_epi16(cr0, yws);
+         __m256i gwt = _mm256_add_epi16(cb0, yws);
+         __m256i bws = _mm256_add_epi16(yws, cb1);
+         __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+         // descale
+         __m256i rw = _mm256_srai_epi16(rws, 4);
+         __m256i bw = _mm256_srai_epi16(bws, 4);
+         __m256i gw = _mm256_srai_epi16(gws, 4);
+
+         // back to byte, set up for transpose
+         __m256i brb = _mm256_packus_epi16(rw, bw);
+         __m256i gxb = _mm256_packus_epi16(gw, xw);
+
+         // transpose to interleave channels; pixels 0-3 and 8-11 land in o0,
+         // 4-7 and 12-15 in o1
+         __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+         __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+         __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+         __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+
+         // store
+         _mm256_storeu_si256((__m256i *) (out + 0), _mm256_permute2x128_si256(o0, o1, 0x20));
+         _mm256_storeu_si256((__m256i *) (out + 32), _mm256_permute2x128_si256(o0, o1, 0x31));
+         out += 64;
+      }
+   }
+
+   stbi__YCbCr_to_RGB_simd(out, y+i, pcb+i, pcr+i, count-i, step);
+}
+#endif
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
    j->idct_block_kernel = stbi__idct_block;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_row;
    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
+   j->idct_block2_kernel = NULL;
 
 #ifdef STBI_SSE2
    if (stbi__sse2_available()) {
       j->idct_block_kernel = stbi__idct_simd;
       j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
       j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+      if (stbi__cpu_features() & STBI__CPU_AVX2) {
+         j->idct_block2_kernel = stbi__idct_avx2;
+         j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+         j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_avx2;
+      }
    }
 #endif
 
@@ -3761,6 +4510,152 @@ static stbi_uc stbi__blinn_8x8(stbi_uc x, stbi_uc y)
    return (stbi_uc) ((t + (t >>8)) >> 8);
 }
 
+// color convert one row of resampled components into 'out'
+static void stbi__jpeg_convert_row(stbi__jpeg *z, stbi_uc *out, stbi_uc *coutput[4], int n, int is_rgb)
+{
+   unsigned int i;
+   if (n >= 3) {
+      stbi_uc *y = coutput[0];
+      if (z->s->img_n == 3) {
+         if (is_rgb) {
+            for (i=0; i < z->s->img_x; ++i) {
+               out[0] = y[i];
+               out[1] = coutput[1][i];
+               out[2] = coutput[2][i];
+               out[3] = 255;
+               out += n;
+            }
+         } else {
+            z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+         }
+      } else if (z->s->img_n == 4) {
+         if (z->app14_color_transform == 0) { // CMYK
+            for (i=0; i < z->s->img_x; ++i) {
+               stbi_uc m = coutput[3][i];
+               out[0] = stbi__blinn_8x8(coutput[0][i], m);
+               out[1] = stbi__blinn_8x8(coutput[1][i], m);
+               out[2] = stbi__blinn_8x8(coutput[2][i], m);
+               out[3] = 255;
+               out += n;
+            }
+         } else if (z->app14_color_transform == 2) { // YCCK
+            z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+            for (i=0; i < z->s->img_x; ++i) {
+               stbi_uc m = coutput[3][i];
+               out[0] = stbi__blinn_8x8(255 - out[0], m);
+               out[1] = stbi__blinn_8x8(255 - out[1], m);
+               out[2] = stbi__blinn_8x8(255 - out[2], m);
+               out += n;
+            }
+         } else { // YCbCr + alpha?  Ignore the fourth channel for now
+            z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+         }
+      } else
+         for (i=0; i < z->s->img_x; ++i) {
+            out[0] = out[1] = out[2] = y[i];
+            out[3] = 255; // not used if n==3
+            out += n;
+         }
+   } else {
+      if (is_rgb) {
+         if (n == 1)
+            for (i=0; i < z->s->img_x; ++i)
+               *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+         else {
+            for (i=0; i < z->s->img_x; ++i, out += 2) {
+               out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+               out[1] = 255;
+            }
+         }
+      } else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
+         for (i=0; i < z->s->img_x; ++i) {
+            stbi_uc m = coutput[3][i];
+            stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
+            stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
+            stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
+            out[0] = stbi__compute_y(r, g, b);
+            if (n == 2) out[1] = 255; // n == 1 must not touch the byte past the row, it might be the end of 'into'
+            out += n;
+         }
+      } else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
+         for (i=0; i < z->s->img_x; ++i) {
+            out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
+            if (n == 2) out[1] = 255;
+            out += n;
+         }
+      } else {
+         stbi_uc *y = coutput[0];
+         if (n == 1)
+            for (i=0; i < z->s->img_x; ++i) out[i] = y[i];
+         else
+            for (i=0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
+      }
+   }
+}
+
+// step a resampler past 'rows' output rows
+static void stbi__resample_skip(stbi__resample *r, int comp_y, int w2, int rows)
+{
+   for (; rows > 0; --rows) {
+      if (++r->ystep >= r->vs) {
+         r->ystep = 0;
+         r->line0 = r->line1;
+         if (++r->ypos < comp_y)
+            r->line1 += w2;
+      }
+   }
+}
+
+typedef struct
+{
+   stbi__jpeg *z;
+   stbi__resample res_comp[4]; // as of output row 0
+   stbi_uc *lines;             // per band: decode_n resample line buffers, then a row buffer if n == 3
+   stbi_uc *output;
+   size_t band_size;
+   int n, decode_n, is_rgb;
+} stbi__jpeg_convert;
+
+// resample and color convert the rows of band 'band'
+static void stbi__jpeg_convert_band(void *data, int band)
+{
+   stbi__jpeg_convert *c = (stbi__jpeg_convert *) data;
+   stbi__jpeg *z = c->z;
+   stbi__resample res_comp[4];
+   stbi_uc *coutput[4] = { NULL, NULL, NULL, NULL };
+   stbi_uc *linebuf = c->lines + c->band_size * band;
+   stbi_uc *rowbuf = c->n == 3 ? linebuf + (size_t) c->decode_n * (z->s->img_x + 3) : NULL;
+   int n = c->n, k;
+   unsigned int j;
+   unsigned int j0 = (unsigned int) ((size_t) z->s->img_y * band / z->bands);
+   unsigned int j1 = (unsigned int) ((size_t) z->s->img_y * (band+1) / z->bands);
+
+   for (k=0; k < c->decode_n; ++k) {
+      res_comp[k] = c->res_comp[k];
+      stbi__resample_skip(&res_comp[k], z->img_comp[k].y, z->img_comp[k].w2, j0);
+   }
+
+   for (j=j0; j < j1; ++j) {
+      stbi_uc *dest = z->s->into ? stbi__into_row(z->s, j, z->s->img_y) : c->output + n * z->s->img_x * j;
+      // the 3 channel loops write a 4th byte past the last pixel. that's the
+      // next row's first byte, harmless unless the next row is in another band
+      // that's already done with it, or the row is in memory that isn't ours
+      stbi_uc *out = rowbuf && (z->s->into || j == j1-1) ? rowbuf : dest;
+      for (k=0; k < c->decode_n; ++k) {
+         stbi__resample *r = &res_comp[k];
+         int y_bot = r->ystep >= (r->vs >> 1);
+         coutput[k] = r->resample(linebuf + (size_t) k * (z->s->img_x + 3),
+                                  y_bot ? r->line1 : r->line0,
+                                  y_bot ? r->line0 : r->line1,
+                                  r->w_lores, r->hs);
+         stbi__resample_skip(r, z->img_comp[k].y, z->img_comp[k].w2, 1);
+      }
+      stbi__jpeg_convert_row(z, out, coutput, n, c->is_rgb);
+      if (out != dest)
+         memcpy(dest, out, n * z->s->img_x);
+   }
+}
+
 static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
 {
    int n, decode_n, is_rgb;
@@ -3785,19 +4680,16 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
    // resample and color-convert
    {
       int k;
-      unsigned int i,j;
       stbi_uc *output;
-      stbi_uc *coutput[4] = { NULL, NULL, NULL, NULL };
+      stbi__jpeg_convert c;
 
-      stbi__resample res_comp[4];
+      c.z = z;
+      c.n = n;
+      c.decode_n = decode_n;
+      c.is_rgb = is_rgb;
 
       for (k=0; k < decode_n; ++k) {
-         stbi__resample *r = &res_comp[k];
-
-         // allocate line buffer big enough for upsampling off the edges
-         // with upsample factor of 4
-         z->img_comp[k].linebuf = (stbi_uc *) stbi__malloc(z->s->img_x + 3);
-         if (!z->img_comp[k].linebuf) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
+         stbi__resample *r = &c.res_comp[k];
 
          r->hs      = z->img_h_max / z->img_comp[k].h;
          r->vs      = z->img_v_max / z->img_comp[k].v;
@@ -3813,105 +4705,32 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
          else                               r->resample = stbi__resample_row_generic;
       }
 
-      // can't error after this so, this is safe
-      output = (stbi_uc *) stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
-      if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
-
-      // now go ahead and resample
-      for (j=0; j < z->s->img_y; ++j) {
-         stbi_uc *out = output + n * z->s->img_x * j;
-         for (k=0; k < decode_n; ++k) {
-            stbi__resample *r = &res_comp[k];
-            int y_bot = r->ystep >= (r->vs >> 1);
-            coutput[k] = r->resample(z->img_comp[k].linebuf,
-                                     y_bot ? r->line1 : r->line0,
-                                     y_bot ? r->line0 : r->line1,
-                                     r->w_lores, r->hs);
-            if (++r->ystep >= r->vs) {
-               r->ystep = 0;
-               r->line0 = r->line1;
-               if (++r->ypos < z->img_comp[k].y)
-                  r->line1 += z->img_comp[k].w2;
-            }
-         }
-         if (n >= 3) {
-            stbi_uc *y = coutput[0];
-            if (z->s->img_n == 3) {
-               if (is_rgb) {
-                  for (i=0; i < z->s->img_x; ++i) {
-                     out[0] = y[i];
-                     out[1] = coutput[1][i];
-                     out[2] = coutput[2][i];
-                     out[3] = 255;
-                     out += n;
-                  }
-               } else {
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-               }
-            } else if (z->s->img_n == 4) {
-               if (z->app14_color_transform == 0) { // CMYK
-                  for (i=0; i < z->s->img_x; ++i) {
-                     stbi_uc m = coutput[3][i];
-                     out[0] = stbi__blinn_8x8(coutput[0][i], m);
-                     out[1] = stbi__blinn_8x8(coutput[1][i], m);
-                     out[2] = stbi__blinn_8x8(coutput[2][i], m);
-                     out[3] = 255;
-                     out += n;
-                  }
-               } else if (z->app14_color_transform == 2) { // YCCK
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                  for (i=0; i < z->s->img_x; ++i) {
-                     stbi_uc m = coutput[3][i];
-                     out[0] = stbi__blinn_8x8(255 - out[0], m);
-                     out[1] = stbi__blinn_8x8(255 - out[1], m);
-                     out[2] = stbi__blinn_8x8(255 - out[2], m);
-                     out += n;
-                  }
-               } else { // YCbCr + alpha?  Ignore the fourth channel for now
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-               }
-            } else
-               for (i=0; i < z->s->img_x; ++i) {
-                  out[0] = out[1] = out[2] = y[i];
-                  out[3] = 255; // not used if n==3
-                  out += n;
-               }
-         } else {
-            if (is_rgb) {
-               if (n == 1)
-                  for (i=0; i < z->s->img_x; ++i)
-                     *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-               else {
-                  for (i=0; i < z->s->img_x; ++i, out += 2) {
-                     out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-                     out[1] = 255;
-                  }
-               }
-            } else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
-               for (i=0; i < z->s->img_x; ++i) {
-                  stbi_uc m = coutput[3][i];
-                  stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
-                  stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
-                  stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
-                  out[0] = stbi__compute_y(r, g, b);
-                  out[1] = 255;
-                  out += n;
-               }
-            } else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
-               for (i=0; i < z->s->img_x; ++i) {
-                  out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
-                  out[1] = 255;
-                  out += n;
-               }
-            } else {
-               stbi_uc *y = coutput[0];
-               if (n == 1)
-                  for (i=0; i < z->s->img_x; ++i) out[i] = y[i];
-               else
-                  for (i=0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
-            }
-         }
+      if (z->s->into) {
+         // color convert straight into the caller's buffer
+         if (!stbi__into_check(z->s, z->s->img_x, z->s->img_y, n)) { stbi__cleanup_jpeg(z); return NULL; }
+         output = z->s->into;
+      } else {
+         output = (stbi_uc *) stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
+         if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
+      }
+      c.output = output;
+
+      // every band gets its own line buffers, big enough for upsampling off the
+      // edges with upsample factor of 4
+      z->bands = stbi__jpeg_bands(z);
+      c.band_size = (size_t) decode_n * (z->s->img_x + 3) + (n == 3 ? (size_t) 4 * z->s->img_x : 0);
+      c.lines = (stbi_uc *) stbi__malloc_mad2(z->bands, (int) c.band_size, 0);
+      if (!c.lines) {
+         if (!z->s->into) STBI_FREE(output);
+         stbi__cleanup_jpeg(z);
+         return stbi__errpuc("outofmem", "Out of memory");
       }
+
+      // can't error after this so, this is safe
+      stbi__run_jobs(stbi__jpeg_convert_band, &c, z->bands);
+
+      STBI_FREE(c.lines);
+      if (z->s->into) z->s->into_written = 1;
       stbi__cleanup_jpeg(z);
       *out_x = z->s->img_x;
       *out_y = z->s->img_y;
@@ -3927,7 +4746,7 @@ static void *stbi__jpeg_load(stbi__context *s, int *x, int *y, int *comp, int re
    STBI_NOTUSED(ri);
    j->s = s;
    stbi__setup_jpeg(j);
-   result = load_jpeg_image(j, x,y,comp,req_comp);
+   result = load_jpeg_image(j, x,y,comp, s->into ? s->into_comp : req_comp);
    STBI_FREE(j);
    return result;
 }
@@ -3980,6 +4799,14 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
 #define STBI__ZFAST_BITS  9 // accelerate all cases in default tables
 #define STBI__ZFAST_MASK  ((1 << STBI__ZFAST_BITS) - 1)
 
+// wider literal/length table for stbi__parse_huffman_fast; one entry can hold two literals
+#define STBI__ZFAST2_BITS  11
+#define STBI__ZFAST2_MASK  ((1 << STBI__ZFAST2_BITS) - 1)
+#define STBI__ZFAST2_LEN(e)      ((e) & 31)         // bits consumed, 0 = take the slow path
+#define STBI__ZFAST2_LITS(e)     (((e) >> 5) & 3)   // literals decoded (0 = length or EOB)
+#define STBI__ZFAST2_SYM(e)      (((e) >> 8) & 511)
+#define STBI__ZFAST2_SECOND(e)   ((e) >> 24)        // the second literal when there are two
+
 // zlib-style huffman encoding
 // (jpegs packs from left, zlib from right, so can't share code)
 typedef struct
@@ -4056,6 +4883,35 @@ static int stbi__zbuild_huffman(stbi__zhuffman *z, const stbi_uc *sizelist, int
    return 1;
 }
 
+// builds the fast2 table for a literal/length code from its canonical codes, then
+// merges literal pairs into single entries
+static void stbi__zbuild_fast2(stbi__uint32 *fast2, const stbi__zhuffman *z)
+{
+   int i,s,c;
+   memset(fast2, 0, sizeof(stbi__uint32) << STBI__ZFAST2_BITS);
+   for (s=1; s <= STBI__ZFAST2_BITS; ++s) {
+      for (c=z->firstsymbol[s]; c < z->firstsymbol[s+1]; ++c) {
+         int v = z->value[c];
+         stbi__uint32 fast2v = (stbi__uint32) (s | ((v < 256) << 5) | (v << 8));
+         int j = stbi__bit_reverse(z->firstcode[s] + c - z->firstsymbol[s], s);
+         while (j < (1 << STBI__ZFAST2_BITS)) {
+            fast2[j] = fast2v;
+            j += (1 << s);
+         }
+      }
+   }
+   // i >> len < i, so walking down only ever reads entries that are still single symbols
+   for (i=STBI__ZFAST2_MASK; i >= 0; --i) {
+      stbi__uint32 e = fast2[i], e2;
+      int len = STBI__ZFAST2_LEN(e);
+      if (STBI__ZFAST2_LITS(e) != 1 || len >= STBI__ZFAST2_BITS) continue;
+      e2 = fast2[i >> len];
+      // the second code has to fit entirely in the bits the index actually covers
+      if (STBI__ZFAST2_LITS(e2) != 1 || (int) STBI__ZFAST2_LEN(e2) > STBI__ZFAST2_BITS - len) continue;
+      fast2[i] = (len + STBI__ZFAST2_LEN(e2)) | (2 << 5) | (STBI__ZFAST2_SYM(e) << 8) | (STBI__ZFAST2_SYM(e2) << 24);
+   }
+}
+
 // zlib-from-memory implementation for PNG reading
 //    because PNG allows splitting the zlib stream arbitrarily,
 //    and it's annoying structurally to have PNG call ZLIB call PNG,
@@ -4074,6 +4930,7 @@ typedef struct
    int   z_expandable;
 
    stbi__zhuffman z_length, z_distance;
+   stbi__uint32 z_length_fast2[1 << STBI__ZFAST2_BITS];
 } stbi__zbuf;
 
 stbi_inline static int stbi__zeof(stbi__zbuf *z)
@@ -4108,12 +4965,13 @@ stbi_inline static unsigned int stbi__zreceive(stbi__zbuf *z, int n)
    return k;
 }
 
-static int stbi__zhuffman_decode_slowpath(stbi__zbuf *a, stbi__zhuffman *z)
+// decodes the symbol at the bottom of `code`, returns it and its length in *len, or -1
+static int stbi__zhuffman_decode_code(stbi__zhuffman *z, unsigned int code, int *len)
 {
    int b,s,k;
    // not resolved by fast table, so compute it the slow way
    // use jpeg approach, which requires MSbits at top
-   k = stbi__bit_reverse(a->code_buffer, 16);
+   k = stbi__bit_reverse(code & 0xffff, 16);
    for (s=STBI__ZFAST_BITS+1; ; ++s)
       if (k < z->maxcode[s])
          break;
@@ -4122,9 +4980,17 @@ static int stbi__zhuffman_decode_slowpath(stbi__zbuf *a, stbi__zhuffman *z)
    b = (k >> (16-s)) - z->firstcode[s] + z->firstsymbol[s];
    if (b >= sizeof (z->size)) return -1; // some data was corrupt somewhere!
    if (z->size[b] != s) return -1;  // was originally an assert, but report failure instead.
+   *len = s;
+   return z->value[b];
+}
+
+static int stbi__zhuffman_decode_slowpath(stbi__zbuf *a, stbi__zhuffman *z)
+{
+   int s, v = stbi__zhuffman_decode_code(z, a->code_buffer, &s);
+   if (v < 0) return -1;
    a->code_buffer >>= s;
    a->num_bits -= s;
-   return z->value[b];
+   return v;
 }
 
 stbi_inline static int stbi__zhuffman_decode(stbi__zbuf *a, stbi__zhuffman *z)
@@ -4182,11 +5048,131 @@ static const int stbi__zdist_base[32] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129
 static const int stbi__zdist_extra[32] =
 { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
 
+stbi_inline static stbi__uint64 stbi__zload64(const stbi_uc *p)
+{
+   // byte by byte so it works on any endianness; compilers turn this into a single load
+   return (stbi__uint64) p[0]       | (stbi__uint64) p[1] <<  8 | (stbi__uint64) p[2] << 16 | (stbi__uint64) p[3] << 24
+        | (stbi__uint64) p[4] << 32 | (stbi__uint64) p[5] << 40 | (stbi__uint64) p[6] << 48 | (stbi__uint64) p[7] << 56;
+}
+
+// room the fast path needs at the end of the output: a 258 byte match plus the overshoot of the 16 byte copies
+#define STBI__ZFAST_OUT_SLACK  (258 + 16)
+
+// Inner loop of stbi__parse_huffman_block for when there are at least 8 bytes of
+// input and STBI__ZFAST_OUT_SLACK bytes of output left. The bit buffer is 64 bits
+// wide and refilled 8 bytes at a time, which covers the longest possible
+// length+distance pair, so there are no per-symbol bounds checks. Returns 1 at
+// the end of the block, 0 on error, and 2 when it gets too close to the end of
+// either buffer, leaving the rest to the careful loop. a->code_buffer is only
+// ever handed back with less than 8 bits in it, like stbi__fill_bits leaves it.
+static int stbi__parse_huffman_fast(stbi__zbuf *a)
+{
+   stbi__uint64 bits = a->code_buffer;
+   int num_bits = a->num_bits, result = 2;
+   stbi_uc *in = a->zbuffer, *in_end = a->zbuffer_end - 8;
+   stbi_uc *zout = (stbi_uc *) a->zout, *zout_start = (stbi_uc *) a->zout_start;
+   stbi_uc *zout_end = (stbi_uc *) a->zout_end - STBI__ZFAST_OUT_SLACK;
+   const stbi__uint32 *litlen = a->z_length_fast2;
+   const stbi__uint16 *distance = a->z_distance.fast;
+
+   while (in <= in_end && zout <= zout_end) {
+      stbi__uint32 e;
+      int z, len, dist, n;
+
+      // refill to 56-63 bits. the bits above num_bits belong to the byte at `in`,
+      // which the next refill ORs in again at the same position, so they're harmless
+      bits |= stbi__zload64(in) << num_bits;
+      in += (63 - num_bits) >> 3;
+      num_bits |= 56;
+
+      e = litlen[bits & STBI__ZFAST2_MASK];
+      if (STBI__ZFAST2_LITS(e)) {
+         // one or two literals; always store two, the slack covers it
+         zout[0] = (stbi_uc) STBI__ZFAST2_SYM(e);
+         zout[1] = (stbi_uc) STBI__ZFAST2_SECOND(e);
+         zout += STBI__ZFAST2_LITS(e);
+         bits >>= STBI__ZFAST2_LEN(e);
+         num_bits -= STBI__ZFAST2_LEN(e);
+         continue;
+      }
+      if (STBI__ZFAST2_LEN(e)) {
+         z = STBI__ZFAST2_SYM(e);
+         n = STBI__ZFAST2_LEN(e);
+      } else {
+         z = stbi__zhuffman_decode_code(&a->z_length, (unsigned int) bits, &n);
+         if (z < 0) { result = stbi__err("bad huffman code","Corrupt PNG"); break; }
+      }
+      bits >>= n;
+      num_bits -= n;
+      if (z < 256) {
+         *zout++ = (stbi_uc) z;
+         continue;
+      }
+      if (z == 256) {
+         result = 1;
+         break;
+      }
+
+      z -= 257;
+      len = stbi__zlength_base[z] + (int) (bits & ((1 << stbi__zlength_extra[z]) - 1));
+      bits >>= stbi__zlength_extra[z];
+      num_bits -= stbi__zlength_extra[z];
+
+      e = distance[bits & STBI__ZFAST_MASK];
+      if (e) {
+         z = e & 511;
+         n = e >> 9;
+      } else {
+         z = stbi__zhuffman_decode_code(&a->z_distance, (unsigned int) bits, &n);
+         if (z < 0) { result = stbi__err("bad huffman code","Corrupt PNG"); break; }
+      }
+      bits >>= n;
+      num_bits -= n;
+      dist = stbi__zdist_base[z] + (int) (bits & ((1 << stbi__zdist_extra[z]) - 1));
+      bits >>= stbi__zdist_extra[z];
+      num_bits -= stbi__zdist_extra[z];
+      if (zout - zout_start < dist) { result = stbi__err("bad dist","Corrupt PNG"); break; }
+
+      if (dist >= 16) {
+         // non-overlapping 16 byte chunks, may run up to 15 bytes past the match
+         stbi_uc *p = zout - dist, *end = zout + len;
+         do {
+            memcpy(zout, p, 16);
+            zout += 16;
+            p += 16;
+         } while (zout < end);
+         zout = end;
+      } else if (dist == 1) { // run of one byte; common in images.
+         memset(zout, zout[-1], len);
+         zout += len;
+      } else {
+         stbi_uc *p = zout - dist;
+         if (len) { do *zout++ = *p++; while (--len); }
+      }
+   }
+
+   // hand back the whole bytes still in the buffer
+   in -= num_bits >> 3;
+   num_bits &= 7;
+   a->code_buffer = (stbi__uint32) (bits & ((1u << num_bits) - 1));
+   a->num_bits = num_bits;
+   a->zbuffer = in;
+   a->zout = (char *) zout;
+   return result;
+}
+
 static int stbi__parse_huffman_block(stbi__zbuf *a)
 {
    char *zout = a->zout;
    for(;;) {
-      int z = stbi__zhuffman_decode(a, &a->z_length);
+      int z;
+      if (a->zbuffer_end - a->zbuffer >= 8 && a->zout_end - zout >= STBI__ZFAST_OUT_SLACK) {
+         a->zout = zout;
+         z = stbi__parse_huffman_fast(a);
+         if (z != 2) return z;
+         zout = a->zout;
+      }
+      z = stbi__zhuffman_decode(a, &a->z_length);
       if (z < 256) {
          if (z < 0) return stbi__err("bad huffman code","Corrupt PNG"); // error in huffman codes
          if (zout >= a->zout_end) {
@@ -4368,6 +5354,7 @@ static int stbi__parse_zlib(stbi__zbuf *a, int parse_header)
          } else {
             if (!stbi__compute_huffman_codes(a)) return 0;
          }
+         stbi__zbuild_fast2(a->z_length_fast2, &a->z_length);
          if (!stbi__parse_huffman_block(a)) return 0;
       }
    } while (!final);
@@ -4535,6 +5522,246 @@ static int stbi__paeth(int a, int b, int c)
 
 static const stbi_uc stbi__depth_scale_table[9] = { 0, 0xff, 0x55, 0, 0x11, 0,0,0, 0x01 };
 
+#ifdef STBI_SSE2
+// SIMD unfiltering for 8-bit RGB and RGBA scanlines, including the RGB->RGBA
+// expansion. Avg and paeth depend on the pixel to the left, so those work one
+// pixel per register (paeth in 16-bit lanes); up and sub (as a prefix sum) can
+// work on whole registers at a time. Results are byte-identical to the
+// scalar loops in stbi__create_png_image_raw. `prior` is NULL on the first row.
+#define STBI__PNG_SIMD
+
+static stbi__uint32 stbi__png_load_px(const stbi_uc *p, int n)
+{
+   stbi__uint32 v;
+   if (n == 4) {
+      memcpy(&v, p, 4);
+      return v;
+   }
+   // never read a 4th byte, it could be past the end of the buffer
+   return p[0] | (p[1] << 8) | ((stbi__uint32) p[2] << 16);
+}
+
+static void stbi__png_store_px(stbi_uc *p, stbi__uint32 v, int img_n, int out_n)
+{
+   if (out_n == 4) {
+      if (img_n == 3) v |= 0xff000000u;
+      memcpy(p, &v, 4);
+   } else {
+      p[0] = STBI__BYTECAST(v);
+      p[1] = STBI__BYTECAST(v >> 8);
+      p[2] = STBI__BYTECAST(v >> 16);
+   }
+}
+
+#define stbi__png_px(p,n)  _mm_cvtsi32_si128((int) stbi__png_load_px(p,n))
+
+static void stbi__png_sub_row_sse2(stbi_uc *cur, const stbi_uc *raw, int w, int img_n, int out_n)
+{
+   __m128i a = _mm_setzero_si128();
+   int i = 0;
+   if (img_n == 4) {
+      // prefix sum of four pixels inside the register, plus the last pixel of the previous group
+      for (; i+4 <= w; i += 4) {
+         __m128i x = _mm_loadu_si128((const __m128i *) (raw + i*4));
+         x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+         x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+         x = _mm_add_epi8(x, a);
+         _mm_storeu_si128((__m128i *) (cur + i*4), x);
+         a = _mm_shuffle_epi32(x, 0xff);
+      }
+   }
+   for (; i < w; ++i) {
+      a = _mm_add_epi8(stbi__png_px(raw + i*img_n, img_n), a);
+      stbi__png_store_px(cur + i*out_n, (stbi__uint32) _mm_cvtsi128_si32(a), img_n, out_n);
+   }
+}
+
+static void stbi__png_up_row_sse2(stbi_uc *cur, const stbi_uc *raw, const stbi_uc *prior, int w, int img_n, int out_n)
+{
+   int i = 0;
+   if (img_n == out_n) {
+      int n = w*img_n;
+      for (; i+16 <= n; i += 16) {
+         __m128i x = _mm_loadu_si128((const __m128i *) (raw + i));
+         __m128i b = _mm_loadu_si128((const __m128i *) (prior + i));
+         _mm_storeu_si128((__m128i *) (cur + i), _mm_add_epi8(x, b));
+      }
+      for (; i < n; ++i)
+         cur[i] = STBI__BYTECAST(raw[i] + prior[i]);
+   } else {
+      for (; i < w; ++i) {
+         __m128i x = stbi__png_px(raw + i*3, 3);
+         if (prior) x = _mm_add_epi8(x, stbi__png_px(prior + i*4, 4));
+         stbi__png_store_px(cur + i*4, (stbi__uint32) _mm_cvtsi128_si32(x), 3, 4);
+      }
+   }
+}
+
+static void stbi__png_avg_row_sse2(stbi_uc *cur, const stbi_uc *raw, const stbi_uc *prior, int w, int img_n, int out_n)
+{
+   __m128i a = _mm_setzero_si128(), b = _mm_setzero_si128();
+   __m128i one = _mm_set1_epi8(1);
+   int i;
+   for (i=0; i < w; ++i) {
+      __m128i avg;
+      if (prior) b = stbi__png_px(prior + i*out_n, out_n);
+      // pavgb rounds up, (a+b)>>1 rounds down; they differ exactly when a+b is odd
+      avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+      a = _mm_add_epi8(stbi__png_px(raw + i*img_n, img_n), avg);
+      stbi__png_store_px(cur + i*out_n, (stbi__uint32) _mm_cvtsi128_si32(a), img_n, out_n);
+   }
+}
+
+// pa = |b-c|, pb = |a-c|, pc = |a+b-2c|; pick a if pa is smallest, then b, then c
+#define STBI__PNG_PAETH_ROW(abs16) \
+   __m128i zero = _mm_setzero_si128(), a = zero, c = zero; \
+   int i; \
+   for (i=0; i < w; ++i) { \
+      __m128i b = _mm_unpacklo_epi8(stbi__png_px(prior + i*out_n, out_n), zero); \
+      __m128i x = stbi__png_px(raw + i*img_n, img_n); \
+      __m128i pa = _mm_sub_epi16(b, c); \
+      __m128i pb = _mm_sub_epi16(a, c); \
+      __m128i pc = abs16(_mm_add_epi16(pa, pb)); \
+      __m128i use_a, use_b, pred; \
+      pa = abs16(pa); \
+      pb = abs16(pb); \
+      use_a = _mm_andnot_si128(_mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc)), _mm_set1_epi16(-1)); \
+      use_b = _mm_andnot_si128(_mm_cmpgt_epi16(pb, pc), _mm_set1_epi16(-1)); \
+      pred = _mm_or_si128(_mm_and_si128(use_b, b), _mm_andnot_si128(use_b, c)); \
+      pred = _mm_or_si128(_mm_and_si128(use_a, a), _mm_andnot_si128(use_a, pred)); \
+      x = _mm_add_epi8(x, _mm_packus_epi16(pred, zero)); \
+      stbi__png_store_px(cur + i*out_n, (stbi__uint32) _mm_cvtsi128_si32(x), img_n, out_n); \
+      a = _mm_unpacklo_epi8(x, zero); \
+      c = b; \
+   }
+
+static __m128i stbi__abs_epi16_sse2(__m128i x)
+{
+   return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static void stbi__png_paeth_row_sse2(stbi_uc *cur, const stbi_uc *raw, const stbi_uc *prior, int w, int img_n, int out_n)
+{
+   STBI__PNG_PAETH_ROW(stbi__abs_epi16_sse2)
+}
+
+STBI__TARGET("ssse3")
+static void stbi__png_paeth_row_ssse3(stbi_uc *cur, const stbi_uc *raw, const stbi_uc *prior, int w, int img_n, int out_n)
+{
+   STBI__PNG_PAETH_ROW(_mm_abs_epi16)
+}
+
+#undef STBI__PNG_PAETH_ROW
+
+// RGB sub (to RGB or RGBA), four pixels at a time: a prefix sum over the four,
+// plus the last pixel of the previous group spread over all of them by pshufb
+STBI__TARGET("ssse3")
+static void stbi__png_sub_rgb_row_ssse3(stbi_uc *cur, const stbi_uc *raw, int w, int out_n)
+{
+   __m128i last = _mm_setr_epi8(9,10,11, 9,10,11, 9,10,11, 9,10,11, -1,-1,-1,-1);
+   __m128i spread = _mm_setr_epi8(0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1);
+   __m128i alpha = _mm_set1_epi32((int) 0xff000000u);
+   __m128i a = _mm_setzero_si128();
+   int i = 0;
+   // 16 byte loads and RGB stores go 4 bytes past the 4 pixels, so stop early enough to stay inside the row
+   for (; i+6 <= w; i += 4) {
+      __m128i x = _mm_loadu_si128((const __m128i *) (raw + i*3));
+      x = _mm_add_epi8(x, _mm_slli_si128(x, 3));
+      x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+      x = _mm_add_epi8(x, a);
+      if (out_n == 4)
+         _mm_storeu_si128((__m128i *) (cur + i*4), _mm_or_si128(_mm_shuffle_epi8(x, spread), alpha));
+      else
+         _mm_storeu_si128((__m128i *) (cur + i*3), x);
+      a = _mm_shuffle_epi8(x, last);
+   }
+   for (; i < w; ++i) {
+      a = _mm_add_epi8(stbi__png_px(raw + i*3, 3), a);
+      stbi__png_store_px(cur + i*out_n, (stbi__uint32) _mm_cvtsi128_si32(a), 3, out_n);
+   }
+}
+
+// RGB->RGBA up (or none, without a prior row), four pixels per pshufb
+STBI__TARGET("ssse3")
+static void stbi__png_up_expand_row_ssse3(stbi_uc *cur, const stbi_uc *raw, const stbi_uc *prior, int w)
+{
+   __m128i spread = _mm_setr_epi8(0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1);
+   __m128i alpha = _mm_set1_epi32((int) 0xff000000u);
+   int i = 0;
+   // 16 byte loads read 4 bytes past the 4 pixels, so stop early enough to stay inside the row
+   for (; i+6 <= w; i += 4) {
+      __m128i x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (raw + i*3)), spread);
+      if (prior) x = _mm_add_epi8(x, _mm_loadu_si128((const __m128i *) (prior + i*4)));
+      _mm_storeu_si128((__m128i *) (cur + i*4), _mm_or_si128(x, alpha));
+   }
+   stbi__png_up_row_sse2(cur + i*4, raw + i*3, prior ? prior + i*4 : NULL, w - i, 3, 4);
+}
+
+STBI__TARGET("avx2")
+static void stbi__png_up_row_avx2(stbi_uc *cur, const stbi_uc *raw, const stbi_uc *prior, int w, int img_n, int out_n)
+{
+   int i = 0;
+   if (img_n == out_n) {
+      int n = w*img_n;
+      for (; i+32 <= n; i += 32) {
+         __m256i x = _mm256_loadu_si256((const __m256i *) (raw + i));
+         __m256i b = _mm256_loadu_si256((const __m256i *) (prior + i));
+         _mm256_storeu_si256((__m256i *) (cur + i), _mm256_add_epi8(x, b));
+      }
+      for (; i < n; ++i)
+         cur[i] = STBI__BYTECAST(raw[i] + prior[i]);
+   } else {
+      __m256i spread = _mm256_setr_epi8(0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1,
+                                        0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1);
+      __m256i alpha = _mm256_set1_epi32((int) 0xff000000u);
+      // eight pixels: two 12 byte groups, one per 128-bit lane, same overread rule as the SSSE3 version
+      for (; i+10 <= w; i += 8) {
+         __m128i lo = _mm_loadu_si128((const __m128i *) (raw + i*3));
+         __m128i hi = _mm_loadu_si128((const __m128i *) (raw + i*3 + 12));
+         __m256i x = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), spread);
+         if (prior) x = _mm256_add_epi8(x, _mm256_loadu_si256((const __m256i *) (prior + i*4)));
+         _mm256_storeu_si256((__m256i *) (cur + i*4), _mm256_or_si256(x, alpha));
+      }
+      stbi__png_up_expand_row_ssse3(cur + i*4, raw + i*3, prior ? prior + i*4 : NULL, w - i);
+   }
+}
+
+static void stbi__png_unfilter_row_simd(stbi_uc *cur, const stbi_uc *raw, const stbi_uc *prior, int filter, int w, int img_n, int out_n, int cpu)
+{
+   if (!prior) {
+      // first row: up and paeth degenerate to none and sub, avg just sees zeros above
+      if (filter == STBI__F_up) filter = STBI__F_none;
+      if (filter == STBI__F_paeth) filter = STBI__F_sub;
+   }
+   if (filter == STBI__F_none && img_n != out_n) {
+      // RGB->RGBA: an up with nothing to add
+      filter = STBI__F_up;
+      prior = NULL;
+   }
+   switch (filter) {
+      case STBI__F_none:
+         memcpy(cur, raw, w*img_n);
+         break;
+      case STBI__F_up:
+         if (cpu & STBI__CPU_AVX2) stbi__png_up_row_avx2(cur, raw, prior, w, img_n, out_n);
+         else if (img_n != out_n && (cpu & STBI__CPU_SSSE3)) stbi__png_up_expand_row_ssse3(cur, raw, prior, w);
+         else stbi__png_up_row_sse2(cur, raw, prior, w, img_n, out_n);
+         break;
+      case STBI__F_sub:
+         if (img_n == 3 && (cpu & STBI__CPU_SSSE3)) stbi__png_sub_rgb_row_ssse3(cur, raw, w, out_n);
+         else stbi__png_sub_row_sse2(cur, raw, w, img_n, out_n);
+         break;
+      case STBI__F_avg:
+         stbi__png_avg_row_sse2(cur, raw, prior, w, img_n, out_n);
+         break;
+      case STBI__F_paeth:
+         if (cpu & STBI__CPU_SSSE3) stbi__png_paeth_row_ssse3(cur, raw, prior, w, img_n, out_n);
+         else stbi__png_paeth_row_sse2(cur, raw, prior, w, img_n, out_n);
+         break;
+   }
+}
+#endif // STBI_SSE2
+
 // create the png data from post-deflated data
 static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
 {
@@ -4548,6 +5775,9 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
    int output_bytes = out_n*bytes;
    int filter_bytes = img_n*bytes;
    int width = x;
+#ifdef STBI__PNG_SIMD
+   int cpu = stbi__cpu_features();
+#endif
 
    STBI_ASSERT(out_n == s->img_n || out_n == s->img_n+1);
    a->out = (stbi_uc *) stbi__malloc_mad3(x, y, output_bytes, 0); // extra bytes to write off the end into
@@ -4578,6 +5808,14 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
       }
       prior = cur - stride; // bugfix: need to compute this after 'cur +=' computation above
 
+#ifdef STBI__PNG_SIMD
+      if ((cpu & STBI__CPU_SSE2) && depth == 8 && img_n >= 3) {
+         stbi__png_unfilter_row_simd(cur, raw, j ? prior : NULL, filter, x, img_n, out_n, cpu);
+         raw += x*img_n;
+         continue;
+      }
+#endif
+
       // if first row, use special filter that doesn't sample previous row
       if (j == 0) filter = first_row_filter[filter];
 
@@ -5057,6 +6295,18 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
             // initial guess for decoded data size to avoid unnecessary reallocs
             bpl = (s->img_x * z->depth + 7) / 8; // bytes per line, per component
             raw_len = bpl * s->img_y * s->img_n /* pixels */ + s->img_y /* filter mode per row */;
+            if (interlace) {
+               // Adam7 passes are separate images with their own rows, so add them up to get the size exactly
+               static const int xorig[] = { 0,4,0,2,0,1,0 }, yorig[] = { 0,0,4,0,2,0,1 };
+               static const int xspc[]  = { 8,8,4,4,2,2,1 }, yspc[]  = { 8,8,8,4,4,2,2 };
+               raw_len = 0;
+               for (k=0; k < 7; ++k) {
+                  stbi__uint32 px = (s->img_x - xorig[k] + xspc[k]-1) / xspc[k];
+                  stbi__uint32 py = (s->img_y - yorig[k] + yspc[k]-1) / yspc[k];
+                  if (s->img_x > (stbi__uint32) xorig[k] && s->img_y > (stbi__uint32) yorig[k])
+                     raw_len += ((s->img_n * px * z->depth + 7) >> 3) * py + py;
+               }
+            }
             z->expanded = (stbi_uc *) stbi_zlib_decode_malloc_guesssize_headerflag((char *) z->idata, ioff, raw_len, (int *) &raw_len, !is_iphone);
             if (z->expanded == NULL) return 0; // zlib should set error
             STBI_FREE(z->idata); z->idata = NULL;
@@ -5395,7 +6645,7 @@ static void *stbi__bmp_load(stbi__context *s, int *x, int *y, int *comp, int req
    }
    if (psize == 0) {
       STBI_ASSERT(info.offset == s->callback_already_read + (int) (s->img_buffer - s->img_buffer_original));
-      if (info.offset != s->callback_already_read + (s->img_buffer - s->buffer_start)) {
+      if (info.offset != s->callback_already_read + (s->img_buffer - s->img_buffer_original)) {
         return stbi__errpuc("bad offset", "Corrupt BMP");
       }
    }
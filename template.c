@@ -4,6 +4,8 @@
 #include <GL/glew.h>
 #include <SDL2/SDL_opengl.h>
 #include <GL/glu.h>
+#include "hz_capture.h"
+#include "hz_frame.h"
 
 /* This struct contains all of the properties for a window - borrowed from HAZE. */
 struct hzwinprop {
@@ -148,6 +150,9 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 	 */
 	SDL_GL_SetSwapInterval(1);
 
+	/* Frame capture and fixed frame counts, if they were asked for on the command line. See hz_capture.h */
+	hz_capture_init(argc, argv);
+
 	/* Specifies clear values for the colour buffers. We want the whole colour buffer to be magenta, so
 	 * we set the colour buffer's clear value to magenta.
 	 */
@@ -186,12 +191,24 @@ INAT main(INAT argc, CHR *argv[]) /* Remember, argc is the number of arguments,
 		/* Then we clear the colour buffer, making everything magenta. */
 		glClear(GL_COLOR_BUFFER_BIT);
 
+		/* Queue a readback of this frame if we're capturing. It has to happen before the swap. */
+		hz_capture_frame(primarywin.window);
+		if (hz_capture_done()) primarywin.quit = true;
+
 		/* Swap our buffer to display the current contents of buffer on screen.
 		 * Since we set SDL_GL_SetSwapInterval(1), this will use the monitor's refresh rate.
 		 */
 		SDL_GL_SwapWindow(primarywin.window);
+		/* Frame arena turnover, see hz_frame.h */
+		hz_frame_end();
 	}
 
+	/* Flush out any frames still being read back. A capture that silently lost frames is worse than no capture. */
+	if (!hz_capture_shutdown()) errwindow("Frame capture failed! Check the terminal output for details.");
+
+	/* Gives the frame arenas back and reports the most a frame needed */
+	hz_frame_shutdown();
+
 	/* Cleanup before exit, just in case. */
 	cleanup();
 
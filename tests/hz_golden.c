@@ -0,0 +1,241 @@
+/* Golden image and frame time regression runner.
+ *
+ * Runs one of the demos headless for a fixed number of frames, captures the last frame and the frame time stats
+ * (see hz_capture.h), then compares them against the reference image and baseline stored in tests/golden/. Meson
+ * drives this once per executable, see tests/meson.build.
+ *
+ * Exit codes follow the meson convention: 0 = pass, 1 = fail. The reference images are committed (rendered on
+ * llvmpipe), so a demo without one fails. The frame time baselines are machine specific and stay out of git; without
+ * one the performance check is skipped with a note saying so, and only the image is checked.
+ * Run the suite with HZ_GOLDEN_BLESS=1 in the environment to (re)write the references from the current output.
+ */
+#include "holyh/src/holy.h"
+#include "hz_png.h"
+#include "stb_image.h"
+#include <math.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#define HZ_GOLDEN_PATH 4096
+
+extern CHR **environ;
+
+struct goldenopts {
+	const CHR *demo;
+	const CHR *name;
+	const CHR *golden_dir;
+	const CHR *out_dir;
+	INAT frames;
+	INAT tolerance; /* Per-channel difference a pixel may have before it counts as wrong */
+	R64 max_bad; /* Fraction of wrong pixels we put up with (rasterisation differences between Mesa versions) */
+	R64 slowdown; /* Allowed median frame time increase over the baseline, 0.5 = 50% slower */
+};
+
+static const CHR *arg_value(const CHR *arg, const CHR *name)
+{
+	size_t len = strlen(name);
+	if (strncmp(arg, name, len) == 0 && arg[len] == '=') return arg + len + 1;
+	return NULL;
+}
+
+static U1 copy_file(const CHR *from, const CHR *to)
+{
+	FILE *in = fopen(from, "rb"), *out = fopen(to, "wb");
+	U1 ok = in && out;
+	CHR buffer[65536];
+	size_t n;
+	while (ok && (n = fread(buffer, 1, sizeof(buffer), in)) > 0) ok = fwrite(buffer, 1, n, out) == n;
+	if (in) fclose(in);
+	if (out && fclose(out) != 0) ok = false;
+	return ok;
+}
+
+/* Pulls one number out of the flat JSON hz_capture writes. Returns a negative value if it isn't there. */
+static R64 json_number(const CHR *path, const CHR *key)
+{
+	FILE *f = fopen(path, "r");
+	if (!f) return -1.0;
+
+	CHR line[256], quoted[64];
+	snprintf(quoted, sizeof(quoted), "\"%s\"", key);
+	R64 value = -1.0;
+	while (fgets(line, sizeof(line), f)) {
+		CHR *at = strstr(line, quoted);
+		if (at && (at = strchr(at, ':'))) {
+			value = strtod(at + 1, NULL);
+			break;
+		}
+	}
+	fclose(f);
+	return value;
+}
+
+static INAT run_demo(const struct goldenopts *o, const CHR *png_path, const CHR *json_path)
+{
+	/* Room for a whole HZ_GOLDEN_PATH path after the option name */
+	CHR frames[64], skip[64], capture[HZ_GOLDEN_PATH + 16], stats[HZ_GOLDEN_PATH + 16];
+	snprintf(frames, sizeof(frames), "--frames=%d", o->frames);
+	snprintf(skip, sizeof(skip), "--capture-skip=%d", o->frames - 1);
+	snprintf(capture, sizeof(capture), "--capture=%s", png_path);
+	snprintf(stats, sizeof(stats), "--stats=%s", json_path);
+
+	CHR *args[] = {
+		(CHR*)o->demo, frames, skip, capture, "--capture-format=png", stats, "--no-vsync", NULL
+	};
+
+	pid_t pid;
+	INAT status;
+	if (posix_spawn(&pid, o->demo, NULL, NULL, args, environ) != 0) {
+		fprintf(stderr, "golden: unable to start %s\n", o->demo);
+		return -1;
+	}
+	if (waitpid(pid, &status, 0) < 0) return -1;
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* Compares the captured frame against the reference. Writes a diff image next to the output if they don't match. */
+static U1 compare_images(const struct goldenopts *o, const CHR *ref_path, const CHR *out_path)
+{
+	INAT rw, rh, ow, oh, comp;
+	U8 *ref = stbi_load(ref_path, &rw, &rh, &comp, 3);
+	U8 *out = stbi_load(out_path, &ow, &oh, &comp, 3);
+	U1 ok = false;
+
+	if (!ref) {
+		fprintf(stderr, "golden: unable to load the reference %s: %s\n", ref_path, stbi_failure_reason());
+	} else if (!out) {
+		fprintf(stderr, "golden: unable to load the captured frame %s: %s\n", out_path, stbi_failure_reason());
+	} else if (rw != ow || rh != oh) {
+		fprintf(stderr, "golden: %s is %dx%d but the reference is %dx%d\n", o->name, ow, oh, rw, rh);
+	} else {
+		size_t n = (size_t)rw * rh, bad = 0;
+		R64 sq_err = 0;
+		U8 *diff = malloc(n * 3);
+
+		for (size_t i = 0; i < n; i++) {
+			INAT worst = 0;
+			for (INAT c = 0; c < 3; c++) {
+				INAT d = abs(ref[i * 3 + c] - out[i * 3 + c]);
+				sq_err += d * d;
+				if (d > worst) worst = d;
+			}
+			if (worst > o->tolerance) bad++;
+			/* Wrong pixels show up red, everything else is a dimmed copy of the reference */
+			if (diff) {
+				diff[i * 3] = worst > o->tolerance ? 255 : ref[i * 3] / 4;
+				diff[i * 3 + 1] = worst > o->tolerance ? 0 : ref[i * 3 + 1] / 4;
+				diff[i * 3 + 2] = worst > o->tolerance ? 0 : ref[i * 3 + 2] / 4;
+			}
+		}
+
+		R64 mse = sq_err / (n * 3);
+		R64 psnr = mse > 0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+		R64 bad_fraction = (R64)bad / n;
+		ok = bad_fraction <= o->max_bad;
+
+		printf("golden: %s image: %zu/%zu pixels off by more than %d (%.4f%%, limit %.4f%%), PSNR %.2f dB\n",
+			o->name, bad, n, o->tolerance, bad_fraction * 100.0, o->max_bad * 100.0, psnr);
+
+		if (!ok && diff) {
+			CHR diff_path[HZ_GOLDEN_PATH];
+			snprintf(diff_path, sizeof(diff_path), "%s/%s.diff.png", o->out_dir, o->name);
+			if (hz_png_write(diff_path, diff, rw, rh, 3, 0, false))
+				fprintf(stderr, "golden: %s does not match its reference, see %s\n", o->name, diff_path);
+		}
+		free(diff);
+	}
+
+	stbi_image_free(ref);
+	stbi_image_free(out);
+	return ok;
+}
+
+static U1 compare_timing(const struct goldenopts *o, const CHR *base_path, const CHR *stats_path)
+{
+	R64 base = json_number(base_path, "median_ms");
+	R64 now = json_number(stats_path, "median_ms");
+
+	if (now < 0) {
+		fprintf(stderr, "golden: %s didn't write any frame time stats\n", o->name);
+		return false;
+	}
+	if (base <= 0) {
+		printf("golden: %s has no frame time baseline at %s, SKIPPING the performance check (bless on this machine "
+			"to record one)\n", o->name, base_path);
+		return true;
+	}
+
+	R64 limit = base * (1.0 + o->slowdown);
+	printf("golden: %s median frame time %.3f ms, baseline %.3f ms, limit %.3f ms\n", o->name, now, base, limit);
+	if (now > limit) {
+		fprintf(stderr, "golden: %s got slower than the allowed %.0f%% over its baseline\n", o->name,
+			o->slowdown * 100.0);
+		return false;
+	}
+	return true;
+}
+
+INAT main(INAT argc, CHR *argv[])
+{
+	struct goldenopts o = { NULL, NULL, "tests/golden", ".", 120, 8, 0.001, 0.5 };
+
+	for (INAT i = 1; i < argc; i++) {
+		const CHR *v;
+		if ((v = arg_value(argv[i], "--name"))) o.name = v;
+		else if ((v = arg_value(argv[i], "--golden-dir"))) o.golden_dir = v;
+		else if ((v = arg_value(argv[i], "--out-dir"))) o.out_dir = v;
+		else if ((v = arg_value(argv[i], "--frames"))) o.frames = atoi(v);
+		else if ((v = arg_value(argv[i], "--tolerance"))) o.tolerance = atoi(v);
+		else if ((v = arg_value(argv[i], "--max-bad"))) o.max_bad = strtod(v, NULL);
+		else if ((v = arg_value(argv[i], "--slowdown"))) o.slowdown = strtod(v, NULL);
+		else o.demo = argv[i];
+	}
+
+	if (!o.demo || !o.name || o.frames < 1) {
+		fprintf(stderr, "usage: %s DEMO --name=NAME [--golden-dir=DIR] [--out-dir=DIR] [--frames=N]\n"
+			"          [--tolerance=N] [--max-bad=FRACTION] [--slowdown=FRACTION]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	CHR out_png[HZ_GOLDEN_PATH], out_json[HZ_GOLDEN_PATH], ref_png[HZ_GOLDEN_PATH], ref_json[HZ_GOLDEN_PATH];
+	if (snprintf(out_png, sizeof(out_png), "%s/%s.png", o.out_dir, o.name) >= (INAT)sizeof(out_png)
+		|| snprintf(out_json, sizeof(out_json), "%s/%s.json", o.out_dir, o.name) >= (INAT)sizeof(out_json)
+		|| snprintf(ref_png, sizeof(ref_png), "%s/%s.png", o.golden_dir, o.name) >= (INAT)sizeof(ref_png)
+		|| snprintf(ref_json, sizeof(ref_json), "%s/%s.json", o.golden_dir, o.name) >= (INAT)sizeof(ref_json)) {
+		fprintf(stderr, "golden: the paths for %s are too long\n", o.name);
+		return EXIT_FAILURE;
+	}
+
+	/* Don't let a stale capture from an earlier run pass for this one */
+	remove(out_png);
+	remove(out_json);
+
+	INAT status = run_demo(&o, out_png, out_json);
+	if (status != 0) {
+		fprintf(stderr, "golden: %s exited with status %d\n", o.name, status);
+		return EXIT_FAILURE;
+	}
+
+	const CHR *bless = getenv("HZ_GOLDEN_BLESS");
+	if (bless && *bless && strcmp(bless, "0")) {
+		if (!copy_file(out_png, ref_png) || !copy_file(out_json, ref_json)) {
+			fprintf(stderr, "golden: unable to write the references for %s to %s\n", o.name, o.golden_dir);
+			return EXIT_FAILURE;
+		}
+		printf("golden: blessed %s and %s\n", ref_png, ref_json);
+		return EXIT_SUCCESS;
+	}
+
+	/* tests/golden/ ships a PNG for every demo, so one going missing is a failure, not a reason to skip */
+	FILE *ref = fopen(ref_png, "rb");
+	if (!ref) {
+		fprintf(stderr, "golden: no reference image for %s, run the suite with HZ_GOLDEN_BLESS=1 on llvmpipe and "
+			"commit %s\n", o.name, ref_png);
+		return EXIT_FAILURE;
+	}
+	fclose(ref);
+
+	U1 image_ok = compare_images(&o, ref_png, out_png);
+	U1 timing_ok = compare_timing(&o, ref_json, out_json);
+	return image_ok && timing_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
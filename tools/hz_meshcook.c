@@ -0,0 +1,954 @@
+/* Mesh cooker. Imports an OBJ or glTF 2.0 file (.gltf with its buffers in data: URIs or files next to it, or .glb)
+ * once, offline, and writes it out as a cooked mesh (see hz_meshfile.h) that hz_meshfile_load() hands to GL straight
+ * out of a memory mapping.
+ *
+ *   hz_meshcook [--float-positions] [--no-normals] [--no-texcoords] [--lods=N] INPUT OUTPUT
+ *
+ * Everything in the file becomes one triangle list: every OBJ face, or every triangle primitive of every mesh in the
+ * glTF's default scene, with its node transforms applied. Positions, normals and the first set of texture
+ * coordinates are kept, and only if every vertex has them. On the way out:
+ *
+ *   - positions are quantised to 16 bits across the bounding box (--float-positions keeps them as floats),
+ *     normals to 8 bits, texture coordinates to 16 bit fixed point, or half floats if they go outside 0..1,
+ *   - identical vertices (after quantisation) are welded, and triangles that quantisation collapsed are dropped,
+ *   - up to N levels of detail are made (4 unless --lods says otherwise, 1 being just the mesh), each with about half
+ *     the triangles of the one before, for as long as simplifying gets anywhere,
+ *   - each level's triangles are put in vertex cache order and vertices in the order the full mesh first uses them
+ *     (see hz_meshopt.h),
+ *   - indices are 16 bits wherever the vertex count allows.
+ *
+ * glTF texture coordinates have their origin at the top left. They're flipped to GL's bottom left, which is how
+ * hz_texture_load() uploads images, so the same texture works for both kinds of file.
+ */
+#include "holyh/src/holy.h"
+#include "hz_file.h"
+#include "hz_meshfile.h"
+#include "hz_meshopt.h"
+#include <GL/glew.h>
+#include <math.h>
+
+/* The imported mesh: floats, one vertex per triangle corner until it's welded */
+struct mesh {
+	R32 *pos, *normal, *uv;
+	U32 vertices, vertex_cap;
+	U32 *index;
+	U32 indices, index_cap;
+	U1 normals, uvs; /* Every vertex so far had them */
+};
+
+/* Grows `*array` to hold `need` elements of `size` bytes, doubling */
+static U1 reserve(X0 **array, U32 *cap, U32 need, size_t size)
+{
+	if (need <= *cap) return true;
+	U32 n = *cap ? *cap : 1024;
+	while (n < need) n *= 2;
+	X0 *a = realloc(*array, (size_t)n * size);
+	if (!a) return false;
+	*array = a;
+	*cap = n;
+	return true;
+}
+
+/* Room for `count` more vertices. Returns the first one's index, or UINT32_MAX if we're out of memory. */
+static U32 add_vertices(struct mesh *m, U32 count)
+{
+	U32 cap = m->vertex_cap;
+	if (count > UINT32_MAX / 2 - m->vertices || !reserve((X0**)&m->pos, &cap, m->vertices + count, 3 * sizeof(R32))
+		|| (cap = m->vertex_cap, !reserve((X0**)&m->normal, &cap, m->vertices + count, 3 * sizeof(R32)))
+		|| (cap = m->vertex_cap, !reserve((X0**)&m->uv, &cap, m->vertices + count, 2 * sizeof(R32)))) {
+		fprintf(stderr, "meshcook: out of memory\n");
+		return UINT32_MAX;
+	}
+	m->vertex_cap = cap;
+	U32 first = m->vertices;
+	m->vertices += count;
+	return first;
+}
+
+static U1 add_index(struct mesh *m, U32 index)
+{
+	if (m->indices == UINT32_MAX / 2 || !reserve((X0**)&m->index, &m->index_cap, m->indices + 1, sizeof(U32))) {
+		fprintf(stderr, "meshcook: out of memory\n");
+		return false;
+	}
+	m->index[m->indices++] = index;
+	return true;
+}
+
+/* The whole file, NUL terminated so strtof() and friends can't run off the end */
+static CHR *read_text(const CHR *path, size_t *size)
+{
+	struct hzfile f;
+	if (!hz_file_map(&f, path, HZ_FILE_SEQUENTIAL)) return NULL;
+	CHR *text = malloc(f.size + 1);
+	if (text) {
+		memcpy(text, f.data, f.size);
+		text[f.size] = '\0';
+		*size = f.size;
+	} else {
+		fprintf(stderr, "meshcook: out of memory reading %s\n", path);
+	}
+	hz_file_unmap(&f);
+	return text;
+}
+
+/* OBJ */
+
+/* One list of v, vt or vn */
+struct objlist {
+	R32 *v;
+	U32 count, cap;
+	U32 width;
+};
+
+static U1 obj_push(struct objlist *l, const CHR **p)
+{
+	if (!reserve((X0**)&l->v, &l->cap, l->count + 1, l->width * sizeof(R32))) return false;
+	R32 *v = &l->v[(size_t)l->count++ * l->width];
+	for (U32 i = 0; i < l->width; i++) {
+		CHR *end;
+		v[i] = strtof(*p, &end);
+		*p = end;
+	}
+	return true;
+}
+
+/* Turns an OBJ index (1 based, or negative from the end) into a 0 based one. UINT32_MAX if it's out of range. */
+static U32 obj_index(long i, U32 count)
+{
+	if (i > 0 && (unsigned long)i <= count) return (U32)(i - 1);
+	if (i < 0 && (unsigned long)-i <= count) return (U32)(count + i);
+	return UINT32_MAX;
+}
+
+static U1 import_obj(struct mesh *m, const CHR *path)
+{
+	size_t size;
+	CHR *text = read_text(path, &size);
+	if (!text) return false;
+
+	struct objlist v = { .width = 3 }, vt = { .width = 2 }, vn = { .width = 3 };
+	U1 ok = true;
+	U32 line = 0;
+	for (const CHR *p = text; ok && *p; line++) {
+		while (*p == ' ' || *p == '\t') p++;
+		const CHR *eol = strchr(p, '\n');
+		if (!eol) eol = p + strlen(p);
+
+		if (!strncmp(p, "v ", 2) || !strncmp(p, "v\t", 2)) {
+			p += 2;
+			ok = obj_push(&v, &p);
+		} else if (!strncmp(p, "vt ", 3)) {
+			p += 3;
+			ok = obj_push(&vt, &p);
+		} else if (!strncmp(p, "vn ", 3)) {
+			p += 3;
+			ok = obj_push(&vn, &p);
+		} else if (!strncmp(p, "f ", 2)) {
+			/* A polygon, as a fan around its first corner */
+			U32 first = 0, prev = 0, corners = 0;
+			for (p += 2; ok; corners++) {
+				while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+				if (p >= eol) break;
+				CHR *end;
+				long iv = strtol(p, &end, 10), ivt = 0, ivn = 0;
+				if (end == p) {
+					fprintf(stderr, "meshcook: %s:%u: bad face\n", path, line + 1);
+					ok = false;
+					break;
+				}
+				p = end;
+				if (*p == '/') {
+					ivt = strtol(++p, &end, 10);
+					p = end;
+					if (*p == '/') {
+						ivn = strtol(++p, &end, 10);
+						p = end;
+					}
+				}
+
+				U32 pi = obj_index(iv, v.count), ti = obj_index(ivt, vt.count), ni = obj_index(ivn, vn.count);
+				if (pi == UINT32_MAX || (ivt && ti == UINT32_MAX) || (ivn && ni == UINT32_MAX)) {
+					fprintf(stderr, "meshcook: %s:%u: index out of range\n", path, line + 1);
+					ok = false;
+					break;
+				}
+				U32 c = add_vertices(m, 1);
+				if (c == UINT32_MAX) {
+					ok = false;
+					break;
+				}
+				memcpy(&m->pos[c * 3], &v.v[pi * 3], 3 * sizeof(R32));
+				if (ivt) memcpy(&m->uv[c * 2], &vt.v[ti * 2], 2 * sizeof(R32));
+				else m->uvs = false;
+				if (ivn) memcpy(&m->normal[c * 3], &vn.v[ni * 3], 3 * sizeof(R32));
+				else m->normals = false;
+
+				if (!corners) first = c;
+				else if (corners >= 2) ok = add_index(m, first) && add_index(m, prev) && add_index(m, c);
+				prev = c;
+			}
+		}
+		/* Groups, objects, materials, smoothing groups, lines: all the same mesh to us */
+		p = *eol ? eol + 1 : eol;
+	}
+
+	free(v.v);
+	free(vt.v);
+	free(vn.v);
+	free(text);
+	return ok;
+}
+
+/* JSON, as much of it as glTF needs: a flat array of tokens, each knowing where the next sibling starts. Strings
+ * aren't unescaped, glTF keys and URIs don't need it.
+ */
+
+enum { JSON_OBJECT, JSON_ARRAY, JSON_STRING, JSON_PRIMITIVE };
+
+struct jsontok {
+	U32 type;
+	U32 start, end; /* Into the text. Strings without their quotes. */
+	U32 children; /* Array elements, or object keys (each followed by its value) */
+	U32 next; /* The token after this one and everything inside it */
+};
+
+struct json {
+	const CHR *text;
+	size_t size;
+	struct jsontok *tok;
+	U32 count, cap;
+};
+
+static const CHR *skip_space(const CHR *p, const CHR *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+	return p;
+}
+
+/* Parses the value at `*p`, returning its token, or -1 */
+static INAT json_value(struct json *j, const CHR **p, U32 depth)
+{
+	const CHR *end = j->text + j->size;
+	*p = skip_space(*p, end);
+	if (*p == end || depth > 64 || !reserve((X0**)&j->tok, &j->cap, j->count + 1, sizeof(struct jsontok))) return -1;
+	U32 t = j->count++;
+	struct jsontok tok = { 0, (U32)(*p - j->text), 0, 0, 0 };
+
+	if (**p == '{' || **p == '[') {
+		CHR close = **p == '{' ? '}' : ']';
+		tok.type = **p == '{' ? JSON_OBJECT : JSON_ARRAY;
+		*p = skip_space(*p + 1, end);
+		while (*p < end && **p != close) {
+			if (tok.type == JSON_OBJECT) {
+				INAT key = json_value(j, p, depth + 1);
+				if (key < 0 || j->tok[key].type != JSON_STRING) return -1;
+				*p = skip_space(*p, end);
+				if (*p == end || **p != ':') return -1;
+				(*p)++;
+			}
+			if (json_value(j, p, depth + 1) < 0) return -1;
+			tok.children++;
+			*p = skip_space(*p, end);
+			if (*p < end && **p == ',') *p = skip_space(*p + 1, end);
+			else if (*p < end && **p != close) return -1;
+		}
+		if (*p == end) return -1;
+		(*p)++;
+	} else if (**p == '"') {
+		tok.type = JSON_STRING;
+		tok.start++;
+		for ((*p)++; *p < end && **p != '"'; (*p)++) if (**p == '\\' && *p + 1 < end) (*p)++;
+		if (*p == end) return -1;
+		tok.end = (U32)(*p - j->text);
+		(*p)++;
+	} else {
+		tok.type = JSON_PRIMITIVE;
+		while (*p < end && !strchr(" \t\r\n,]}:", **p)) (*p)++;
+		if ((U32)(*p - j->text) == tok.start) return -1;
+	}
+	if (tok.type != JSON_STRING) tok.end = (U32)(*p - j->text);
+	tok.next = j->count;
+	j->tok[t] = tok;
+	return t;
+}
+
+/* The value of `key` in object `obj`, or -1 */
+static INAT json_get(const struct json *j, INAT obj, const CHR *key)
+{
+	if (obj < 0 || j->tok[obj].type != JSON_OBJECT) return -1;
+	size_t len = strlen(key);
+	U32 t = obj + 1;
+	for (U32 i = 0; i < j->tok[obj].children; i++) {
+		const struct jsontok *k = &j->tok[t];
+		if (k->end - k->start == len && !memcmp(j->text + k->start, key, len)) return t + 1;
+		t = j->tok[t + 1].next;
+	}
+	return -1;
+}
+
+/* Element `n` of array `arr`, or -1 */
+static INAT json_at(const struct json *j, INAT arr, U32 n)
+{
+	if (arr < 0 || j->tok[arr].type != JSON_ARRAY || n >= j->tok[arr].children) return -1;
+	U32 t = arr + 1;
+	while (n--) t = j->tok[t].next;
+	return t;
+}
+
+static R64 json_number(const struct json *j, INAT t, R64 fallback)
+{
+	if (t < 0 || j->tok[t].type != JSON_PRIMITIVE) return fallback;
+	CHR buffer[64];
+	U32 len = j->tok[t].end - j->tok[t].start;
+	if (len >= sizeof(buffer)) return fallback;
+	memcpy(buffer, j->text + j->tok[t].start, len);
+	buffer[len] = '\0';
+	CHR *end;
+	R64 v = strtod(buffer, &end);
+	return end == buffer ? fallback : v;
+}
+
+static INAT json_int(const struct json *j, INAT t, INAT fallback)
+{
+	R64 v = json_number(j, t, fallback);
+	return v >= 0.0 && v < 2147483648.0 ? (INAT)v : fallback;
+}
+
+static U1 json_is(const struct json *j, INAT t, const CHR *s)
+{
+	size_t len = strlen(s);
+	return t >= 0 && j->tok[t].type == JSON_STRING && j->tok[t].end - j->tok[t].start == len
+		&& !memcmp(j->text + j->tok[t].start, s, len);
+}
+
+/* glTF */
+
+#define GLB_MAGIC 0x46546c67 /* "glTF" */
+#define GLB_JSON 0x4e4f534a
+#define GLB_BIN 0x004e4942
+
+struct gltfbuffer {
+	const U8 *data;
+	size_t size;
+	U8 *owned; /* Decoded from a data: URI */
+	struct hzfile file; /* Or mapped from a file */
+};
+
+struct gltf {
+	struct json j;
+	const CHR *path;
+	struct gltfbuffer *buffer;
+	U32 buffers;
+	INAT accessors, views, meshes, nodes; /* The top level arrays, -1 if missing */
+};
+
+static U1 gltf_fail(const struct gltf *g, const CHR *why)
+{
+	fprintf(stderr, "meshcook: %s: %s\n", g->path, why);
+	return false;
+}
+
+static INAT base64_value(CHR c)
+{
+	if (c >= 'A' && c <= 'Z') return c - 'A';
+	if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+	if (c >= '0' && c <= '9') return c - '0' + 52;
+	if (c == '+' || c == '-') return 62;
+	if (c == '/' || c == '_') return 63;
+	return -1;
+}
+
+static U1 gltf_load_buffer(struct gltf *g, struct gltfbuffer *b, INAT uri, size_t length)
+{
+	const CHR *s = g->j.text + g->j.tok[uri].start;
+	U32 len = g->j.tok[uri].end - g->j.tok[uri].start;
+	const CHR *comma = memchr(s, ',', len);
+
+	if (len > 5 && !memcmp(s, "data:", 5)) {
+		if (!comma || comma - s < 7 || memcmp(comma - 7, ";base64", 7)) return gltf_fail(g, "Unsupported data URI");
+		const CHR *in = comma + 1, *end = s + len;
+		b->owned = malloc((end - in) / 4 * 3 + 3);
+		if (!b->owned) return gltf_fail(g, "Out of memory");
+		U32 bits = 0, nbits = 0;
+		size_t n = 0;
+		for (; in < end && *in != '='; in++) {
+			INAT v = base64_value(*in);
+			if (v < 0) return gltf_fail(g, "Bad base64");
+			bits = bits << 6 | v;
+			nbits += 6;
+			if (nbits >= 8) {
+				nbits -= 8;
+				b->owned[n++] = bits >> nbits;
+			}
+		}
+		b->data = b->owned;
+		b->size = n;
+	} else {
+		/* Relative to the .gltf. Percent escapes would need decoding, nobody uses them for buffers. */
+		const CHR *slash = strrchr(g->path, '/');
+		size_t dir = slash ? (size_t)(slash - g->path) + 1 : 0;
+		CHR *file = malloc(dir + len + 1);
+		if (!file) return gltf_fail(g, "Out of memory");
+		memcpy(file, g->path, dir);
+		memcpy(file + dir, s, len);
+		file[dir + len] = '\0';
+		U1 ok = hz_file_map(&b->file, file, 0);
+		free(file);
+		if (!ok) return false;
+		b->data = b->file.data;
+		b->size = b->file.size;
+	}
+	if (b->size < length) return gltf_fail(g, "Buffer shorter than its byteLength");
+	return true;
+}
+
+/* Reads `components` components of every element of accessor `a` as floats, into `out`, which has room for
+ * `*count` elements on the way in and gets the real count on the way out. With `out` NULL, just returns the count.
+ */
+static U1 gltf_read(const struct gltf *g, INAT index, U32 components, R32 *out, U32 *count)
+{
+	const struct json *j = &g->j;
+	INAT a = json_at(j, g->accessors, index);
+	if (a < 0) return gltf_fail(g, "Bad accessor");
+	if (json_get(j, a, "sparse") >= 0) return gltf_fail(g, "Sparse accessors aren't supported");
+
+	INAT n = json_int(j, json_get(j, a, "count"), -1), type = json_get(j, a, "type"), comps = 0;
+	static const CHR *types[] = { "SCALAR", "VEC2", "VEC3", "VEC4" };
+	for (INAT i = 0; i < 4; i++) if (json_is(j, type, types[i])) comps = i + 1;
+	if (n < 0 || comps < (INAT)components) return gltf_fail(g, "Unexpected accessor type");
+	if (!out) {
+		*count = n;
+		return true;
+	}
+	if ((U32)n > *count) return gltf_fail(g, "Accessor larger than expected");
+	*count = n;
+
+	INAT ctype = json_int(j, json_get(j, a, "componentType"), 0), csize;
+	switch (ctype) {
+	case GL_BYTE: case GL_UNSIGNED_BYTE: csize = 1; break;
+	case GL_SHORT: case GL_UNSIGNED_SHORT: csize = 2; break;
+	case GL_UNSIGNED_INT: case GL_FLOAT: csize = 4; break;
+	default: return gltf_fail(g, "Bad component type");
+	}
+	INAT norm = json_get(j, a, "normalized");
+	U1 normalized = norm >= 0 && j->tok[norm].end - j->tok[norm].start == 4 && !memcmp(j->text + j->tok[norm].start,
+		"true", 4);
+
+	/* No buffer view means all zeros */
+	INAT view = json_at(j, g->views, json_int(j, json_get(j, a, "bufferView"), -1));
+	if (json_get(j, a, "bufferView") < 0) {
+		memset(out, 0, (size_t)n * components * sizeof(R32));
+		return true;
+	}
+	if (view < 0) return gltf_fail(g, "Bad buffer view");
+	INAT buffer = json_int(j, json_get(j, view, "buffer"), -1);
+	size_t view_offset = json_int(j, json_get(j, view, "byteOffset"), 0);
+	size_t view_length = json_int(j, json_get(j, view, "byteLength"), 0);
+	size_t offset = json_int(j, json_get(j, a, "byteOffset"), 0);
+	size_t element = (size_t)comps * csize, stride = json_int(j, json_get(j, view, "byteStride"), 0);
+	if (!stride) stride = element;
+	if (buffer < 0 || (U32)buffer >= g->buffers || view_offset > g->buffer[buffer].size
+		|| view_length > g->buffer[buffer].size - view_offset
+		|| (n && (offset > view_length || (size_t)(n - 1) * stride + element > view_length - offset))) {
+		return gltf_fail(g, "Accessor out of bounds");
+	}
+
+	const U8 *p = g->buffer[buffer].data + view_offset + offset;
+	for (INAT i = 0; i < n; i++, p += stride) {
+		for (U32 c = 0; c < components; c++) {
+			const U8 *q = p + c * csize;
+			R32 v;
+			switch (ctype) {
+			case GL_BYTE: v = normalized ? fmaxf(*(const I8*)q / 127.0f, -1.0f) : *(const I8*)q; break;
+			case GL_UNSIGNED_BYTE: v = normalized ? *q / 255.0f : *q; break;
+			case GL_SHORT: {
+				I16 s;
+				memcpy(&s, q, 2);
+				v = normalized ? fmaxf(s / 32767.0f, -1.0f) : s;
+				break;
+			}
+			case GL_UNSIGNED_SHORT: {
+				U16 s;
+				memcpy(&s, q, 2);
+				v = normalized ? s / 65535.0f : s;
+				break;
+			}
+			case GL_UNSIGNED_INT: {
+				U32 s;
+				memcpy(&s, q, 4);
+				v = (R32)s;
+				break;
+			}
+			default:
+				memcpy(&v, q, 4);
+				break;
+			}
+			out[(size_t)i * components + c] = v;
+		}
+	}
+	return true;
+}
+
+/* Indices go through floats above, which is exact up to 2^24 vertices in a primitive */
+#define GLTF_MAX_VERTICES (1u << 24)
+
+static U1 gltf_primitive(struct gltf *g, struct mesh *m, INAT prim, const R32 *world)
+{
+	const struct json *j = &g->j;
+	if (json_int(j, json_get(j, prim, "mode"), 4) != 4) {
+		fprintf(stderr, "meshcook: %s: skipping a primitive that isn't triangles\n", g->path);
+		return true;
+	}
+	INAT attributes = json_get(j, prim, "attributes");
+	INAT position = json_int(j, json_get(j, attributes, "POSITION"), -1);
+	INAT normal = json_int(j, json_get(j, attributes, "NORMAL"), -1);
+	INAT uv = json_int(j, json_get(j, attributes, "TEXCOORD_0"), -1);
+	INAT indices = json_int(j, json_get(j, prim, "indices"), -1);
+	if (position < 0) return gltf_fail(g, "Primitive without positions");
+
+	U32 count, n;
+	if (!gltf_read(g, position, 3, NULL, &count)) return false;
+	if (count > GLTF_MAX_VERTICES) return gltf_fail(g, "Primitive too large");
+	U32 first = add_vertices(m, count);
+	if (first == UINT32_MAX) return false;
+	if (!gltf_read(g, position, 3, &m->pos[first * 3], (n = count, &n))) return false;
+	if (normal < 0) m->normals = false;
+	else if (!gltf_read(g, normal, 3, &m->normal[first * 3], (n = count, &n)) || n != count) {
+		return gltf_fail(g, "Normals don't match positions");
+	}
+	if (uv < 0) m->uvs = false;
+	else if (!gltf_read(g, uv, 2, &m->uv[first * 2], (n = count, &n)) || n != count) {
+		return gltf_fail(g, "Texture coordinates don't match positions");
+	}
+
+	/* Into world space. Normals by the inverse transpose (the columns' cross products, up to a scale they lose when
+	 * they're normalised), and a mirroring transform turns the triangles inside out, so their winding flips.
+	 */
+	const R32 *w = world;
+	R32 cof[9] = {
+		w[5] * w[10] - w[6] * w[9], w[6] * w[8] - w[4] * w[10], w[4] * w[9] - w[5] * w[8],
+		w[9] * w[2] - w[10] * w[1], w[10] * w[0] - w[8] * w[2], w[8] * w[1] - w[9] * w[0],
+		w[1] * w[6] - w[2] * w[5], w[2] * w[4] - w[0] * w[6], w[0] * w[5] - w[1] * w[4]
+	};
+	R32 det = w[0] * cof[0] + w[1] * cof[1] + w[2] * cof[2];
+	for (U32 i = first; i < first + count; i++) {
+		R32 *p = &m->pos[i * 3], *nr = &m->normal[i * 3], t[3], len = 0.0f;
+		for (INAT r = 0; r < 3; r++) t[r] = w[r] * p[0] + w[4 + r] * p[1] + w[8 + r] * p[2] + w[12 + r];
+		memcpy(p, t, sizeof(t));
+		if (uv >= 0) m->uv[i * 2 + 1] = 1.0f - m->uv[i * 2 + 1];
+		if (normal < 0) continue;
+		for (INAT r = 0; r < 3; r++) {
+			t[r] = cof[r] * nr[0] + cof[3 + r] * nr[1] + cof[6 + r] * nr[2];
+			len += t[r] * t[r];
+		}
+		len = len > 0.0f ? (det < 0.0f ? -1.0f : 1.0f) / sqrtf(len) : 0.0f;
+		for (INAT r = 0; r < 3; r++) nr[r] = t[r] * len;
+	}
+
+	U32 icount = count;
+	R32 *idx = NULL;
+	if (indices >= 0) {
+		if (!gltf_read(g, indices, 1, NULL, &icount)) return false;
+		if (icount > UINT32_MAX / 4 || !(idx = malloc((size_t)(icount ? icount : 1) * sizeof(R32)))) {
+			return gltf_fail(g, "Out of memory");
+		}
+		if (!gltf_read(g, indices, 1, idx, (n = icount, &n))) {
+			free(idx);
+			return false;
+		}
+	}
+	U1 ok = true;
+	for (U32 i = 0; ok && i + 2 < icount; i += 3) {
+		U32 tri[3];
+		for (U32 k = 0; k < 3; k++) {
+			tri[k] = idx ? (U32)idx[i + k] : i + k;
+			if (tri[k] >= count) ok = gltf_fail(g, "Index out of range");
+		}
+		if (det < 0.0f) {
+			U32 swap = tri[1];
+			tri[1] = tri[2];
+			tri[2] = swap;
+		}
+		for (U32 k = 0; ok && k < 3; k++) ok = add_index(m, first + tri[k]);
+	}
+	free(idx);
+	return ok;
+}
+
+static X0 mat4_mul(const R32 *a, const R32 *b, R32 *out)
+{
+	for (INAT c = 0; c < 4; c++) {
+		for (INAT r = 0; r < 4; r++) {
+			out[c * 4 + r] = a[r] * b[c * 4] + a[4 + r] * b[c * 4 + 1] + a[8 + r] * b[c * 4 + 2]
+				+ a[12 + r] * b[c * 4 + 3];
+		}
+	}
+}
+
+static U1 gltf_node(struct gltf *g, struct mesh *m, INAT index, const R32 *parent, U32 depth)
+{
+	const struct json *j = &g->j;
+	INAT node = json_at(j, g->nodes, index);
+	if (node < 0 || depth > 64) return gltf_fail(g, "Bad node hierarchy");
+
+	/* Either a matrix, or translation * rotation * scale */
+	R32 local[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 }, world[16];
+	INAT matrix = json_get(j, node, "matrix");
+	if (matrix >= 0) {
+		for (U32 i = 0; i < 16; i++) local[i] = json_number(j, json_at(j, matrix, i), local[i]);
+	} else {
+		INAT t = json_get(j, node, "translation"), r = json_get(j, node, "rotation"), s = json_get(j, node, "scale");
+		R32 x = json_number(j, json_at(j, r, 0), 0), y = json_number(j, json_at(j, r, 1), 0);
+		R32 z = json_number(j, json_at(j, r, 2), 0), w = json_number(j, json_at(j, r, 3), 1);
+		R32 rot[9] = {
+			1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w),
+			2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+			2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y)
+		};
+		for (U32 c = 0; c < 3; c++) {
+			R32 scale = json_number(j, json_at(j, s, c), 1);
+			for (U32 row = 0; row < 3; row++) local[c * 4 + row] = rot[c * 3 + row] * scale;
+			local[12 + c] = json_number(j, json_at(j, t, c), 0);
+		}
+	}
+	mat4_mul(parent, local, world);
+
+	INAT mesh = json_at(j, g->meshes, json_int(j, json_get(j, node, "mesh"), -1));
+	if (json_get(j, node, "mesh") >= 0 && mesh < 0) return gltf_fail(g, "Bad mesh");
+	INAT prims = json_get(j, mesh, "primitives");
+	for (U32 i = 0; mesh >= 0 && i < (prims >= 0 ? j->tok[prims].children : 0); i++) {
+		if (!gltf_primitive(g, m, json_at(j, prims, i), world)) return false;
+	}
+
+	INAT children = json_get(j, node, "children");
+	for (U32 i = 0; children >= 0 && i < j->tok[children].children; i++) {
+		if (!gltf_node(g, m, json_int(j, json_at(j, children, i), -1), world, depth + 1)) return false;
+	}
+	return true;
+}
+
+static U1 import_gltf(struct mesh *m, const CHR *path)
+{
+	struct hzfile f;
+	if (!hz_file_map(&f, path, HZ_FILE_SEQUENTIAL)) return false;
+
+	struct gltf g = { .path = path };
+	const CHR *text = (const CHR *)f.data;
+	size_t text_size = f.size;
+	const U8 *bin = NULL;
+	size_t bin_size = 0;
+	U1 ok = true;
+
+	/* A .glb is a header, then a JSON chunk and an optional binary one */
+	U32 h[5] = { 0 };
+	if (f.size >= 20) memcpy(h, f.data, 20);
+	if (h[0] == GLB_MAGIC) {
+		/* The header's total length covers the 20 bytes we just read, and the JSON chunk has to fit in the rest */
+		if (h[1] != 2 || h[2] < 20 || h[2] > f.size || h[3] > h[2] - 20 || h[4] != GLB_JSON) {
+			ok = gltf_fail(&g, "Bad GLB header");
+		} else {
+			text = (const CHR *)f.data + 20;
+			text_size = h[3];
+			size_t pos = 20 + ((h[3] + 3) & ~3u);
+			U32 chunk[2];
+			if (pos + 8 <= h[2] && (memcpy(chunk, f.data + pos, 8), chunk[1] == GLB_BIN) && chunk[0] <= h[2] - pos - 8) {
+				bin = f.data + pos + 8;
+				bin_size = chunk[0];
+			}
+		}
+	}
+
+	/* Our own copy of the JSON, so it's NUL terminated */
+	CHR *json = ok ? malloc(text_size + 1) : NULL;
+	if (ok && !json) ok = gltf_fail(&g, "Out of memory");
+	if (ok) {
+		memcpy(json, text, text_size);
+		json[text_size] = '\0';
+		g.j.text = json;
+		g.j.size = text_size;
+		const CHR *p = json;
+		if (json_value(&g.j, &p, 0) != 0 || g.j.tok[0].type != JSON_OBJECT) ok = gltf_fail(&g, "Bad JSON");
+	}
+
+	INAT buffers = ok ? json_get(&g.j, 0, "buffers") : -1;
+	if (ok && buffers >= 0) {
+		g.buffers = g.j.tok[buffers].children;
+		g.buffer = calloc(g.buffers ? g.buffers : 1, sizeof(*g.buffer));
+		if (!g.buffer) ok = gltf_fail(&g, "Out of memory");
+		for (U32 i = 0; ok && i < g.buffers; i++) {
+			INAT b = json_at(&g.j, buffers, i), uri = json_get(&g.j, b, "uri");
+			size_t length = json_int(&g.j, json_get(&g.j, b, "byteLength"), 0);
+			if (uri >= 0) {
+				ok = gltf_load_buffer(&g, &g.buffer[i], uri, length);
+			} else if (!i && bin && bin_size >= length) {
+				/* The first buffer of a .glb can be its binary chunk */
+				g.buffer[i].data = bin;
+				g.buffer[i].size = bin_size;
+			} else {
+				ok = gltf_fail(&g, "Buffer without any data");
+			}
+		}
+	}
+
+	if (ok) {
+		g.accessors = json_get(&g.j, 0, "accessors");
+		g.views = json_get(&g.j, 0, "bufferViews");
+		g.meshes = json_get(&g.j, 0, "meshes");
+		g.nodes = json_get(&g.j, 0, "nodes");
+
+		/* The default scene's nodes, or the first scene's, or if there are no scenes, every mesh as is */
+		static const R32 identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+		INAT scenes = json_get(&g.j, 0, "scenes");
+		INAT scene = json_at(&g.j, scenes, json_int(&g.j, json_get(&g.j, 0, "scene"), 0));
+		INAT roots = json_get(&g.j, scene, "nodes");
+		if (roots >= 0) {
+			for (U32 i = 0; ok && i < g.j.tok[roots].children; i++) {
+				ok = gltf_node(&g, m, json_int(&g.j, json_at(&g.j, roots, i), -1), identity, 0);
+			}
+		} else {
+			for (U32 i = 0; ok && g.meshes >= 0 && i < g.j.tok[g.meshes].children; i++) {
+				INAT prims = json_get(&g.j, json_at(&g.j, g.meshes, i), "primitives");
+				for (U32 k = 0; ok && prims >= 0 && k < g.j.tok[prims].children; k++) {
+					ok = gltf_primitive(&g, m, json_at(&g.j, prims, k), identity);
+				}
+			}
+		}
+	}
+
+	for (U32 i = 0; i < g.buffers; i++) {
+		free(g.buffer[i].owned);
+		if (g.buffer[i].file.data) hz_file_unmap(&g.buffer[i].file);
+	}
+	free(g.buffer);
+	free(g.j.tok);
+	free(json);
+	hz_file_unmap(&f);
+	return ok;
+}
+
+/* Cooking */
+
+static U16 to_half(R32 f)
+{
+	U32 x;
+	memcpy(&x, &f, 4);
+	U32 sign = (x >> 16) & 0x8000, mant = x & 0x7fffff;
+	INAT exp = (INAT)((x >> 23) & 0xff) - 127 + 15;
+	if (((x >> 23) & 0xff) == 0xff) return sign | 0x7c00 | (mant ? 0x200 : 0);
+	if (exp >= 31) return sign | 0x7c00;
+	if (exp <= 0) {
+		/* Subnormal, or too small for even that */
+		if (exp < -10) return sign;
+		mant |= 0x800000;
+		U32 shift = 14 - exp;
+		return sign | ((mant >> shift) + ((mant >> (shift - 1)) & 1));
+	}
+	/* Round to nearest. A carry out of the mantissa lands in the exponent, which is right. */
+	return (sign | exp << 10 | mant >> 13) + ((mant >> 12) & 1);
+}
+
+static I32 quantise(R32 v, R32 range)
+{
+	R32 q = roundf(v * range);
+	return q < -range ? -range : q > range ? range : q;
+}
+
+static U1 cook(const CHR *in, const CHR *out, U1 float_positions, U1 keep_normals, U1 keep_uvs, U32 max_lods)
+{
+	struct mesh m = { .normals = true, .uvs = true };
+	size_t len = strlen(in);
+	U1 ok = len > 4 && !strcmp(in + len - 4, ".obj") ? import_obj(&m, in) : import_gltf(&m, in);
+	if (ok && (!m.vertices || m.indices < 3)) {
+		fprintf(stderr, "meshcook: %s has no triangles\n", in);
+		ok = false;
+	}
+	if (!ok) {
+		free(m.pos);
+		free(m.normal);
+		free(m.uv);
+		free(m.index);
+		return false;
+	}
+	m.normals &= keep_normals;
+	m.uvs &= keep_uvs;
+
+	/* Bounds, a sphere around the box's centre, and whether the texture coordinates fit in 0..1 */
+	struct hzmeshfileheader h = { 0 };
+	U1 unorm_uvs = true;
+	for (U32 i = 0; i < 3; i++) {
+		h.min[i] = INFINITY;
+		h.max[i] = -INFINITY;
+	}
+	for (U32 v = 0; v < m.vertices; v++) {
+		for (U32 i = 0; i < 3; i++) {
+			h.min[i] = fminf(h.min[i], m.pos[v * 3 + i]);
+			h.max[i] = fmaxf(h.max[i], m.pos[v * 3 + i]);
+		}
+		if (m.uvs) unorm_uvs &= m.uv[v * 2] >= 0.0f && m.uv[v * 2] <= 1.0f && m.uv[v * 2 + 1] >= 0.0f
+			&& m.uv[v * 2 + 1] <= 1.0f;
+	}
+	for (U32 i = 0; i < 3; i++) {
+		h.center[i] = (h.min[i] + h.max[i]) * 0.5f;
+		h.scale[i] = 1.0f;
+	}
+	for (U32 v = 0; v < m.vertices; v++) {
+		R32 d = 0.0f;
+		for (U32 i = 0; i < 3; i++) d += (m.pos[v * 3 + i] - h.center[i]) * (m.pos[v * 3 + i] - h.center[i]);
+		h.radius = fmaxf(h.radius, sqrtf(d));
+	}
+
+	/* The vertex format: every attribute on a 4 byte boundary */
+	U32 size = 0;
+	struct hzmeshfileattrib *a = h.attrib;
+	if (float_positions) {
+		a[HZ_MESH_POSITION] = (struct hzmeshfileattrib){ GL_FLOAT, 3, false, size };
+		size += 12;
+	} else {
+		/* -1..1 spans the box, so positions come back out as center + half extent * stored */
+		a[HZ_MESH_POSITION] = (struct hzmeshfileattrib){ GL_SHORT, 3, true, size };
+		size += 8;
+		for (U32 i = 0; i < 3; i++) {
+			R32 half = (h.max[i] - h.min[i]) * 0.5f;
+			h.scale[i] = half > 0.0f ? half : 1.0f;
+			h.offset[i] = h.center[i];
+		}
+	}
+	if (m.normals) {
+		a[HZ_MESH_NORMAL] = (struct hzmeshfileattrib){ GL_BYTE, 3, true, size };
+		size += 4;
+	}
+	if (m.uvs) {
+		a[HZ_MESH_TEXCOORD] = (struct hzmeshfileattrib){ unorm_uvs ? GL_UNSIGNED_SHORT : GL_HALF_FLOAT, 2, unorm_uvs,
+			size };
+		size += 4;
+	}
+	h.vertex_size = size;
+
+	/* Quantised, one per corner, then welded */
+	U8 *raw = calloc(m.vertices, size), *welded = malloc((size_t)m.vertices * size);
+	U32 *remap = malloc((size_t)m.vertices * sizeof(U32)), *index = malloc((size_t)m.indices * sizeof(U32));
+	U32 *lod_index = malloc((size_t)m.indices * max_lods * sizeof(U32));
+	R32 *lod_pos = malloc((size_t)m.vertices * 3 * sizeof(R32));
+	U32 vertices = 0, indices = 0, total = 0;
+	ok = raw && welded && remap && index && lod_index && lod_pos;
+	for (U32 v = 0; ok && v < m.vertices; v++) {
+		U8 *o = raw + (size_t)v * size;
+		const R32 *p = &m.pos[v * 3], *n = &m.normal[v * 3], *t = &m.uv[v * 2];
+		if (float_positions) {
+			memcpy(o, p, 12);
+		} else {
+			I16 q[3];
+			for (U32 i = 0; i < 3; i++) q[i] = quantise((p[i] - h.offset[i]) / h.scale[i], 32767.0f);
+			memcpy(o, q, 6);
+		}
+		if (m.normals) {
+			I8 *q = (I8*)(o + a[HZ_MESH_NORMAL].offset);
+			for (U32 i = 0; i < 3; i++) q[i] = quantise(n[i], 127.0f);
+		}
+		if (m.uvs) {
+			U16 q[2];
+			for (U32 i = 0; i < 2; i++) q[i] = unorm_uvs ? (U16)roundf(t[i] * 65535.0f) : to_half(t[i]);
+			memcpy(o + a[HZ_MESH_TEXCOORD].offset, q, 4);
+		}
+	}
+	if (ok) ok = (vertices = hz_meshopt_weld(remap, raw, m.vertices, size)) != 0;
+	if (ok) {
+		hz_meshopt_remap_vertices(welded, raw, m.vertices, size, remap);
+		/* The simplifier wants the welded vertices' positions as floats */
+		hz_meshopt_remap_vertices(lod_pos, m.pos, m.vertices, 3 * sizeof(R32), remap);
+		/* Quantisation can collapse small triangles to a line or a point, which nobody will miss */
+		for (U32 i = 0; i + 2 < m.indices; i += 3) {
+			U32 i0 = remap[m.index[i]], i1 = remap[m.index[i + 1]], i2 = remap[m.index[i + 2]];
+			if (i0 == i1 || i1 == i2 || i2 == i0) continue;
+			index[indices++] = i0;
+			index[indices++] = i1;
+			index[indices++] = i2;
+		}
+	}
+
+	struct hzmeshlod lod[HZ_MESHFILE_MAX_LODS];
+	U32 lods = 0;
+	if (ok) {
+		lods = hz_meshopt_lods(lod_index, lod, max_lods, index, indices, lod_pos, vertices, 3 * sizeof(R32));
+		total = lod[lods - 1].first_index + lod[lods - 1].index_count;
+	}
+
+	R32 acmr_before = 0.0f, acmr_after = 0.0f;
+	if (ok) {
+		acmr_before = hz_meshopt_acmr(index, indices, vertices, HZ_MESHOPT_CACHE_SIZE);
+		/* Every level on its own, into `index`, which now needs room for them all. The vertices go back into `raw`,
+		 * in the order LOD 0 (first in the buffer) uses them.
+		 */
+		free(index);
+		ok = (index = malloc((size_t)total * sizeof(U32))) != NULL;
+		for (U32 l = 0; ok && l < lods; l++) {
+			ok = hz_meshopt_vertex_cache(index + lod[l].first_index, lod_index + lod[l].first_index,
+				lod[l].index_count, vertices);
+		}
+		if (ok) ok = (vertices = hz_meshopt_vertex_fetch(raw, index, total, welded, vertices, size)) != 0;
+		if (ok) acmr_after = hz_meshopt_acmr(index, indices, vertices, HZ_MESHOPT_CACHE_SIZE);
+	}
+
+	if (ok) {
+		h.vertex_count = vertices;
+		h.index_count = total;
+		h.index_size = vertices <= 65536 ? 2 : 4;
+		if (h.index_size == 2) {
+			U16 *small = (U16*)index;
+			for (U32 i = 0; i < total; i++) small[i] = index[i];
+		}
+		h.lods = lods;
+		for (U32 l = 0; l < lods; l++) {
+			h.lod[l] = (struct hzmeshfilelod){ lod[l].first_index, lod[l].index_count, lod[l].error };
+		}
+		ok = hz_meshfile_write(out, &h, raw, index);
+	} else {
+		fprintf(stderr, "meshcook: out of memory cooking %s\n", in);
+	}
+	if (ok) {
+		printf("%s: %u vertices (from %u corners) of %u bytes, %u triangles, %u-bit indices, ACMR %.2f -> %.2f, "
+			"%zu bytes\n", out, vertices, m.vertices, size, indices / 3, h.index_size * 8, acmr_before, acmr_after,
+			(size_t)vertices * size + (size_t)total * h.index_size);
+		for (U32 l = 1; l < lods; l++) {
+			printf("  LOD %u: %u triangles, error %g (%.2f%% of the radius)\n", l, lod[l].index_count / 3,
+				lod[l].error, h.radius > 0.0f ? lod[l].error / h.radius * 100.0f : 0.0f);
+		}
+	}
+
+	free(raw);
+	free(welded);
+	free(remap);
+	free(index);
+	free(lod_index);
+	free(lod_pos);
+	free(m.pos);
+	free(m.normal);
+	free(m.uv);
+	free(m.index);
+	return ok;
+}
+
+INAT main(INAT argc, CHR *argv[])
+{
+	const CHR *paths[2];
+	INAT npaths = 0;
+	U1 float_positions = false, normals = true, uvs = true;
+	U32 lods = HZ_MESHFILE_MAX_LODS;
+
+	for (INAT i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--float-positions")) float_positions = true;
+		else if (!strcmp(argv[i], "--no-normals")) normals = false;
+		else if (!strcmp(argv[i], "--no-texcoords")) uvs = false;
+		else if (!strncmp(argv[i], "--lods=", 7) && atoi(argv[i] + 7) >= 1) lods = atoi(argv[i] + 7);
+		else if (argv[i][0] != '-' && npaths < 2) paths[npaths++] = argv[i];
+		else npaths = 3;
+	}
+	if (npaths != 2) {
+		fprintf(stderr, "usage: %s [--float-positions] [--no-normals] [--no-texcoords] [--lods=N] INPUT OUTPUT\n",
+			argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (lods > HZ_MESHFILE_MAX_LODS) lods = HZ_MESHFILE_MAX_LODS;
+	return cook(paths[0], paths[1], float_positions, normals, uvs, lods) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
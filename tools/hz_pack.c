@@ -0,0 +1,230 @@
+/* Asset packer. Bundles files into one pack (see hz_pack.h) that the demos mount with a single mmap().
+ *
+ *   hz_pack [--compress] OUTPUT [NAME=]FILE...
+ *
+ * Each file goes in under NAME, or its path as given if there's no NAME=. That's the name hz_pack_find() (and so
+ * hz_texture_load()) looks it up by, so it should be the path the demos would have loaded it from. --compress stores
+ * a file with hz_lz.h when that makes it at least an eighth smaller. Files with identical contents are stored once.
+ */
+#include "holyh/src/holy.h"
+#include "hz_file.h"
+#include "hz_lz.h"
+#include "hz_pack.h"
+#include <errno.h>
+
+struct input {
+	const CHR *name;
+	const CHR *path;
+	struct hzfile file;
+	struct hzpackentry entry;
+	U8 *compressed; /* NULL if it's stored as is */
+	struct input *same; /* An earlier input with the same contents, whose payload we share */
+};
+
+static INAT by_hash(const X0 *a, const X0 *b)
+{
+	const struct input *ia = a, *ib = b;
+	return (ia->entry.hash > ib->entry.hash) - (ia->entry.hash < ib->entry.hash);
+}
+
+static U64 align(U64 n, U64 to)
+{
+	return (n + to - 1) / to * to;
+}
+
+static U1 write_at(FILE *f, U64 offset, const X0 *data, size_t size)
+{
+	static const U8 zero[HZ_PACK_ALIGN] = { 0 };
+	/* Everything is written in order, so getting to `offset` is just padding */
+	for (long pos = ftell(f); pos >= 0 && (U64)pos < offset; pos = ftell(f)) {
+		size_t pad = offset - pos < sizeof(zero) ? offset - pos : sizeof(zero);
+		if (fwrite(zero, pad, 1, f) != 1) return false;
+	}
+	return !size || fwrite(data, size, 1, f) == 1;
+}
+
+static U1 pack(const CHR *out, struct input *in, U32 count, U1 compress)
+{
+	U64 names_size = 0, raw = 0, stored = 0;
+	U32 compressed = 0, shared = 0;
+
+	for (U32 i = 0; i < count; i++) {
+		struct hzpackentry *e = &in[i].entry;
+		e->hash = hz_pack_hash(in[i].name, strlen(in[i].name));
+		e->content = hz_pack_hash(in[i].file.data, in[i].file.size);
+		e->size = e->stored_size = in[i].file.size;
+		e->name = names_size;
+		names_size += strlen(in[i].name) + 1;
+		raw += e->size;
+
+		for (U32 j = 0; j < i && !in[i].same; j++) {
+			if (in[j].entry.content == e->content && in[j].file.size == in[i].file.size
+				&& !memcmp(in[j].file.data, in[i].file.data, in[i].file.size)) in[i].same = &in[j];
+		}
+		if (in[i].same) {
+			shared++;
+			continue;
+		}
+
+		if (compress) {
+			size_t bound = hz_lz_bound(e->size), size;
+			in[i].compressed = malloc(bound);
+			if (!in[i].compressed) {
+				fprintf(stderr, "hz_pack: out of memory compressing %s\n", in[i].path);
+				return false;
+			}
+			size = hz_lz_compress(in[i].file.data, e->size, in[i].compressed, bound);
+			if (size && size <= e->size - e->size / 8) {
+				e->stored_size = size;
+				e->flags |= HZ_PACK_LZ;
+				compressed++;
+			} else {
+				free(in[i].compressed);
+				in[i].compressed = NULL;
+			}
+		}
+	}
+
+	/* Lay it all out: buckets big enough for about one entry each, then the entries, names and payloads */
+	U32 bits = 0;
+	while (bits < 24 && (1u << bits) < count) bits++;
+	U64 entries_offset = align(sizeof(struct hzpackheader) + (((U64)1 << bits) + 1) * 4, 8);
+	U64 names_offset = entries_offset + (U64)count * sizeof(struct hzpackentry);
+	U64 offset = names_offset + names_size;
+	for (U32 i = 0; i < count; i++) {
+		if (in[i].same) continue;
+		offset = align(offset, HZ_PACK_ALIGN);
+		in[i].entry.offset = offset;
+		offset += in[i].entry.stored_size;
+		stored += in[i].entry.stored_size;
+	}
+	for (U32 i = 0; i < count; i++) {
+		if (!in[i].same) continue;
+		in[i].entry.offset = in[i].same->entry.offset;
+		in[i].entry.stored_size = in[i].same->entry.stored_size;
+		in[i].entry.flags = in[i].same->entry.flags;
+	}
+
+	/* Payloads go out in input order, the table in hash order. Sort a copy so `same` still points the right way. */
+	struct input *sorted = malloc(count * sizeof(*sorted));
+	U32 *buckets = calloc(((size_t)1 << bits) + 1, sizeof(U32));
+	if (!sorted || !buckets) {
+		fprintf(stderr, "hz_pack: out of memory\n");
+		free(sorted);
+		free(buckets);
+		return false;
+	}
+	memcpy(sorted, in, count * sizeof(*sorted));
+	qsort(sorted, count, sizeof(*sorted), by_hash);
+	for (U32 i = 1; i < count; i++) {
+		if (sorted[i].entry.hash == sorted[i - 1].entry.hash) {
+			fprintf(stderr, "hz_pack: %s and %s have the same name hash, rename one\n", sorted[i - 1].name,
+				sorted[i].name);
+			free(sorted);
+			free(buckets);
+			return false;
+		}
+	}
+	/* buckets[b] is the first entry whose hash starts with b, so bucket b runs up to buckets[b + 1] */
+	for (U32 b = 0, i = 0; b <= (1u << bits); b++) {
+		while (i < count && (bits ? sorted[i].entry.hash >> (64 - bits) : 0) < b) i++;
+		buckets[b] = i;
+	}
+	buckets[1u << bits] = count;
+
+	struct hzpackheader header = {
+		.magic = HZ_PACK_MAGIC,
+		.version = HZ_PACK_VERSION,
+		.entries = count,
+		.bucket_bits = bits,
+		.names_offset = names_offset,
+		.names_size = names_size,
+	};
+
+	FILE *f = fopen(out, "wb");
+	if (!f) {
+		fprintf(stderr, "hz_pack: unable to open %s for writing: %s\n", out, strerror(errno));
+		free(sorted);
+		free(buckets);
+		return false;
+	}
+	U1 ok = write_at(f, 0, &header, sizeof(header))
+		&& write_at(f, sizeof(header), buckets, (((size_t)1 << bits) + 1) * sizeof(U32));
+	for (U32 i = 0; ok && i < count; i++) {
+		ok = write_at(f, entries_offset + (U64)i * sizeof(struct hzpackentry), &sorted[i].entry,
+			sizeof(struct hzpackentry));
+	}
+	for (U32 i = 0; ok && i < count; i++) {
+		ok = write_at(f, names_offset + in[i].entry.name, in[i].name, strlen(in[i].name) + 1);
+	}
+	for (U32 i = 0; ok && i < count; i++) {
+		if (in[i].same) continue;
+		ok = write_at(f, in[i].entry.offset, in[i].compressed ? in[i].compressed : in[i].file.data,
+			in[i].entry.stored_size);
+	}
+	if (fclose(f) != 0) ok = false;
+	free(sorted);
+	free(buckets);
+
+	if (!ok) {
+		fprintf(stderr, "hz_pack: unable to write %s: %s\n", out, strerror(errno));
+		return false;
+	}
+	printf("%s: %u file%s, %llu bytes of assets in %llu bytes of payload (%u compressed, %u shared)\n", out, count,
+		count == 1 ? "" : "s", (unsigned long long)raw, (unsigned long long)stored, compressed, shared);
+	return true;
+}
+
+INAT main(INAT argc, CHR *argv[])
+{
+	U1 compress = false;
+	const CHR *out = NULL;
+	struct input *in = calloc(argc, sizeof(*in));
+	U32 count = 0;
+	if (!in) return EXIT_FAILURE;
+
+	for (INAT i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--compress")) {
+			compress = true;
+		} else if (argv[i][0] == '-') {
+			out = NULL;
+			break;
+		} else if (!out) {
+			out = argv[i];
+		} else {
+			CHR *eq = strchr(argv[i], '=');
+			in[count].name = argv[i];
+			in[count].path = argv[i];
+			if (eq) {
+				*eq = '\0';
+				in[count].path = eq + 1;
+			}
+			count++;
+		}
+	}
+	if (!out || !count) {
+		fprintf(stderr, "usage: %s [--compress] OUTPUT [NAME=]FILE...\n", argv[0]);
+		free(in);
+		return EXIT_FAILURE;
+	}
+
+	U1 ok = true;
+	for (U32 i = 0; ok && i < count; i++) {
+		for (U32 j = 0; ok && j < i; j++) {
+			if (!strcmp(in[i].name, in[j].name)) {
+				fprintf(stderr, "hz_pack: %s is in there twice\n", in[i].name);
+				ok = false;
+			}
+		}
+		/* Empty files can't be mapped, and aren't worth packing */
+		if (ok) ok = hz_file_map(&in[i].file, in[i].path, HZ_FILE_SEQUENTIAL);
+	}
+	if (ok) ok = pack(out, in, count, compress);
+
+	for (U32 i = 0; i < count; i++) {
+		if (in[i].file.data) hz_file_unmap(&in[i].file);
+		free(in[i].compressed);
+	}
+	free(in);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,157 @@
+/* Texture cooker. Decodes an image once, offline, and writes it out as a KTX file (see hz_ktx.h) holding the whole
+ * mip chain, already in the layout GL wants. hz_texture_load() then uploads the levels straight out of a memory
+ * mapping, so loading a cooked texture costs about as much as reading the file.
+ *
+ *   hz_texcook [--srgb] [--no-mips] [--kaiser] [--compress=bc1|bc3|bc7] INPUT OUTPUT
+ *
+ * Output is RGBA8 by default: GL_RGBA8, or GL_SRGB8_ALPHA8 with --srgb (in which case the mips are filtered in linear
+ * light). The demos don't render in sRGB, so their textures want the default. --no-mips writes the base level only,
+ * and the loader falls back to glGenerateMipmap(). --kaiser filters the mips with a Kaiser windowed sinc instead of a
+ * box (see hz_mip.h), which keeps them sharper. --compress block compresses every level (see hz_bc.h) and prints
+ * how much VRAM that saves and the PSNR of the base level.
+ */
+#include "holyh/src/holy.h"
+#include "hz_bc.h"
+#include "hz_file.h"
+#include "hz_jobs.h"
+#include "hz_ktx.h"
+#include "hz_mip.h"
+#include "hz_stbi.h"
+#include "stb_image.h"
+#include <GL/glew.h>
+#include <limits.h>
+
+/* Keeps the biggest level's byte count well inside a U32, which is what KTX stores it in */
+#define TEXCOOK_MAX_SIZE 16384
+
+/* Replaces the RGBA8 levels in `k` with compressed ones, in `blocks` */
+static X0 compress(struct hzktx *k, enum hzbcformat format, U1 srgb, U8 *blocks, const CHR *name)
+{
+	size_t before = 0, after = 0;
+	R64 psnr = 0.0;
+	for (U32 i = 0, lw = k->width, lh = k->height; i < k->levels; i++) {
+		size_t size = hz_bc_size(format, lw, lh);
+		hz_bc_compress(format, k->level_data[i], lw, lh, blocks);
+		if (!i) psnr = hz_bc_psnr(format, k->level_data[i], lw, lh, blocks);
+		before += k->level_size[i];
+		after += size;
+		k->level_data[i] = blocks;
+		k->level_size[i] = size;
+		blocks += size;
+		lw = hz_mip_next_size(lw);
+		lh = hz_mip_next_size(lh);
+	}
+
+	k->gl_type = 0;
+	k->gl_format = 0;
+	k->gl_internal_format = hz_bc_gl_format(format, srgb);
+	k->gl_base_internal_format = format == HZ_BC1 ? GL_RGB : GL_RGBA;
+	printf("%s: %s, %zu KiB instead of %zu KiB of RGBA8 (%.1fx smaller), PSNR %.2f dB\n", name, hz_bc_name(format),
+		after / 1024, before / 1024, (R64)before / after, psnr);
+}
+
+static U1 cook(const CHR *in, const CHR *out, U1 srgb, U1 mips, UNAT mip_flags, INAT format)
+{
+	INAT w, h, comp;
+	struct hzfile f;
+	if (!hz_file_map(&f, in, HZ_FILE_SEQUENTIAL | HZ_FILE_WILLNEED_LARGE)) return false;
+	if (f.size > INT_MAX || !stbi_info_from_memory(f.data, f.size, &w, &h, &comp)) {
+		fprintf(stderr, "texcook: unable to load %s: %s\n", in, f.size > INT_MAX ? "File too large" :
+			stbi_failure_reason());
+		hz_file_unmap(&f);
+		return false;
+	}
+	if (w > TEXCOOK_MAX_SIZE || h > TEXCOOK_MAX_SIZE) {
+		fprintf(stderr, "texcook: %s is %dx%d, the limit is %d on either side\n", in, w, h, TEXCOOK_MAX_SIZE);
+		hz_file_unmap(&f);
+		return false;
+	}
+
+	struct hzktx k = {
+		.gl_type = GL_UNSIGNED_BYTE,
+		.gl_type_size = 1,
+		.gl_format = GL_RGBA,
+		.gl_internal_format = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8,
+		.gl_base_internal_format = GL_RGBA,
+		.width = w,
+		.height = h,
+		.levels = mips ? hz_ktx_mip_count(w, h) : 1,
+	};
+
+	/* Every level in one allocation, back to back, and room for the compressed ones after them. RGBA8 rows never need
+	 * padding.
+	 */
+	size_t total = hz_mip_chain_size(w, h, k.levels), compressed = 0;
+	for (U32 i = 0, lw = w, lh = h; i < k.levels; i++, lw = hz_mip_next_size(lw), lh = hz_mip_next_size(lh)) {
+		k.level_size[i] = lw * lh * 4;
+		if (format >= 0) compressed += hz_bc_size(format, lw, lh);
+	}
+	U8 *pixels = malloc(total + compressed);
+	if (!pixels) {
+		fprintf(stderr, "texcook: out of memory cooking %s\n", in);
+		hz_file_unmap(&f);
+		return false;
+	}
+
+	/* KTX levels are bottom row first, same as GL */
+	stbi_set_flip_vertically_on_load(1);
+	U1 ok = hz_stbi_load_from_memory_into(f.data, f.size, pixels, k.level_size[0], w * 4, &w, &h, &comp, 4);
+	hz_file_unmap(&f);
+	if (!ok) {
+		fprintf(stderr, "texcook: unable to load %s: %s\n", in, stbi_failure_reason());
+		free(pixels);
+		return false;
+	}
+
+	if (!hz_mip_chain(pixels, w, h, k.levels, mip_flags | (srgb ? HZ_MIP_SRGB : 0))) {
+		fprintf(stderr, "texcook: out of memory building the mips of %s\n", in);
+		free(pixels);
+		return false;
+	}
+	U8 *level = pixels;
+	for (U32 i = 0; i < k.levels; i++) {
+		k.level_data[i] = level;
+		level += k.level_size[i];
+	}
+	if (format >= 0) {
+		compress(&k, format, srgb, pixels + total, out);
+		total = compressed;
+	}
+
+	ok = hz_ktx_write(&k, out);
+	if (ok) {
+		printf("%s: %dx%d (%d channel%s), %u level%s, internal format 0x%x, %zu bytes\n", out, w, h, comp,
+			comp == 1 ? "" : "s", k.levels, k.levels == 1 ? "" : "s", k.gl_internal_format, total);
+	}
+	free(pixels);
+	return ok;
+}
+
+INAT main(INAT argc, CHR *argv[])
+{
+	const CHR *paths[2];
+	INAT npaths = 0;
+	U1 srgb = false, mips = true;
+	UNAT mip_flags = 0;
+	INAT format = -1;
+
+	for (INAT i = 1; i < argc; i++) {
+		enum hzbcformat bc;
+		if (!strcmp(argv[i], "--srgb")) srgb = true;
+		else if (!strcmp(argv[i], "--no-mips")) mips = false;
+		else if (!strcmp(argv[i], "--kaiser")) mip_flags |= HZ_MIP_KAISER;
+		else if (!strncmp(argv[i], "--compress=", 11) && hz_bc_parse(argv[i] + 11, &bc)) format = bc;
+		else if (argv[i][0] != '-' && npaths < 2) paths[npaths++] = argv[i];
+		else npaths = 3;
+	}
+	if (npaths != 2) {
+		fprintf(stderr, "usage: %s [--srgb] [--no-mips] [--kaiser] [--compress=bc1|bc3|bc7] INPUT OUTPUT\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* Compression is the slow part, give it every CPU */
+	hz_jobs_init(0);
+	U1 ok = cook(paths[0], paths[1], srgb, mips, mip_flags, format);
+	hz_jobs_shutdown();
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}